@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "Dataset.hpp"
+#include "Random.hpp"
+#include "Shuffle.hpp"
+
+static const char* const USAGE =
+    "Usage:\n\tDatasetGenerator <output> [--rows <count>] [--seed <seed>]\n"
+    "Description:\n\tWrites a dataset file (modules/Dataset) with benchmark inputs:\n"
+    "\tuniform_int32, sorted_int32, duplicates_int32, shuffled_uint64 and uniform_float64.\n";
+
+static bool
+parseNumber(const char* text, uint64_t& value)
+{
+    char* end = nullptr;
+    value = std::strtoull(text, &end, 10);
+    return end != text && *end == '\0';
+}
+
+int
+main(int argc, const char* argv[])
+{
+    std::string output;
+    uint64_t rows = 1 << 20;
+    uint64_t seed = 42;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if ((arg == "--rows" || arg == "--seed") && i + 1 < argc)
+        {
+            if (!parseNumber(argv[++i], arg == "--rows" ? rows : seed))
+            {
+                std::cerr << "invalid number: " << argv[i] << "\n" << USAGE;
+                return 1;
+            }
+        }
+        else if (output.empty() && arg[0] != '-')
+            output = arg;
+        else
+        {
+            std::cerr << USAGE;
+            return 1;
+        }
+    }
+    if (output.empty())
+    {
+        std::cerr << USAGE;
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const size_t count = static_cast<size_t>(rows);
+    ct::Xoshiro256StarStar generator(seed);
+
+    std::vector<int32_t> uniform(count);
+    for (auto& value : uniform)
+        value = ct::uniformInt<int32_t>(generator, -1000000, 1000000);
+
+    std::vector<int32_t> sorted = uniform;
+    std::sort(sorted.begin(), sorted.end());
+
+    // About 16 copies of every value.
+    const auto distinct = static_cast<int32_t>(std::max<size_t>(1, count / 16));
+    std::vector<int32_t> duplicates(count);
+    for (auto& value : duplicates)
+        value = ct::uniformInt<int32_t>(generator, 0, distinct - 1);
+
+    std::vector<uint64_t> shuffled(count);
+    std::iota(shuffled.begin(), shuffled.end(), uint64_t{ 0 });
+    ct::shuffle(shuffled.begin(), shuffled.end(), generator);
+
+    std::vector<double> real(count);
+    for (auto& value : real)
+        value = ct::uniformReal(generator);
+
+    ct::DatasetWriter writer;
+    writer.addColumn("uniform_int32", uniform);
+    writer.addColumn("sorted_int32", sorted);
+    writer.addColumn("duplicates_int32", duplicates);
+    writer.addColumn("shuffled_uint64", shuffled);
+    writer.addColumn("uniform_float64", real);
+
+    std::string error;
+    if (!writer.write(output, &error))
+    {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    // Read it back, the file must pass all checks.
+    auto dataset = ct::Dataset::open(output, ct::Dataset::Verify::All, &error);
+    if (dataset == nullptr)
+    {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << output << ": " << dataset->fileSize() << " bytes, " << seconds << " s\n";
+    for (const auto& column : dataset->columns())
+        std::cout << "\t" << column.name << " " << ct::dataset::typeName(column.type) << "[" << column.count << "] at " << column.offset << "\n";
+    return 0;
+}
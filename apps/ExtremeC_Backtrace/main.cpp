@@ -43,7 +43,9 @@ createCrash()
 {
     std::cout << "nullPointer" << std::endl;
 
-    TemplateClass<float>* myVector = nullptr;
+    // volatile hides the null pointer from the optimizer, GCC 12 warns about the deliberate
+    // dereference otherwise (-Wstringop-overflow in Release).
+    TemplateClass<float>* volatile myVector = nullptr;
     if (myVector == nullptr)
         std::cout << "is null: " << std::endl;
 
@@ -54,6 +56,9 @@ createCrash()
 int
 main(int argc, const char* argv[])
 {
+    CT_UNUSED(argc);
+    CT_UNUSED(argv);
+
     signal(SIGSEGV, handler);   // install our handler
     std::cout << HEADER;
 
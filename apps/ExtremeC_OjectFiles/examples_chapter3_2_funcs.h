@@ -4,8 +4,36 @@
 #ifndef EXTREME_C_EXAMPLES_CHAPTER_3_2_H
 #define EXTREME_C_EXAMPLES_CHAPTER_3_2_H
 
+#include <stddef.h>
+
+// Keep C linkage when the header is included from C++ (tests and benchmarks).
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 int max(int a, int b);
 
 int max_3(int a, int b, int c);
 
+// Array kernels, see examples_chapter3_2_kernels.c.
+// The same results as calling 'max' and 'max_3' in a loop, but branchless and
+// vectorized (SSE2/SSE4.1/AVX2) with a scalar tail.
+
+// Largest element of 'a'. Returns INT_MIN / -INFINITY when 'n' is 0.
+// NaN elements are skipped.
+int max_reduce_i32(const int* a, size_t n);
+float max_reduce_f32(const float* a, size_t n);
+
+// out[i] = max_3(a[i], b[i], c[i]). 'out' may alias any of the inputs.
+void max_n_i32(const int* a, const int* b, const int* c, int* out, size_t n);
+void max_n_f32(const float* a, const float* b, const float* c, float* out, size_t n);
+
+// out[i] = a[i] clamped to [lo, hi]. Expects lo <= hi. 'out' may alias 'a'.
+void clamp_n_i32(const int* a, int lo, int hi, int* out, size_t n);
+void clamp_n_f32(const float* a, float lo, float hi, float* out, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,237 @@
+// File name: examples_chapter3_2_kernels.c
+// Description: Array versions of 'max' and 'max_3'. Branchless and vectorized.
+//
+// The vector width is chosen at compile time. Default x86-64 builds use SSE2,
+// -DCPPTRAINING_ENABLE_NATIVE_ARCH=ON enables SSE4.1 (pmaxsd) and AVX/AVX2 (vmaxps).
+// Elements which do not fill a full register are done by a scalar tail.
+
+#include <limits.h>
+#include <math.h>
+
+#include "examples_chapter3_2_funcs.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define EXAMPLES_KERNELS_SSE2 1
+#endif
+
+// Scalar helpers, no branches. Same results as 'max'.
+static inline int max_scalar_i32(int a, int b) {
+  return a ^ ((a ^ b) & -(a < b));
+}
+
+static inline int min_scalar_i32(int a, int b) {
+  return b ^ ((a ^ b) & -(a < b));
+}
+
+// maxss/minss have the same semantics as the ternary, so the compiler does not branch.
+static inline float max_scalar_f32(float a, float b) {
+  return a > b ? a : b;
+}
+
+static inline float min_scalar_f32(float a, float b) {
+  return a < b ? a : b;
+}
+
+#if defined(EXAMPLES_KERNELS_SSE2)
+
+// pmaxsd/pminsd are SSE4.1, emulate them with compare and blend on plain SSE2.
+static inline __m128i max_epi32(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  return _mm_max_epi32(a, b);
+#else
+  __m128i gt = _mm_cmpgt_epi32(a, b);
+  return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+#endif
+}
+
+static inline __m128i min_epi32(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  return _mm_min_epi32(a, b);
+#else
+  __m128i gt = _mm_cmpgt_epi32(a, b);
+  return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+#endif
+}
+
+static inline int hmax_epi32(__m128i v) {
+  v = max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(v);
+}
+
+static inline float hmax_ps(__m128 v) {
+  v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(v);
+}
+
+#endif
+
+int max_reduce_i32(const int* a, size_t n) {
+  size_t i = 0;
+  int m = INT_MIN;
+
+#if defined(__AVX2__)
+  if (n >= 8) {
+    // Two accumulators hide the latency of vpmaxsd.
+    __m256i acc0 = _mm256_set1_epi32(INT_MIN);
+    __m256i acc1 = acc0;
+    for (; i + 16 <= n; i += 16) {
+      acc0 = _mm256_max_epi32(acc0, _mm256_loadu_si256((const __m256i*)(a + i)));
+      acc1 = _mm256_max_epi32(acc1, _mm256_loadu_si256((const __m256i*)(a + i + 8)));
+    }
+    for (; i + 8 <= n; i += 8)
+      acc0 = _mm256_max_epi32(acc0, _mm256_loadu_si256((const __m256i*)(a + i)));
+    acc0 = _mm256_max_epi32(acc0, acc1);
+    m = hmax_epi32(max_epi32(_mm256_castsi256_si128(acc0), _mm256_extracti128_si256(acc0, 1)));
+  }
+#elif defined(EXAMPLES_KERNELS_SSE2)
+  if (n >= 4) {
+    __m128i acc0 = _mm_set1_epi32(INT_MIN);
+    __m128i acc1 = acc0;
+    for (; i + 8 <= n; i += 8) {
+      acc0 = max_epi32(acc0, _mm_loadu_si128((const __m128i*)(a + i)));
+      acc1 = max_epi32(acc1, _mm_loadu_si128((const __m128i*)(a + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4)
+      acc0 = max_epi32(acc0, _mm_loadu_si128((const __m128i*)(a + i)));
+    m = hmax_epi32(max_epi32(acc0, acc1));
+  }
+#endif
+
+  for (; i < n; i++)
+    m = max_scalar_i32(a[i], m);
+  return m;
+}
+
+float max_reduce_f32(const float* a, size_t n) {
+  size_t i = 0;
+  float m = -INFINITY;
+
+  // maxps returns the second operand for NaN, keeping the accumulator
+  // second skips NaN elements the same way as the scalar tail.
+#if defined(__AVX__)
+  if (n >= 8) {
+    __m256 acc0 = _mm256_set1_ps(-INFINITY);
+    __m256 acc1 = acc0;
+    for (; i + 16 <= n; i += 16) {
+      acc0 = _mm256_max_ps(_mm256_loadu_ps(a + i), acc0);
+      acc1 = _mm256_max_ps(_mm256_loadu_ps(a + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8)
+      acc0 = _mm256_max_ps(_mm256_loadu_ps(a + i), acc0);
+    acc0 = _mm256_max_ps(acc0, acc1);
+    m = hmax_ps(_mm_max_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1)));
+  }
+#elif defined(EXAMPLES_KERNELS_SSE2)
+  if (n >= 4) {
+    __m128 acc0 = _mm_set1_ps(-INFINITY);
+    __m128 acc1 = acc0;
+    for (; i + 8 <= n; i += 8) {
+      acc0 = _mm_max_ps(_mm_loadu_ps(a + i), acc0);
+      acc1 = _mm_max_ps(_mm_loadu_ps(a + i + 4), acc1);
+    }
+    for (; i + 4 <= n; i += 4)
+      acc0 = _mm_max_ps(_mm_loadu_ps(a + i), acc0);
+    m = hmax_ps(_mm_max_ps(acc0, acc1));
+  }
+#endif
+
+  for (; i < n; i++)
+    m = max_scalar_f32(a[i], m);
+  return m;
+}
+
+void max_n_i32(const int* a, const int* b, const int* c, int* out, size_t n) {
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    __m256i temp = _mm256_max_epi32(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                    _mm256_loadu_si256((const __m256i*)(b + i)));
+    temp = _mm256_max_epi32(_mm256_loadu_si256((const __m256i*)(c + i)), temp);
+    _mm256_storeu_si256((__m256i*)(out + i), temp);
+  }
+#endif
+#if defined(EXAMPLES_KERNELS_SSE2)
+  for (; i + 4 <= n; i += 4) {
+    __m128i temp = max_epi32(_mm_loadu_si128((const __m128i*)(a + i)),
+                             _mm_loadu_si128((const __m128i*)(b + i)));
+    temp = max_epi32(_mm_loadu_si128((const __m128i*)(c + i)), temp);
+    _mm_storeu_si128((__m128i*)(out + i), temp);
+  }
+#endif
+
+  for (; i < n; i++)
+    out[i] = max_scalar_i32(c[i], max_scalar_i32(a[i], b[i]));
+}
+
+void max_n_f32(const float* a, const float* b, const float* c, float* out, size_t n) {
+  size_t i = 0;
+
+  // Operand order follows max_3: temp = a > b ? a : b; c > temp ? c : temp.
+#if defined(__AVX__)
+  for (; i + 8 <= n; i += 8) {
+    __m256 temp = _mm256_max_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+    _mm256_storeu_ps(out + i, _mm256_max_ps(_mm256_loadu_ps(c + i), temp));
+  }
+#endif
+#if defined(EXAMPLES_KERNELS_SSE2)
+  for (; i + 4 <= n; i += 4) {
+    __m128 temp = _mm_max_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+    _mm_storeu_ps(out + i, _mm_max_ps(_mm_loadu_ps(c + i), temp));
+  }
+#endif
+
+  for (; i < n; i++)
+    out[i] = max_scalar_f32(c[i], max_scalar_f32(a[i], b[i]));
+}
+
+void clamp_n_i32(const int* a, int lo, int hi, int* out, size_t n) {
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i lo8 = _mm256_set1_epi32(lo);
+  const __m256i hi8 = _mm256_set1_epi32(hi);
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(a + i));
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_min_epi32(_mm256_max_epi32(v, lo8), hi8));
+  }
+#endif
+#if defined(EXAMPLES_KERNELS_SSE2)
+  const __m128i lo4 = _mm_set1_epi32(lo);
+  const __m128i hi4 = _mm_set1_epi32(hi);
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(a + i));
+    _mm_storeu_si128((__m128i*)(out + i), min_epi32(max_epi32(v, lo4), hi4));
+  }
+#endif
+
+  for (; i < n; i++)
+    out[i] = min_scalar_i32(max_scalar_i32(a[i], lo), hi);
+}
+
+void clamp_n_f32(const float* a, float lo, float hi, float* out, size_t n) {
+  size_t i = 0;
+
+#if defined(__AVX__)
+  const __m256 lo8 = _mm256_set1_ps(lo);
+  const __m256 hi8 = _mm256_set1_ps(hi);
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(a + i);
+    _mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_max_ps(v, lo8), hi8));
+  }
+#endif
+#if defined(EXAMPLES_KERNELS_SSE2)
+  const __m128 lo4 = _mm_set1_ps(lo);
+  const __m128 hi4 = _mm_set1_ps(hi);
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(a + i);
+    _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(v, lo4), hi4));
+  }
+#endif
+
+  for (; i < n; i++)
+    out[i] = min_scalar_f32(max_scalar_f32(a[i], lo), hi);
+}
@@ -6,7 +6,10 @@
 #include <stdio.h>
 #include <mutex>
 
-template <typename Scalar>
+#include "Precision.hpp"
+
+// Precision: how length() and normalize() take the root, see Precision.hpp.
+template <typename Scalar, typename Precision = ct::precision::Exact>
 class TemplateClass
 {
 public:
@@ -18,7 +21,7 @@ public:
         // std::lock_guard<std::mutex> l(mutex);
         ++timesCalled;
         std::cout << "TemplateClass::length() const " << timesCalled << " - ";
-        return std::sqrt(x * x + y * y + z * z);
+        return Precision::length(x * x + y * y + z * z);
     }
 
     Scalar length()
@@ -26,7 +29,15 @@ public:
         // std::lock_guard<std::mutex> l(mutex);
         ++timesCalled;
         std::cout << "TemplateClass::length() " << timesCalled << " - ";
-        return std::sqrt(x * x + y * y + z * z);
+        return Precision::length(x * x + y * y + z * z);
+    }
+
+    void normalize()
+    {
+        const Scalar inverse = Precision::inverseLength(x * x + y * y + z * z);
+        x *= inverse;
+        y *= inverse;
+        z *= inverse;
     }
 
     // What compiler does here? Compiler creates name mangled free function.
@@ -7,9 +7,14 @@
 #include <utility>
 
 #include "Macros.hpp"
+#include "SpscQueue.hpp"
 #include "ClassOne.hpp"
 #include "TemplateClass.hpp"
 
+#if defined(CPPTRAINING_COROUTINES)
+#include "Executor.hpp"
+#endif
+
 using namespace std;
 
 // TODO integrate google test instead.
@@ -72,6 +77,36 @@ constFunction()
     std::cout << "length = " << myVector2.length() << '\n';
 }
 
+#if defined(CPPTRAINING_COROUTINES)
+
+/**
+ * refresh_thread as a coroutine, sleeps in the executor's timer queue instead of blocking a thread.
+ */
+static ct::Task<float>
+refreshLength(ct::Executor& executor, size_t i)
+{
+    co_await executor.sleepFor(std::chrono::milliseconds(10));
+    std::cout << "refresh_thread" << std::endl;
+    const TemplateClass<float> vector{ float(i), 5, 5 };
+    co_return vector.length();
+}
+
+/**
+ * refresh_thread2 as a coroutine, suspended while the next length is produced.
+ */
+static ct::Task<>
+refreshLoop(ct::Executor& executor, size_t loops)
+{
+    for (size_t i = 0; i < loops; i++)
+    {
+        const float length = co_await refreshLength(executor, i);
+        std::cout << "refresh_thread2 length = " << length << std::endl;
+        constFunction();
+    }
+}
+
+#endif
+
 int
 main(int argc, const char* argv[])
 {
@@ -96,34 +131,42 @@ main(int argc, const char* argv[])
     {
         validExpression();
 
+        // refresh_thread produces lengths, refresh_thread2 consumes and prints them, both call constFunction().
+        constexpr size_t loops = 4;
+#if defined(CPPTRAINING_COROUTINES)
+        ct::Executor executor(1);
+        executor.run(refreshLoop(executor, loops));
+#else
+        ct::SpscQueue<float> lengths(loops);
+
         std::thread refresh_thread = std::thread(
             [&]() {
                 std::chrono::milliseconds time(10);
-                size_t loops = 4;
-                while (loops > 0)
+                for (size_t i = 0; i < loops; i++)
                 {
                     std::this_thread::sleep_for(time);
                     std::cout << "refresh_thread" << std::endl;
+                    // Both threads read the static vectors of constFunction() concurrently.
                     constFunction();
-                    --loops;
+                    const TemplateClass<float> vector{ float(i), 5, 5 };
+                    lengths.push(vector.length());
                 }
             });
 
         std::thread refresh_thread2 = std::thread(
             [&]() {
-                std::chrono::milliseconds time(10);
-                size_t loops = 4;
-                while (loops > 0)
+                // Sleeps in the queue until the producer pushes, no polling with sleep_for.
+                for (size_t i = 0; i < loops; i++)
                 {
-                    std::this_thread::sleep_for(time);
-                    std::cout << "refresh_thread2" << std::endl;
+                    const float length = lengths.pop();
+                    std::cout << "refresh_thread2 length = " << length << std::endl;
                     constFunction();
-                    --loops;
                 }
             });
 
         refresh_thread.join();
         refresh_thread2.join();
+#endif
     }
 
     std::cout << "\nProgram finished successfully!\n";
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace ct {
+
+namespace fixture {
+
+constexpr size_t cacheLine = 64;
+
+// Evicts [data, data + size) from all cache levels.
+inline void
+flushFromCache(const void* data, size_t size)
+{
+#if defined(__SSE2__)
+    const auto* first = static_cast<const unsigned char*>(data);
+    for (size_t offset = 0; offset < size; offset += cacheLine)
+        _mm_clflush(first + offset);
+    _mm_mfence();
+#else
+    // No flush instruction, stream a buffer larger than the last level cache over it.
+    static std::vector<unsigned char> eviction(64 << 20);
+    for (size_t offset = 0; offset < eviction.size(); offset += cacheLine)
+        eviction[offset]++;
+    benchmark::DoNotOptimize(eviction.data());
+    (void)data;
+    (void)size;
+#endif
+}
+
+}
+
+/**
+ * Input data of a benchmark which modifies it (sort, unique, nth_element, ...).
+ * Copying the dataset into a new std::vector in the timed loop measures malloc and page faults
+ * next to the algorithm, PauseTiming/ResumeTiming costs more than a small algorithm.
+ * The fixture allocates the working vector once, writes all its pages and reset() copies
+ * the dataset back into the same memory (memmove, the capacity never changes):
+ *
+ *     ct::BenchmarkFixture<int> data(state, sortData);
+ *     for (auto _ : state)
+ *     {
+ *         std::vector<int>& v = data.reset();
+ *         std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+ *     }
+ *     data.stop();
+ *
+ * The algorithm may erase from the vector, it must not grow it past the dataset size.
+ * The constructor measures the cost of reset() on its own, stop() reports it as the 'setup_ns'
+ * counter and the rest of an iteration as 'algorithm_ns'. CacheState::Cold flushes the data
+ * from the caches after every reset(), the algorithm then reads it from memory.
+ */
+template <typename T>
+class BenchmarkFixture
+{
+    static_assert(std::is_trivially_copyable_v<T>, "the dataset is restored with memmove");
+
+public:
+    enum class CacheState
+    {
+        Warm,
+        Cold,
+    };
+
+    BenchmarkFixture(benchmark::State& _state, std::vector<T> _dataset, CacheState _cache = CacheState::Warm)
+        : state(_state), cache(_cache), source(std::move(_dataset)), work(source.size())
+    {
+        setupNs = measureSetup();
+    }
+
+    ~BenchmarkFixture() { stop(); }
+
+    BenchmarkFixture(const BenchmarkFixture&) = delete;
+    BenchmarkFixture& operator=(const BenchmarkFixture&) = delete;
+
+    // Restores the dataset, call it at the start of every iteration.
+    std::vector<T>& reset()
+    {
+        if (resets++ == 0)
+            firstReset = Clock::now();
+        return restore();
+    }
+
+    void stop()
+    {
+        if (stopped)
+            return;
+        stopped = true;
+        if (resets == 0)
+            return;
+
+        const double iterationNs = std::chrono::duration<double, std::nano>(Clock::now() - firstReset).count() / static_cast<double>(resets);
+        state.counters["setup_ns"] = setupNs;
+        state.counters["algorithm_ns"] = std::max(0.0, iterationNs - setupNs);
+    }
+
+    // The working copy, as the algorithm left it.
+    std::vector<T>& get() { return work; }
+    const std::vector<T>& dataset() const { return source; }
+
+    // Estimated cost of one reset(), measured before the timed loop.
+    double setupNanoseconds() const { return setupNs; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<T>& restore()
+    {
+        work.assign(source.begin(), source.end());
+        if (cache == CacheState::Cold)
+            fixture::flushFromCache(work.data(), work.size() * sizeof(T));
+        benchmark::ClobberMemory();
+        return work;
+    }
+
+    // Repeats the reset until it took at least a millisecond.
+    double measureSetup()
+    {
+        size_t repetitions = 1;
+        for (;;)
+        {
+            const auto start = Clock::now();
+            for (size_t i = 0; i < repetitions; i++)
+                restore();
+            const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            if (ns >= 1e6 || repetitions >= (1u << 20))
+                return ns / static_cast<double>(repetitions);
+            repetitions *= 2;
+        }
+    }
+
+    benchmark::State& state;
+    CacheState cache;
+    std::vector<T> source;
+    std::vector<T> work;
+    double setupNs = 0.0;
+    size_t resets = 0;
+    Clock::time_point firstReset;
+    bool stopped = false;
+};
+
+}
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ct {
+
+/**
+ * Stream compaction: removeIf, remove and copyIf over contiguous arrays with the
+ * semantics of std::remove_if, std::remove and std::copy_if (return the new end).
+ *
+ * The std versions branch on the predicate for every element, with a predicate
+ * like "val % 2 != 0" on random data half of these branches are mispredicted.
+ * Here the input is processed in blocks of 64 elements:
+ *  1. the predicate is written into 64 flag bytes, a loop without branches
+ *     which the compiler vectorizes for simple predicates,
+ *  2. the flags become a 64 bit mask (movemask),
+ *  3. the kept elements are packed with a permute table (AVX2, 8 x 32 bit or 4 x 64 bit lanes)
+ *     or the compress instruction (AVX-512, 16 x 32 bit or 8 x 64 bit lanes).
+ * Without AVX2 step 3 walks the set bits of the mask, one branch per kept element
+ * instead of one unpredictable branch per element.
+ *
+ * The predicate is called exactly once per element in order, like the std algorithms.
+ * Elements must be trivially copyable, 4 and 8 byte types (int32_t, int64_t, float, double)
+ * use the SIMD path. SIMD is chosen at compile time, build with CPPTRAINING_ENABLE_NATIVE_ARCH.
+ */
+
+namespace compact {
+
+constexpr size_t blockSize = 64;
+
+inline unsigned
+popCount(uint64_t x)
+{
+#if defined(_MSC_VER)
+    return static_cast<unsigned>(__popcnt64(x));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(x));
+#endif
+}
+
+inline unsigned
+countTrailingZeros(uint64_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+}
+
+// For every 8 bit mask the lanes of the set bits packed to the front, one byte per lane.
+constexpr std::array<uint64_t, 256>
+makePermute32()
+{
+    std::array<uint64_t, 256> table{};
+    for (unsigned mask = 0; mask < 256; mask++)
+    {
+        uint64_t packed = 0;
+        unsigned kept = 0;
+        for (unsigned lane = 0; lane < 8; lane++)
+        {
+            if (mask & (1u << lane))
+                packed |= uint64_t{ lane } << (8 * kept++);
+        }
+        table[mask] = packed;
+    }
+    return table;
+}
+
+// The same for 4 x 64 bit lanes, every 64 bit lane is a pair of 32 bit lanes.
+constexpr std::array<uint64_t, 16>
+makePermute64()
+{
+    std::array<uint64_t, 16> table{};
+    for (unsigned mask = 0; mask < 16; mask++)
+    {
+        uint64_t packed = 0;
+        unsigned kept = 0;
+        for (unsigned lane = 0; lane < 4; lane++)
+        {
+            if (mask & (1u << lane))
+            {
+                packed |= uint64_t{ 2 * lane } << (8 * kept++);
+                packed |= uint64_t{ 2 * lane + 1 } << (8 * kept++);
+            }
+        }
+        table[mask] = packed;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint64_t, 256> permute32 = makePermute32();
+inline constexpr std::array<uint64_t, 16> permute64 = makePermute64();
+
+// Bit i is keep(first[i]), for a full block.
+template <typename T, typename Keep>
+uint64_t
+keepMask(const T* first, Keep& keep)
+{
+    alignas(64) uint8_t flags[blockSize];
+    for (size_t i = 0; i < blockSize; i++)
+        flags[i] = static_cast<uint8_t>(keep(first[i]) ? 1 : 0);
+
+#if defined(__AVX512BW__)
+    const __m512i v = _mm512_load_si512(reinterpret_cast<const void*>(flags));
+    return _mm512_test_epi8_mask(v, v);
+#elif defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i*>(flags));
+    const __m256i high = _mm256_load_si256(reinterpret_cast<const __m256i*>(flags + 32));
+    const uint32_t lowBits = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, zero)));
+    const uint32_t highBits = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, zero)));
+    return uint64_t{ lowBits } | (uint64_t{ highBits } << 32);
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t bits = 0;
+    for (size_t i = 0; i < blockSize; i += 16)
+    {
+        const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(flags + i));
+        bits |= uint64_t{ ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) & 0xffffu } << i;
+    }
+    return bits;
+#else
+    uint64_t bits = 0;
+    for (size_t i = 0; i < blockSize; i++)
+        bits |= uint64_t{ flags[i] } << i;
+    return bits;
+#endif
+}
+
+// Bit i is keep(first[i]), for the last block with less than 64 elements.
+template <typename T, typename Keep>
+uint64_t
+keepMaskTail(const T* first, size_t size, Keep& keep)
+{
+    uint64_t bits = 0;
+    for (size_t i = 0; i < size; i++)
+        bits |= uint64_t{ keep(first[i]) ? 1u : 0u } << i;
+    return bits;
+}
+
+// Copies in[i] for every set bit i to out, returns the number of copied elements.
+template <typename T>
+size_t
+compactBits(const T* in, uint64_t bits, T* out)
+{
+    size_t kept = 0;
+    for (; bits != 0; bits &= bits - 1)
+        out[kept++] = in[countTrailingZeros(bits)];
+    return kept;
+}
+
+/**
+ * compactBits() for a full block. When 'exact' is false the SIMD stores write whole vectors
+ * and may write up to one vector past the kept elements. In place (out <= in) that only
+ * overwrites elements of the block which were already loaded.
+ */
+template <bool exact, typename T>
+size_t
+compactBlock(const T* in, uint64_t bits, T* out)
+{
+#if defined(__AVX512F__)
+    if constexpr (sizeof(T) == 4)
+    {
+        size_t kept = 0;
+        for (size_t group = 0; group < blockSize; group += 16)
+        {
+            const __mmask16 mask = static_cast<__mmask16>(bits >> group);
+            const __m512i v = _mm512_maskz_compress_epi32(mask, _mm512_loadu_si512(reinterpret_cast<const void*>(in + group)));
+            const unsigned count = popCount(mask);
+            if constexpr (exact)
+                _mm512_mask_storeu_epi32(reinterpret_cast<void*>(out + kept), static_cast<__mmask16>((1u << count) - 1), v);
+            else
+                _mm512_storeu_si512(reinterpret_cast<void*>(out + kept), v);
+            kept += count;
+        }
+        return kept;
+    }
+    else if constexpr (sizeof(T) == 8)
+    {
+        size_t kept = 0;
+        for (size_t group = 0; group < blockSize; group += 8)
+        {
+            const __mmask8 mask = static_cast<__mmask8>(bits >> group);
+            const __m512i v = _mm512_maskz_compress_epi64(mask, _mm512_loadu_si512(reinterpret_cast<const void*>(in + group)));
+            const unsigned count = popCount(mask);
+            if constexpr (exact)
+                _mm512_mask_storeu_epi64(reinterpret_cast<void*>(out + kept), static_cast<__mmask8>((1u << count) - 1), v);
+            else
+                _mm512_storeu_si512(reinterpret_cast<void*>(out + kept), v);
+            kept += count;
+        }
+        return kept;
+    }
+    else
+        return compactBits(in, bits, out);
+#elif defined(__AVX2__)
+    if constexpr (sizeof(T) == 4)
+    {
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        size_t kept = 0;
+        for (size_t group = 0; group < blockSize; group += 8)
+        {
+            const unsigned mask = static_cast<unsigned>(bits >> group) & 0xffu;
+            const __m256i index = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(static_cast<long long>(permute32[mask])));
+            const __m256i v = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + group)), index);
+            const unsigned count = popCount(mask);
+            if constexpr (exact)
+                _mm256_maskstore_epi32(reinterpret_cast<int*>(out + kept), _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(count)), lanes), v);
+            else
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + kept), v);
+            kept += count;
+        }
+        return kept;
+    }
+    else if constexpr (sizeof(T) == 8)
+    {
+        const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+        size_t kept = 0;
+        for (size_t group = 0; group < blockSize; group += 4)
+        {
+            const unsigned mask = static_cast<unsigned>(bits >> group) & 0xfu;
+            const __m256i index = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(static_cast<long long>(permute64[mask])));
+            const __m256i v = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + group)), index);
+            const unsigned count = popCount(mask);
+            if constexpr (exact)
+                _mm256_maskstore_epi64(reinterpret_cast<long long*>(out + kept), _mm256_cmpgt_epi64(_mm256_set1_epi64x(static_cast<long long>(count)), lanes), v);
+            else
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + kept), v);
+            kept += count;
+        }
+        return kept;
+    }
+    else
+        return compactBits(in, bits, out);
+#else
+    return compactBits(in, bits, out);
+#endif
+}
+
+// Keeps the elements for which keep() is true, packed to 'out'. 'exact' as in compactBlock().
+template <bool exact, typename T, typename Keep>
+T*
+compactIf(const T* first, const T* last, T* out, Keep keep)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "compaction copies elements as bytes");
+
+    for (; last - first >= static_cast<ptrdiff_t>(blockSize); first += blockSize)
+    {
+        const uint64_t bits = keepMask(first, keep);
+        if (bits == ~uint64_t{ 0 } && first == out)
+        {
+            // Nothing removed yet, nothing to move.
+            out += blockSize;
+            continue;
+        }
+        out += compactBlock<exact>(first, bits, out);
+    }
+
+    const size_t rest = static_cast<size_t>(last - first);
+    return out + compactBits(first, keepMaskTail(first, rest, keep), out);
+}
+
+}
+
+// std::remove_if for contiguous arrays of trivially copyable elements. Returns the new end.
+template <typename T, typename Predicate>
+T*
+removeIf(T* first, T* last, Predicate predicate)
+{
+    return compact::compactIf<false>(first, last, first, [&predicate](const T& value) { return !predicate(value); });
+}
+
+// std::remove, removes the elements equal to 'value'.
+template <typename T>
+T*
+remove(T* first, T* last, const T& value)
+{
+    return removeIf(first, last, [value](const T& element) { return element == value; });
+}
+
+/**
+ * std::copy_if for contiguous arrays, 'out' must not overlap the input.
+ * Only the kept elements are written (masked stores), like std::copy_if,
+ * so 'out' needs room only for them.
+ */
+template <typename T, typename Predicate>
+T*
+copyIf(const T* first, const T* last, T* out, Predicate predicate)
+{
+    return compact::compactIf<true>(first, last, out, std::move(predicate));
+}
+
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ct {
+
+/**
+ * Types whose operator== is the same as comparing their bytes: integers, enums and pointers.
+ * Floating point is not (0.0 == -0.0, NaN != NaN). Specialize it for structs of such types
+ * without padding whose operator== compares all members:
+ *
+ *     namespace ct { template <> struct IsTriviallyComparable<Pixel> : std::true_type {}; }
+ */
+template <typename T>
+struct IsTriviallyComparable : std::bool_constant<std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>>
+{
+};
+
+template <typename T>
+constexpr bool isTriviallyComparable = IsTriviallyComparable<std::remove_cv_t<T>>::value;
+
+namespace compare {
+
+inline unsigned
+countTrailingZeros(uint64_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+}
+
+/**
+ * Index of the first differing byte of a and b, 'size' when they are equal.
+ * 64 bytes per step with AVX-512BW, 32 with AVX2, 16 with SSE2. Large buffers
+ * compare four vectors per step and only look for the position in a step which differs.
+ */
+inline size_t
+mismatchBytes(const void* first, const void* second, size_t size)
+{
+    const auto* a = static_cast<const unsigned char*>(first);
+    const auto* b = static_cast<const unsigned char*>(second);
+    size_t i = 0;
+
+#if defined(__AVX512BW__)
+    for (; i + 256 <= size; i += 256)
+    {
+        const __m512i x0 = _mm512_xor_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        const __m512i x1 = _mm512_xor_si512(_mm512_loadu_si512(a + i + 64), _mm512_loadu_si512(b + i + 64));
+        const __m512i x2 = _mm512_xor_si512(_mm512_loadu_si512(a + i + 128), _mm512_loadu_si512(b + i + 128));
+        const __m512i x3 = _mm512_xor_si512(_mm512_loadu_si512(a + i + 192), _mm512_loadu_si512(b + i + 192));
+        const __m512i any = _mm512_or_si512(_mm512_or_si512(x0, x1), _mm512_or_si512(x2, x3));
+        if (_mm512_test_epi64_mask(any, any) != 0)
+            break;
+    }
+    for (; i + 64 <= size; i += 64)
+    {
+        const uint64_t differ = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        if (differ != 0)
+            return i + countTrailingZeros(differ);
+    }
+    if (i < size)
+    {
+        // Masked loads of the tail do not touch bytes past the end.
+        const __mmask64 tail = ~uint64_t{ 0 } >> (64 - (size - i));
+        const uint64_t differ = _mm512_mask_cmpneq_epi8_mask(tail, _mm512_maskz_loadu_epi8(tail, a + i), _mm512_maskz_loadu_epi8(tail, b + i));
+        return differ != 0 ? i + countTrailingZeros(differ) : size;
+    }
+    return size;
+#elif defined(__AVX2__)
+    for (; i + 128 <= size; i += 128)
+    {
+        const __m256i e0 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        const __m256i e1 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 32)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 32)));
+        const __m256i e2 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 64)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 64)));
+        const __m256i e3 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 96)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 96)));
+        const __m256i all = _mm256_and_si256(_mm256_and_si256(e0, e1), _mm256_and_si256(e2, e3));
+        if (static_cast<uint32_t>(_mm256_movemask_epi8(all)) != 0xffffffffu)
+            break;
+    }
+    for (; i + 32 <= size; i += 32)
+    {
+        const __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        const uint32_t differ = ~static_cast<uint32_t>(_mm256_movemask_epi8(equal));
+        if (differ != 0)
+            return i + countTrailingZeros(differ);
+    }
+#endif
+#if defined(__SSE2__) && !defined(__AVX512BW__)
+    for (; i + 16 <= size; i += 16)
+    {
+        const __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        const uint32_t differ = ~static_cast<uint32_t>(_mm_movemask_epi8(equal)) & 0xffffu;
+        if (differ != 0)
+            return i + countTrailingZeros(differ);
+    }
+#endif
+#if !defined(__AVX512BW__)
+    // 8 bytes at a time, the lowest differing byte of a little endian word is the first one.
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t x;
+        uint64_t y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        if (x != y)
+        {
+            for (; a[i] == b[i]; i++)
+            {
+            }
+            return i;
+        }
+    }
+    for (; i < size; i++)
+    {
+        if (a[i] != b[i])
+            return i;
+    }
+    return size;
+#endif
+}
+
+// Order of one element. Characters compare as unsigned like std::string::compare, char may be signed.
+template <typename T>
+bool
+less(const T& a, const T& b)
+{
+    if constexpr (std::is_same_v<T, char> || std::is_same_v<T, wchar_t> || std::is_same_v<T, char16_t> || std::is_same_v<T, char32_t>)
+        return std::char_traits<T>::lt(a, b);
+    else
+        return a < b;
+}
+
+}
+
+/**
+ * Index of the first position where a[i] != b[i], 'size' when the first 'size' elements are equal.
+ * Trivially comparable types compare their bytes with SIMD, others use operator==.
+ */
+template <typename T>
+size_t
+mismatchIndex(const T* a, const T* b, size_t size)
+{
+    if constexpr (isTriviallyComparable<T>)
+    {
+        static_assert(std::has_unique_object_representations_v<T>, "trivially comparable types must not have padding");
+        return compare::mismatchBytes(a, b, size * sizeof(T)) / sizeof(T);
+    }
+    else
+        return static_cast<size_t>(std::mismatch(a, a + size, b).first - a);
+}
+
+// Equality does not need the position, libc memcmp picks the widest vectors of the running CPU.
+template <typename T>
+bool
+equal(const T* a, const T* b, size_t size)
+{
+    if constexpr (isTriviallyComparable<T>)
+        return size == 0 || std::memcmp(a, b, size * sizeof(T)) == 0;
+    else
+        return ct::mismatchIndex(a, b, size) == size;
+}
+
+/**
+ * Three way lexicographic compare: negative when a sorts before b, 0 when equal, positive after.
+ * Finds the first difference with mismatchIndex, then orders that element with operator<,
+ * a prefix sorts before the longer range.
+ */
+template <typename T>
+int
+lexicographicCompare(const T* a, size_t sizeA, const T* b, size_t sizeB)
+{
+    const size_t common = std::min(sizeA, sizeB);
+    const size_t i = ct::mismatchIndex(a, b, common);
+    if (i < common)
+        return compare::less(a[i], b[i]) ? -1 : 1;
+    return sizeA < sizeB ? -1 : (sizeA > sizeB ? 1 : 0);
+}
+
+// Contiguous containers: std::vector, std::array, std::string, std::string_view.
+
+template <typename RangeA, typename RangeB>
+size_t
+mismatchIndex(const RangeA& a, const RangeB& b)
+{
+    return ct::mismatchIndex(std::data(a), std::data(b), std::min<size_t>(std::size(a), std::size(b)));
+}
+
+template <typename RangeA, typename RangeB>
+bool
+equal(const RangeA& a, const RangeB& b)
+{
+    return std::size(a) == std::size(b) && ct::equal(std::data(a), std::data(b), std::size(a));
+}
+
+template <typename RangeA, typename RangeB>
+int
+lexicographicCompare(const RangeA& a, const RangeB& b)
+{
+    return ct::lexicographicCompare(std::data(a), std::size(a), std::data(b), std::size(b));
+}
+
+}
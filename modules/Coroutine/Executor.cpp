@@ -0,0 +1,92 @@
+#include <algorithm>
+
+#include "Executor.hpp"
+
+namespace ct {
+
+Executor::Executor(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    workers.reserve(threads);
+    for (unsigned t = 0; t < threads; t++)
+        workers.emplace_back([this]() { work(); });
+}
+
+Executor::~Executor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void
+Executor::post(std::coroutine_handle<> handle)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(handle);
+    }
+    wake.notify_one();
+}
+
+void
+Executor::postAt(Clock::time_point time, std::coroutine_handle<> handle)
+{
+    bool earliest = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        earliest = timers.empty() || time < timers.top().time;
+        timers.push({ time, timerSequence++, handle });
+    }
+    // Workers sleeping until a later deadline have to look again.
+    if (earliest)
+        wake.notify_one();
+}
+
+void
+Executor::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        if (!timers.empty())
+        {
+            const Clock::time_point now = Clock::now();
+            while (!timers.empty() && timers.top().time <= now)
+            {
+                ready.push_back(timers.top().handle);
+                timers.pop();
+            }
+        }
+
+        if (!ready.empty())
+        {
+            const std::coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+            // Other workers take the rest of the queue meanwhile.
+            if (!ready.empty())
+                wake.notify_one();
+
+            lock.unlock();
+            handle.resume();
+            lock.lock();
+            continue;
+        }
+
+        if (stopping)
+            return;
+        if (timers.empty())
+            wake.wait(lock);
+        else
+            wake.wait_until(lock, timers.top().time);
+    }
+}
+
+}
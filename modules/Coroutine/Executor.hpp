@@ -0,0 +1,166 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "Task.hpp"
+
+namespace ct {
+
+/**
+ * Runs coroutines on a few worker threads. Ready coroutines wait in one FIFO queue, sleeping
+ * ones in a timer queue ordered by their deadline; the workers sleep until the next deadline
+ * when there is nothing to run. Thousands of suspended tasks cost their frames, not threads.
+ *
+ *     ct::Executor executor(2);
+ *     ct::Task<> tick(ct::Executor& executor)
+ *     {
+ *         co_await executor.schedule();                                // continue on a worker
+ *         co_await executor.sleepFor(std::chrono::milliseconds(10));   // no thread is blocked
+ *     }
+ *     executor.run(tick(executor));
+ *
+ * Every task must be finished before the executor is destroyed, frames of coroutines still
+ * waiting in its queues are not freed.
+ */
+class Executor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 0 threads means one per hardware thread.
+    explicit Executor(unsigned threads = 0);
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()); }
+
+    // Resumes 'handle' on a worker thread.
+    void post(std::coroutine_handle<> handle);
+    // Resumes 'handle' on a worker thread at 'time'.
+    void postAt(Clock::time_point time, std::coroutine_handle<> handle);
+
+    // co_await executor.schedule() continues the coroutine on a worker, it is also a yield.
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) const { executor.post(handle); }
+            void await_resume() const noexcept {}
+
+            Executor& executor;
+        };
+        return Awaiter{ *this };
+    }
+
+    // co_await executor.sleepUntil(time) suspends the coroutine until 'time', then resumes it on a worker.
+    auto sleepUntil(Clock::time_point time)
+    {
+        struct Awaiter
+        {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) const { executor.postAt(time, handle); }
+            void await_resume() const noexcept {}
+
+            Executor& executor;
+            Clock::time_point time;
+        };
+        return Awaiter{ *this, time };
+    }
+
+    template <typename Rep, typename Period>
+    auto sleepFor(std::chrono::duration<Rep, Period> duration)
+    {
+        return sleepUntil(Clock::now() + std::chrono::duration_cast<Clock::duration>(duration));
+    }
+
+    // Starts 'task' on a worker and forgets it, exceptions terminate the program.
+    void spawn(Task<> task) { spawnDetached(*this, std::move(task)); }
+
+    // Runs 'task' on the workers and blocks the calling thread until it finishes.
+    template <typename T>
+    T run(Task<T> task)
+    {
+        RunState<T> state;
+        runDetached(*this, std::move(task), state);
+
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.finished.wait(lock, [&state]() { return state.done; });
+        if (state.exception)
+            std::rethrow_exception(state.exception);
+        if constexpr (!std::is_void_v<T>)
+            return std::move(*state.value);
+    }
+
+private:
+    struct Timer
+    {
+        Clock::time_point time;
+        // Same deadlines resume in the order they were posted.
+        uint64_t sequence;
+        std::coroutine_handle<> handle;
+
+        bool operator>(const Timer& other) const { return time != other.time ? time > other.time : sequence > other.sequence; }
+    };
+
+    template <typename T>
+    struct RunState
+    {
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool done = false;
+        std::exception_ptr exception;
+        std::optional<std::conditional_t<std::is_void_v<T>, char, T>> value;
+    };
+
+    template <typename T>
+    static detail::Detached runDetached(Executor& executor, Task<T> task, RunState<T>& state)
+    {
+        co_await executor.schedule();
+        try
+        {
+            if constexpr (std::is_void_v<T>)
+                co_await std::move(task);
+            else
+                state.value.emplace(co_await std::move(task));
+        }
+        catch (...)
+        {
+            state.exception = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.done = true;
+        state.finished.notify_one();
+    }
+
+    static detail::Detached spawnDetached(Executor& executor, Task<> task)
+    {
+        co_await executor.schedule();
+        co_await std::move(task);
+    }
+
+    void work();
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::coroutine_handle<>> ready;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    uint64_t timerSequence = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace ct {
+
+template <typename T>
+class Task;
+
+namespace detail {
+
+// Resumes the awaiting coroutine when a task finishes, without growing the stack (symmetric transfer).
+struct FinalAwaiter
+{
+    bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) const noexcept
+    {
+        const std::coroutine_handle<> continuation = handle.promise().continuation;
+        return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase
+{
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+template <typename T>
+struct TaskPromise : PromiseBase
+{
+    Task<T> get_return_object() noexcept;
+
+    template <typename Value>
+    void return_value(Value&& _value)
+    {
+        value.emplace(std::forward<Value>(_value));
+    }
+
+    T result()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+template <>
+struct TaskPromise<void> : PromiseBase
+{
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void result()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+};
+
+}
+
+/**
+ * Lazy coroutine returning a T (C++20). The body starts when the task is awaited and the
+ * awaiting coroutine continues on the thread which finishes the task. A suspended task is
+ * a heap frame of a few hundred bytes, not a thread with its own stack.
+ *
+ *     ct::Task<float> refresh(ct::Executor& executor)
+ *     {
+ *         co_await executor.sleepFor(std::chrono::milliseconds(10));
+ *         co_return 42.0f;
+ *     }
+ *
+ *     float value = executor.run(refresh(executor));
+ *
+ * Exceptions thrown in the body are rethrown by co_await.
+ */
+template <typename T = void>
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> _handle) : handle(_handle) {}
+
+    ~Task()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool valid() const { return static_cast<bool>(handle); }
+    bool done() const { return handle && handle.done(); }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            bool await_ready() const noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result(); }
+
+            std::coroutine_handle<promise_type> handle;
+        };
+        return Awaiter{ handle };
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T>
+TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>{ std::coroutine_handle<TaskPromise<T>>::from_promise(*this) };
+}
+
+inline Task<void>
+TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>{ std::coroutine_handle<TaskPromise<void>>::from_promise(*this) };
+}
+
+// Coroutine nobody awaits, it runs until its first suspension when called and frees itself at the end.
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+}
+
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "Task.hpp"
+
+namespace ct {
+
+namespace detail {
+
+// Counts the finished tasks, the last one resumes the coroutine waiting in whenAll().
+class WhenAllLatch
+{
+public:
+    // One more than the tasks, whenAll() itself arrives after starting them all.
+    explicit WhenAllLatch(size_t tasks) : count(tasks + 1) {}
+
+    void setException(std::exception_ptr _exception)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!exception)
+            exception = std::move(_exception);
+    }
+
+    void rethrow() const
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+
+    void arrive()
+    {
+        if (count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            continuation.resume();
+    }
+
+    template <typename Start>
+    auto wait(Start start)
+    {
+        struct Awaiter
+        {
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> handle)
+            {
+                latch.continuation = handle;
+                start();
+                // All tasks finished without suspending, continue right away.
+                return latch.count.fetch_sub(1, std::memory_order_acq_rel) != 1;
+            }
+
+            void await_resume() const noexcept {}
+
+            WhenAllLatch& latch;
+            Start start;
+        };
+        return Awaiter{ *this, std::move(start) };
+    }
+
+private:
+    std::atomic<size_t> count;
+    std::coroutine_handle<> continuation;
+    std::mutex mutex;
+    std::exception_ptr exception;
+};
+
+template <typename T>
+Detached
+whenAllTask(Task<T> task, WhenAllLatch& latch, std::optional<T>& result)
+{
+    try
+    {
+        result.emplace(co_await std::move(task));
+    }
+    catch (...)
+    {
+        latch.setException(std::current_exception());
+    }
+    latch.arrive();
+}
+
+inline Detached
+whenAllTask(Task<> task, WhenAllLatch& latch)
+{
+    try
+    {
+        co_await std::move(task);
+    }
+    catch (...)
+    {
+        latch.setException(std::current_exception());
+    }
+    latch.arrive();
+}
+
+}
+
+/**
+ * Starts all tasks and finishes when the last of them does, with their results in order.
+ * The tasks run on the calling thread until they suspend, co_await executor.schedule()
+ * at their start spreads them over the workers. The first exception is rethrown after
+ * all tasks finished.
+ *
+ *     std::vector<ct::Task<float>> refreshes;
+ *     for (int i = 0; i < 1000; i++)
+ *         refreshes.push_back(refresh(executor, i));
+ *     std::vector<float> lengths = co_await ct::whenAll(std::move(refreshes));
+ */
+template <typename T>
+Task<std::vector<T>>
+whenAll(std::vector<Task<T>> tasks)
+{
+    std::vector<std::optional<T>> results(tasks.size());
+    detail::WhenAllLatch latch(tasks.size());
+    co_await latch.wait([&tasks, &latch, &results]() {
+        for (size_t i = 0; i < tasks.size(); i++)
+            detail::whenAllTask(std::move(tasks[i]), latch, results[i]);
+    });
+    latch.rethrow();
+
+    std::vector<T> values;
+    values.reserve(results.size());
+    for (auto& result : results)
+        values.push_back(std::move(*result));
+    co_return values;
+}
+
+inline Task<>
+whenAll(std::vector<Task<>> tasks)
+{
+    detail::WhenAllLatch latch(tasks.size());
+    co_await latch.wait([&tasks, &latch]() {
+        for (auto& task : tasks)
+            detail::whenAllTask(std::move(task), latch);
+    });
+    latch.rethrow();
+}
+
+}
@@ -0,0 +1,226 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <set>
+
+#include "Dataset.hpp"
+
+namespace ct {
+
+static size_t
+elementSize(dataset::ElementType type)
+{
+    switch (type)
+    {
+    case dataset::ElementType::Int8:
+    case dataset::ElementType::UInt8:
+        return 1;
+    case dataset::ElementType::Int16:
+    case dataset::ElementType::UInt16:
+        return 2;
+    case dataset::ElementType::Int32:
+    case dataset::ElementType::UInt32:
+    case dataset::ElementType::Float32:
+        return 4;
+    case dataset::ElementType::Int64:
+    case dataset::ElementType::UInt64:
+    case dataset::ElementType::Float64:
+        return 8;
+    }
+    return 0;
+}
+
+// Checksum of the file header with headerChecksum = 0 followed by the column headers.
+static uint64_t
+headerChecksum(dataset::FileHeader header, const dataset::ColumnHeader* columns, size_t count)
+{
+    header.headerChecksum = 0;
+    std::vector<unsigned char> bytes(sizeof(header) + count * sizeof(dataset::ColumnHeader));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    if (count > 0)
+        std::memcpy(bytes.data() + sizeof(header), columns, count * sizeof(dataset::ColumnHeader));
+    return dataset::checksum(bytes.data(), bytes.size());
+}
+
+static void
+setError(std::string* error, const std::string& message)
+{
+    if (error != nullptr)
+        *error = message;
+}
+
+Dataset::Ptr
+Dataset::open(const std::string& path, Verify verify, std::string* error)
+{
+    std::string message;
+    Dataset::Ptr ret{ new Dataset{} };
+    if (ret->init(path, verify, message))
+        return ret;
+
+    setError(error, path + ": " + message);
+    return nullptr;
+}
+
+Dataset::~Dataset() = default;
+
+bool
+Dataset::init(const std::string& path, Verify verify, std::string& error)
+{
+    // Queries touch single columns, no read ahead over the whole file.
+    file = MappedFile::create(path, MappedFile::Access::Normal, &error);
+    if (file == nullptr)
+        return false;
+    if (file->size() < sizeof(dataset::FileHeader))
+    {
+        error = "file too small for a dataset header";
+        return false;
+    }
+    base = reinterpret_cast<const unsigned char*>(file->view().data());
+    size = file->size();
+
+    dataset::FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, dataset::magic, sizeof(header.magic)) != 0)
+    {
+        error = "not a dataset file";
+        return false;
+    }
+    if (header.version != dataset::version)
+    {
+        error = "unsupported dataset version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.fileSize != size)
+    {
+        error = "file size " + std::to_string(size) + " does not match the header (" + std::to_string(header.fileSize) + "), truncated?";
+        return false;
+    }
+    if (header.alignment != dataset::alignment || header.columnCount > (size - sizeof(header)) / sizeof(dataset::ColumnHeader))
+    {
+        error = "corrupted header";
+        return false;
+    }
+
+    const auto* columnHeaders = reinterpret_cast<const dataset::ColumnHeader*>(base + sizeof(header));
+    if (headerChecksum(header, columnHeaders, header.columnCount) != header.headerChecksum)
+    {
+        error = "header checksum mismatch";
+        return false;
+    }
+
+    const size_t dataStart = sizeof(header) + header.columnCount * sizeof(dataset::ColumnHeader);
+    for (uint32_t i = 0; i < header.columnCount; i++)
+    {
+        const dataset::ColumnHeader& column = columnHeaders[i];
+        const size_t nameLength = strnlen(column.name, sizeof(column.name));
+        const size_t bytesPerElement = elementSize(column.type);
+        if (nameLength == 0 || nameLength == sizeof(column.name) || bytesPerElement == 0 || bytesPerElement != column.elementSize ||
+            column.offset % dataset::alignment != 0 || column.offset < dataStart || column.offset > size ||
+            column.count > (size - column.offset) / bytesPerElement)
+        {
+            error = "corrupted column header " + std::to_string(i);
+            return false;
+        }
+        columnList.push_back({ std::string(column.name, nameLength), column.type, bytesPerElement, column.offset, column.count, column.checksum });
+    }
+
+    if (verify == Verify::All)
+        return verifyColumns(&error);
+    return true;
+}
+
+const Dataset::Column*
+Dataset::find(const std::string& name) const
+{
+    for (const auto& column : columnList)
+    {
+        if (column.name == name)
+            return &column;
+    }
+    return nullptr;
+}
+
+bool
+Dataset::verifyColumns(std::string* error) const
+{
+    for (const auto& column : columnList)
+    {
+        if (dataset::checksum(base + column.offset, column.count * column.elementSize) != column.checksum)
+        {
+            setError(error, "checksum mismatch in column " + column.name);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+DatasetWriter::write(const std::string& path, std::string* error) const
+{
+    std::set<std::string> names;
+    for (const auto& column : columns)
+    {
+        if (column.name.empty() || column.name.size() > dataset::maxNameLength)
+        {
+            setError(error, "column name '" + column.name + "' must have 1 to " + std::to_string(dataset::maxNameLength) + " characters");
+            return false;
+        }
+        if (!names.insert(column.name).second)
+        {
+            setError(error, "column '" + column.name + "' added twice");
+            return false;
+        }
+    }
+
+    std::vector<dataset::ColumnHeader> headers(columns.size());
+    size_t offset = dataset::alignUp(sizeof(dataset::FileHeader) + headers.size() * sizeof(dataset::ColumnHeader));
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        const Source& column = columns[i];
+        dataset::ColumnHeader& header = headers[i];
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.name, column.name.data(), column.name.size());
+        header.type = column.type;
+        header.elementSize = static_cast<uint32_t>(column.elementSize);
+        header.offset = offset;
+        header.count = column.count;
+        header.checksum = dataset::checksum(column.data, column.count * column.elementSize);
+        offset = dataset::alignUp(offset + column.count * column.elementSize);
+    }
+
+    dataset::FileHeader fileHeader;
+    std::memset(&fileHeader, 0, sizeof(fileHeader));
+    std::memcpy(fileHeader.magic, dataset::magic, sizeof(fileHeader.magic));
+    fileHeader.version = dataset::version;
+    fileHeader.columnCount = static_cast<uint32_t>(columns.size());
+    fileHeader.fileSize = columns.empty() ? sizeof(fileHeader) : headers.back().offset + columns.back().count * columns.back().elementSize;
+    fileHeader.alignment = dataset::alignment;
+    fileHeader.headerChecksum = headerChecksum(fileHeader, headers.data(), headers.size());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        setError(error, path + ": " + strerror(errno));
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    file.write(reinterpret_cast<const char*>(headers.data()), static_cast<std::streamsize>(headers.size() * sizeof(dataset::ColumnHeader)));
+    const char padding[dataset::alignment] = {};
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        const auto position = static_cast<size_t>(file.tellp());
+        file.write(padding, static_cast<std::streamsize>(headers[i].offset - position));
+        file.write(static_cast<const char*>(columns[i].data), static_cast<std::streamsize>(columns[i].count * columns[i].elementSize));
+    }
+
+    file.close();
+    if (!file)
+    {
+        setError(error, path + ": write failed");
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DatasetFormat.hpp"
+#include "MappedFile.hpp"
+
+namespace ct {
+
+/**
+ * Read only view of a column, like std::span<const T> (C++20). The memory belongs to the Dataset.
+ */
+template <typename T>
+class ColumnView
+{
+public:
+    ColumnView() = default;
+    ColumnView(const T* _data, size_t _size) : first(_data), count(_size) {}
+
+    const T* data() const { return first; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+
+    const T& operator[](size_t i) const { return first[i]; }
+    const T& front() const { return first[0]; }
+    const T& back() const { return first[count - 1]; }
+
+    ColumnView subview(size_t offset, size_t size) const { return { first + offset, size }; }
+
+private:
+    const T* first = nullptr;
+    size_t count = 0;
+};
+
+/**
+ * Dataset file mapped into memory with MappedFile (see DatasetFormat.hpp). Opening reads and checks
+ * the headers only, the pages of a column are loaded on first access by the kernel,
+ * nothing is parsed or copied. Multi GB files open in microseconds.
+ *
+ *     std::string error;
+ *     auto dataset = ct::Dataset::open("data.ctd", ct::Dataset::Verify::Header, &error);
+ *     ct::ColumnView<int32_t> values = dataset->column<int32_t>("values");
+ *     int64_t sum = std::accumulate(values.begin(), values.end(), int64_t{ 0 });
+ */
+class Dataset
+{
+public:
+    enum class Verify
+    {
+        // Magic, version, sizes and the header checksum.
+        Header,
+        // Also the checksums of all columns, reads the whole file.
+        All,
+    };
+
+    struct Column
+    {
+        std::string name;
+        dataset::ElementType type;
+        size_t elementSize;
+        size_t offset;
+        size_t count;
+        uint64_t checksum;
+    };
+
+    using Ptr = std::unique_ptr<Dataset>;
+    // Returns nullptr when the file can not be mapped or is not a valid dataset, 'error' says why.
+    static Ptr open(const std::string& path, Verify verify = Verify::Header, std::string* error = nullptr);
+
+    ~Dataset();
+
+    Dataset(const Dataset&) = delete;
+    Dataset& operator=(const Dataset&) = delete;
+
+    const std::vector<Column>& columns() const { return columnList; }
+    // nullptr when there is no such column.
+    const Column* find(const std::string& name) const;
+
+    // Empty view when the column does not exist or holds another type.
+    template <typename T>
+    ColumnView<T> column(const std::string& name) const
+    {
+        const Column* info = find(name);
+        if (info == nullptr || info->type != dataset::typeOf<T>())
+            return {};
+        return { reinterpret_cast<const T*>(base + info->offset), info->count };
+    }
+
+    // Compares the checksums of all columns with their data.
+    bool verifyColumns(std::string* error = nullptr) const;
+
+    size_t fileSize() const { return size; }
+
+private:
+    Dataset() = default;
+    bool init(const std::string& path, Verify verify, std::string& error);
+
+    MappedFile::Ptr file;
+    const unsigned char* base = nullptr;
+    size_t size = 0;
+    std::vector<Column> columnList;
+};
+
+/**
+ * Writes a dataset file. The columns are not copied, keep them alive until write() returns.
+ *
+ *     ct::DatasetWriter writer;
+ *     writer.addColumn("values", values);
+ *     writer.write("data.ctd");
+ */
+class DatasetWriter
+{
+public:
+    template <typename T>
+    void addColumn(const std::string& name, const T* data, size_t count)
+    {
+        columns.push_back({ name, dataset::typeOf<T>(), sizeof(T), data, count });
+    }
+
+    template <typename T>
+    void addColumn(const std::string& name, const std::vector<T>& values)
+    {
+        addColumn(name, values.data(), values.size());
+    }
+
+    // False when a name is empty, too long or used twice, or the file can not be written.
+    bool write(const std::string& path, std::string* error = nullptr) const;
+
+private:
+    struct Source
+    {
+        std::string name;
+        dataset::ElementType type;
+        size_t elementSize;
+        const void* data;
+        size_t count;
+    };
+
+    std::vector<Source> columns;
+};
+
+}
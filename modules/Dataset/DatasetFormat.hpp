@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace ct {
+
+/**
+ * Columnar binary dataset file, version 1. Little endian, every part is 64 byte aligned:
+ *
+ *     FileHeader                       64 bytes
+ *     ColumnHeader[columnCount]        64 bytes each
+ *     column data                      each column starts at a multiple of 'alignment'
+ *
+ * headerChecksum covers the file header (with headerChecksum = 0) and all column headers,
+ * every column header has the checksum of its data. The columns are plain arrays,
+ * a memory mapped file is used in place without parsing or copying.
+ */
+namespace dataset {
+
+constexpr char magic[8] = { 'C', 'T', 'D', 'A', 'T', 'A', '\r', '\n' };
+constexpr uint32_t version = 1;
+constexpr uint32_t alignment = 64;
+constexpr size_t maxNameLength = 31;
+
+enum class ElementType : uint32_t
+{
+    Int8 = 1,
+    Int16,
+    Int32,
+    Int64,
+    UInt8,
+    UInt16,
+    UInt32,
+    UInt64,
+    Float32,
+    Float64,
+};
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t columnCount;
+    uint64_t fileSize;
+    uint32_t alignment;
+    uint32_t reserved;
+    uint64_t headerChecksum;
+    uint8_t padding[24];
+};
+
+struct ColumnHeader
+{
+    char name[maxNameLength + 1];
+    ElementType type;
+    uint32_t elementSize;
+    uint64_t offset;
+    uint64_t count;
+    uint64_t checksum;
+};
+
+static_assert(sizeof(FileHeader) == 64, "the file layout must not depend on the compiler");
+static_assert(sizeof(ColumnHeader) == 64, "the file layout must not depend on the compiler");
+
+template <typename T>
+constexpr bool isElementType = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, long double>;
+
+// Element type stored for a C++ type.
+template <typename T>
+constexpr ElementType
+typeOf()
+{
+    static_assert(isElementType<T>, "columns hold integers or floating point numbers");
+    if constexpr (std::is_floating_point_v<T>)
+        return sizeof(T) == 4 ? ElementType::Float32 : ElementType::Float64;
+    else if constexpr (std::is_signed_v<T>)
+        return sizeof(T) == 1 ? ElementType::Int8 : sizeof(T) == 2 ? ElementType::Int16 : sizeof(T) == 4 ? ElementType::Int32 : ElementType::Int64;
+    else
+        return sizeof(T) == 1 ? ElementType::UInt8 : sizeof(T) == 2 ? ElementType::UInt16 : sizeof(T) == 4 ? ElementType::UInt32 : ElementType::UInt64;
+}
+
+inline const char*
+typeName(ElementType type)
+{
+    switch (type)
+    {
+    case ElementType::Int8:
+        return "int8";
+    case ElementType::Int16:
+        return "int16";
+    case ElementType::Int32:
+        return "int32";
+    case ElementType::Int64:
+        return "int64";
+    case ElementType::UInt8:
+        return "uint8";
+    case ElementType::UInt16:
+        return "uint16";
+    case ElementType::UInt32:
+        return "uint32";
+    case ElementType::UInt64:
+        return "uint64";
+    case ElementType::Float32:
+        return "float32";
+    case ElementType::Float64:
+        return "float64";
+    }
+    return "unknown";
+}
+
+inline size_t
+alignUp(size_t offset)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+namespace detail {
+
+constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+
+inline uint64_t
+rotateLeft(uint64_t x, int bits)
+{
+    return (x << bits) | (x >> (64 - bits));
+}
+
+inline uint64_t
+load64(const unsigned char* p)
+{
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t
+round(uint64_t lane, uint64_t word)
+{
+    return rotateLeft(lane + word * prime2, 31) * prime1;
+}
+
+}
+
+/**
+ * 64 bit checksum of the column data, four independent lanes of 8 bytes (xxHash64 rounds,
+ * not compatible with xxHash), several GB/s. Detects corrupted and truncated files, it is
+ * not a cryptographic hash.
+ */
+inline uint64_t
+checksum(const void* data, size_t size)
+{
+    const auto* p = static_cast<const unsigned char*>(data);
+    uint64_t lanes[4] = { detail::prime1 + detail::prime2, detail::prime2, 0, 0 - detail::prime1 };
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        lanes[0] = detail::round(lanes[0], detail::load64(p + i));
+        lanes[1] = detail::round(lanes[1], detail::load64(p + i + 8));
+        lanes[2] = detail::round(lanes[2], detail::load64(p + i + 16));
+        lanes[3] = detail::round(lanes[3], detail::load64(p + i + 24));
+    }
+
+    uint64_t hash = detail::rotateLeft(lanes[0], 1) + detail::rotateLeft(lanes[1], 7) + detail::rotateLeft(lanes[2], 12) + detail::rotateLeft(lanes[3], 18);
+    hash += size;
+    for (; i + 8 <= size; i += 8)
+        hash = detail::rotateLeft(hash ^ detail::round(0, detail::load64(p + i)), 27) * detail::prime1 + detail::prime3;
+    for (; i < size; i++)
+        hash = detail::rotateLeft(hash ^ (p[i] * detail::prime3), 11) * detail::prime1;
+
+    hash ^= hash >> 33;
+    hash *= detail::prime2;
+    hash ^= hash >> 29;
+    hash *= detail::prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+}
+
+}
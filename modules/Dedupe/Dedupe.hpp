@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "FlatHashSet.hpp"
+#include "HyperLogLog.hpp"
+#include "ParallelFor.hpp"
+
+namespace ct {
+
+/**
+ * Duplicate elimination and distinct counting without sorting.
+ *
+ * sort + unique is O(n log n) and loses the input order. The functions here are O(n)
+ * with an open addressing hash set (FlatHashSet), keep the first occurrence of every value
+ * in input order, and need only Hash and operator== of the value type.
+ * distinctCountApprox() does not keep the values at all, HyperLogLog needs 2^precision bytes.
+ *
+ * Parallel versions partition the values by hash: thread t owns the values whose hash falls
+ * into its partition and keeps its own set, so no value is shared between threads and
+ * the first occurrence is still the one with the lowest index. The indices are scattered
+ * into per partition buckets first (a radix partition), every thread then reads only its
+ * own bucket instead of scanning all hashes.
+ */
+
+namespace detail {
+
+// Partition of a hash for 'threads' threads. High bits, the set uses the low bits for the slot.
+inline unsigned
+partitionOf(uint64_t hash, unsigned threads)
+{
+    return static_cast<unsigned>(((hash >> 32) * threads) >> 32);
+}
+
+// Indices of partition p are indices[bounds[p], bounds[p + 1]) in ascending order, hashes[i] is the hash of value i.
+struct Partitions
+{
+    std::vector<uint64_t> hashes;
+    std::vector<size_t> indices;
+    std::vector<size_t> bounds;
+};
+
+/**
+ * Radix partition by partitionOf(). Every chunk hashes its values and counts them per
+ * partition, a prefix sum in (partition, chunk) order gives every chunk its write positions
+ * and the scatter keeps the input order inside a partition. parallelFor splits the same way
+ * both times, 'threads' already comes from parallelThreads().
+ */
+template <typename RandomIt, typename HashFunction>
+Partitions
+partitionAll(RandomIt first, size_t size, unsigned threads, size_t minChunk)
+{
+    Partitions partitions;
+    partitions.hashes.resize(size);
+    partitions.indices.resize(size);
+    partitions.bounds.assign(threads + 1, 0);
+
+    // counts[chunk * threads + partition], after the prefix sum the next write position.
+    std::vector<size_t> counts(static_cast<size_t>(threads) * threads, 0);
+    parallelFor(size, threads, [&partitions, &counts, first, threads](size_t begin, size_t end, unsigned chunk) {
+        HashFunction hash;
+        std::vector<size_t> local(threads, 0);
+        for (size_t i = begin; i < end; i++)
+        {
+            partitions.hashes[i] = hash(first[i]);
+            local[partitionOf(partitions.hashes[i], threads)]++;
+        }
+        std::copy(local.begin(), local.end(), counts.begin() + static_cast<size_t>(chunk) * threads);
+    }, minChunk);
+
+    size_t offset = 0;
+    for (unsigned partition = 0; partition < threads; partition++)
+    {
+        partitions.bounds[partition] = offset;
+        for (unsigned chunk = 0; chunk < threads; chunk++)
+        {
+            size_t& count = counts[static_cast<size_t>(chunk) * threads + partition];
+            const size_t next = offset + count;
+            count = offset;
+            offset = next;
+        }
+    }
+    partitions.bounds[threads] = offset;
+
+    parallelFor(size, threads, [&partitions, &counts, threads](size_t begin, size_t end, unsigned chunk) {
+        const auto row = counts.begin() + static_cast<size_t>(chunk) * threads;
+        std::vector<size_t> write(row, row + threads);
+        for (size_t i = begin; i < end; i++)
+            partitions.indices[write[partitionOf(partitions.hashes[i], threads)]++] = i;
+    }, minChunk);
+    return partitions;
+}
+
+}
+
+// Removes repeated values keeping the first occurrence and the order. Returns the new end like std::unique.
+template <typename ForwardIt, typename HashFunction = Hash<typename std::iterator_traits<ForwardIt>::value_type>>
+ForwardIt
+dedupe(ForwardIt first, ForwardIt last)
+{
+    using T = typename std::iterator_traits<ForwardIt>::value_type;
+
+    FlatHashSet<T, HashFunction> seen;
+    ForwardIt write = first;
+    for (; first != last; ++first)
+    {
+        if (!seen.insert(*first))
+            continue;
+        if (write != first)
+            *write = std::move(*first);
+        ++write;
+    }
+    return write;
+}
+
+// Copies the first occurrence of every value to 'out' in input order.
+template <typename InputIt, typename OutputIt, typename HashFunction = Hash<typename std::iterator_traits<InputIt>::value_type>>
+OutputIt
+dedupeCopy(InputIt first, InputIt last, OutputIt out)
+{
+    using T = typename std::iterator_traits<InputIt>::value_type;
+
+    FlatHashSet<T, HashFunction> seen;
+    for (; first != last; ++first)
+    {
+        if (seen.insert(*first))
+            *out++ = *first;
+    }
+    return out;
+}
+
+/**
+ * dedupeCopy() on 'threads' threads, the output is the same. 'out' needs room for all
+ * values and must be random access, the compaction is parallel as well.
+ */
+template <typename RandomIt, typename OutputIt, typename HashFunction = Hash<typename std::iterator_traits<RandomIt>::value_type>>
+OutputIt
+dedupeCopyParallel(RandomIt first, RandomIt last, OutputIt out, unsigned threads = 0, size_t minChunk = 1 << 16)
+{
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+
+    const size_t size = static_cast<size_t>(std::distance(first, last));
+    threads = parallelThreads(size, threads, minChunk);
+    if (threads <= 1)
+        return dedupeCopy<RandomIt, OutputIt, HashFunction>(first, last, out);
+
+    const detail::Partitions partitions = detail::partitionAll<RandomIt, HashFunction>(first, size, threads, minChunk);
+
+    // Every thread dedupes its bucket. Indices of first occurrences go to per thread lists,
+    // writing flags directly would share cache lines between threads.
+    std::vector<std::vector<size_t>> firsts(threads);
+    parallelRun(threads, [&](unsigned t) {
+        FlatHashSet<T, HashFunction> seen;
+        for (size_t k = partitions.bounds[t]; k < partitions.bounds[t + 1]; k++)
+        {
+            const size_t i = partitions.indices[k];
+            if (seen.insertHashed(first[i], partitions.hashes[i]))
+                firsts[t].push_back(i);
+        }
+    });
+
+    std::vector<uint8_t> keep(size, 0);
+    for (const auto& indices : firsts)
+    {
+        for (size_t i : indices)
+            keep[i] = 1;
+    }
+
+    // Compaction: count per chunk, prefix sum, copy. parallelFor splits the same way both times.
+    std::vector<size_t> offsets(threads + 1, 0);
+    parallelFor(size, threads, [&keep, &offsets](size_t begin, size_t end, unsigned t) {
+        size_t kept = 0;
+        for (size_t i = begin; i < end; i++)
+            kept += keep[i];
+        offsets[t + 1] = kept;
+    }, minChunk);
+    for (unsigned t = 0; t < threads; t++)
+        offsets[t + 1] += offsets[t];
+
+    parallelFor(size, threads, [&keep, &offsets, first, out](size_t begin, size_t end, unsigned t) {
+        OutputIt write = out + offsets[t];
+        for (size_t i = begin; i < end; i++)
+        {
+            if (keep[i])
+                *write++ = first[i];
+        }
+    }, minChunk);
+
+    return out + offsets[threads];
+}
+
+// Exact number of distinct values.
+template <typename InputIt, typename HashFunction = Hash<typename std::iterator_traits<InputIt>::value_type>>
+size_t
+distinctCount(InputIt first, InputIt last)
+{
+    using T = typename std::iterator_traits<InputIt>::value_type;
+
+    FlatHashSet<T, HashFunction> seen;
+    for (; first != last; ++first)
+        seen.insert(*first);
+    return seen.size();
+}
+
+template <typename RandomIt, typename HashFunction = Hash<typename std::iterator_traits<RandomIt>::value_type>>
+size_t
+distinctCountParallel(RandomIt first, RandomIt last, unsigned threads = 0, size_t minChunk = 1 << 16)
+{
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+
+    const size_t size = static_cast<size_t>(std::distance(first, last));
+    threads = parallelThreads(size, threads, minChunk);
+    if (threads <= 1)
+        return distinctCount<RandomIt, HashFunction>(first, last);
+
+    const detail::Partitions partitions = detail::partitionAll<RandomIt, HashFunction>(first, size, threads, minChunk);
+
+    std::vector<size_t> counts(threads, 0);
+    parallelRun(threads, [&](unsigned t) {
+        FlatHashSet<T, HashFunction> seen;
+        for (size_t k = partitions.bounds[t]; k < partitions.bounds[t + 1]; k++)
+        {
+            const size_t i = partitions.indices[k];
+            seen.insertHashed(first[i], partitions.hashes[i]);
+        }
+        counts[t] = seen.size();
+    });
+
+    size_t total = 0;
+    for (size_t count : counts)
+        total += count;
+    return total;
+}
+
+// Approximate number of distinct values with HyperLogLog, see HyperLogLog::standardError().
+template <typename InputIt, typename HashFunction = Hash<typename std::iterator_traits<InputIt>::value_type>>
+double
+distinctCountApprox(InputIt first, InputIt last, unsigned precision = 14)
+{
+    HyperLogLog counter(precision);
+    HashFunction hash;
+    for (; first != last; ++first)
+        counter.add(hash(*first));
+    return counter.estimate();
+}
+
+// Every thread counts a chunk of the input, the counters are merged at the end.
+template <typename RandomIt, typename HashFunction = Hash<typename std::iterator_traits<RandomIt>::value_type>>
+double
+distinctCountApproxParallel(RandomIt first, RandomIt last, unsigned precision = 14, unsigned threads = 0, size_t minChunk = 1 << 16)
+{
+    const size_t size = static_cast<size_t>(std::distance(first, last));
+    threads = parallelThreads(size, threads, minChunk);
+
+    std::vector<HyperLogLog> counters(threads, HyperLogLog(precision));
+    parallelFor(size, threads, [&counters, first](size_t begin, size_t end, unsigned t) {
+        HashFunction hash;
+        for (size_t i = begin; i < end; i++)
+            counters[t].add(hash(first[i]));
+    }, minChunk);
+
+    for (unsigned t = 1; t < threads; t++)
+        counters[0].merge(counters[t]);
+    return counters[0].estimate();
+}
+
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ct {
+
+// Finalizer of splitmix64, spreads every input bit over the whole 64 bit result.
+inline uint64_t
+hashMix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * 64 bit hash with good low and high bits. Open addressing uses the low bits for the slot
+ * and HyperLogLog the high bits, std::hash of integers is the identity on libstdc++.
+ */
+template <typename T>
+struct Hash
+{
+    uint64_t operator()(const T& value) const
+    {
+        if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+            return hashMix(static_cast<uint64_t>(value));
+        else
+            return hashMix(static_cast<uint64_t>(std::hash<T>{}(value)));
+    }
+};
+
+/**
+ * Open addressing hash set with linear probing, power of two capacity and
+ * keys stored inline. Every slot has a control byte: 0 is empty, otherwise
+ * 7 bits of the hash, so most probes of other keys are rejected without comparing keys.
+ * Insert only, there is no erase.
+ */
+template <typename Key, typename HashFunction = Hash<Key>, typename Equal = std::equal_to<Key>>
+class FlatHashSet
+{
+public:
+    explicit FlatHashSet(size_t expected = 0) { reserve(expected); }
+
+    // True when the key was not in the set yet.
+    bool insert(const Key& key) { return insertHashed(key, hash(key)); }
+
+    // insert() with the hash computed by the caller, hash must be hash(key).
+    bool insertHashed(const Key& key, uint64_t keyHash)
+    {
+        // Load factor at most 0.7, linear probing degrades quickly above it.
+        if ((count + 1) * 10 > capacity() * 7)
+            grow();
+
+        const uint8_t tag = tagOf(keyHash);
+        size_t slot = keyHash & mask;
+        while (control[slot] != 0)
+        {
+            if (control[slot] == tag && equal(keys[slot], key))
+                return false;
+            slot = (slot + 1) & mask;
+        }
+        control[slot] = tag;
+        keys[slot] = key;
+        count++;
+        return true;
+    }
+
+    bool contains(const Key& key) const
+    {
+        if (count == 0)
+            return false;
+        const uint64_t keyHash = hash(key);
+        const uint8_t tag = tagOf(keyHash);
+        for (size_t slot = keyHash & mask; control[slot] != 0; slot = (slot + 1) & mask)
+        {
+            if (control[slot] == tag && equal(keys[slot], key))
+                return true;
+        }
+        return false;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t capacity() const { return control.size(); }
+
+    // Room for 'expected' keys without rehashing.
+    void reserve(size_t expected)
+    {
+        size_t wanted = 16;
+        while (wanted * 7 < expected * 10)
+            wanted *= 2;
+        if (wanted > capacity())
+            rehash(wanted);
+    }
+
+    void clear()
+    {
+        std::fill(control.begin(), control.end(), uint8_t{ 0 });
+        count = 0;
+    }
+
+    const HashFunction& hashFunction() const { return hash; }
+
+private:
+    static uint8_t tagOf(uint64_t keyHash) { return static_cast<uint8_t>(0x80 | (keyHash >> 57)); }
+
+    void grow() { rehash(capacity() * 2); }
+
+    void rehash(size_t newCapacity)
+    {
+        std::vector<Key> oldKeys(newCapacity);
+        std::vector<uint8_t> oldControl(newCapacity, 0);
+        oldKeys.swap(keys);
+        oldControl.swap(control);
+        mask = newCapacity - 1;
+
+        for (size_t i = 0; i < oldControl.size(); i++)
+        {
+            if (oldControl[i] == 0)
+                continue;
+            size_t slot = hash(oldKeys[i]) & mask;
+            while (control[slot] != 0)
+                slot = (slot + 1) & mask;
+            control[slot] = oldControl[i];
+            keys[slot] = std::move(oldKeys[i]);
+        }
+    }
+
+    std::vector<Key> keys;
+    std::vector<uint8_t> control;
+    size_t mask = 0;
+    size_t count = 0;
+    HashFunction hash;
+    Equal equal;
+};
+
+}
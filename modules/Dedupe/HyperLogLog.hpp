@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ct {
+
+/**
+ * HyperLogLog distinct counter (Flajolet et al. 2007) over 64 bit hashes.
+ *
+ * 2^precision registers of one byte. The top 'precision' bits of the hash select a register,
+ * the register keeps the maximum position of the first set bit in the rest of the hash.
+ * The standard error of estimate() is about 1.04 / sqrt(2^precision), 0.8% for the default 14
+ * (16 KiB). Small cardinalities use linear counting, a 64 bit hash needs no large range correction.
+ * Counters with the same precision can be merged, so partial counters can be built on many threads.
+ */
+class HyperLogLog
+{
+public:
+    static constexpr unsigned minPrecision = 4;
+    static constexpr unsigned maxPrecision = 18;
+
+    explicit HyperLogLog(unsigned _precision = 14)
+        : precision(std::min(maxPrecision, std::max(minPrecision, _precision))), registers(size_t{ 1 } << precision, 0)
+    {
+    }
+
+    // 'hash' must be a well mixed 64 bit hash, see ct::Hash.
+    void add(uint64_t hash)
+    {
+        const size_t index = static_cast<size_t>(hash >> (64 - precision));
+        // A guard bit limits the rank to 64 - precision + 1 when the rest of the hash is zero.
+        const uint64_t rest = (hash << precision) | (uint64_t{ 1 } << (precision - 1));
+        const uint8_t rank = static_cast<uint8_t>(countLeadingZeros(rest) + 1);
+        registers[index] = std::max(registers[index], rank);
+    }
+
+    // Union of both counted sets, false when the precision differs.
+    bool merge(const HyperLogLog& other)
+    {
+        if (other.precision != precision)
+            return false;
+        for (size_t i = 0; i < registers.size(); i++)
+            registers[i] = std::max(registers[i], other.registers[i]);
+        return true;
+    }
+
+    double estimate() const
+    {
+        const double m = static_cast<double>(registers.size());
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (uint8_t rank : registers)
+        {
+            sum += std::ldexp(1.0, -rank);
+            zeros += rank == 0;
+        }
+
+        const double raw = alpha() * m * m / sum;
+        if (raw <= 2.5 * m && zeros > 0)
+            return m * std::log(m / static_cast<double>(zeros));
+        return raw;
+    }
+
+    void clear() { std::fill(registers.begin(), registers.end(), uint8_t{ 0 }); }
+
+    unsigned getPrecision() const { return precision; }
+
+    // Expected relative standard error of estimate().
+    double standardError() const { return 1.04 / std::sqrt(static_cast<double>(registers.size())); }
+
+private:
+    static unsigned countLeadingZeros(uint64_t x)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, x);
+        return 63 - static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_clzll(x));
+#endif
+    }
+
+    double alpha() const
+    {
+        switch (registers.size())
+        {
+        case 16:
+            return 0.673;
+        case 32:
+            return 0.697;
+        case 64:
+            return 0.709;
+        default:
+            return 0.7213 / (1.0 + 1.079 / static_cast<double>(registers.size()));
+        }
+    }
+
+    unsigned precision;
+    std::vector<uint8_t> registers;
+};
+
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace ct {
+
+namespace half {
+
+namespace detail {
+
+inline uint32_t
+floatBits(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float
+bitsFloat(uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#if defined(__AVX512F__)
+constexpr __mmask16 all = 0xffff;
+#endif
+
+}
+
+/**
+ * 16 bit float formats for packed storage, computation stays in float.
+ *
+ *  Fp16  IEEE half: 5 exponent bits, 10 mantissa bits. |x| up to 65504, 2^-11 relative error
+ *        for normals (|x| >= 2^-14), smaller values lose bits as denormals.
+ *  Bf16  brain float: the top half of a float, 8 exponent bits, 7 mantissa bits. The float
+ *        range, 2^-8 relative error.
+ *
+ * encode() rounds to nearest even, decode() is exact. maxRelativeError bounds
+ * |decode(encode(x)) / x - 1| in the normal range. Both give the same bits on every path:
+ * the scalar code, F16C (vcvtph2ps / vcvtps2ph) and AVX-512 for Fp16, integer ops for Bf16
+ * (vcvtneps2bf16 would flush denormals to zero).
+ *
+ *     uint16_t packed = ct::half::Fp16::encode(x);
+ *     ct::half::decode<ct::half::Bf16>(packed, floats, count);
+ */
+struct Fp16
+{
+    using Storage = uint16_t;
+    static constexpr double maxRelativeError = 1.0 / 2048;
+
+    static uint16_t encode(float value)
+    {
+        uint32_t bits = detail::floatBits(value);
+        const uint32_t sign = (bits >> 16) & 0x8000u;
+        bits &= 0x7fffffffu;
+        // 2^16 and up, infinity and NaN. 65520 up to 2^16 round to infinity below.
+        if (bits >= 0x47800000u)
+            return static_cast<uint16_t>(sign | (bits > 0x7f800000u ? 0x7e00u : 0x7c00u));
+        if (bits < 0x38800000u)
+        {
+            // Below 2^-14: adding 0.5 shifts the denormal mantissa to the low bits, the float
+            // addition rounds it to nearest even.
+            const float shifted = detail::bitsFloat(bits) + 0.5f;
+            return static_cast<uint16_t>(sign | (detail::floatBits(shifted) - 0x3f000000u));
+        }
+        const uint32_t odd = (bits >> 13) & 1;
+        bits += 0xc8000fffu + odd;
+        return static_cast<uint16_t>(sign | (bits >> 13));
+    }
+
+    static float decode(uint16_t half)
+    {
+        uint32_t bits = static_cast<uint32_t>(half & 0x7fffu) << 13;
+        const uint32_t exponent = bits & 0x0f800000u;
+        bits += 0x38000000u;
+        if (exponent == 0x0f800000u)
+            bits += 0x38000000u; // Infinity and NaN.
+        else if (exponent == 0)
+            bits = detail::floatBits(detail::bitsFloat(bits + 0x00800000u) - 6.103515625e-05f); // Denormal, - 2^-14.
+        return detail::bitsFloat(bits | static_cast<uint32_t>(half & 0x8000u) << 16);
+    }
+
+#if defined(__AVX2__)
+    static __m256 load(const uint16_t* source)
+    {
+        const __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+#if defined(__F16C__)
+        return _mm256_cvtph_ps(halves);
+#else
+        // decode() on 8 lanes.
+        const __m256i half = _mm256_cvtepu16_epi32(halves);
+        __m256i bits = _mm256_slli_epi32(_mm256_and_si256(half, _mm256_set1_epi32(0x7fff)), 13);
+        const __m256i exponent = _mm256_and_si256(bits, _mm256_set1_epi32(0x0f800000));
+        bits = _mm256_add_epi32(bits, _mm256_set1_epi32(0x38000000));
+        const __m256i special = _mm256_cmpeq_epi32(exponent, _mm256_set1_epi32(0x0f800000));
+        bits = _mm256_add_epi32(bits, _mm256_and_si256(special, _mm256_set1_epi32(0x38000000)));
+        const __m256 denormal =
+            _mm256_sub_ps(_mm256_castsi256_ps(_mm256_add_epi32(bits, _mm256_set1_epi32(0x00800000))), _mm256_set1_ps(6.103515625e-05f));
+        const __m256i small = _mm256_cmpeq_epi32(exponent, _mm256_setzero_si256());
+        bits = _mm256_blendv_epi8(bits, _mm256_castps_si256(denormal), small);
+        const __m256i sign = _mm256_slli_epi32(_mm256_and_si256(half, _mm256_set1_epi32(0x8000)), 16);
+        return _mm256_castsi256_ps(_mm256_or_si256(bits, sign));
+#endif
+    }
+
+    static void store(uint16_t* target, __m256 values)
+    {
+#if defined(__F16C__)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+#else
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, values);
+        for (int lane = 0; lane < 8; lane++)
+            target[lane] = encode(lanes[lane]);
+#endif
+    }
+#endif
+
+#if defined(__AVX512F__)
+    // GCC 12 warns of an uninitialized register in the unmasked AVX-512 conversions and shifts,
+    // the forms with all 16 lanes selected compile to the same instructions.
+    static __m512 load16(const uint16_t* source) { return _mm512_maskz_cvtph_ps(detail::all, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source))); }
+    static void store16(uint16_t* target, __m512 values)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(target), _mm512_maskz_cvtps_ph(detail::all, values, _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+};
+
+struct Bf16
+{
+    using Storage = uint16_t;
+    static constexpr double maxRelativeError = 1.0 / 256;
+
+    static uint16_t encode(float value)
+    {
+        const uint32_t bits = detail::floatBits(value);
+        // NaN stays NaN: keep the top bits and set the quiet bit.
+        if ((bits & 0x7fffffffu) > 0x7f800000u)
+            return static_cast<uint16_t>((bits >> 16) | 0x40u);
+        return static_cast<uint16_t>((bits + 0x7fffu + ((bits >> 16) & 1)) >> 16);
+    }
+
+    static float decode(uint16_t packed) { return detail::bitsFloat(static_cast<uint32_t>(packed) << 16); }
+
+#if defined(__AVX2__)
+    static __m256 load(const uint16_t* source)
+    {
+        const __m256i packed = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source)));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(packed, 16));
+    }
+
+    static void store(uint16_t* target, __m256 values)
+    {
+        const __m256i bits = _mm256_castps_si256(values);
+        const __m256i odd = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+        const __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7fff))), 16);
+        const __m256i quiet = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x40));
+        const __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(values, values, _CMP_UNORD_Q));
+        const __m256i packed = _mm256_blendv_epi8(rounded, quiet, nan);
+        // packus works per 128 bit lane, the permute brings the 8 results together.
+        const __m256i narrow = _mm256_permute4x64_epi64(_mm256_packus_epi32(packed, packed), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm256_castsi256_si128(narrow));
+    }
+#endif
+
+#if defined(__AVX512F__)
+    // Masked forms as in Fp16.
+    static __m512 load16(const uint16_t* source)
+    {
+        const __m512i packed = _mm512_maskz_cvtepu16_epi32(detail::all, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)));
+        return _mm512_castsi512_ps(_mm512_maskz_slli_epi32(detail::all, packed, 16));
+    }
+
+    static void store16(uint16_t* target, __m512 values)
+    {
+        const __m512i bits = _mm512_castps_si512(values);
+        const __m512i top = _mm512_maskz_srli_epi32(detail::all, bits, 16);
+        const __m512i odd = _mm512_and_si512(top, _mm512_set1_epi32(1));
+        __m512i packed = _mm512_maskz_srli_epi32(detail::all, _mm512_add_epi32(bits, _mm512_add_epi32(odd, _mm512_set1_epi32(0x7fff))), 16);
+        const __mmask16 nan = _mm512_cmp_ps_mask(values, values, _CMP_UNORD_Q);
+        packed = _mm512_mask_or_epi32(packed, nan, top, _mm512_set1_epi32(0x40));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(target), _mm512_maskz_cvtepi32_epi16(detail::all, packed));
+    }
+#endif
+};
+
+// Plain floats in the same interface, the baseline for the packed formats.
+struct Fp32
+{
+    using Storage = float;
+    static constexpr double maxRelativeError = 0;
+
+    static float encode(float value) { return value; }
+    static float decode(float value) { return value; }
+
+#if defined(__AVX2__)
+    static __m256 load(const float* source) { return _mm256_loadu_ps(source); }
+    static void store(float* target, __m256 values) { _mm256_storeu_ps(target, values); }
+#endif
+#if defined(__AVX512F__)
+    static __m512 load16(const float* source) { return _mm512_loadu_ps(source); }
+    static void store16(float* target, __m512 values) { _mm512_storeu_ps(target, values); }
+#endif
+};
+
+/**
+ * Bulk conversion, 16 values per step with AVX-512, 8 with AVX2.
+ */
+template <typename Format>
+inline void
+decode(const typename Format::Storage* source, float* target, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX512F__)
+    for (; i < count / 16 * 16; i += 16)
+        _mm512_storeu_ps(target + i, Format::load16(source + i));
+#endif
+#if defined(__AVX2__)
+    for (; i < count / 8 * 8; i += 8)
+        _mm256_storeu_ps(target + i, Format::load(source + i));
+#endif
+    for (; i < count; i++)
+        target[i] = Format::decode(source[i]);
+}
+
+template <typename Format>
+inline void
+encode(const float* source, typename Format::Storage* target, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX512F__)
+    for (; i < count / 16 * 16; i += 16)
+        Format::store16(target + i, _mm512_loadu_ps(source + i));
+#endif
+#if defined(__AVX2__)
+    for (; i < count / 8 * 8; i += 8)
+        Format::store(target + i, _mm256_loadu_ps(source + i));
+#endif
+    for (; i < count; i++)
+        target[i] = Format::encode(source[i]);
+}
+
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+#include "HugePages.hpp"
+
+namespace ct {
+
+/**
+ * Allocator for std containers which puts large buffers on huge pages (see HugePages.hpp),
+ * MAP_HUGETLB first, then transparent huge pages, then regular pages.
+ *
+ *     std::vector<int, ct::HugePageAllocator<int>> values(1 << 24);
+ *     ct::hugepages::Path path = ct::hugepages::lastPath();
+ *
+ * Small allocations, like the first growth steps of a vector, come from the heap.
+ */
+template <typename T>
+class HugePageAllocator
+{
+public:
+    using value_type = T;
+
+    HugePageAllocator() noexcept = default;
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>&) noexcept
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        if (count > static_cast<size_t>(-1) / sizeof(T))
+            throw std::bad_array_new_length();
+        void* memory = hugepages::allocate(count * sizeof(T));
+        if (memory == nullptr)
+            throw std::bad_alloc();
+        return static_cast<T*>(memory);
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept { hugepages::deallocate(pointer, count * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U>&) const noexcept
+    {
+        return false;
+    }
+};
+
+}
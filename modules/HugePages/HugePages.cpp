@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "HugePages.hpp"
+
+namespace ct {
+
+namespace hugepages {
+
+constexpr size_t heapAlignment = 64;
+constexpr size_t pathCount = 3;
+
+static std::atomic<size_t> allocations[pathCount];
+static std::atomic<size_t> bytesPerPath[pathCount];
+static thread_local Path lastAllocation = Path::Regular;
+
+static void
+record(Path path, size_t bytes)
+{
+    allocations[static_cast<size_t>(path)].fetch_add(1, std::memory_order_relaxed);
+    bytesPerPath[static_cast<size_t>(path)].fetch_add(bytes, std::memory_order_relaxed);
+    lastAllocation = path;
+}
+
+const char*
+name(Path path)
+{
+    switch (path)
+    {
+    case Path::HugeTlb:
+        return "hugetlb";
+    case Path::Transparent:
+        return "transparent";
+    case Path::Regular:
+        return "regular";
+    }
+    return "unknown";
+}
+
+size_t
+hugePageSize()
+{
+    static const size_t size = []() {
+        size_t kilobytes = 0;
+        FILE* file = std::fopen("/proc/meminfo", "r");
+        if (file != nullptr)
+        {
+            char line[256];
+            while (std::fgets(line, sizeof(line), file) != nullptr)
+            {
+                if (std::sscanf(line, "Hugepagesize: %zu kB", &kilobytes) == 1)
+                    break;
+            }
+            std::fclose(file);
+        }
+        return kilobytes > 0 ? kilobytes * 1024 : size_t{ 2 } << 20;
+    }();
+    return size;
+}
+
+size_t
+minimumBytes()
+{
+    return hugePageSize() / 2;
+}
+
+#if defined(__linux__)
+
+// Mappings are whole huge pages whatever the path, deallocate() then knows the length.
+static size_t
+mappedBytes(size_t bytes)
+{
+    const size_t page = hugePageSize();
+    return (bytes + page - 1) / page * page;
+}
+
+static void*
+mapHugeTlb(size_t length)
+{
+    void* memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+// A transparent huge page needs a 2 MB aligned virtual address, map more and cut the ends off.
+static void*
+mapAligned(size_t length)
+{
+    const size_t page = hugePageSize();
+    void* memory = mmap(nullptr, length + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return nullptr;
+
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(memory);
+    const uintptr_t aligned = (begin + page - 1) / page * page;
+    if (aligned > begin)
+        munmap(memory, aligned - begin);
+    munmap(reinterpret_cast<void*>(aligned + length), begin + page - aligned);
+    return reinterpret_cast<void*>(aligned);
+}
+
+void*
+allocate(size_t bytes, Path first, Path* used)
+{
+    if (bytes < minimumBytes())
+    {
+        void* memory = ::operator new(std::max<size_t>(bytes, 1), std::align_val_t(heapAlignment), std::nothrow);
+        if (memory != nullptr)
+            record(Path::Regular, bytes);
+        if (used != nullptr)
+            *used = Path::Regular;
+        return memory;
+    }
+
+    const size_t length = mappedBytes(bytes);
+    Path path = first;
+    void* memory = nullptr;
+    if (path == Path::HugeTlb)
+    {
+        memory = mapHugeTlb(length);
+        // No reserved huge pages (vm.nr_hugepages = 0) is the common case.
+        if (memory == nullptr)
+            path = Path::Transparent;
+    }
+    if (memory == nullptr)
+    {
+        memory = mapAligned(length);
+        if (memory == nullptr)
+            return nullptr;
+        // Fails when transparent huge pages are disabled or not compiled into the kernel.
+        if (path == Path::Transparent && madvise(memory, length, MADV_HUGEPAGE) != 0)
+            path = Path::Regular;
+    }
+
+    record(path, bytes);
+    if (used != nullptr)
+        *used = path;
+    return memory;
+}
+
+void
+deallocate(void* address, size_t bytes)
+{
+    if (address == nullptr)
+        return;
+    if (bytes < minimumBytes())
+        ::operator delete(address, std::align_val_t(heapAlignment));
+    else
+        munmap(address, mappedBytes(bytes));
+}
+
+size_t
+transparentHugeBytes(const void* address, size_t bytes)
+{
+    FILE* file = std::fopen("/proc/self/smaps", "r");
+    if (file == nullptr)
+        return 0;
+
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(address);
+    const uintptr_t end = begin + bytes;
+    bool inside = false;
+    size_t total = 0;
+    char line[512];
+    while (std::fgets(line, sizeof(line), file) != nullptr)
+    {
+        // A mapping starts with "7f0000000000-7f0000400000 rw-p ...", the fields follow.
+        unsigned long first = 0;
+        unsigned long last = 0;
+        char separator = 0;
+        if (std::sscanf(line, "%lx%c%lx ", &first, &separator, &last) == 3 && separator == '-')
+        {
+            inside = first < end && begin < last;
+            continue;
+        }
+        size_t kilobytes = 0;
+        if (inside && std::sscanf(line, "AnonHugePages: %zu kB", &kilobytes) == 1)
+            total += kilobytes * 1024;
+    }
+    std::fclose(file);
+    return total;
+}
+
+#else
+
+void*
+allocate(size_t bytes, Path, Path* used)
+{
+    void* memory = ::operator new(std::max<size_t>(bytes, 1), std::align_val_t(heapAlignment), std::nothrow);
+    if (memory != nullptr)
+        record(Path::Regular, bytes);
+    if (used != nullptr)
+        *used = Path::Regular;
+    return memory;
+}
+
+void
+deallocate(void* address, size_t)
+{
+    ::operator delete(address, std::align_val_t(heapAlignment));
+}
+
+size_t
+transparentHugeBytes(const void*, size_t)
+{
+    return 0;
+}
+
+#endif
+
+Path
+lastPath()
+{
+    return lastAllocation;
+}
+
+size_t
+allocationCount(Path path)
+{
+    return allocations[static_cast<size_t>(path)].load(std::memory_order_relaxed);
+}
+
+size_t
+allocatedBytes(Path path)
+{
+    return bytesPerPath[static_cast<size_t>(path)].load(std::memory_order_relaxed);
+}
+
+}
+
+}
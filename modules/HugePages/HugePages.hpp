@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ct {
+
+namespace hugepages {
+
+/**
+ * How the pages of an allocation are backed, in the order allocate() tries them:
+ *
+ *  HugeTlb      mmap(MAP_HUGETLB), needs huge pages reserved by the admin (vm.nr_hugepages).
+ *  Transparent  2 MB aligned mapping with madvise(MADV_HUGEPAGE), works without root when
+ *               /sys/kernel/mm/transparent_hugepage/enabled is "always" or "madvise".
+ *               The kernel may still use 4K pages when it finds no free 2 MB block.
+ *  Regular      4K pages.
+ *
+ * With 4K pages the dTLB (1.5K - 3K entries) covers a few MB, sort, lower_bound and shuffle
+ * on larger arrays miss it on almost every access. 2 MB pages cover GBs.
+ */
+enum class Path
+{
+    HugeTlb,
+    Transparent,
+    Regular,
+};
+
+const char* name(Path path);
+
+// Size of a huge page from /proc/meminfo, 2 MB when it is unknown.
+size_t hugePageSize();
+
+// Allocations smaller than this come from the heap and count as Regular, a mapping would waste most of a huge page.
+size_t minimumBytes();
+
+/**
+ * Allocates 'bytes', 64 byte aligned, trying the paths from 'first' on. 'used' receives the
+ * path which worked. Returns nullptr when not even regular pages can be mapped.
+ */
+void* allocate(size_t bytes, Path first = Path::HugeTlb, Path* used = nullptr);
+// 'bytes' must be the size passed to allocate().
+void deallocate(void* address, size_t bytes);
+
+// Path of the last allocate() of the calling thread, e.g. of the last growth of a vector.
+Path lastPath();
+
+// Allocations and bytes per path since the program started, over all threads.
+size_t allocationCount(Path path);
+size_t allocatedBytes(Path path);
+
+// Bytes of [address, address + bytes) the kernel backs with transparent huge pages right now (/proc/self/smaps).
+size_t transparentHugeBytes(const void* address, size_t bytes);
+
+}
+
+}
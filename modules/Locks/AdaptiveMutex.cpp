@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "AdaptiveMutex.hpp"
+#include "EventCount.hpp"
+
+namespace ct {
+
+int32_t
+AdaptiveMutex::spinLimit() const
+{
+    return std::min(maxSpins, spinAverage.load(std::memory_order_relaxed) * 2 + 10);
+}
+
+void
+AdaptiveMutex::lockContended()
+{
+    const int32_t limit = spinLimit();
+    int32_t spins = 0;
+    for (; spins < limit; spins++)
+    {
+        uint32_t expected = 0;
+        if (state.load(std::memory_order_relaxed) == 0 && state.compare_exchange_weak(expected, 1, std::memory_order_acquire, std::memory_order_relaxed))
+            break;
+        cpuRelax();
+    }
+    const int32_t average = spinAverage.load(std::memory_order_relaxed);
+    spinAverage.store(average + (spins - average) / 8, std::memory_order_relaxed);
+    if (spins < limit)
+        return;
+
+    // From here on the state stays 2 while this thread may sleep, unlock() then wakes one.
+    while (state.exchange(2, std::memory_order_acquire) != 0)
+        wait();
+}
+
+#if defined(__linux__)
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a 32 bit word");
+
+void
+AdaptiveMutex::wait()
+{
+    // Returns at once with EAGAIN when the state is not 2 anymore.
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state), FUTEX_WAIT_PRIVATE, 2, nullptr, nullptr, 0);
+}
+
+void
+AdaptiveMutex::wake()
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+#else
+
+void
+AdaptiveMutex::wait()
+{
+    std::this_thread::yield();
+}
+
+void
+AdaptiveMutex::wake()
+{
+}
+
+#endif
+
+}
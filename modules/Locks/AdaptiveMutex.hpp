@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ct {
+
+/**
+ * Mutex which spins a while and then sleeps on a futex (Drepper, "Futexes Are Tricky").
+ *
+ * The state is 0 when free, 1 when held and 2 when held with possible sleepers, unlock() only
+ * makes a syscall in state 2. The number of spins adapts like glibc's adaptive mutex: a moving
+ * average of the spins which were needed, twice that is tried before sleeping. Short critical
+ * sections are handed over without a syscall, long ones do not burn cores.
+ *
+ *     ct::AdaptiveMutex mutex;
+ *     std::lock_guard<ct::AdaptiveMutex> guard(mutex);
+ *
+ * Other systems than Linux yield instead of sleeping.
+ */
+class AdaptiveMutex
+{
+public:
+    static constexpr int32_t maxSpins = 1000;
+
+    AdaptiveMutex() = default;
+    AdaptiveMutex(const AdaptiveMutex&) = delete;
+    AdaptiveMutex& operator=(const AdaptiveMutex&) = delete;
+
+    void lock()
+    {
+        uint32_t expected = 0;
+        if (!state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed))
+            lockContended();
+    }
+
+    bool try_lock()
+    {
+        uint32_t expected = 0;
+        return state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock()
+    {
+        if (state.exchange(0, std::memory_order_release) == 2)
+            wake();
+    }
+
+    // Current spin budget before sleeping.
+    int32_t spinLimit() const;
+
+private:
+    void lockContended();
+    void wait();
+    void wake();
+
+    std::atomic<uint32_t> state{ 0 };
+    // Average spins needed, updated without synchronization like glibc's __spins.
+    std::atomic<int32_t> spinAverage{ 0 };
+};
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <thread>
+
+#include "EventCount.hpp"
+
+namespace ct {
+
+/**
+ * Wait step of the spinning locks: pause instructions first, then yield the core. Without the
+ * yield a waiter spins through its whole time slice while the holder is preempted, with more
+ * threads than cores every handover then costs a scheduler tick.
+ *
+ *     ct::Backoff backoff;
+ *     while (!ready.load(std::memory_order_acquire))
+ *         backoff.pause();
+ */
+class Backoff
+{
+public:
+    static constexpr unsigned spinLimit = 256;
+
+    // 'spins' pause instructions per step, e.g. more for waiters further back in a queue.
+    void pause(unsigned spins = 1)
+    {
+        if (steps++ < spinLimit)
+        {
+            for (unsigned i = 0; i < spins; i++)
+                cpuRelax();
+        }
+        else
+            std::this_thread::yield();
+    }
+
+private:
+    unsigned steps = 0;
+};
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "LockProfile.hpp"
+
+namespace ct {
+
+/**
+ * Any lock with the profile of LockProfile.hpp: acquisitions, contended acquisitions, wait time
+ * histogram and the call sites which take the lock and which make others wait.
+ *
+ *     ct::Instrumented<ct::AdaptiveMutex> mutex("TemplateClass::mutex");
+ *     {
+ *         ct::LockGuard<ct::Instrumented<ct::AdaptiveMutex>> guard(mutex);
+ *         ...
+ *     }
+ *     std::cout << ct::locks::formatReport(ct::locks::report());
+ *
+ * An uncontended lock() costs a try_lock() and the counters, only a contended one reads the
+ * clock. The call site is the caller of lock() (__builtin_FILE / __builtin_LINE), use
+ * ct::LockGuard instead of std::lock_guard, which would report a line in <mutex>.
+ */
+template <typename Lock>
+class Instrumented
+{
+public:
+    explicit Instrumented(std::string name) : lockProfile(std::move(name)) {}
+
+    Instrumented(const Instrumented&) = delete;
+    Instrumented& operator=(const Instrumented&) = delete;
+
+    void lock(const char* file = __builtin_FILE(), unsigned line = __builtin_LINE())
+    {
+        if (lockable.try_lock())
+        {
+            holder.store(lockProfile.acquired(file, line, 0, false, nullptr), std::memory_order_relaxed);
+            return;
+        }
+        locks::Profile::Site* blocker = holder.load(std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+        lockable.lock();
+        const auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        holder.store(lockProfile.acquired(file, line, static_cast<uint64_t>(wait.count()), true, blocker), std::memory_order_relaxed);
+    }
+
+    bool try_lock(const char* file = __builtin_FILE(), unsigned line = __builtin_LINE())
+    {
+        if (!lockable.try_lock())
+            return false;
+        holder.store(lockProfile.acquired(file, line, 0, false, nullptr), std::memory_order_relaxed);
+        return true;
+    }
+
+    void unlock() { lockable.unlock(); }
+
+    const locks::Profile& profile() const { return lockProfile; }
+    locks::Profile& profile() { return lockProfile; }
+
+private:
+    Lock lockable;
+    locks::Profile lockProfile;
+    // Site of the current holder, read by waiters to find who blocks them.
+    std::atomic<locks::Profile::Site*> holder{ nullptr };
+};
+
+/**
+ * std::lock_guard which passes its own call site to an Instrumented lock.
+ */
+template <typename Lock>
+class LockGuard
+{
+public:
+    explicit LockGuard(Lock& _lockable, const char* file = __builtin_FILE(), unsigned line = __builtin_LINE()) : lockable(_lockable)
+    {
+        if constexpr (std::is_invocable_v<decltype(&Lock::lock), Lock&, const char*, unsigned>)
+            lockable.lock(file, line);
+        else
+            lockable.lock();
+    }
+
+    ~LockGuard() { lockable.unlock(); }
+
+    LockGuard(const LockGuard&) = delete;
+    LockGuard& operator=(const LockGuard&) = delete;
+
+private:
+    Lock& lockable;
+};
+
+}
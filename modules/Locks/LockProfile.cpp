@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include "LockProfile.hpp"
+
+namespace ct {
+
+namespace locks {
+
+static std::mutex registryMutex;
+
+static std::vector<Profile*>&
+registry()
+{
+    static std::vector<Profile*> profiles;
+    return profiles;
+}
+
+// Single writer (the holder), a relaxed load and store is enough and cheaper than fetch_add.
+static void
+add(std::atomic<uint64_t>& counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static size_t
+bucket(uint64_t nanoseconds)
+{
+    size_t bits = 0;
+    while (nanoseconds != 0 && bits + 1 < histogramBuckets)
+    {
+        nanoseconds >>= 1;
+        bits++;
+    }
+    return bits;
+}
+
+static void
+clear(Profile::Site& site)
+{
+    for (auto* counter : { &site.acquisitions, &site.contended, &site.waitNanoseconds, &site.blocking })
+        counter->store(0, std::memory_order_relaxed);
+}
+
+uint64_t
+LockReport::waitPercentile(double fraction) const
+{
+    uint64_t total = 0;
+    for (uint64_t count : waitHistogram)
+        total += count;
+    if (total == 0)
+        return 0;
+
+    const double target = fraction * static_cast<double>(total);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < histogramBuckets; b++)
+    {
+        seen += waitHistogram[b];
+        if (static_cast<double>(seen) >= target)
+            return b == 0 ? 0 : uint64_t{ 1 } << b;
+    }
+    return maxWaitNanoseconds;
+}
+
+Profile::Profile(std::string _name) : lockName(std::move(_name))
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry().push_back(this);
+}
+
+Profile::~Profile()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto& profiles = registry();
+    profiles.erase(std::remove(profiles.begin(), profiles.end(), this), profiles.end());
+}
+
+Profile::Site*
+Profile::find(const char* file, unsigned line)
+{
+    for (Site& site : siteList)
+    {
+        const char* known = site.file.load(std::memory_order_relaxed);
+        if (known == nullptr)
+        {
+            // First use of the site, the holder is the only writer.
+            site.line.store(line, std::memory_order_relaxed);
+            site.file.store(file, std::memory_order_release);
+            return &site;
+        }
+        // __builtin_FILE() of one file may be different pointers in different translation units.
+        if (site.line.load(std::memory_order_relaxed) == line && (known == file || std::strcmp(known, file) == 0))
+            return &site;
+    }
+    return &other;
+}
+
+Profile::Site*
+Profile::acquired(const char* file, unsigned line, uint64_t wait, bool wasContended, Site* blocker)
+{
+    Site* site = find(file, line);
+    add(acquisitions, 1);
+    add(site->acquisitions, 1);
+    if (wasContended)
+    {
+        add(contended, 1);
+        add(waitNanoseconds, wait);
+        add(waitHistogram[bucket(wait)], 1);
+        if (wait > maxWaitNanoseconds.load(std::memory_order_relaxed))
+            maxWaitNanoseconds.store(wait, std::memory_order_relaxed);
+        add(site->contended, 1);
+        add(site->waitNanoseconds, wait);
+        if (blocker != nullptr)
+            add(blocker->blocking, 1);
+    }
+    return site;
+}
+
+LockReport
+Profile::report() const
+{
+    LockReport result;
+    result.name = lockName;
+    result.acquisitions = acquisitions.load(std::memory_order_relaxed);
+    result.contended = contended.load(std::memory_order_relaxed);
+    result.waitNanoseconds = waitNanoseconds.load(std::memory_order_relaxed);
+    result.maxWaitNanoseconds = maxWaitNanoseconds.load(std::memory_order_relaxed);
+    for (size_t b = 0; b < histogramBuckets; b++)
+        result.waitHistogram[b] = waitHistogram[b].load(std::memory_order_relaxed);
+
+    for (const Site& site : siteList)
+    {
+        const char* file = site.file.load(std::memory_order_acquire);
+        if (file == nullptr)
+            break;
+        SiteReport entry;
+        entry.file = file;
+        entry.line = site.line.load(std::memory_order_relaxed);
+        entry.acquisitions = site.acquisitions.load(std::memory_order_relaxed);
+        entry.contended = site.contended.load(std::memory_order_relaxed);
+        entry.waitNanoseconds = site.waitNanoseconds.load(std::memory_order_relaxed);
+        entry.blocking = site.blocking.load(std::memory_order_relaxed);
+        result.sites.push_back(entry);
+    }
+    if (other.acquisitions.load(std::memory_order_relaxed) != 0)
+    {
+        SiteReport entry;
+        entry.file = otherSite;
+        entry.acquisitions = other.acquisitions.load(std::memory_order_relaxed);
+        entry.contended = other.contended.load(std::memory_order_relaxed);
+        entry.waitNanoseconds = other.waitNanoseconds.load(std::memory_order_relaxed);
+        entry.blocking = other.blocking.load(std::memory_order_relaxed);
+        result.sites.push_back(entry);
+    }
+    std::stable_sort(result.sites.begin(), result.sites.end(), [](const SiteReport& a, const SiteReport& b) {
+        return a.contended + a.blocking > b.contended + b.blocking;
+    });
+    return result;
+}
+
+void
+Profile::reset()
+{
+    for (auto* counter : { &acquisitions, &contended, &waitNanoseconds, &maxWaitNanoseconds })
+        counter->store(0, std::memory_order_relaxed);
+    for (auto& count : waitHistogram)
+        count.store(0, std::memory_order_relaxed);
+    for (Site& site : siteList)
+        clear(site);
+    clear(other);
+}
+
+std::vector<LockReport>
+report(size_t top)
+{
+    std::vector<LockReport> reports;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const Profile* profile : registry())
+            reports.push_back(profile->report());
+    }
+    std::stable_sort(reports.begin(), reports.end(), [](const LockReport& a, const LockReport& b) {
+        return a.waitNanoseconds != b.waitNanoseconds ? a.waitNanoseconds > b.waitNanoseconds : a.contended > b.contended;
+    });
+    if (reports.size() > top)
+        reports.resize(top);
+    return reports;
+}
+
+std::string
+formatReport(const std::vector<LockReport>& reports, size_t sitesPerLock)
+{
+    std::string text;
+    char line[512];
+    std::snprintf(line, sizeof(line), "%-24s %12s %10s %12s %10s %10s %10s\n", "lock", "acquisitions", "contended", "wait ms", "p50 ns", "p99 ns", "max ns");
+    text += line;
+    for (const LockReport& lock : reports)
+    {
+        const double percent = lock.acquisitions == 0 ? 0.0 : 100.0 * static_cast<double>(lock.contended) / static_cast<double>(lock.acquisitions);
+        std::snprintf(line, sizeof(line), "%-24s %12llu %9.1f%% %12.3f %10llu %10llu %10llu\n", lock.name.c_str(),
+                      static_cast<unsigned long long>(lock.acquisitions), percent, static_cast<double>(lock.waitNanoseconds) / 1e6,
+                      static_cast<unsigned long long>(lock.waitPercentile(0.5)), static_cast<unsigned long long>(lock.waitPercentile(0.99)),
+                      static_cast<unsigned long long>(lock.maxWaitNanoseconds));
+        text += line;
+        for (size_t s = 0; s < std::min(sitesPerLock, lock.sites.size()); s++)
+        {
+            const SiteReport& site = lock.sites[s];
+            std::snprintf(line, sizeof(line), "    %s:%u  acquisitions %llu, waited %llu times %.3f ms, blocked others %llu times\n", site.file, site.line,
+                          static_cast<unsigned long long>(site.acquisitions), static_cast<unsigned long long>(site.contended),
+                          static_cast<double>(site.waitNanoseconds) / 1e6, static_cast<unsigned long long>(site.blocking));
+            text += line;
+        }
+    }
+    return text;
+}
+
+}
+
+}
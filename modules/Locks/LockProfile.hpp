@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ct {
+
+namespace locks {
+
+// Wait times in buckets of powers of two nanoseconds, bucket b holds [2^(b-1), 2^b).
+constexpr size_t histogramBuckets = 40;
+// Call sites tracked per lock, later sites are counted together as one "other" site
+// (file otherSite, line 0).
+constexpr size_t maxSites = 16;
+inline constexpr char otherSite[] = "other";
+
+// Statistics of one place which takes the lock.
+struct SiteReport
+{
+    const char* file = nullptr;
+    unsigned line = 0;
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    uint64_t waitNanoseconds = 0;
+    // Acquisitions by other sites which had to wait while this site held the lock.
+    uint64_t blocking = 0;
+};
+
+struct LockReport
+{
+    std::string name;
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    uint64_t waitNanoseconds = 0;
+    uint64_t maxWaitNanoseconds = 0;
+    std::array<uint64_t, histogramBuckets> waitHistogram{};
+    // Sorted by contended + blocking, the sites involved in the most contention first.
+    std::vector<SiteReport> sites;
+
+    // Upper bound of the bucket which holds the 'fraction' quantile of the contended waits.
+    uint64_t waitPercentile(double fraction) const;
+};
+
+/**
+ * Statistics of one instrumented lock (see Instrumented.hpp). The counters are only written
+ * by the thread which holds the lock, plain relaxed stores, no extra synchronization. Every
+ * profile registers itself, report() ranks all profiles alive.
+ */
+class Profile
+{
+public:
+    struct Site
+    {
+        std::atomic<const char*> file{ nullptr };
+        std::atomic<unsigned> line{ 0 };
+        std::atomic<uint64_t> acquisitions{ 0 };
+        std::atomic<uint64_t> contended{ 0 };
+        std::atomic<uint64_t> waitNanoseconds{ 0 };
+        std::atomic<uint64_t> blocking{ 0 };
+    };
+
+    explicit Profile(std::string _name);
+    ~Profile();
+
+    Profile(const Profile&) = delete;
+    Profile& operator=(const Profile&) = delete;
+
+    const std::string& name() const { return lockName; }
+
+    // Called by the new holder. 'blocker' is the site which held the lock when the wait started.
+    Site* acquired(const char* file, unsigned line, uint64_t waitNanoseconds, bool contended, Site* blocker);
+
+    LockReport report() const;
+    // Zeroes the counters, call while nobody uses the lock.
+    void reset();
+
+private:
+    Site* find(const char* file, unsigned line);
+
+    std::string lockName;
+    std::atomic<uint64_t> acquisitions{ 0 };
+    std::atomic<uint64_t> contended{ 0 };
+    std::atomic<uint64_t> waitNanoseconds{ 0 };
+    std::atomic<uint64_t> maxWaitNanoseconds{ 0 };
+    std::array<std::atomic<uint64_t>, histogramBuckets> waitHistogram{};
+    std::array<Site, maxSites> siteList;
+    // Sites beyond maxSites.
+    Site other;
+};
+
+// The 'top' instrumented locks with the most total wait time, alive at the time of the call.
+std::vector<LockReport> report(size_t top = 10);
+// A table of the reports, one line per lock and its worst call sites.
+std::string formatReport(const std::vector<LockReport>& reports, size_t sitesPerLock = 3);
+
+}
+
+}
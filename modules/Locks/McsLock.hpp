@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+#include "Backoff.hpp"
+
+namespace ct {
+
+/**
+ * Queue lock by Mellor-Crummey and Scott. Every waiter appends a node to a list and spins on
+ * a flag in its own node, the holder's unlock() clears the flag of its successor. A handover
+ * touches one line of one waiter instead of a line shared by all, contention does not grow
+ * with the number of cores. Fair like TicketLock.
+ *
+ *     ct::McsLock lock;
+ *     std::lock_guard<ct::McsLock> guard(lock);
+ *
+ * The nodes come from a small per thread pool, a thread can hold up to maxHeld MCS locks.
+ */
+class McsLock
+{
+public:
+    static constexpr size_t maxHeld = 16;
+
+    McsLock() = default;
+    McsLock(const McsLock&) = delete;
+    McsLock& operator=(const McsLock&) = delete;
+
+    void lock()
+    {
+        Node* node = acquireNode();
+        Node* previous = tail.exchange(node, std::memory_order_acq_rel);
+        if (previous != nullptr)
+        {
+            previous->next.store(node, std::memory_order_release);
+            Backoff backoff;
+            while (node->locked.load(std::memory_order_acquire))
+                backoff.pause();
+        }
+        owner = node;
+    }
+
+    bool try_lock()
+    {
+        Node* node = acquireNode();
+        Node* expected = nullptr;
+        if (!tail.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            node->used = false;
+            return false;
+        }
+        owner = node;
+        return true;
+    }
+
+    void unlock()
+    {
+        Node* node = owner;
+        Node* successor = node->next.load(std::memory_order_acquire);
+        if (successor == nullptr)
+        {
+            Node* expected = node;
+            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed))
+            {
+                node->used = false;
+                return;
+            }
+            // A thread swapped the tail and is about to link its node.
+            Backoff backoff;
+            while ((successor = node->next.load(std::memory_order_acquire)) == nullptr)
+                backoff.pause();
+        }
+        successor->locked.store(false, std::memory_order_release);
+        node->used = false;
+    }
+
+private:
+    struct alignas(64) Node
+    {
+        std::atomic<Node*> next{ nullptr };
+        std::atomic<bool> locked{ false };
+        // Only touched by the owning thread.
+        bool used = false;
+    };
+
+    static Node* acquireNode()
+    {
+        static thread_local Node nodes[maxHeld];
+        for (Node& node : nodes)
+        {
+            if (!node.used)
+            {
+                node.used = true;
+                node.next.store(nullptr, std::memory_order_relaxed);
+                node.locked.store(true, std::memory_order_relaxed);
+                return &node;
+            }
+        }
+        throw std::length_error("McsLock: more than ct::McsLock::maxHeld locks held by one thread");
+    }
+
+    std::atomic<Node*> tail{ nullptr };
+    // Node of the holder, written after the lock is taken.
+    Node* owner = nullptr;
+};
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "Backoff.hpp"
+
+namespace ct {
+
+/**
+ * Fair spin lock: lock() draws a ticket, the holder's unlock() serves the next one, threads get
+ * the lock in arrival order. Waiters spin on one shared word, every unlock invalidates it in
+ * all their caches, fine for a few cores, use McsLock for many.
+ *
+ *     ct::TicketLock lock;
+ *     std::lock_guard<ct::TicketLock> guard(lock);
+ */
+class TicketLock
+{
+public:
+    TicketLock() = default;
+    TicketLock(const TicketLock&) = delete;
+    TicketLock& operator=(const TicketLock&) = delete;
+
+    void lock()
+    {
+        const uint32_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+        Backoff backoff;
+        while (true)
+        {
+            const uint32_t current = serving.load(std::memory_order_acquire);
+            if (current == ticket)
+                return;
+            // Proportional backoff, waiters further back poll less often.
+            backoff.pause(ticket - current);
+        }
+    }
+
+    bool try_lock()
+    {
+        // Free when the next ticket is the one being served.
+        const uint32_t current = serving.load(std::memory_order_acquire);
+        uint32_t expected = current;
+        return next.compare_exchange_strong(expected, current + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock() { serving.store(serving.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+    std::atomic<uint32_t> next{ 0 };
+    std::atomic<uint32_t> serving{ 0 };
+};
+
+}
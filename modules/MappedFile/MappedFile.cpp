@@ -0,0 +1,108 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.hpp"
+
+namespace ct {
+
+MappedFile::MappedFile() = default;
+
+void
+MappedFile::AlignedDelete::operator()(char* pointer) const
+{
+    ::operator delete[](pointer, std::align_val_t{ alignment });
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapped)
+        munmap(const_cast<char*>(data), length);
+#endif
+}
+
+MappedFile::Ptr
+MappedFile::create(const std::string& path, Access access, std::string* error)
+{
+    std::string message;
+    MappedFile::Ptr ret{ new MappedFile{} };
+    if (ret->init(path, access, message))
+        return ret;
+
+    if (error != nullptr)
+        *error = message;
+    return nullptr;
+}
+
+bool
+MappedFile::init(const std::string& path, Access access, std::string& error)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = strerror(errno);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        error = strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    length = static_cast<size_t>(info.st_size);
+    // mmap fails for an empty file, an empty view is fine.
+    if (length > 0)
+    {
+        void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            error = strerror(errno);
+            close(fd);
+            return false;
+        }
+        if (access == Access::Sequential)
+            madvise(address, length, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(address);
+        mapped = true;
+    }
+
+    // The mapping stays valid after close.
+    close(fd);
+    return true;
+#else
+    (void)access;
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        error = strerror(errno);
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    length = static_cast<size_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+    // new[] of a std::string or vector only guarantees the alignment of max_align_t.
+    buffer.reset(static_cast<char*>(::operator new[](length > 0 ? length : 1, std::align_val_t{ alignment })));
+    if (!file.read(buffer.get(), static_cast<std::streamsize>(length)))
+    {
+        error = "read failed";
+        return false;
+    }
+    data = buffer.get();
+    return true;
+#endif
+}
+
+}
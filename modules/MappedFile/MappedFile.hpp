@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ct {
+
+/**
+ * Read only view of a whole file. POSIX systems map the file (mmap), pages are read
+ * by the kernel on first access and shared with the page cache, so a GB log is searched
+ * without copying it. Other systems read the file into memory.
+ * The view starts at a multiple of 'alignment' (a page when mapped), so the 64 byte
+ * aligned columns of a dataset file stay aligned in memory.
+ * Used by StringSearch for logs and by Dataset for column files.
+ */
+class MappedFile
+{
+public:
+    static constexpr size_t alignment = 64;
+
+    enum class Access
+    {
+        // Front to back, the kernel reads ahead (searches).
+        Sequential,
+        // No hint, pages are read where they are touched (columns of a dataset).
+        Normal,
+    };
+
+    using Ptr = std::unique_ptr<MappedFile>;
+    // nullptr when the file can not be opened or mapped, 'error' says why.
+    static Ptr create(const std::string& path, Access access = Access::Sequential, std::string* error = nullptr);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const { return std::string_view(data, length); }
+    size_t size() const { return length; }
+
+private:
+    bool init(const std::string& path, Access access, std::string& error);
+    MappedFile();
+
+    const char* data = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+
+    // Releases the buffer of the read fallback, allocated with 'alignment'.
+    struct AlignedDelete
+    {
+        void operator()(char* pointer) const;
+    };
+    std::unique_ptr<char[], AlignedDelete> buffer;
+};
+
+}
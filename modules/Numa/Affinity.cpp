@@ -0,0 +1,86 @@
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "Affinity.hpp"
+
+namespace ct {
+
+#if defined(__linux__)
+
+bool
+pinCurrentThread(const std::vector<unsigned>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+    // pid 0 is the calling thread, not the whole process.
+    return CPU_COUNT(&set) > 0 && sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+int
+currentCpu()
+{
+    return sched_getcpu();
+}
+
+static std::vector<unsigned>
+currentAffinity()
+{
+    std::vector<unsigned> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return cpus;
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &set))
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+#else
+
+bool
+pinCurrentThread(const std::vector<unsigned>&)
+{
+    return false;
+}
+
+int
+currentCpu()
+{
+    return -1;
+}
+
+static std::vector<unsigned>
+currentAffinity()
+{
+    return {};
+}
+
+#endif
+
+bool
+pinCurrentThread(unsigned cpu)
+{
+    return pinCurrentThread(std::vector<unsigned>{ cpu });
+}
+
+ScopedAffinity::ScopedAffinity(unsigned cpu) : previous(currentAffinity())
+{
+    pinned = !previous.empty() && pinCurrentThread(cpu);
+}
+
+ScopedAffinity::~ScopedAffinity()
+{
+    if (pinned)
+        pinCurrentThread(previous);
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+namespace ct {
+
+/**
+ * CPU affinity of the calling thread (sched_setaffinity). On other systems than Linux
+ * the functions do nothing and return false, the code still runs, only unpinned.
+ */
+
+// Pins the calling thread to one CPU.
+bool pinCurrentThread(unsigned cpu);
+// Lets the calling thread run on any of 'cpus', for example all CPUs of a NUMA node.
+bool pinCurrentThread(const std::vector<unsigned>& cpus);
+// CPU the calling thread runs on right now, -1 when unknown.
+int currentCpu();
+
+/**
+ * Pins the calling thread for the lifetime of the object and restores the previous affinity.
+ * Used for the calling thread of a parallel algorithm, which runs a part of the work itself.
+ */
+class ScopedAffinity
+{
+public:
+    explicit ScopedAffinity(unsigned cpu);
+    ~ScopedAffinity();
+
+    ScopedAffinity(const ScopedAffinity&) = delete;
+    ScopedAffinity& operator=(const ScopedAffinity&) = delete;
+
+    // False when the thread could not be pinned.
+    bool isPinned() const { return pinned; }
+
+private:
+    std::vector<unsigned> previous;
+    bool pinned = false;
+};
+
+}
@@ -0,0 +1,150 @@
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <cstdlib>
+#endif
+
+#include "NumaMemory.hpp"
+
+namespace ct {
+
+namespace numa {
+
+#if defined(__linux__)
+
+// The raw system calls, libnuma is not needed for these few.
+constexpr unsigned maskBits = 1024;
+constexpr unsigned bitsPerWord = 8 * sizeof(unsigned long);
+
+bool
+isAvailable()
+{
+    int mode = 0;
+    return syscall(SYS_get_mempolicy, &mode, nullptr, 0ul, nullptr, 0ul) == 0;
+}
+
+bool
+setMemoryPolicy(void* address, size_t size, Policy policy, const std::vector<unsigned>& nodes, bool move)
+{
+    if (address == nullptr || size == 0)
+        return false;
+
+    unsigned long mask[maskBits / bitsPerWord] = {};
+    for (unsigned node : nodes)
+    {
+        if (node < maskBits)
+            mask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+    }
+
+    int mode = MPOL_DEFAULT;
+    switch (policy)
+    {
+    case Policy::Default:
+        mode = MPOL_DEFAULT;
+        break;
+    case Policy::Bind:
+        mode = MPOL_BIND;
+        break;
+    case Policy::Preferred:
+        mode = MPOL_PREFERRED;
+        break;
+    case Policy::Interleave:
+        mode = MPOL_INTERLEAVE;
+        break;
+    }
+    if (mode != MPOL_DEFAULT && nodes.empty())
+        return false;
+
+    // mbind() works on whole pages.
+    const uintptr_t page = pageSize();
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(address) & ~(page - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(address) + size + page - 1) & ~(page - 1);
+    const unsigned long flags = move ? MPOL_MF_MOVE : 0;
+    // The kernel reads maxnode - 1 bits.
+    return syscall(SYS_mbind, begin, end - begin, mode, mode == MPOL_DEFAULT ? nullptr : mask, mode == MPOL_DEFAULT ? 0ul : maskBits + 1ul, flags) == 0;
+}
+
+int
+nodeOfAddress(const void* address)
+{
+    // move_pages() without target nodes only reports where the page is, without faulting it in.
+    void* pages[1] = { const_cast<void*>(address) };
+    int status[1] = { -1 };
+    if (syscall(SYS_move_pages, 0, 1ul, pages, nullptr, status, 0) != 0)
+        return -1;
+    return status[0] >= 0 ? status[0] : -1;
+}
+
+void*
+mapPages(size_t size)
+{
+    if (size == 0)
+        return nullptr;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+void
+unmapPages(void* address, size_t size)
+{
+    if (address != nullptr && size > 0)
+        munmap(address, size);
+}
+
+size_t
+pageSize()
+{
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+#else
+
+bool
+isAvailable()
+{
+    return false;
+}
+
+bool
+setMemoryPolicy(void*, size_t, Policy, const std::vector<unsigned>&, bool)
+{
+    return false;
+}
+
+int
+nodeOfAddress(const void*)
+{
+    return -1;
+}
+
+void*
+mapPages(size_t size)
+{
+    if (size == 0)
+        return nullptr;
+    return std::calloc(1, size);
+}
+
+void
+unmapPages(void* address, size_t)
+{
+    std::free(address);
+}
+
+size_t
+pageSize()
+{
+    return 4096;
+}
+
+#endif
+
+}
+
+}
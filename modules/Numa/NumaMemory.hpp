@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ct {
+
+namespace numa {
+
+enum class Policy
+{
+    // Local node of the thread which touches a page first (first touch).
+    Default,
+    // Only the given nodes, allocation fails over to swap rather than to other nodes.
+    Bind,
+    // The first given node while it has free memory.
+    Preferred,
+    // Pages round robin over the given nodes, for data read by all threads.
+    Interleave,
+};
+
+// True when the kernel supports memory policies, false without NUMA support or on other systems.
+bool isAvailable();
+
+/**
+ * Sets the memory policy of the pages of [address, address + size) (mbind). The policy applies
+ * to pages allocated later, pages touched already stay where they are unless 'move' is set.
+ */
+bool setMemoryPolicy(void* address, size_t size, Policy policy, const std::vector<unsigned>& nodes, bool move = false);
+
+inline bool
+bindMemory(void* address, size_t size, unsigned node, bool move = false)
+{
+    return setMemoryPolicy(address, size, Policy::Bind, { node }, move);
+}
+
+inline bool
+interleaveMemory(void* address, size_t size, const std::vector<unsigned>& nodes)
+{
+    return setMemoryPolicy(address, size, Policy::Interleave, nodes);
+}
+
+// Node of the page holding 'address', -1 when the page was not touched yet or it is unknown.
+int nodeOfAddress(const void* address);
+
+// Page aligned anonymous memory, no page is allocated before it is touched.
+void* mapPages(size_t size);
+void unmapPages(void* address, size_t size);
+
+size_t pageSize();
+
+}
+
+/**
+ * Array in anonymous memory which is not touched on allocation, unlike std::vector.
+ * Choose where the pages go before writing them: bindToNode(), interleave() or
+ * ct::firstTouch() with the partition the parallel algorithm uses (NumaParallel.hpp).
+ */
+template <typename T>
+class NumaBuffer
+{
+    static_assert(std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T>,
+                  "the pages are not initialized, only trivial types can live there");
+
+public:
+    NumaBuffer() = default;
+    explicit NumaBuffer(size_t _count) : first(static_cast<T*>(numa::mapPages(_count * sizeof(T)))), count(first != nullptr ? _count : 0) {}
+
+    ~NumaBuffer()
+    {
+        if (first != nullptr)
+            numa::unmapPages(first, count * sizeof(T));
+    }
+
+    NumaBuffer(NumaBuffer&& other) noexcept : first(std::exchange(other.first, nullptr)), count(std::exchange(other.count, 0)) {}
+    NumaBuffer& operator=(NumaBuffer&& other) noexcept
+    {
+        std::swap(first, other.first);
+        std::swap(count, other.count);
+        return *this;
+    }
+
+    T* data() { return first; }
+    const T* data() const { return first; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T* begin() { return first; }
+    T* end() { return first + count; }
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+
+    T& operator[](size_t i) { return first[i]; }
+    const T& operator[](size_t i) const { return first[i]; }
+
+    bool bindToNode(unsigned node) { return numa::bindMemory(first, count * sizeof(T), node); }
+    bool interleave(const std::vector<unsigned>& nodes) { return numa::interleaveMemory(first, count * sizeof(T), nodes); }
+
+private:
+    T* first = nullptr;
+    size_t count = 0;
+};
+
+}
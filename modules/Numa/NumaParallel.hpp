@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "Affinity.hpp"
+#include "ParallelFor.hpp"
+#include "Topology.hpp"
+
+namespace ct {
+
+struct NumaRange
+{
+    size_t begin;
+    size_t end;
+    unsigned cpu;
+    unsigned node;
+};
+
+/**
+ * Splits [0, size) into one contiguous range per thread, like parallelFor(), and gives every
+ * range a CPU. The threads are placed with 'placement' and grouped by node, so each node works
+ * on one contiguous block of the data, sized by its number of threads.
+ *
+ * Use the same partition to first touch the data and to process it, every thread then reads
+ * pages of its own node:
+ *
+ *     const auto partition = ct::numaPartition(topology, values.size());
+ *     ct::firstTouch(values.data(), partition);
+ *     ... fill the values ...
+ *     double sum = ct::numaParallelReduce(partition, 0.0, sumRange, std::plus<>());
+ */
+inline std::vector<NumaRange>
+numaPartition(const Topology& topology, size_t size, unsigned threads = 0, Topology::Placement placement = Topology::Placement::Scatter,
+              size_t minChunk = 1 << 14)
+{
+    if (threads == 0)
+        threads = static_cast<unsigned>(std::max<size_t>(1, topology.allowedCpuCount()));
+    threads = parallelThreads(size, threads, minChunk);
+
+    std::vector<unsigned> cpus = topology.placeThreads(threads, placement);
+    std::stable_sort(cpus.begin(), cpus.end(), [&topology](unsigned a, unsigned b) { return topology.nodeOfCpu(a) < topology.nodeOfCpu(b); });
+
+    std::vector<NumaRange> partition(threads);
+    const size_t chunk = (size + threads - 1) / threads;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        const size_t begin = std::min(size, t * chunk);
+        partition[t] = { begin, std::min(size, begin + chunk), cpus[t], static_cast<unsigned>(std::max(0, topology.nodeOfCpu(cpus[t]))) };
+    }
+    return partition;
+}
+
+/**
+ * Calls function(begin, end, thread) for every range of the partition on a thread pinned to
+ * the CPU of the range. The calling thread runs range 0 and gets its old affinity back.
+ */
+template <typename Function>
+void
+numaParallelFor(const std::vector<NumaRange>& partition, Function function)
+{
+    parallelRun(static_cast<unsigned>(partition.size()), [&partition, &function](unsigned t) {
+        if (t >= partition.size())
+            return;
+        ScopedAffinity pin(partition[t].cpu);
+        function(partition[t].begin, partition[t].end, t);
+    });
+}
+
+// Reduces every range with reduceRange(begin, end) on its pinned thread, then combines the results in order.
+template <typename T, typename ReduceRange, typename Combine>
+T
+numaParallelReduce(const std::vector<NumaRange>& partition, T identity, ReduceRange reduceRange, Combine combine)
+{
+    std::vector<T> partial(partition.size(), identity);
+    numaParallelFor(partition, [&partial, &reduceRange](size_t begin, size_t end, unsigned t) { partial[t] = reduceRange(begin, end); });
+
+    T result = std::move(identity);
+    for (auto& value : partial)
+        result = combine(std::move(result), std::move(value));
+    return result;
+}
+
+// Writes 'value' into every range from the thread which will process it, the pages land on its node.
+template <typename T>
+void
+firstTouch(T* data, const std::vector<NumaRange>& partition, const T& value = T{})
+{
+    numaParallelFor(partition, [data, &value](size_t begin, size_t end, unsigned) { std::fill(data + begin, data + end, value); });
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <type_traits>
+#include <vector>
+
+#include "NumaParallel.hpp"
+#include "Scan.hpp"
+
+namespace ct {
+
+/**
+ * inclusiveScanParallel() and exclusiveScanParallel() (Scan.hpp) on the pinned threads of a
+ * numaPartition() of [0, last - first). Both passes give range t to the thread on
+ * partition[t].cpu, so when the input and the output were first touched with the same
+ * partition every thread reads and writes pages of its own node.
+ *
+ *     const auto partition = ct::numaPartition(topology, lengths.size());
+ *     ct::firstTouch(lengths.data(), partition);
+ *     ct::firstTouch(offsets.data(), partition);
+ *     ... fill the lengths ...
+ *     ct::exclusiveScanParallel(partition, lengths.data(), lengths.data() + lengths.size(), offsets.data());
+ */
+template <typename T>
+T*
+inclusiveScanParallel(const std::vector<NumaRange>& partition, const T* first, const T* last, T* out, T init = T{})
+{
+    static_assert(std::is_arithmetic_v<T>, "scan needs an arithmetic type");
+    scan::scanChunks<false>(first, out, init, static_cast<unsigned>(partition.size()),
+                            [&partition](auto function) { numaParallelFor(partition, function); });
+    return out + (last - first);
+}
+
+template <typename T>
+T*
+exclusiveScanParallel(const std::vector<NumaRange>& partition, const T* first, const T* last, T* out, T init = T{})
+{
+    static_assert(std::is_arithmetic_v<T>, "scan needs an arithmetic type");
+    scan::scanChunks<true>(first, out, init, static_cast<unsigned>(partition.size()),
+                           [&partition](auto function) { numaParallelFor(partition, function); });
+    return out + (last - first);
+}
+
+}
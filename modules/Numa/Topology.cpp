@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "Topology.hpp"
+
+namespace ct {
+
+namespace numa {
+
+std::vector<unsigned>
+parseCpuList(const std::string& list)
+{
+    std::vector<unsigned> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        unsigned first = 0;
+        unsigned last = 0;
+        const int fields = std::sscanf(range.c_str(), "%u-%u", &first, &last);
+        if (fields <= 0)
+            continue;
+        if (fields == 1)
+            last = first;
+        for (unsigned cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+std::string
+formatCpuList(std::vector<unsigned> cpus)
+{
+    std::sort(cpus.begin(), cpus.end());
+    std::string list;
+    for (size_t i = 0; i < cpus.size();)
+    {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+            j++;
+        if (!list.empty())
+            list += ",";
+        list += std::to_string(cpus[i]);
+        if (j > i)
+        {
+            list += '-';
+            list += std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return list;
+}
+
+}
+
+static bool
+readFirstLine(const std::filesystem::path& path, std::string& line)
+{
+    std::ifstream file(path);
+    return static_cast<bool>(std::getline(file, line));
+}
+
+static bool
+readNumber(const std::filesystem::path& path, unsigned& value)
+{
+    std::string line;
+    if (!readFirstLine(path, line))
+        return false;
+    return std::sscanf(line.c_str(), "%u", &value) == 1;
+}
+
+// "Node 0 MemTotal:       5471992 kB"
+static uint64_t
+readNodeMemory(const std::filesystem::path& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        unsigned node = 0;
+        unsigned long long kilobytes = 0;
+        if (std::sscanf(line.c_str(), "Node %u MemTotal: %llu kB", &node, &kilobytes) == 2)
+            return kilobytes * 1024;
+    }
+    return 0;
+}
+
+// One block per processor in /proc/cpuinfo, the fallback for package and core ids.
+struct CpuinfoEntry
+{
+    unsigned package = 0;
+    unsigned core = 0;
+};
+
+static std::map<unsigned, CpuinfoEntry>
+readCpuinfo(const std::string& path, std::string& model)
+{
+    std::map<unsigned, CpuinfoEntry> entries;
+    std::ifstream file(path);
+    std::string line;
+    unsigned processor = 0;
+    while (std::getline(file, line))
+    {
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos)
+            continue;
+        std::string key = line.substr(0, colon);
+        key.erase(key.find_last_not_of(" \t") + 1);
+        const std::string value = colon + 2 <= line.size() ? line.substr(colon + 2) : "";
+
+        if (key == "processor")
+        {
+            processor = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+            entries[processor];
+        }
+        else if (key == "physical id")
+            entries[processor].package = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (key == "core id")
+            entries[processor].core = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (key == "model name" && model.empty())
+            model = value;
+    }
+    return entries;
+}
+
+static bool
+isAllowed(unsigned cpu, bool useAffinity)
+{
+#if defined(__linux__)
+    if (!useAffinity)
+        return true;
+    static const cpu_set_t mask = []() {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        {
+            for (unsigned i = 0; i < CPU_SETSIZE; i++)
+                CPU_SET(i, &set);
+        }
+        return set;
+    }();
+    return cpu >= CPU_SETSIZE || CPU_ISSET(cpu, &mask);
+#else
+    (void)cpu;
+    (void)useAffinity;
+    return true;
+#endif
+}
+
+Topology
+Topology::detect()
+{
+    return fromFiles("/sys", "/proc/cpuinfo", true);
+}
+
+Topology
+Topology::fromFiles(const std::string& sysRoot, const std::string& cpuinfo, bool useAffinity)
+{
+    namespace fs = std::filesystem;
+    const fs::path system = fs::path(sysRoot) / "devices" / "system";
+
+    Topology topology;
+    const auto entries = readCpuinfo(cpuinfo, topology.model);
+
+    std::vector<unsigned> online;
+    std::string line;
+    if (readFirstLine(system / "cpu" / "online", line))
+        online = numa::parseCpuList(line);
+    if (online.empty())
+    {
+        for (const auto& entry : entries)
+            online.push_back(entry.first);
+    }
+    if (online.empty())
+    {
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+            online.push_back(cpu);
+    }
+
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(system / "node", error))
+    {
+        const std::string name = entry.path().filename().string();
+        unsigned id = 0;
+        char rest = 0;
+        if (name.compare(0, 4, "node") != 0 || std::sscanf(name.c_str() + 4, "%u%c", &id, &rest) != 1)
+            continue;
+
+        Node node{ id, {}, readNodeMemory(entry.path() / "meminfo") };
+        if (readFirstLine(entry.path() / "cpulist", line))
+            node.cpus = numa::parseCpuList(line);
+        topology.nodeList.push_back(std::move(node));
+    }
+    if (topology.nodeList.empty())
+        topology.nodeList.push_back({ 0, online, 0 });
+    std::sort(topology.nodeList.begin(), topology.nodeList.end(), [](const Node& a, const Node& b) { return a.id < b.id; });
+
+    for (unsigned id : online)
+    {
+        Cpu cpu{ id, topology.nodeList.front().id, 0, id, isAllowed(id, useAffinity) };
+        for (const auto& node : topology.nodeList)
+        {
+            if (std::find(node.cpus.begin(), node.cpus.end(), id) != node.cpus.end())
+                cpu.node = node.id;
+        }
+
+        const fs::path cpuTopology = system / "cpu" / ("cpu" + std::to_string(id)) / "topology";
+        const auto entry = entries.find(id);
+        if (!readNumber(cpuTopology / "physical_package_id", cpu.package) && entry != entries.end())
+            cpu.package = entry->second.package;
+        if (!readNumber(cpuTopology / "core_id", cpu.core) && entry != entries.end())
+            cpu.core = entry->second.core;
+        topology.cpuList.push_back(cpu);
+    }
+
+    // Offline CPUs are not in the node lists either.
+    for (auto& node : topology.nodeList)
+    {
+        node.cpus.erase(std::remove_if(node.cpus.begin(), node.cpus.end(),
+                                       [&online](unsigned cpu) { return std::find(online.begin(), online.end(), cpu) == online.end(); }),
+                        node.cpus.end());
+    }
+    return topology;
+}
+
+size_t
+Topology::allowedCpuCount() const
+{
+    return static_cast<size_t>(std::count_if(cpuList.begin(), cpuList.end(), [](const Cpu& cpu) { return cpu.allowed; }));
+}
+
+int
+Topology::nodeOfCpu(unsigned cpu) const
+{
+    for (const auto& info : cpuList)
+    {
+        if (info.id == cpu)
+            return static_cast<int>(info.node);
+    }
+    return -1;
+}
+
+std::vector<unsigned>
+Topology::allowedCpus(unsigned node) const
+{
+    std::vector<unsigned> cpus;
+    for (const auto& cpu : cpuList)
+    {
+        if (cpu.allowed && cpu.node == node)
+            cpus.push_back(cpu.id);
+    }
+    return cpus;
+}
+
+std::vector<unsigned>
+Topology::placeThreads(unsigned threads, Placement placement) const
+{
+    std::vector<Cpu> allowed;
+    for (const auto& cpu : cpuList)
+    {
+        if (cpu.allowed)
+            allowed.push_back(cpu);
+    }
+    if (allowed.empty())
+        allowed = cpuList;
+
+    // Hyper-thread siblings are next to each other.
+    std::sort(allowed.begin(), allowed.end(), [](const Cpu& a, const Cpu& b) {
+        return std::tie(a.node, a.package, a.core, a.id) < std::tie(b.node, b.package, b.core, b.id);
+    });
+
+    std::vector<unsigned> order;
+    if (placement == Placement::Compact)
+    {
+        for (const auto& cpu : allowed)
+            order.push_back(cpu.id);
+    }
+    else
+    {
+        // Per node the first thread of every core, then the second ones, ...
+        std::vector<std::vector<unsigned>> perNode;
+        for (size_t i = 0; i < allowed.size();)
+        {
+            std::vector<std::vector<unsigned>> cores;
+            const unsigned node = allowed[i].node;
+            for (; i < allowed.size() && allowed[i].node == node;)
+            {
+                std::vector<unsigned> siblings;
+                const Cpu& first = allowed[i];
+                for (; i < allowed.size() && allowed[i].node == node && allowed[i].package == first.package && allowed[i].core == first.core; i++)
+                    siblings.push_back(allowed[i].id);
+                cores.push_back(std::move(siblings));
+            }
+
+            std::vector<unsigned> nodeOrder;
+            for (size_t thread = 0; nodeOrder.size() < allowed.size(); thread++)
+            {
+                const size_t before = nodeOrder.size();
+                for (const auto& siblings : cores)
+                {
+                    if (thread < siblings.size())
+                        nodeOrder.push_back(siblings[thread]);
+                }
+                if (nodeOrder.size() == before)
+                    break;
+            }
+            perNode.push_back(std::move(nodeOrder));
+        }
+
+        for (size_t index = 0; order.size() < allowed.size(); index++)
+        {
+            for (const auto& nodeOrder : perNode)
+            {
+                if (index < nodeOrder.size())
+                    order.push_back(nodeOrder[index]);
+            }
+        }
+    }
+
+    std::vector<unsigned> placed(threads);
+    for (unsigned t = 0; t < threads; t++)
+        placed[t] = order[t % order.size()];
+    return placed;
+}
+
+std::string
+Topology::describe() const
+{
+    std::string text = std::to_string(nodeList.size()) + (nodeList.size() == 1 ? " node, " : " nodes, ") + std::to_string(cpuList.size()) +
+                       (cpuList.size() == 1 ? " cpu (" : " cpus (");
+    for (size_t i = 0; i < nodeList.size(); i++)
+    {
+        const Node& node = nodeList[i];
+        text += (i > 0 ? ", node" : "node") + std::to_string(node.id) + ": " + numa::formatCpuList(node.cpus);
+        if (node.memoryBytes > 0)
+        {
+            char memory[32];
+            std::snprintf(memory, sizeof(memory), " %.1f GiB", static_cast<double>(node.memoryBytes) / (1024.0 * 1024.0 * 1024.0));
+            text += memory;
+        }
+    }
+    return text + ")";
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ct {
+
+/**
+ * CPUs and NUMA nodes of the machine, read from /sys/devices/system/node, /sys/devices/system/cpu
+ * and /proc/cpuinfo. Machines without NUMA (or without /sys) are one node with all CPUs.
+ * CPUs outside the affinity mask of the process (taskset, cgroups) are not used for placement.
+ */
+class Topology
+{
+public:
+    struct Cpu
+    {
+        unsigned id;
+        unsigned node;
+        unsigned package;
+        unsigned core;
+        bool allowed;
+    };
+
+    struct Node
+    {
+        unsigned id;
+        std::vector<unsigned> cpus;
+        uint64_t memoryBytes;
+    };
+
+    enum class Placement
+    {
+        // Fill one node, and both hyper-threads of a core, before the next one.
+        // Threads sharing data share the caches.
+        Compact,
+        // Round robin over the nodes, one thread per core before the hyper-thread siblings.
+        // Threads streaming their own data get the memory bandwidth of all nodes.
+        Scatter,
+    };
+
+    static Topology detect();
+    // Reads '<sysRoot>/devices/system/...' and 'cpuinfo' instead of /sys and /proc/cpuinfo,
+    // the tests describe a dual socket machine with a few files.
+    static Topology fromFiles(const std::string& sysRoot, const std::string& cpuinfo, bool useAffinity = false);
+
+    const std::vector<Cpu>& cpus() const { return cpuList; }
+    const std::vector<Node>& nodes() const { return nodeList; }
+    size_t nodeCount() const { return nodeList.size(); }
+    // CPUs the process may run on.
+    size_t allowedCpuCount() const;
+
+    // Node of a CPU, -1 when the CPU is unknown.
+    int nodeOfCpu(unsigned cpu) const;
+    // Allowed CPUs of a node.
+    std::vector<unsigned> allowedCpus(unsigned node) const;
+
+    // CPUs for 'threads' threads, starts again at the first CPU when there are more threads than CPUs.
+    std::vector<unsigned> placeThreads(unsigned threads, Placement placement) const;
+
+    const std::string& modelName() const { return model; }
+    // One line summary, for example "2 nodes, 32 cpus (node0: 0-15 64 GiB, node1: 16-31 64 GiB)".
+    std::string describe() const;
+
+private:
+    std::vector<Cpu> cpuList;
+    std::vector<Node> nodeList;
+    std::string model;
+};
+
+namespace numa {
+
+// Parses a kernel CPU list like "0-3,8,10-11".
+std::vector<unsigned> parseCpuList(const std::string& list);
+
+// Formats CPU ids as a kernel CPU list.
+std::string formatCpuList(std::vector<unsigned> cpus);
+
+}
+
+}
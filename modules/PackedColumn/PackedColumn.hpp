@@ -0,0 +1,693 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "Scan.hpp"
+
+namespace ct {
+
+// Bit packing kernels of PackedColumn.
+namespace packed {
+
+constexpr size_t blockSize = 256;
+constexpr size_t lanes = 8;
+constexpr size_t valuesPerLane = blockSize / lanes;
+
+inline unsigned
+bitWidth(uint32_t x)
+{
+    if (x == 0)
+        return 0;
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, x);
+    return static_cast<unsigned>(index) + 1;
+#else
+    return 32 - static_cast<unsigned>(__builtin_clz(x));
+#endif
+}
+
+// 8 unpacked values, one per lane.
+#if defined(__AVX2__)
+
+struct Lanes
+{
+    __m256i v;
+};
+
+inline Lanes
+loadLanes(const uint32_t* p)
+{
+    return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) };
+}
+
+inline Lanes
+zeroLanes()
+{
+    return { _mm256_setzero_si256() };
+}
+
+inline Lanes
+shiftRight(Lanes x, unsigned count)
+{
+    return { _mm256_srli_epi32(x.v, static_cast<int>(count)) };
+}
+
+inline Lanes
+shiftLeft(Lanes x, unsigned count)
+{
+    return { _mm256_slli_epi32(x.v, static_cast<int>(count)) };
+}
+
+inline Lanes
+orLanes(Lanes a, Lanes b)
+{
+    return { _mm256_or_si256(a.v, b.v) };
+}
+
+inline Lanes
+andLanes(Lanes x, uint32_t mask)
+{
+    return { _mm256_and_si256(x.v, _mm256_set1_epi32(static_cast<int>(mask))) };
+}
+
+// Writes reference + x.
+class Store
+{
+public:
+    Store(int32_t* _out, uint32_t reference) : out(_out), referenceLanes(_mm256_set1_epi32(static_cast<int>(reference))) {}
+
+    void operator()(unsigned m, Lanes x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + m * lanes), _mm256_add_epi32(x.v, referenceLanes)); }
+
+private:
+    int32_t* out;
+    __m256i referenceLanes;
+};
+
+// Writes the prefix sum of the differences reference + x, starting at 'first'. Wraps like uint32_t.
+class DeltaStore
+{
+public:
+    DeltaStore(int32_t* _out, uint32_t reference, uint32_t first)
+        : out(_out), referenceLanes(_mm256_set1_epi32(static_cast<int>(reference))), carry(_mm256_set1_epi32(static_cast<int>(first - reference)))
+    {
+    }
+
+    void operator()(unsigned m, Lanes x)
+    {
+        using Simd = scan::Simd<uint32_t>;
+        carry = Simd::add(Simd::prefix(_mm256_add_epi32(x.v, referenceLanes)), carry);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + m * lanes), carry);
+        carry = Simd::broadcastLast(carry);
+    }
+
+private:
+    int32_t* out;
+    __m256i referenceLanes;
+    __m256i carry;
+};
+
+// Counts the lanes with low <= x <= low + span (unsigned).
+class RangeCounter
+{
+public:
+    RangeCounter(uint32_t low, uint32_t span) : lowLanes(_mm256_set1_epi32(static_cast<int>(low))), spanLanes(_mm256_set1_epi32(static_cast<int>(span))) {}
+
+    void operator()(unsigned, Lanes x)
+    {
+        const __m256i offset = _mm256_sub_epi32(x.v, lowLanes);
+        // offset <= span  <=>  min(offset, span) == offset, compare lanes are -1.
+        total = _mm256_sub_epi32(total, _mm256_cmpeq_epi32(_mm256_min_epu32(offset, spanLanes), offset));
+    }
+
+    size_t result() const
+    {
+        alignas(32) uint32_t counts[lanes];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(counts), total);
+        size_t sum = 0;
+        for (uint32_t count : counts)
+            sum += count;
+        return sum;
+    }
+
+private:
+    __m256i lowLanes;
+    __m256i spanLanes;
+    __m256i total = _mm256_setzero_si256();
+};
+
+// Sums the lanes in 64 bit, 32 values of up to 32 bits per lane would overflow 32 bit sums.
+class LaneSum
+{
+public:
+    void operator()(unsigned, Lanes x)
+    {
+        even = _mm256_add_epi64(even, _mm256_and_si256(x.v, _mm256_set1_epi64x(0xffffffff)));
+        odd = _mm256_add_epi64(odd, _mm256_srli_epi64(x.v, 32));
+    }
+
+    uint64_t result() const
+    {
+        alignas(32) uint64_t sums[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(sums), _mm256_add_epi64(even, odd));
+        return sums[0] + sums[1] + sums[2] + sums[3];
+    }
+
+private:
+    __m256i even = _mm256_setzero_si256();
+    __m256i odd = _mm256_setzero_si256();
+};
+
+#else
+
+// Plain loops over 8 lanes, vectorized by the compiler where it can (SSE2).
+struct Lanes
+{
+    uint32_t v[lanes];
+};
+
+inline Lanes
+loadLanes(const uint32_t* p)
+{
+    Lanes x;
+    for (size_t j = 0; j < lanes; j++)
+        x.v[j] = p[j];
+    return x;
+}
+
+inline Lanes
+zeroLanes()
+{
+    return Lanes{};
+}
+
+inline Lanes
+shiftRight(Lanes x, unsigned count)
+{
+    for (auto& value : x.v)
+        value >>= count;
+    return x;
+}
+
+inline Lanes
+shiftLeft(Lanes x, unsigned count)
+{
+    for (auto& value : x.v)
+        value <<= count;
+    return x;
+}
+
+inline Lanes
+orLanes(Lanes a, Lanes b)
+{
+    for (size_t j = 0; j < lanes; j++)
+        a.v[j] |= b.v[j];
+    return a;
+}
+
+inline Lanes
+andLanes(Lanes x, uint32_t mask)
+{
+    for (auto& value : x.v)
+        value &= mask;
+    return x;
+}
+
+class Store
+{
+public:
+    Store(int32_t* _out, uint32_t _reference) : out(_out), reference(_reference) {}
+
+    void operator()(unsigned m, Lanes x)
+    {
+        for (size_t j = 0; j < lanes; j++)
+            out[m * lanes + j] = static_cast<int32_t>(x.v[j] + reference);
+    }
+
+private:
+    int32_t* out;
+    uint32_t reference;
+};
+
+class DeltaStore
+{
+public:
+    DeltaStore(int32_t* _out, uint32_t _reference, uint32_t first) : out(_out), reference(_reference), carry(first - _reference) {}
+
+    void operator()(unsigned m, Lanes x)
+    {
+        for (size_t j = 0; j < lanes; j++)
+        {
+            carry += x.v[j] + reference;
+            out[m * lanes + j] = static_cast<int32_t>(carry);
+        }
+    }
+
+private:
+    int32_t* out;
+    uint32_t reference;
+    uint32_t carry;
+};
+
+class RangeCounter
+{
+public:
+    RangeCounter(uint32_t _low, uint32_t _span) : low(_low), span(_span) {}
+
+    void operator()(unsigned, Lanes x)
+    {
+        for (uint32_t value : x.v)
+            total += value - low <= span;
+    }
+
+    size_t result() const { return total; }
+
+private:
+    uint32_t low;
+    uint32_t span;
+    size_t total = 0;
+};
+
+class LaneSum
+{
+public:
+    void operator()(unsigned, Lanes x)
+    {
+        for (uint32_t value : x.v)
+            total += value;
+    }
+
+    uint64_t result() const { return total; }
+
+private:
+    uint64_t total = 0;
+};
+
+#endif
+
+// Lanes of values 8 * m ... 8 * m + 7, all shifts are constants.
+template <unsigned bits, unsigned m>
+inline Lanes
+unpackLanes(const uint32_t* words)
+{
+    constexpr unsigned bit = m * bits;
+    constexpr unsigned word = bit / 32;
+    constexpr unsigned shift = bit % 32;
+    Lanes x = shiftRight(loadLanes(words + word * lanes), shift);
+    if constexpr (shift + bits > 32)
+        x = orLanes(x, shiftLeft(loadLanes(words + (word + 1) * lanes), 32 - shift));
+    if constexpr (bits < 32)
+        x = andLanes(x, (1u << bits) - 1);
+    return x;
+}
+
+template <unsigned bits, typename Visit, unsigned... m>
+inline void
+unpackUnrolled(const uint32_t* words, Visit& visit, std::integer_sequence<unsigned, m...>)
+{
+    if constexpr (bits == 0)
+        (visit(m, zeroLanes()), ...);
+    else
+        (visit(m, unpackLanes<bits, m>(words)), ...);
+}
+
+/**
+ * Calls visit(m, lanes) with values 8 * m ... 8 * m + 7 of a block packed with 'bits' bits,
+ * m = 0 ... 31, in order. Fully unrolled, a block is 32 - 64 loads, shifts and masks.
+ */
+template <unsigned bits, typename Visit>
+inline void
+unpack(const uint32_t* words, Visit& visit)
+{
+    unpackUnrolled<bits>(words, visit, std::make_integer_sequence<unsigned, valuesPerLane>());
+}
+
+template <typename Visit, unsigned... widths>
+inline void
+unpackDispatch(unsigned bits, const uint32_t* words, Visit& visit, std::integer_sequence<unsigned, widths...>)
+{
+    using Kernel = void (*)(const uint32_t*, Visit&);
+    static constexpr Kernel kernels[] = { &unpack<widths, Visit>... };
+    kernels[bits](words, visit);
+}
+
+// unpack() with the bit width known at run time, one indirect call to the kernel of the width per block.
+template <typename Visit>
+inline void
+unpackBlock(unsigned bits, const uint32_t* words, Visit& visit)
+{
+    unpackDispatch(bits, words, visit, std::make_integer_sequence<unsigned, 33>());
+}
+
+// Packs one block of 256 values below 2^bits into bits * 8 zeroed words.
+inline void
+pack(const uint32_t* values, unsigned bits, uint32_t* words)
+{
+    if (bits == 0)
+        return;
+    for (size_t i = 0; i < blockSize; i++)
+    {
+        const size_t lane = i % lanes;
+        const unsigned bit = static_cast<unsigned>(i / lanes) * bits;
+        const unsigned word = bit / 32;
+        const unsigned shift = bit % 32;
+        words[word * lanes + lane] |= values[i] << shift;
+        if (shift + bits > 32)
+            words[(word + 1) * lanes + lane] |= values[i] >> (32 - shift);
+    }
+}
+
+}
+
+/**
+ * Compressed int32 column: frame of reference, delta and bit packing in blocks of 256 values.
+ *
+ *  FrameOfReference  value = reference + packed, reference is the minimum of the block.
+ *                    Values in [-50, 50] take 7 bits instead of 32.
+ *  Delta             value[i] = value[i - 1] + reference + packed, for sorted or slowly
+ *                    changing columns like ids. Decoding adds the prefix sum of every
+ *                    unpacked register (Scan.hpp) to the last value of the one before.
+ *  Auto              the smaller of the two for every block.
+ *
+ * Every block is packed with the bit width of its largest packed value, in 8 lanes: value i
+ * of the block is in lane i % 8, and 32 bit word k of lane j is words[8 * k + j]. Unpacking
+ * 8 words at once (AVX2) gives 8 consecutive values in a register with shifts and masks only.
+ *
+ * The min and max of every block (zone map) are kept next to the packing parameters:
+ * min() and max() read the block headers only, countBetween() and find() skip blocks outside
+ * the range and count blocks inside it without touching their data. Frame of reference blocks
+ * are counted and summed in the registers the unpacking produces, the predicate is moved into
+ * the packed domain (value <= high becomes packed <= high - reference), nothing is written.
+ *
+ *     ct::PackedColumn column(values);                 // std::vector<int32_t>
+ *     size_t small = column.countBetween(-10, 10);
+ *     int64_t total = column.sum();
+ *     std::vector<int32_t> copy = column.decode();
+ */
+class PackedColumn
+{
+public:
+    enum class Encoding
+    {
+        FrameOfReference,
+        // Blocks whose values span more than 2^31 fall back to frame of reference.
+        Delta,
+        Auto,
+    };
+
+    struct Block
+    {
+        // Frame of reference: minimum of the block. Delta: minimum of the differences.
+        int32_t reference;
+        // Delta: the first value of the block.
+        int32_t first;
+        int32_t min;
+        int32_t max;
+        // Index of the first word of the block.
+        uint32_t offset;
+        uint8_t bits;
+        bool delta;
+    };
+
+    PackedColumn() = default;
+    PackedColumn(const int32_t* values, size_t count, Encoding encoding = Encoding::Auto);
+    explicit PackedColumn(const std::vector<int32_t>& values, Encoding encoding = Encoding::Auto) : PackedColumn(values.data(), values.size(), encoding) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    // Memory of the packed words and the block headers.
+    size_t packedBytes() const { return wordList.size() * sizeof(uint32_t) + blockList.size() * sizeof(Block); }
+    const std::vector<Block>& blocks() const { return blockList; }
+
+    // Frame of reference blocks unpack one value, delta blocks decode the block.
+    int32_t at(size_t index) const;
+
+    void decode(int32_t* out) const;
+    std::vector<int32_t> decode() const;
+
+    // Number of values with low <= value <= high.
+    size_t countBetween(int32_t low, int32_t high) const;
+    size_t countEqual(int32_t value) const { return countBetween(value, value); }
+    size_t countLess(int32_t value) const { return value == std::numeric_limits<int32_t>::min() ? 0 : countBetween(std::numeric_limits<int32_t>::min(), value - 1); }
+    size_t countGreater(int32_t value) const { return value == std::numeric_limits<int32_t>::max() ? 0 : countBetween(value + 1, std::numeric_limits<int32_t>::max()); }
+
+    // Index of the first value equal to 'value', size() when there is none.
+    size_t find(int32_t value) const;
+
+    int64_t sum() const;
+    // The column must not be empty.
+    int32_t min() const;
+    int32_t max() const;
+
+private:
+    size_t blockValues(size_t block) const { return std::min(packed::blockSize, count - block * packed::blockSize); }
+    // Writes all 256 values of the block, the ones after the end of the column are garbage.
+    void decodeBlock(size_t block, int32_t* out) const;
+
+    size_t count = 0;
+    std::vector<Block> blockList;
+    std::vector<uint32_t> wordList;
+};
+
+inline PackedColumn::PackedColumn(const int32_t* values, size_t _count, Encoding encoding) : count(_count)
+{
+    blockList.reserve((count + packed::blockSize - 1) / packed::blockSize);
+    uint32_t forValues[packed::blockSize];
+    uint32_t deltaValues[packed::blockSize];
+
+    for (size_t begin = 0; begin < count; begin += packed::blockSize)
+    {
+        const size_t n = std::min(packed::blockSize, count - begin);
+        const int32_t* block = values + begin;
+        const auto [minimum, maximum] = std::minmax_element(block, block + n);
+
+        Block header{ *minimum, block[0], *minimum, *maximum, static_cast<uint32_t>(wordList.size()), 0, false };
+        // Padding after the end of the column packs to 0.
+        for (size_t i = 0; i < packed::blockSize; i++)
+            forValues[i] = i < n ? static_cast<uint32_t>(static_cast<int64_t>(block[i]) - header.min) : 0;
+        header.bits = static_cast<uint8_t>(packed::bitWidth(static_cast<uint32_t>(static_cast<int64_t>(header.max) - header.min)));
+
+        // With max - min < 2^31 every difference, and every sum of consecutive differences, fits in int32_t.
+        const bool deltaFits = static_cast<int64_t>(header.max) - header.min <= std::numeric_limits<int32_t>::max();
+        if (encoding != Encoding::FrameOfReference && deltaFits)
+        {
+            // The first difference is not stored, the first value is in the header.
+            int32_t lowest = std::numeric_limits<int32_t>::max();
+            int32_t highest = std::numeric_limits<int32_t>::min();
+            for (size_t i = 1; i < n; i++)
+            {
+                const int32_t difference = block[i] - block[i - 1];
+                lowest = std::min(lowest, difference);
+                highest = std::max(highest, difference);
+            }
+            if (n == 1)
+                lowest = highest = 0;
+            const unsigned deltaBits = packed::bitWidth(static_cast<uint32_t>(static_cast<int64_t>(highest) - lowest));
+            if (encoding == Encoding::Delta || deltaBits < header.bits)
+            {
+                // The first difference and the padding pack to 0, the header's first value replaces the first one.
+                for (size_t i = 0; i < packed::blockSize; i++)
+                    deltaValues[i] = i > 0 && i < n ? static_cast<uint32_t>(static_cast<int64_t>(block[i] - block[i - 1]) - lowest) : 0;
+                header.reference = lowest;
+                header.bits = static_cast<uint8_t>(deltaBits);
+                header.delta = true;
+            }
+        }
+
+        wordList.resize(wordList.size() + header.bits * packed::lanes, 0);
+        packed::pack(header.delta ? deltaValues : forValues, header.bits, wordList.data() + header.offset);
+        blockList.push_back(header);
+    }
+}
+
+inline void
+PackedColumn::decodeBlock(size_t block, int32_t* out) const
+{
+    const Block& header = blockList[block];
+    const uint32_t* words = wordList.data() + header.offset;
+    if (header.delta)
+    {
+        packed::DeltaStore store(out, static_cast<uint32_t>(header.reference), static_cast<uint32_t>(header.first));
+        packed::unpackBlock(header.bits, words, store);
+    }
+    else
+    {
+        packed::Store store(out, static_cast<uint32_t>(header.reference));
+        packed::unpackBlock(header.bits, words, store);
+    }
+}
+
+inline void
+PackedColumn::decode(int32_t* out) const
+{
+    int32_t buffer[packed::blockSize];
+    for (size_t block = 0; block < blockList.size(); block++)
+    {
+        const size_t n = blockValues(block);
+        // Full blocks are decoded in place, the last one through the buffer.
+        if (n == packed::blockSize)
+        {
+            decodeBlock(block, out + block * packed::blockSize);
+        }
+        else
+        {
+            decodeBlock(block, buffer);
+            std::copy(buffer, buffer + n, out + block * packed::blockSize);
+        }
+    }
+}
+
+inline std::vector<int32_t>
+PackedColumn::decode() const
+{
+    std::vector<int32_t> values(count);
+    decode(values.data());
+    return values;
+}
+
+inline int32_t
+PackedColumn::at(size_t index) const
+{
+    const size_t block = index / packed::blockSize;
+    const Block& header = blockList[block];
+    const size_t i = index % packed::blockSize;
+    if (header.delta)
+    {
+        int32_t buffer[packed::blockSize];
+        decodeBlock(block, buffer);
+        return buffer[i];
+    }
+    if (header.bits == 0)
+        return header.reference;
+
+    const uint32_t* words = wordList.data() + header.offset;
+    const size_t lane = i % packed::lanes;
+    const unsigned bit = static_cast<unsigned>(i / packed::lanes) * header.bits;
+    const unsigned word = bit / 32;
+    const unsigned shift = bit % 32;
+    uint32_t value = words[word * packed::lanes + lane] >> shift;
+    if (shift + header.bits > 32)
+        value |= words[(word + 1) * packed::lanes + lane] << (32 - shift);
+    if (header.bits < 32)
+        value &= (1u << header.bits) - 1;
+    return static_cast<int32_t>(value + static_cast<uint32_t>(header.reference));
+}
+
+inline size_t
+PackedColumn::countBetween(int32_t low, int32_t high) const
+{
+    if (low > high)
+        return 0;
+
+    size_t total = 0;
+    int32_t buffer[packed::blockSize];
+    for (size_t block = 0; block < blockList.size(); block++)
+    {
+        const Block& header = blockList[block];
+        const size_t n = blockValues(block);
+        if (header.max < low || header.min > high)
+            continue;
+        if (low <= header.min && header.max <= high)
+        {
+            total += n;
+            continue;
+        }
+
+        if (header.delta)
+        {
+            decodeBlock(block, buffer);
+            for (size_t i = 0; i < n; i++)
+                total += low <= buffer[i] && buffer[i] <= high;
+            continue;
+        }
+
+        // low <= reference + packed <= high, the block overlaps the range so high >= reference.
+        const int64_t packedLow = std::max<int64_t>(static_cast<int64_t>(low) - header.reference, 0);
+        const int64_t packedHigh = static_cast<int64_t>(high) - header.reference;
+        packed::RangeCounter counter(static_cast<uint32_t>(packedLow), static_cast<uint32_t>(packedHigh - packedLow));
+        packed::unpackBlock(header.bits, wordList.data() + header.offset, counter);
+        size_t matches = counter.result();
+        // Padding is packed 0.
+        if (packedLow == 0)
+            matches -= packed::blockSize - n;
+        total += matches;
+    }
+    return total;
+}
+
+inline size_t
+PackedColumn::find(int32_t value) const
+{
+    int32_t buffer[packed::blockSize];
+    for (size_t block = 0; block < blockList.size(); block++)
+    {
+        const Block& header = blockList[block];
+        if (value < header.min || value > header.max)
+            continue;
+
+        decodeBlock(block, buffer);
+        const size_t n = blockValues(block);
+        const int32_t* found = std::find(buffer, buffer + n, value);
+        if (found != buffer + n)
+            return block * packed::blockSize + static_cast<size_t>(found - buffer);
+    }
+    return count;
+}
+
+inline int64_t
+PackedColumn::sum() const
+{
+    int64_t total = 0;
+    int32_t buffer[packed::blockSize];
+    for (size_t block = 0; block < blockList.size(); block++)
+    {
+        const Block& header = blockList[block];
+        const size_t n = blockValues(block);
+        if (header.delta)
+        {
+            decodeBlock(block, buffer);
+            for (size_t i = 0; i < n; i++)
+                total += buffer[i];
+            continue;
+        }
+
+        // Padding is packed 0 and adds nothing.
+        packed::LaneSum lanes;
+        packed::unpackBlock(header.bits, wordList.data() + header.offset, lanes);
+        total += static_cast<int64_t>(lanes.result()) + static_cast<int64_t>(n) * header.reference;
+    }
+    return total;
+}
+
+inline int32_t
+PackedColumn::min() const
+{
+    int32_t minimum = std::numeric_limits<int32_t>::max();
+    for (const auto& header : blockList)
+        minimum = std::min(minimum, header.min);
+    return minimum;
+}
+
+inline int32_t
+PackedColumn::max() const
+{
+    int32_t maximum = std::numeric_limits<int32_t>::min();
+    for (const auto& header : blockList)
+        maximum = std::max(maximum, header.max);
+    return maximum;
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace ct {
+
+// Threads used when the caller passes 0.
+inline unsigned
+hardwareThreads()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Number of threads parallelFor() uses for 'size' elements, at least 'minChunk' elements per thread.
+inline unsigned
+parallelThreads(size_t size, unsigned threads, size_t minChunk)
+{
+    if (threads == 0)
+        threads = hardwareThreads();
+    const size_t chunks = (size + std::max<size_t>(minChunk, 1) - 1) / std::max<size_t>(minChunk, 1);
+    return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, chunks)));
+}
+
+/**
+ * Calls function(thread) on 'threads' threads and waits for all of them.
+ * The calling thread runs thread 0, so parallelRun(1, ...) does not start a thread.
+ */
+template <typename Function>
+void
+parallelRun(unsigned threads, Function function)
+{
+    std::vector<std::thread> workers;
+    workers.reserve(threads > 0 ? threads - 1 : 0);
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back([&function, t]() { function(t); });
+
+    function(0u);
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+/**
+ * Splits [0, size) into contiguous chunks, one per thread, and calls
+ * function(begin, end, thread) for each of them. Returns the number of threads used.
+ */
+template <typename Function>
+unsigned
+parallelFor(size_t size, unsigned threads, Function function, size_t minChunk = 1 << 14)
+{
+    threads = parallelThreads(size, threads, minChunk);
+    const size_t chunk = (size + threads - 1) / threads;
+
+    parallelRun(threads, [&function, chunk, size](unsigned t) {
+        const size_t begin = std::min(size, t * chunk);
+        const size_t end = std::min(size, begin + chunk);
+        function(begin, end, t);
+    });
+    return threads;
+}
+
+}
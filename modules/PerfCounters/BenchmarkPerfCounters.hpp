@@ -0,0 +1,65 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include "PerfCounters.hpp"
+
+namespace ct {
+
+/**
+ * Adds perf counters to a benchmark run as user counters, averaged per iteration.
+ * Create it right before the timed loop and call stop() right after it:
+ *
+ *     ct::BenchmarkPerfCounters perf(state);
+ *     for (auto _ : state) { ... }
+ *     perf.stop();
+ *
+ * When no counter can be opened the benchmark gets a label instead.
+ */
+class BenchmarkPerfCounters
+{
+public:
+    explicit BenchmarkPerfCounters(benchmark::State& _state, const std::vector<PerfCounters::Event>& _events = PerfCounters::defaultEvents())
+        : state(_state), events(_events), counters(PerfCounters::create(events))
+    {
+        counters->start();
+    }
+
+    ~BenchmarkPerfCounters() { stop(); }
+
+    BenchmarkPerfCounters(const BenchmarkPerfCounters&) = delete;
+    BenchmarkPerfCounters& operator=(const BenchmarkPerfCounters&) = delete;
+
+    void stop()
+    {
+        if (stopped)
+            return;
+        stopped = true;
+        counters->stop();
+
+        if (!counters->isAnyAvailable())
+        {
+            state.SetLabel("perf counters unavailable");
+            return;
+        }
+
+        for (auto event : events)
+        {
+            if (counters->isAvailable(event))
+                state.counters[PerfCounters::name(event)] = benchmark::Counter(counters->value(event), benchmark::Counter::kAvgIterations);
+        }
+
+        if (counters->isAvailable(PerfCounters::Event::Cycles) && counters->isAvailable(PerfCounters::Event::Instructions))
+            state.counters["ipc"] = counters->ipc();
+    }
+
+    const PerfCounters& get() const { return *counters; }
+
+private:
+    benchmark::State& state;
+    std::vector<PerfCounters::Event> events;
+    PerfCounters::Ptr counters;
+    bool stopped = false;
+};
+
+}
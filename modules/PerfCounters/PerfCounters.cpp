@@ -0,0 +1,244 @@
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "PerfCounters.hpp"
+
+namespace ct {
+
+#if defined(__linux__)
+
+static bool
+eventConfig(PerfCounters::Event event, __u32& type, __u64& config)
+{
+    constexpr uint64_t readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    switch (event)
+    {
+    case PerfCounters::Event::Cycles:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_CPU_CYCLES;
+        return true;
+    case PerfCounters::Event::Instructions:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_INSTRUCTIONS;
+        return true;
+    case PerfCounters::Event::BranchMisses:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_BRANCH_MISSES;
+        return true;
+    case PerfCounters::Event::L1DMisses:
+        type = PERF_TYPE_HW_CACHE;
+        config = PERF_COUNT_HW_CACHE_L1D | readMiss;
+        return true;
+    case PerfCounters::Event::LLCMisses:
+        type = PERF_TYPE_HW_CACHE;
+        config = PERF_COUNT_HW_CACHE_LL | readMiss;
+        return true;
+    case PerfCounters::Event::PageFaults:
+        type = PERF_TYPE_SOFTWARE;
+        config = PERF_COUNT_SW_PAGE_FAULTS;
+        return true;
+    case PerfCounters::Event::DTLBMisses:
+        type = PERF_TYPE_HW_CACHE;
+        config = PERF_COUNT_HW_CACHE_DTLB | readMiss;
+        return true;
+    }
+    return false;
+}
+
+static int
+openEvent(PerfCounters::Event event)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    if (!eventConfig(event, attr.type, attr.config))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    attr.disabled = 1;
+    // User space only, allowed with the default perf_event_paranoid level.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Count threads started by the measured code as well.
+    attr.inherit = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+#endif
+
+PerfCounters::PerfCounters() = default;
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+    for (auto& counter : counters)
+    {
+        if (counter.fd >= 0)
+            close(counter.fd);
+    }
+#endif
+}
+
+PerfCounters::Ptr
+PerfCounters::create(const std::vector<Event>& events)
+{
+    PerfCounters::Ptr ret{ new PerfCounters{} };
+    if (ret->init(events))
+        return ret;
+    else
+        return nullptr;
+}
+
+bool
+PerfCounters::init(const std::vector<Event>& events)
+{
+    for (auto event : events)
+    {
+        Counter counter;
+        counter.event = event;
+#if defined(__linux__)
+        counter.fd = openEvent(event);
+        if (counter.fd < 0)
+            openErrors.push_back(std::string(name(event)) + ": " + strerror(errno));
+#else
+        openErrors.push_back(std::string(name(event)) + ": perf_event_open is only available on Linux");
+#endif
+        counters.push_back(counter);
+    }
+
+    // Not an error, the counters are optional. Check isAvailable().
+    return true;
+}
+
+std::vector<PerfCounters::Event>
+PerfCounters::defaultEvents()
+{
+    return { Event::Cycles, Event::Instructions, Event::BranchMisses, Event::L1DMisses, Event::LLCMisses, Event::PageFaults };
+}
+
+const char*
+PerfCounters::name(Event event)
+{
+    switch (event)
+    {
+    case Event::Cycles:
+        return "cycles";
+    case Event::Instructions:
+        return "instructions";
+    case Event::BranchMisses:
+        return "branch_misses";
+    case Event::L1DMisses:
+        return "l1d_misses";
+    case Event::LLCMisses:
+        return "llc_misses";
+    case Event::PageFaults:
+        return "page_faults";
+    case Event::DTLBMisses:
+        return "dtlb_misses";
+    }
+    return "unknown";
+}
+
+void
+PerfCounters::start()
+{
+#if defined(__linux__)
+    for (auto& counter : counters)
+    {
+        counter.value = 0.0;
+        if (counter.fd >= 0)
+            ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+    }
+    // Enable in a second loop, so opening and resetting is not counted.
+    for (auto& counter : counters)
+    {
+        if (counter.fd >= 0)
+            ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+void
+PerfCounters::stop()
+{
+#if defined(__linux__)
+    for (auto& counter : counters)
+    {
+        if (counter.fd >= 0)
+            ioctl(counter.fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    for (auto& counter : counters)
+    {
+        if (counter.fd < 0)
+            continue;
+
+        // value, time enabled, time running
+        uint64_t data[3] = { 0, 0, 0 };
+        if (read(counter.fd, data, sizeof(data)) != sizeof(data))
+            continue;
+
+        // The counter was multiplexed with other events, extrapolate.
+        counter.value = static_cast<double>(data[0]);
+        if (data[2] > 0 && data[2] < data[1])
+            counter.value *= static_cast<double>(data[1]) / static_cast<double>(data[2]);
+    }
+#endif
+}
+
+const PerfCounters::Counter*
+PerfCounters::find(Event event) const
+{
+    for (const auto& counter : counters)
+    {
+        if (counter.event == event)
+            return &counter;
+    }
+    return nullptr;
+}
+
+bool
+PerfCounters::isAvailable(Event event) const
+{
+    const Counter* counter = find(event);
+    return counter != nullptr && counter->fd >= 0;
+}
+
+bool
+PerfCounters::isAnyAvailable() const
+{
+    for (const auto& counter : counters)
+    {
+        if (counter.fd >= 0)
+            return true;
+    }
+    return false;
+}
+
+double
+PerfCounters::value(Event event) const
+{
+    const Counter* counter = find(event);
+    return counter != nullptr ? counter->value : 0.0;
+}
+
+double
+PerfCounters::ipc() const
+{
+    const double cycles = value(Event::Cycles);
+    return cycles > 0.0 ? value(Event::Instructions) / cycles : 0.0;
+}
+
+}
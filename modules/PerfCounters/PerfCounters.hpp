@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ct {
+
+/**
+ * Hardware and software performance counters of the calling thread (Linux perf_event_open).
+ *
+ * Every event is opened on its own, so the kernel can multiplex them when there
+ * are not enough hardware counters. Values are scaled by time enabled / time running.
+ * Events which can not be opened (no PMU in a VM, perf_event_paranoid, other OS)
+ * are skipped, value() returns 0 and isAvailable() false for them.
+ */
+class PerfCounters
+{
+public:
+    enum class Event
+    {
+        Cycles,
+        Instructions,
+        BranchMisses,
+        L1DMisses,
+        LLCMisses,
+        PageFaults,
+        // Loads missing the data TLB, page walks. Not part of defaultEvents().
+        DTLBMisses,
+    };
+
+    using Ptr = std::unique_ptr<PerfCounters>;
+    static Ptr create(const std::vector<Event>& events = defaultEvents());
+
+    static std::vector<Event> defaultEvents();
+    static const char* name(Event event);
+
+    ~PerfCounters();
+
+    // Reset and start counting.
+    void start();
+    // Stop counting and read the values.
+    void stop();
+
+    bool isAvailable(Event event) const;
+    // True when at least one event could be opened.
+    bool isAnyAvailable() const;
+
+    // Value measured between the last start() and stop().
+    double value(Event event) const;
+    // Instructions per cycle, 0 when cycles are not available.
+    double ipc() const;
+
+    // Events which could not be opened and why, for example "cycles: No such file or directory".
+    const std::vector<std::string>& errors() const { return openErrors; }
+
+private:
+    struct Counter
+    {
+        Event event;
+        int fd = -1;
+        double value = 0.0;
+    };
+
+    bool init(const std::vector<Event>& events);
+    PerfCounters();
+
+    const Counter* find(Event event) const;
+
+    std::vector<Counter> counters;
+    std::vector<std::string> openErrors;
+};
+
+}
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ct {
+
+/**
+ * Lazy fused pipeline over a range. Stages do not create intermediate collections,
+ * every element is pushed through all stages before the next one is read:
+ *
+ *     int sum = ct::from(v)
+ *         | ct::filter([](int i) { return i % 2 == 0; })
+ *         | ct::transform([](int i) { return i * 2; })
+ *         | ct::take(100)
+ *         | ct::reduce(0, std::plus<>());
+ *
+ * The same as copy_if + transform + accumulate, but one pass over memory and no allocations.
+ * A stage wraps the sink of the next stage, a sink returns false to stop the pass (take).
+ * Pass lambdas or function objects to the stages, function pointers are called
+ * indirectly and stop the compiler from fusing the stages into one loop.
+ */
+
+namespace pipeline {
+
+template <typename Predicate>
+struct FilterStage
+{
+    Predicate predicate;
+
+    template <typename T>
+    using Output = T;
+
+    template <typename Sink>
+    auto wrap(Sink sink) const
+    {
+        return [predicate = predicate, sink](auto&& value) mutable -> bool {
+            if (!predicate(value))
+                return true;
+            return sink(std::forward<decltype(value)>(value));
+        };
+    }
+};
+
+template <typename Function>
+struct TransformStage
+{
+    Function function;
+
+    template <typename T>
+    using Output = std::decay_t<std::invoke_result_t<const Function&, T>>;
+
+    template <typename Sink>
+    auto wrap(Sink sink) const
+    {
+        return [function = function, sink](auto&& value) mutable -> bool {
+            return sink(function(std::forward<decltype(value)>(value)));
+        };
+    }
+};
+
+struct TakeStage
+{
+    size_t count;
+
+    template <typename T>
+    using Output = T;
+
+    template <typename Sink>
+    auto wrap(Sink sink) const
+    {
+        return [count = count, taken = size_t{ 0 }, sink](auto&& value) mutable -> bool {
+            if (taken == count)
+                return false;
+            ++taken;
+            return sink(std::forward<decltype(value)>(value)) && taken < count;
+        };
+    }
+};
+
+template <typename T, typename Operation>
+struct ReduceTerminal
+{
+    T init;
+    Operation operation;
+};
+
+struct ToVectorTerminal
+{
+};
+
+// Element type after all stages.
+template <typename T, typename... Stages>
+struct OutputType
+{
+    using type = T;
+};
+
+template <typename T, typename Stage, typename... Stages>
+struct OutputType<T, Stage, Stages...>
+{
+    using type = typename OutputType<typename Stage::template Output<T>, Stages...>::type;
+};
+
+template <typename... Stages>
+constexpr bool hasTake = (std::is_same_v<Stages, TakeStage> || ...);
+
+}
+
+template <typename Iterator, typename... Stages>
+class Pipeline
+{
+public:
+    using InputType = typename std::iterator_traits<Iterator>::value_type;
+    using OutputType = typename pipeline::OutputType<InputType, Stages...>::type;
+
+    Pipeline(Iterator _first, Iterator _last, std::tuple<Stages...> _stages = {})
+        : first(_first), last(_last), stages(std::move(_stages))
+    {
+    }
+
+    template <typename Stage>
+    Pipeline<Iterator, Stages..., Stage> then(Stage stage) const
+    {
+        return { first, last, std::tuple_cat(stages, std::make_tuple(std::move(stage))) };
+    }
+
+    // Calls function(value) for every element which reaches the end of the pipeline.
+    template <typename Function>
+    void forEach(Function function) const
+    {
+        run(first, last, [&function](auto&& value) {
+            function(std::forward<decltype(value)>(value));
+            return true;
+        });
+    }
+
+    template <typename T, typename Operation>
+    T reduce(T init, Operation operation) const
+    {
+        return reduceRange(first, last, std::move(init), operation);
+    }
+
+    size_t count() const
+    {
+        return reduce(size_t{ 0 }, [](size_t total, const auto&) { return total + 1; });
+    }
+
+    std::vector<OutputType> toVector() const
+    {
+        std::vector<OutputType> result;
+        forEach([&result](auto&& value) { result.push_back(std::forward<decltype(value)>(value)); });
+        return result;
+    }
+
+    /**
+     * Reduces chunks of the input on 'threads' threads and combines the partial results.
+     * 'identity' must be the identity of 'operation' and the operation associative.
+     * Pipelines with take() depend on the order of elements and run sequentially.
+     */
+    template <typename T, typename Operation>
+    T reduceParallel(T identity, Operation operation, unsigned threads = 0, size_t minChunk = 1 << 16) const
+    {
+        static_assert(std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>,
+                      "reduceParallel needs random access iterators");
+
+        const size_t size = static_cast<size_t>(std::distance(first, last));
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<size_t>(threads, (size + minChunk - 1) / std::max<size_t>(minChunk, 1)));
+
+        if (pipeline::hasTake<Stages...> || threads <= 1)
+            return reduce(std::move(identity), operation);
+
+        std::vector<T> partial(threads, identity);
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+
+        const size_t chunk = (size + threads - 1) / threads;
+        for (unsigned t = 1; t < threads; t++)
+        {
+            workers.emplace_back([this, &partial, &identity, &operation, chunk, size, t]() {
+                const size_t begin = std::min(size, t * chunk);
+                const size_t end = std::min(size, begin + chunk);
+                partial[t] = reduceRange(first + begin, first + end, identity, operation);
+            });
+        }
+        partial[0] = reduceRange(first, first + std::min(size, chunk), identity, operation);
+
+        for (auto& worker : workers)
+            worker.join();
+
+        T result = std::move(partial[0]);
+        for (unsigned t = 1; t < threads; t++)
+            result = operation(std::move(result), std::move(partial[t]));
+        return result;
+    }
+
+private:
+    template <typename T, typename Operation>
+    T reduceRange(Iterator begin, Iterator end, T init, Operation& operation) const
+    {
+        T accumulator = std::move(init);
+        run(begin, end, [&accumulator, &operation](auto&& value) {
+            accumulator = operation(std::move(accumulator), std::forward<decltype(value)>(value));
+            return true;
+        });
+        return accumulator;
+    }
+
+    template <typename Sink>
+    void run(Iterator begin, Iterator end, Sink sink) const
+    {
+        auto head = buildSink<sizeof...(Stages)>(std::move(sink));
+        if constexpr (pipeline::hasTake<Stages...>)
+        {
+            for (; begin != end; ++begin)
+            {
+                if (!head(*begin))
+                    break;
+            }
+        }
+        else
+        {
+            // Nothing can stop the pass early, a loop without exit lets the compiler vectorize it.
+            for (; begin != end; ++begin)
+                head(*begin);
+        }
+    }
+
+    // Wraps the sink into the stages from the last one to the first one.
+    template <size_t I, typename Sink>
+    auto buildSink(Sink sink) const
+    {
+        if constexpr (I == 0)
+            return sink;
+        else
+            return buildSink<I - 1>(std::get<I - 1>(stages).wrap(std::move(sink)));
+    }
+
+    Iterator first;
+    Iterator last;
+    std::tuple<Stages...> stages;
+};
+
+// Start a pipeline over a container or an iterator range. The range must outlive the pipeline.
+template <typename Range>
+auto
+from(const Range& range)
+{
+    return Pipeline<decltype(std::begin(range))>(std::begin(range), std::end(range));
+}
+
+template <typename Iterator>
+auto
+from(Iterator first, Iterator last)
+{
+    return Pipeline<Iterator>(first, last);
+}
+
+template <typename Predicate>
+pipeline::FilterStage<Predicate>
+filter(Predicate predicate)
+{
+    return { std::move(predicate) };
+}
+
+template <typename Function>
+pipeline::TransformStage<Function>
+transform(Function function)
+{
+    return { std::move(function) };
+}
+
+inline pipeline::TakeStage
+take(size_t count)
+{
+    return { count };
+}
+
+template <typename T, typename Operation>
+pipeline::ReduceTerminal<T, Operation>
+reduce(T init, Operation operation)
+{
+    return { std::move(init), std::move(operation) };
+}
+
+inline pipeline::ToVectorTerminal
+toVector()
+{
+    return {};
+}
+
+template <typename Iterator, typename... Stages, typename Predicate>
+auto
+operator|(const Pipeline<Iterator, Stages...>& source, pipeline::FilterStage<Predicate> stage)
+{
+    return source.then(std::move(stage));
+}
+
+template <typename Iterator, typename... Stages, typename Function>
+auto
+operator|(const Pipeline<Iterator, Stages...>& source, pipeline::TransformStage<Function> stage)
+{
+    return source.then(std::move(stage));
+}
+
+template <typename Iterator, typename... Stages>
+auto
+operator|(const Pipeline<Iterator, Stages...>& source, pipeline::TakeStage stage)
+{
+    return source.then(stage);
+}
+
+template <typename Iterator, typename... Stages, typename T, typename Operation>
+T
+operator|(const Pipeline<Iterator, Stages...>& source, pipeline::ReduceTerminal<T, Operation> terminal)
+{
+    return source.reduce(std::move(terminal.init), terminal.operation);
+}
+
+template <typename Iterator, typename... Stages>
+auto
+operator|(const Pipeline<Iterator, Stages...>& source, pipeline::ToVectorTerminal)
+{
+    return source.toVector();
+}
+
+}
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace ct {
+
+namespace precision {
+
+namespace detail {
+
+/**
+ * a * b + c, one rounding with FMA. GCC contracts x * y + z in scalar code into an FMA when
+ * FMA is enabled (-ffp-contract=fast), the scalar and SIMD paths use these to round the same way.
+ */
+inline float
+multiplyAdd(float a, float b, float c)
+{
+#if defined(__FMA__)
+    return std::fma(a, b, c);
+#else
+    return a * b + c;
+#endif
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+inline __m128
+multiplyAdd(__m128 a, __m128 b, __m128 c)
+{
+#if defined(__FMA__)
+    return _mm_fmadd_ps(a, b, c);
+#else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+#endif
+
+#if defined(__AVX2__)
+inline __m256
+multiplyAdd(__m256 a, __m256 b, __m256 c)
+{
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+#endif
+
+// x * x + y * y + z * z with the same roundings for float and the vector types.
+inline float
+squaredLength(float x, float y, float z)
+{
+    return multiplyAdd(z, z, multiplyAdd(y, y, x * x));
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+inline __m128
+squaredLength(__m128 x, __m128 y, __m128 z)
+{
+    return multiplyAdd(z, z, multiplyAdd(y, y, _mm_mul_ps(x, x)));
+}
+#endif
+
+#if defined(__AVX2__)
+inline __m256
+squaredLength(__m256 x, __m256 y, __m256 z)
+{
+    return multiplyAdd(z, z, multiplyAdd(y, y, _mm256_mul_ps(x, x)));
+}
+#endif
+
+}
+
+/**
+ * Precision policies for length() and normalize() of 3D vectors, the template parameter of
+ * TemplateClass. A policy turns a squared length into a length and an inverse length:
+ *
+ *  Exact        std::sqrt, correctly rounded.
+ *  RsqrtNewton  rsqrtps (12 bit estimate) and one Newton step, no divide and no sqrt.
+ *  Squared      length() is the squared length. Only for comparing distances, it keeps their
+ *               order and skips the root. inverseLength() is exact.
+ *  Polynomial   degree 4 minimax polynomial of sqrt on the mantissa in [1, 4), the exponent is
+ *               halved with integer ops. Same result on every CPU, unlike rsqrtps which differs
+ *               between vendors.
+ *
+ * maxRelativeError bounds |result / exact - 1| of length() and inverseLength() for squared
+ * lengths which are 0 or normal floats, precision.cpp checks it on every mantissa. A length
+ * from coordinates adds the rounding of x * x + y * y + z * z, at most 2^-23.
+ *
+ * sqrtps is pipelined on current cores, the approximations win where a divide is saved
+ * (normalize with RsqrtNewton) and in the batch functions, less in scalar loops.
+ *
+ *     float distance = ct::precision::length<ct::precision::RsqrtNewton>(x, y, z);
+ *     ct::precision::lengths<ct::precision::Polynomial>(xs, ys, zs, out, count);
+ */
+struct Exact
+{
+    static constexpr double maxRelativeError = 1.2e-7;
+
+    // Also for double, the other policies compute in float.
+    template <typename T>
+    static T length(T squared)
+    {
+        return std::sqrt(squared);
+    }
+    template <typename T>
+    static T inverseLength(T squared)
+    {
+        return T(1) / std::sqrt(squared);
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    static __m128 length(__m128 squared) { return _mm_sqrt_ps(squared); }
+    static __m128 inverseLength(__m128 squared) { return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(squared)); }
+#endif
+#if defined(__AVX2__)
+    static __m256 length(__m256 squared) { return _mm256_sqrt_ps(squared); }
+    static __m256 inverseLength(__m256 squared) { return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(squared)); }
+#endif
+};
+
+struct RsqrtNewton
+{
+    // The estimate has at most 1.5 * 2^-12, the Newton step squares that to about 2^-22.
+    static constexpr double maxRelativeError = 5e-7;
+
+#if defined(__SSE2__) || defined(_M_X64)
+    static float inverseLength(float squared) { return _mm_cvtss_f32(inverseLength(_mm_set_ss(squared))); }
+    static float length(float squared) { return _mm_cvtss_f32(length(_mm_set_ss(squared))); }
+
+    static __m128 inverseLength(__m128 squared)
+    {
+        const __m128 estimate = _mm_rsqrt_ps(squared);
+        // y * (1.5 - 0.5 * x * y * y)
+        const __m128 product = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), squared), _mm_mul_ps(estimate, estimate));
+        return _mm_mul_ps(estimate, _mm_sub_ps(_mm_set1_ps(1.5f), product));
+    }
+    // x * rsqrt(x), 0 instead of 0 * infinity.
+    static __m128 length(__m128 squared) { return _mm_and_ps(_mm_mul_ps(squared, inverseLength(squared)), _mm_cmpneq_ps(squared, _mm_setzero_ps())); }
+#else
+    // No rsqrt instruction: the 0x5f3759df estimate (3.4%) needs three Newton steps.
+    static float inverseLength(float squared)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &squared, sizeof(bits));
+        bits = 0x5f3759dfu - (bits >> 1);
+        float estimate;
+        std::memcpy(&estimate, &bits, sizeof(estimate));
+        for (int i = 0; i < 3; i++)
+            estimate *= 1.5f - 0.5f * squared * estimate * estimate;
+        return squared == 0.0f ? INFINITY : estimate;
+    }
+    static float length(float squared) { return squared == 0.0f ? 0.0f : squared * inverseLength(squared); }
+#endif
+#if defined(__AVX2__)
+    static __m256 inverseLength(__m256 squared)
+    {
+        const __m256 estimate = _mm256_rsqrt_ps(squared);
+        const __m256 product = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), squared), _mm256_mul_ps(estimate, estimate));
+        return _mm256_mul_ps(estimate, _mm256_sub_ps(_mm256_set1_ps(1.5f), product));
+    }
+    static __m256 length(__m256 squared)
+    {
+        return _mm256_and_ps(_mm256_mul_ps(squared, inverseLength(squared)), _mm256_cmp_ps(squared, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+    }
+#endif
+};
+
+struct Squared
+{
+    // Exact, but length() is not a length.
+    static constexpr double maxRelativeError = Exact::maxRelativeError;
+
+    template <typename T>
+    static T length(T squared)
+    {
+        return squared;
+    }
+    template <typename T>
+    static T inverseLength(T squared)
+    {
+        return Exact::inverseLength(squared);
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    static __m128 length(__m128 squared) { return squared; }
+    static __m128 inverseLength(__m128 squared) { return Exact::inverseLength(squared); }
+#endif
+#if defined(__AVX2__)
+    static __m256 length(__m256 squared) { return squared; }
+    static __m256 inverseLength(__m256 squared) { return Exact::inverseLength(squared); }
+#endif
+};
+
+struct Polynomial
+{
+    // The polynomial has 2.52e-4 on [1, 4), float evaluation adds a few ulps.
+    static constexpr double maxRelativeError = 2.6e-4;
+
+    static constexpr float c0 = 0.38090142f;
+    static constexpr float c1 = 0.773151635f;
+    static constexpr float c2 = -0.184486001f;
+    static constexpr float c3 = 0.0332149067f;
+    static constexpr float c4 = -0.00253120201f;
+
+    static float length(float squared)
+    {
+        if (squared == 0.0f)
+            return 0.0f;
+        uint32_t bits;
+        std::memcpy(&bits, &squared, sizeof(bits));
+        // squared = m * 2^(2 * half), m in [1, 4), sqrt = sqrt(m) * 2^half.
+        const int32_t exponent = static_cast<int32_t>(bits >> 23) - 127;
+        const int32_t half = exponent >> 1;
+        const uint32_t mantissaBits = (bits & 0x7fffffu) | static_cast<uint32_t>(127 + exponent - 2 * half) << 23;
+        float m;
+        std::memcpy(&m, &mantissaBits, sizeof(m));
+        const float root = detail::multiplyAdd(m, detail::multiplyAdd(m, detail::multiplyAdd(m, detail::multiplyAdd(m, c4, c3), c2), c1), c0);
+        uint32_t rootBits;
+        std::memcpy(&rootBits, &root, sizeof(rootBits));
+        rootBits += static_cast<uint32_t>(half) << 23;
+        float result;
+        std::memcpy(&result, &rootBits, sizeof(result));
+        return result;
+    }
+    static float inverseLength(float squared) { return 1.0f / length(squared); }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    static __m128 length(__m128 squared)
+    {
+        const __m128i bits = _mm_castps_si128(squared);
+        const __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+        const __m128i half = _mm_srai_epi32(exponent, 1);
+        const __m128i odd = _mm_sub_epi32(exponent, _mm_add_epi32(half, half));
+        const __m128i mantissaBits = _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x7fffff)), _mm_slli_epi32(_mm_add_epi32(odd, _mm_set1_epi32(127)), 23));
+        const __m128 m = _mm_castsi128_ps(mantissaBits);
+        __m128 root = detail::multiplyAdd(m, _mm_set1_ps(c4), _mm_set1_ps(c3));
+        root = detail::multiplyAdd(m, root, _mm_set1_ps(c2));
+        root = detail::multiplyAdd(m, root, _mm_set1_ps(c1));
+        root = detail::multiplyAdd(m, root, _mm_set1_ps(c0));
+        const __m128 result = _mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(root), _mm_slli_epi32(half, 23)));
+        return _mm_and_ps(result, _mm_cmpneq_ps(squared, _mm_setzero_ps()));
+    }
+    static __m128 inverseLength(__m128 squared) { return _mm_div_ps(_mm_set1_ps(1.0f), length(squared)); }
+#endif
+#if defined(__AVX2__)
+    static __m256 length(__m256 squared)
+    {
+        const __m256i bits = _mm256_castps_si256(squared);
+        const __m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+        const __m256i half = _mm256_srai_epi32(exponent, 1);
+        const __m256i odd = _mm256_sub_epi32(exponent, _mm256_add_epi32(half, half));
+        const __m256i mantissaBits =
+            _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x7fffff)), _mm256_slli_epi32(_mm256_add_epi32(odd, _mm256_set1_epi32(127)), 23));
+        const __m256 m = _mm256_castsi256_ps(mantissaBits);
+        __m256 root = detail::multiplyAdd(m, _mm256_set1_ps(c4), _mm256_set1_ps(c3));
+        root = detail::multiplyAdd(m, root, _mm256_set1_ps(c2));
+        root = detail::multiplyAdd(m, root, _mm256_set1_ps(c1));
+        root = detail::multiplyAdd(m, root, _mm256_set1_ps(c0));
+        const __m256 result = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(root), _mm256_slli_epi32(half, 23)));
+        return _mm256_and_ps(result, _mm256_cmp_ps(squared, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+    }
+    static __m256 inverseLength(__m256 squared) { return _mm256_div_ps(_mm256_set1_ps(1.0f), length(squared)); }
+#endif
+};
+
+template <typename Policy = Exact>
+inline float
+length(float x, float y, float z)
+{
+    return Policy::length(detail::squaredLength(x, y, z));
+}
+
+// A zero vector becomes infinity or NaN times zero, like x / length.
+template <typename Policy = Exact>
+inline void
+normalize(float& x, float& y, float& z)
+{
+    const float inverse = Policy::inverseLength(detail::squaredLength(x, y, z));
+    x *= inverse;
+    y *= inverse;
+    z *= inverse;
+}
+
+/**
+ * Batch versions on coordinate arrays (SoA), 8 vectors per step with AVX2, 4 with SSE2.
+ */
+template <typename Policy = Exact>
+inline void
+lengths(const float* xs, const float* ys, const float* zs, float* out, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(xs + i);
+        const __m256 y = _mm256_loadu_ps(ys + i);
+        const __m256 z = _mm256_loadu_ps(zs + i);
+        const __m256 squared = detail::squaredLength(x, y, z);
+        _mm256_storeu_ps(out + i, Policy::length(squared));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(xs + i);
+        const __m128 y = _mm_loadu_ps(ys + i);
+        const __m128 z = _mm_loadu_ps(zs + i);
+        const __m128 squared = detail::squaredLength(x, y, z);
+        _mm_storeu_ps(out + i, Policy::length(squared));
+    }
+#endif
+    for (; i < count; i++)
+        out[i] = length<Policy>(xs[i], ys[i], zs[i]);
+}
+
+template <typename Policy = Exact>
+inline void
+normalize(float* xs, float* ys, float* zs, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(xs + i);
+        const __m256 y = _mm256_loadu_ps(ys + i);
+        const __m256 z = _mm256_loadu_ps(zs + i);
+        const __m256 inverse = Policy::inverseLength(detail::squaredLength(x, y, z));
+        _mm256_storeu_ps(xs + i, _mm256_mul_ps(x, inverse));
+        _mm256_storeu_ps(ys + i, _mm256_mul_ps(y, inverse));
+        _mm256_storeu_ps(zs + i, _mm256_mul_ps(z, inverse));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(xs + i);
+        const __m128 y = _mm_loadu_ps(ys + i);
+        const __m128 z = _mm_loadu_ps(zs + i);
+        const __m128 inverse = Policy::inverseLength(detail::squaredLength(x, y, z));
+        _mm_storeu_ps(xs + i, _mm_mul_ps(x, inverse));
+        _mm_storeu_ps(ys + i, _mm_mul_ps(y, inverse));
+        _mm_storeu_ps(zs + i, _mm_mul_ps(z, inverse));
+    }
+#endif
+    for (; i < count; i++)
+        normalize<Policy>(xs[i], ys[i], zs[i]);
+}
+
+}
+
+}
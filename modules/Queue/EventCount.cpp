@@ -0,0 +1,56 @@
+#include <climits>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "EventCount.hpp"
+
+namespace ct {
+
+#if defined(__linux__)
+
+// std::atomic<uint32_t> has the size and the representation of uint32_t, the futex word.
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a 32 bit word");
+
+void
+EventCount::wait(uint32_t key)
+{
+    // Returns at once with EAGAIN when the epoch is not 'key' anymore.
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void
+EventCount::wake()
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#else
+
+void
+EventCount::wait(uint32_t key)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this, key]() { return epoch.load(std::memory_order_seq_cst) != key; });
+    }
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void
+EventCount::wake()
+{
+    // The lock makes sure a waiter is either before its check or inside wait().
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    condition.notify_all();
+}
+
+#endif
+
+}
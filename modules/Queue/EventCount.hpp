@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#if !defined(__linux__)
+#include <condition_variable>
+#include <mutex>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace ct {
+
+// Pause instruction for spin loops, frees the core for the sibling hyper thread.
+inline void
+cpuRelax()
+{
+#if defined(__SSE2__) || defined(_M_X64)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/**
+ * Lets threads sleep until another thread notifies them, without a syscall on the notify side
+ * when nobody sleeps. Linux uses a futex on the epoch counter, other systems a condition variable.
+ *
+ *     uint32_t key = event.prepareWait();
+ *     if (ready())
+ *         event.cancelWait();
+ *     else
+ *         event.wait(key);
+ *
+ * The notifier makes the condition true first and then calls notifyAll(). A notify between
+ * prepareWait() and wait() changes the epoch and wait() returns immediately, no wakeup is lost.
+ */
+class EventCount
+{
+public:
+    EventCount() = default;
+    EventCount(const EventCount&) = delete;
+    EventCount& operator=(const EventCount&) = delete;
+
+    uint32_t prepareWait()
+    {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        return epoch.load(std::memory_order_seq_cst);
+    }
+
+    void cancelWait() { waiters.fetch_sub(1, std::memory_order_relaxed); }
+
+    // Sleeps until the epoch differs from 'key'. May return spuriously, check the condition again.
+    void wait(uint32_t key);
+
+    void notifyAll()
+    {
+        if (hasWaiters())
+            wakeWaiters();
+    }
+
+    // True when a thread is between prepareWait() and the end of its wait. Call after changing the condition.
+    bool hasWaiters()
+    {
+        // Orders the change of the condition before the load of waiters (Dekker with prepareWait).
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return waiters.load(std::memory_order_relaxed) != 0;
+    }
+
+    // The slow half of notifyAll(), only after hasWaiters() returned true.
+    void wakeWaiters()
+    {
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+        wake();
+    }
+
+private:
+    void wake();
+
+    std::atomic<uint32_t> epoch{ 0 };
+    std::atomic<uint32_t> waiters{ 0 };
+#if !defined(__linux__)
+    std::mutex mutex;
+    std::condition_variable condition;
+#endif
+};
+
+/**
+ * What a blocking queue operation does while the queue is full or empty:
+ *  Spin:           retry with a pause instruction, lowest latency, burns the core.
+ *  SpinYield:      spin a while, then std::this_thread::yield() between retries.
+ *  SpinYieldBlock: spin, yield, then sleep in the EventCount until notified.
+ * Spinning only helps when producer and consumer run on different cores at the same time.
+ */
+enum class WaitStrategy
+{
+    Spin,
+    SpinYield,
+    SpinYieldBlock,
+};
+
+/**
+ * Calls attempt() until it returns true, waiting as the strategy says.
+ * 'event' must be notified after every change which can make attempt() succeed.
+ */
+template <typename Attempt>
+void
+waitUntil(WaitStrategy strategy, EventCount& event, Attempt attempt)
+{
+    constexpr unsigned spins = 128;
+    constexpr unsigned yields = 16;
+
+    for (unsigned i = 0; i < spins || strategy == WaitStrategy::Spin; i++)
+    {
+        if (attempt())
+            return;
+        cpuRelax();
+    }
+    for (unsigned i = 0; i < yields || strategy == WaitStrategy::SpinYield; i++)
+    {
+        if (attempt())
+            return;
+        std::this_thread::yield();
+    }
+    while (true)
+    {
+        const uint32_t key = event.prepareWait();
+        if (attempt())
+        {
+            event.cancelWait();
+            return;
+        }
+        event.wait(key);
+    }
+}
+
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "EventCount.hpp"
+
+namespace ct {
+
+// Separates data written by different threads, 64 bytes on x86 and most ARM cores.
+constexpr size_t cacheLineSize = 64;
+
+/**
+ * Bounded multi producer multi consumer queue without locks (Dmitry Vyukov's ring).
+ *
+ * Every cell has a sequence number which says whose turn it is: sequence == position
+ * means free for the producer of 'position', sequence == position + 1 means full for
+ * its consumer. A producer claims a position with one CAS on the enqueue counter and
+ * publishes the value with a release store of the sequence, so producers and consumers
+ * only contend on their own counter, which lives on its own cache line.
+ *
+ * tryPush/tryPop never block. push/pop wait as the WaitStrategy says. Batch operations
+ * claim several consecutive cells with one CAS. T must be default constructible and movable.
+ */
+template <typename T>
+class MpmcQueue
+{
+public:
+    // The capacity is rounded up to a power of two.
+    explicit MpmcQueue(size_t capacity, WaitStrategy _strategy = WaitStrategy::SpinYieldBlock)
+        : strategy(_strategy)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    template <typename U>
+    bool tryPush(U&& value)
+    {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = cells[position & mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const ptrdiff_t difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position);
+            if (difference == 0)
+            {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::forward<U>(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    notify(notEmpty);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+                return false; // Full, the consumer of the previous lap has not read the cell.
+            else
+                position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPop(T& value)
+    {
+        size_t position = dequeuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = cells[position & mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const ptrdiff_t difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position + 1);
+            if (difference == 0)
+            {
+                if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.value);
+                    cell.sequence.store(position + mask + 1, std::memory_order_release);
+                    notify(notFull);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+                return false; // Empty.
+            else
+                position = dequeuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Pushes up to 'count' values from 'values', returns how many. The values are consecutive in the queue.
+    size_t tryPushBatch(const T* values, size_t count)
+    {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            // Free cells from 'position' on. They stay free until the CAS claims them,
+            // only the producer of a position may fill its cell.
+            size_t free = 0;
+            while (free < count && free <= mask && cells[(position + free) & mask].sequence.load(std::memory_order_acquire) == position + free)
+                free++;
+            if (free == 0)
+            {
+                const size_t sequence = cells[position & mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position) < 0)
+                    return 0;
+                position = enqueuePosition.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (enqueuePosition.compare_exchange_weak(position, position + free, std::memory_order_relaxed))
+            {
+                for (size_t i = 0; i < free; i++)
+                {
+                    Cell& cell = cells[(position + i) & mask];
+                    cell.value = values[i];
+                    cell.sequence.store(position + i + 1, std::memory_order_release);
+                }
+                notify(notEmpty);
+                return free;
+            }
+        }
+    }
+
+    // Pops up to 'count' values into 'values', returns how many.
+    size_t tryPopBatch(T* values, size_t count)
+    {
+        size_t position = dequeuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            size_t full = 0;
+            while (full < count && full <= mask && cells[(position + full) & mask].sequence.load(std::memory_order_acquire) == position + full + 1)
+                full++;
+            if (full == 0)
+            {
+                const size_t sequence = cells[position & mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position + 1) < 0)
+                    return 0;
+                position = dequeuePosition.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (dequeuePosition.compare_exchange_weak(position, position + full, std::memory_order_relaxed))
+            {
+                for (size_t i = 0; i < full; i++)
+                {
+                    Cell& cell = cells[(position + i) & mask];
+                    values[i] = std::move(cell.value);
+                    cell.sequence.store(position + i + mask + 1, std::memory_order_release);
+                }
+                notify(notFull);
+                return full;
+            }
+        }
+    }
+
+    template <typename U>
+    void push(U&& value)
+    {
+        waitUntil(strategy, notFull, [this, &value]() { return tryPush(std::forward<U>(value)); });
+    }
+
+    T pop()
+    {
+        T value;
+        waitUntil(strategy, notEmpty, [this, &value]() { return tryPop(value); });
+        return value;
+    }
+
+    // Pushes all values, waits while the queue is full.
+    void pushBatch(const T* values, size_t count)
+    {
+        while (count > 0)
+        {
+            size_t pushed = 0;
+            waitUntil(strategy, notFull, [&]() { return (pushed = tryPushBatch(values, count)) > 0; });
+            values += pushed;
+            count -= pushed;
+        }
+    }
+
+    // Waits for at least one value, then pops up to 'count' of them.
+    size_t popBatch(T* values, size_t count)
+    {
+        size_t popped = 0;
+        waitUntil(strategy, notEmpty, [&]() { return (popped = tryPopBatch(values, count)) > 0; });
+        return popped;
+    }
+
+    // Approximate when other threads push or pop at the same time.
+    size_t size() const
+    {
+        const size_t enqueued = enqueuePosition.load(std::memory_order_relaxed);
+        const size_t dequeued = dequeuePosition.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+private:
+    // Only SpinYieldBlock sleeps in the events, the other strategies skip the fence of hasWaiters().
+    void notify(EventCount& event)
+    {
+        if (strategy == WaitStrategy::SpinYieldBlock && event.hasWaiters())
+            event.wakeWaiters();
+    }
+
+    // One cell per cache line: neighbouring positions belong to different producers and
+    // consumers, unpadded cells would make them write the same line.
+    struct alignas(cacheLineSize) Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    alignas(cacheLineSize) std::atomic<size_t> enqueuePosition{ 0 };
+    alignas(cacheLineSize) std::atomic<size_t> dequeuePosition{ 0 };
+    alignas(cacheLineSize) std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    WaitStrategy strategy;
+    EventCount notEmpty;
+    EventCount notFull;
+};
+
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "EventCount.hpp"
+#include "MpmcQueue.hpp"
+
+namespace ct {
+
+/**
+ * Bounded queue for exactly one producer thread and one consumer thread (Lamport ring).
+ *
+ * No CAS and no per cell sequence: the producer owns 'tail', the consumer owns 'head',
+ * each publishes its index with a release store. Both keep a cached copy of the other
+ * index and only reload it when the cached one says the queue is full or empty, so the
+ * cache lines move between the cores once per batch instead of once per element.
+ * Same interface as MpmcQueue.
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    // The capacity is rounded up to a power of two.
+    explicit SpscQueue(size_t capacity, WaitStrategy _strategy = WaitStrategy::SpinYieldBlock)
+        : strategy(_strategy)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        mask = size - 1;
+        values.reset(new T[size]);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    template <typename U>
+    bool tryPush(U&& value)
+    {
+        const size_t position = producer.index;
+        if (position - producer.cachedOther > mask)
+        {
+            producer.cachedOther = head.load(std::memory_order_acquire);
+            if (position - producer.cachedOther > mask)
+                return false;
+        }
+        values[position & mask] = std::forward<U>(value);
+        producer.index = position + 1;
+        tail.store(position + 1, std::memory_order_release);
+        notify(notEmpty);
+        return true;
+    }
+
+    bool tryPop(T& value)
+    {
+        const size_t position = consumer.index;
+        if (position == consumer.cachedOther)
+        {
+            consumer.cachedOther = tail.load(std::memory_order_acquire);
+            if (position == consumer.cachedOther)
+                return false;
+        }
+        value = std::move(values[position & mask]);
+        consumer.index = position + 1;
+        head.store(position + 1, std::memory_order_release);
+        notify(notFull);
+        return true;
+    }
+
+    // Pushes up to 'count' values with one release store, returns how many.
+    size_t tryPushBatch(const T* batch, size_t count)
+    {
+        const size_t position = producer.index;
+        size_t free = mask + 1 - (position - producer.cachedOther);
+        if (free < count)
+        {
+            producer.cachedOther = head.load(std::memory_order_acquire);
+            free = mask + 1 - (position - producer.cachedOther);
+        }
+        count = std::min(count, free);
+        if (count == 0)
+            return 0;
+
+        for (size_t i = 0; i < count; i++)
+            values[(position + i) & mask] = batch[i];
+        producer.index = position + count;
+        tail.store(position + count, std::memory_order_release);
+        notify(notEmpty);
+        return count;
+    }
+
+    // Pops up to 'count' values with one release store, returns how many.
+    size_t tryPopBatch(T* batch, size_t count)
+    {
+        const size_t position = consumer.index;
+        size_t full = consumer.cachedOther - position;
+        if (full < count)
+        {
+            consumer.cachedOther = tail.load(std::memory_order_acquire);
+            full = consumer.cachedOther - position;
+        }
+        count = std::min(count, full);
+        if (count == 0)
+            return 0;
+
+        for (size_t i = 0; i < count; i++)
+            batch[i] = std::move(values[(position + i) & mask]);
+        consumer.index = position + count;
+        head.store(position + count, std::memory_order_release);
+        notify(notFull);
+        return count;
+    }
+
+    template <typename U>
+    void push(U&& value)
+    {
+        waitUntil(strategy, notFull, [this, &value]() { return tryPush(std::forward<U>(value)); });
+    }
+
+    T pop()
+    {
+        T value;
+        waitUntil(strategy, notEmpty, [this, &value]() { return tryPop(value); });
+        return value;
+    }
+
+    // Pushes all values, waits while the queue is full.
+    void pushBatch(const T* batch, size_t count)
+    {
+        while (count > 0)
+        {
+            size_t pushed = 0;
+            waitUntil(strategy, notFull, [&]() { return (pushed = tryPushBatch(batch, count)) > 0; });
+            batch += pushed;
+            count -= pushed;
+        }
+    }
+
+    // Waits for at least one value, then pops up to 'count' of them.
+    size_t popBatch(T* batch, size_t count)
+    {
+        size_t popped = 0;
+        waitUntil(strategy, notEmpty, [&]() { return (popped = tryPopBatch(batch, count)) > 0; });
+        return popped;
+    }
+
+    // Approximate when the other thread pushes or pops at the same time.
+    size_t size() const
+    {
+        const size_t pushed = tail.load(std::memory_order_relaxed);
+        const size_t popped = head.load(std::memory_order_relaxed);
+        return pushed > popped ? pushed - popped : 0;
+    }
+
+private:
+    // Only SpinYieldBlock sleeps in the events, the other strategies skip the fence of hasWaiters().
+    void notify(EventCount& event)
+    {
+        if (strategy == WaitStrategy::SpinYieldBlock && event.hasWaiters())
+            event.wakeWaiters();
+    }
+
+    // Index owned by one side and its cached copy of the index of the other side.
+    struct alignas(cacheLineSize) Side
+    {
+        size_t index = 0;
+        size_t cachedOther = 0;
+    };
+
+    alignas(cacheLineSize) std::atomic<size_t> head{ 0 };
+    alignas(cacheLineSize) std::atomic<size_t> tail{ 0 };
+    Side consumer;
+    Side producer;
+    alignas(cacheLineSize) std::unique_ptr<T[]> values;
+    size_t mask = 0;
+    WaitStrategy strategy;
+    EventCount notEmpty;
+    EventCount notFull;
+};
+
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace ct {
+
+/**
+ * Small fast random generators for test data and sampling, with reproducible seeds.
+ *
+ * std::mt19937 keeps 2.5 KiB of state, refills it every 624 outputs and
+ * std::uniform_int_distribution divides for every number. The generators here keep
+ * 32 bytes, need a few shifts, xors and one multiply per 64 bits and the same seed
+ * gives the same sequence on every platform and standard library (std distributions
+ * do not). All are UniformRandomBitGenerators and work with std::shuffle and std distributions.
+ * Not for cryptography.
+ */
+
+inline uint64_t
+rotateLeft(uint64_t x, unsigned count)
+{
+    return (x << count) | (x >> ((64 - count) & 63));
+}
+
+// Seeds other generators, every 64 bit seed gives a well mixed sequence (Steele, Lea, Flood).
+class SplitMix64
+{
+public:
+    using result_type = uint64_t;
+
+    explicit SplitMix64(uint64_t seed = 0) : state(seed) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+    result_type operator()()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+private:
+    uint64_t state;
+};
+
+/**
+ * xoshiro256** by Blackman and Vigna, period 2^256 - 1.
+ * jump() advances by 2^128 outputs: call it once per thread on copies of one generator
+ * for 2^128 non overlapping streams. longJump() advances by 2^192.
+ */
+class Xoshiro256StarStar
+{
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256StarStar(uint64_t seed = 0)
+    {
+        SplitMix64 seeder(seed);
+        for (auto& word : state)
+            word = seeder();
+    }
+
+    // Seed for the task 'stream' of a computation seeded with 'seed', independent of thread count.
+    Xoshiro256StarStar(uint64_t seed, uint64_t stream) : Xoshiro256StarStar(SplitMix64(seed ^ rotateLeft(stream, 32))() + stream) {}
+
+    // The raw state, must not be all zero.
+    static Xoshiro256StarStar fromState(uint64_t s0, uint64_t s1, uint64_t s2, uint64_t s3)
+    {
+        Xoshiro256StarStar generator;
+        generator.state[0] = s0;
+        generator.state[1] = s1;
+        generator.state[2] = s2;
+        generator.state[3] = s3;
+        return generator;
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+    result_type operator()()
+    {
+        const uint64_t result = rotateLeft(state[1] * 5, 7) * 9;
+        const uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotateLeft(state[3], 45);
+        return result;
+    }
+
+    void jump()
+    {
+        static constexpr uint64_t polynomial[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+        jumpWith(polynomial);
+    }
+
+    void longJump()
+    {
+        static constexpr uint64_t polynomial[] = { 0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+        jumpWith(polynomial);
+    }
+
+    const uint64_t* getState() const { return state; }
+
+private:
+    void jumpWith(const uint64_t (&polynomial)[4])
+    {
+        uint64_t result[4] = { 0, 0, 0, 0 };
+        for (uint64_t word : polynomial)
+        {
+            for (unsigned bit = 0; bit < 64; bit++)
+            {
+                if (word & (uint64_t{ 1 } << bit))
+                {
+                    for (unsigned i = 0; i < 4; i++)
+                        result[i] ^= state[i];
+                }
+                (*this)();
+            }
+        }
+        for (unsigned i = 0; i < 4; i++)
+            state[i] = result[i];
+    }
+
+    uint64_t state[4];
+};
+
+#if defined(__SIZEOF_INT128__)
+
+/**
+ * PCG64 (XSL RR 128/64) by O'Neill, the generator of pcg64 in pcg-cpp and numpy.
+ * A 128 bit LCG with a permuted output. Every odd increment ('stream') is its own
+ * sequence, advance(n) skips n outputs in O(log n). Needs a compiler with 128 bit integers.
+ */
+class Pcg64
+{
+public:
+    using result_type = uint64_t;
+
+    explicit Pcg64(uint64_t seed = 0, uint64_t stream = 0xda3e39cb94b95bdbULL)
+        : increment((static_cast<unsigned __int128>(stream) << 1) | 1)
+    {
+        state = (seed + increment) * multiplier() + increment;
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+    result_type operator()()
+    {
+        state = state * multiplier() + increment;
+        const uint64_t xored = static_cast<uint64_t>(state >> 64) ^ static_cast<uint64_t>(state);
+        const unsigned rotation = static_cast<unsigned>(state >> 122);
+        return (xored >> rotation) | (xored << ((64 - rotation) & 63));
+    }
+
+    // Skips 'delta' outputs (Brown, "Random number generation with arbitrary strides").
+    void advance(unsigned __int128 delta)
+    {
+        unsigned __int128 multiply = multiplier();
+        unsigned __int128 add = increment;
+        unsigned __int128 accumulatedMultiply = 1;
+        unsigned __int128 accumulatedAdd = 0;
+        while (delta > 0)
+        {
+            if (delta & 1)
+            {
+                accumulatedMultiply *= multiply;
+                accumulatedAdd = accumulatedAdd * multiply + add;
+            }
+            add = (multiply + 1) * add;
+            multiply *= multiply;
+            delta >>= 1;
+        }
+        state = accumulatedMultiply * state + accumulatedAdd;
+    }
+
+private:
+    static constexpr unsigned __int128 multiplier()
+    {
+        return (static_cast<unsigned __int128>(2549297995355413924ULL) << 64) | 4865540595714422341ULL;
+    }
+
+    unsigned __int128 state;
+    unsigned __int128 increment;
+};
+
+#endif
+
+// Random bits of one output, std::mt19937 has 32 bits in a 64 bit result_type.
+template <typename Generator>
+constexpr unsigned
+generatorBits()
+{
+    unsigned bits = 0;
+    for (auto max = Generator::max(); max != 0; max >>= 1)
+        bits++;
+    return bits;
+}
+
+/**
+ * Uniform integer in [0, range) with Lemire's nearly divisionless method: the high half
+ * of random * range is the result, the low half decides whether the value is biased.
+ * Division only happens in the rare rejection case. range must not be 0.
+ * 32 bit ranges use one 64 bit multiply and half of a 64 bit output.
+ */
+template <typename Generator>
+uint32_t
+boundedRandom32(Generator& generator, uint32_t range)
+{
+    static_assert(Generator::min() == 0 && generatorBits<Generator>() >= 32, "needs at least 32 random bits");
+    constexpr unsigned shift = generatorBits<Generator>() - 32;
+
+    uint64_t product = static_cast<uint64_t>(static_cast<uint32_t>(generator() >> shift)) * range;
+    uint32_t low = static_cast<uint32_t>(product);
+    if (low < range)
+    {
+        const uint32_t threshold = static_cast<uint32_t>(-range) % range;
+        while (low < threshold)
+        {
+            product = static_cast<uint64_t>(static_cast<uint32_t>(generator() >> shift)) * range;
+            low = static_cast<uint32_t>(product);
+        }
+    }
+    return static_cast<uint32_t>(product >> 32);
+}
+
+template <typename Generator>
+uint64_t
+boundedRandom(Generator& generator, uint64_t range)
+{
+    static_assert(Generator::min() == 0 && generatorBits<Generator>() == 64, "needs a 64 bit generator");
+
+    if (range <= std::numeric_limits<uint32_t>::max())
+        return boundedRandom32(generator, static_cast<uint32_t>(range));
+
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(generator()) * range;
+    uint64_t low = static_cast<uint64_t>(product);
+    if (low < range)
+    {
+        const uint64_t threshold = (0 - range) % range;
+        while (low < threshold)
+        {
+            product = static_cast<unsigned __int128>(generator()) * range;
+            low = static_cast<uint64_t>(product);
+        }
+    }
+    return static_cast<uint64_t>(product >> 64);
+#else
+    // Rejection of the biased top values, one division.
+    const uint64_t limit = std::numeric_limits<uint64_t>::max() - std::numeric_limits<uint64_t>::max() % range;
+    uint64_t value;
+    do
+        value = generator();
+    while (value >= limit);
+    return value % range;
+#endif
+}
+
+// Uniform integer in [low, high], the replacement of std::uniform_int_distribution.
+template <typename Integer, typename Generator>
+Integer
+uniformInt(Generator& generator, Integer low, Integer high)
+{
+    static_assert(std::is_integral_v<Integer>, "uniformInt needs an integer type");
+    using Unsigned = std::make_unsigned_t<Integer>;
+
+    // The inner casts back to Unsigned undo the promotion of char and short to int, a negative
+    // int difference would be sign extended to a huge span.
+    const uint64_t span = static_cast<uint64_t>(static_cast<Unsigned>(static_cast<Unsigned>(high) - static_cast<Unsigned>(low)));
+    const uint64_t offset = span == std::numeric_limits<uint64_t>::max() ? generator() : boundedRandom(generator, span + 1);
+    return static_cast<Integer>(static_cast<Unsigned>(static_cast<Unsigned>(low) + static_cast<Unsigned>(offset)));
+}
+
+// Uniform double in [0, 1) from the top 53 bits.
+template <typename Generator>
+double
+uniformReal(Generator& generator)
+{
+    return static_cast<double>(generator() >> 11) * 0x1.0p-53;
+}
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "ParallelFor.hpp"
+#include "Random.hpp"
+
+namespace ct {
+
+/**
+ * Fisher-Yates shuffle with Lemire's bounded integers, the same permutations for the
+ * same generator state on every platform. std::shuffle with std::mt19937 spends most of
+ * its time in the distribution's division.
+ */
+template <typename Iterator, typename Generator>
+void
+shuffle(Iterator first, Iterator last, Generator& generator)
+{
+    const size_t size = static_cast<size_t>(std::distance(first, last));
+    for (size_t i = size; i > 1; i--)
+    {
+        size_t j;
+        // 32 bit bounds are cheaper, 32 bit generators (std::mt19937) only shuffle less than 2^32 elements.
+        if constexpr (generatorBits<Generator>() >= 64)
+            j = i <= 0xffffffffu ? boundedRandom32(generator, static_cast<uint32_t>(i)) : static_cast<size_t>(boundedRandom(generator, i));
+        else
+            j = boundedRandom32(generator, static_cast<uint32_t>(i));
+        std::iter_swap(first + static_cast<std::ptrdiff_t>(i - 1), first + static_cast<std::ptrdiff_t>(j));
+    }
+}
+
+namespace detail {
+
+// Random bits one at a time, 64 per generator call.
+class RandomBits
+{
+public:
+    explicit RandomBits(Xoshiro256StarStar& _generator) : generator(_generator) {}
+
+    bool next()
+    {
+        if (available == 0)
+        {
+            bits = generator();
+            available = 64;
+        }
+        const bool bit = bits & 1;
+        bits >>= 1;
+        available--;
+        return bit;
+    }
+
+private:
+    Xoshiro256StarStar& generator;
+    uint64_t bits = 0;
+    unsigned available = 0;
+};
+
+/**
+ * Merges the shuffled halves [first, middle) and [middle, last) into a shuffled range
+ * (MergeShuffle, Bacher, Bodini, Hollender, Lumbroso). A coin picks the next element from
+ * either half, the rest of the half which is left over is inserted with Fisher-Yates steps.
+ */
+template <typename Iterator>
+void
+mergeShuffled(Iterator first, Iterator middle, Iterator last, Xoshiro256StarStar& generator)
+{
+    RandomBits coin(generator);
+    Iterator u = first;
+    Iterator v = middle;
+    if constexpr (std::is_trivially_copyable_v<typename std::iterator_traits<Iterator>::value_type>)
+    {
+        // The coin is unpredictable, no branch on it while both halves have elements.
+        while (u != v && v != last)
+        {
+            // Indexing by the coin, compilers turn "right ? b : a" into a branch.
+            const unsigned right = coin.next();
+            const typename std::iterator_traits<Iterator>::value_type pair[2] = { *u, *v };
+            *u = pair[right];
+            *v = pair[right ^ 1];
+            v += right;
+            ++u;
+        }
+    }
+
+    while (true)
+    {
+        if (coin.next())
+        {
+            if (v == last)
+                break;
+            std::iter_swap(u, v++);
+        }
+        else if (u == v)
+            break;
+        ++u;
+    }
+
+    for (; u != last; ++u)
+    {
+        const size_t position = static_cast<size_t>(u - first);
+        std::iter_swap(first + static_cast<std::ptrdiff_t>(boundedRandom(generator, position + 1)), u);
+    }
+}
+
+}
+
+/**
+ * Shuffles on 'threads' threads (0 means all hardware threads): blocks of at least 'minChunk'
+ * elements are shuffled in parallel, then pairs of neighbouring blocks are merged with
+ * MergeShuffle level by level, the pairs of a level in parallel. The last merge touches
+ * every element on one thread, which is a sequential pass of coin flips instead of a random
+ * access per element, so it is cheap compared to the first level when the array is bigger than the caches.
+ *
+ * Every block and merge has its own generator seeded from 'seed' and its position, the
+ * block count depends only on the size and 'minChunk': the permutation for a seed is the same
+ * with any number of threads.
+ */
+template <typename Iterator>
+void
+shuffleParallel(Iterator first, Iterator last, uint64_t seed, unsigned threads = 0, size_t minChunk = 1 << 16)
+{
+    static_assert(std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>,
+                  "shuffleParallel needs random access iterators");
+
+    const size_t size = static_cast<size_t>(std::distance(first, last));
+    minChunk = std::max<size_t>(minChunk, 2);
+
+    size_t levels = 0;
+    while ((size >> levels) >= 2 * minChunk)
+        levels++;
+    const size_t blocks = size_t{ 1 } << levels;
+
+    // Block b is [b * size / blocks, (b + 1) * size / blocks).
+    auto boundary = [first, size](size_t block, size_t count) { return first + static_cast<std::ptrdiff_t>(block * size / count); };
+
+    parallelFor(
+        blocks, threads,
+        [&](size_t begin, size_t end, unsigned) {
+            for (size_t b = begin; b < end; b++)
+            {
+                Xoshiro256StarStar generator(seed, b);
+                shuffle(boundary(b, blocks), boundary(b + 1, blocks), generator);
+            }
+        },
+        1);
+
+    for (size_t level = 1; level <= levels; level++)
+    {
+        const size_t merged = blocks >> level;
+        parallelFor(
+            merged, threads,
+            [&](size_t begin, size_t end, unsigned) {
+                for (size_t m = begin; m < end; m++)
+                {
+                    // Streams of the merges come after the streams of the blocks.
+                    Xoshiro256StarStar generator(seed, (blocks << level) + m);
+                    detail::mergeShuffled(boundary(2 * m, 2 * merged), boundary(2 * m + 1, 2 * merged), boundary(2 * m + 2, 2 * merged), generator);
+                }
+            },
+            1);
+    }
+}
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "Random.hpp"
+
+namespace ct {
+
+/**
+ * Eight xoshiro256** generators stepped together for filling large buffers.
+ * Lane i is the seeded generator after i jump()s, so the lanes never overlap.
+ * One step yields lane 0 to lane 7 in this order. The state is stored per word
+ * across the lanes (structure of arrays): AVX-512 steps the 8 lanes in one register
+ * per word, AVX2 in two, otherwise a loop the compiler vectorizes. The multiplies
+ * by 5 and 9 are shift + add, AVX2 has no 64 bit multiply.
+ *
+ * The output depends only on the seed, not on the instruction set or on how the
+ * calls are split: values of a step which were not returned are kept for the next call.
+ */
+class SimdXoshiro256StarStar
+{
+public:
+    using result_type = uint64_t;
+    static constexpr size_t lanes = 8;
+
+    explicit SimdXoshiro256StarStar(uint64_t seed = 0)
+    {
+        Xoshiro256StarStar generator(seed);
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            for (size_t word = 0; word < 4; word++)
+                state[word][lane] = generator.getState()[word];
+            generator.jump();
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~uint64_t{ 0 }; }
+
+    result_type operator()()
+    {
+        if (buffered == lanes)
+        {
+            step(buffer);
+            buffered = 0;
+        }
+        return buffer[buffered++];
+    }
+
+    void fill(uint64_t* out, size_t count)
+    {
+        for (; count > 0 && buffered < lanes; count--)
+            *out++ = buffer[buffered++];
+        for (; count >= lanes; count -= lanes, out += lanes)
+            step(out);
+        if (count > 0)
+        {
+            step(buffer);
+            std::memcpy(out, buffer, count * sizeof(uint64_t));
+            buffered = count;
+        }
+    }
+
+    // Uniform integers in [0, range) with Lemire's method, two per 64 bit output. range must not be 0.
+    void fillBounded(uint32_t* out, size_t count, uint32_t range)
+    {
+        // One division per call instead of one per rejection check.
+        const uint32_t threshold = static_cast<uint32_t>(-range) % range;
+        uint64_t raw[64];
+        while (count > 0)
+        {
+            fill(raw, 64);
+            for (size_t i = 0; i < 128 && count > 0; i++)
+            {
+                const uint32_t half = static_cast<uint32_t>(raw[i / 2] >> (32 * (i & 1)));
+                const uint64_t product = static_cast<uint64_t>(half) * range;
+                if (static_cast<uint32_t>(product) < threshold)
+                    continue;
+                *out++ = static_cast<uint32_t>(product >> 32);
+                count--;
+            }
+        }
+    }
+
+private:
+    void step(uint64_t* out)
+    {
+#if defined(__AVX512F__)
+        // The zero masked forms, GCC 12 warns about the undefined source of the unmasked shifts.
+        constexpr __mmask8 all = 0xff;
+        __m512i s0 = _mm512_load_si512(state[0]);
+        __m512i s1 = _mm512_load_si512(state[1]);
+        __m512i s2 = _mm512_load_si512(state[2]);
+        __m512i s3 = _mm512_load_si512(state[3]);
+
+        const __m512i times5 = _mm512_add_epi64(_mm512_maskz_slli_epi64(all, s1, 2), s1);
+        const __m512i rotated = _mm512_maskz_rol_epi64(all, times5, 7);
+        _mm512_storeu_si512(out, _mm512_add_epi64(_mm512_maskz_slli_epi64(all, rotated, 3), rotated));
+
+        const __m512i t = _mm512_maskz_slli_epi64(all, s1, 17);
+        s2 = _mm512_xor_si512(s2, s0);
+        s3 = _mm512_xor_si512(s3, s1);
+        s1 = _mm512_xor_si512(s1, s2);
+        s0 = _mm512_xor_si512(s0, s3);
+        s2 = _mm512_xor_si512(s2, t);
+        s3 = _mm512_maskz_rol_epi64(all, s3, 45);
+
+        _mm512_store_si512(state[0], s0);
+        _mm512_store_si512(state[1], s1);
+        _mm512_store_si512(state[2], s2);
+        _mm512_store_si512(state[3], s3);
+#elif defined(__AVX2__)
+        for (size_t half = 0; half < lanes; half += 4)
+        {
+            __m256i s0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[0] + half));
+            __m256i s1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[1] + half));
+            __m256i s2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[2] + half));
+            __m256i s3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[3] + half));
+
+            const __m256i times5 = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+            const __m256i rotated = _mm256_or_si256(_mm256_slli_epi64(times5, 7), _mm256_srli_epi64(times5, 57));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + half), _mm256_add_epi64(_mm256_slli_epi64(rotated, 3), rotated));
+
+            const __m256i t = _mm256_slli_epi64(s1, 17);
+            s2 = _mm256_xor_si256(s2, s0);
+            s3 = _mm256_xor_si256(s3, s1);
+            s1 = _mm256_xor_si256(s1, s2);
+            s0 = _mm256_xor_si256(s0, s3);
+            s2 = _mm256_xor_si256(s2, t);
+            s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 19));
+
+            _mm256_store_si256(reinterpret_cast<__m256i*>(state[0] + half), s0);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(state[1] + half), s1);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(state[2] + half), s2);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(state[3] + half), s3);
+        }
+#else
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            out[lane] = rotateLeft(state[1][lane] * 5, 7) * 9;
+            const uint64_t t = state[1][lane] << 17;
+            state[2][lane] ^= state[0][lane];
+            state[3][lane] ^= state[1][lane];
+            state[1][lane] ^= state[2][lane];
+            state[0][lane] ^= state[3][lane];
+            state[2][lane] ^= t;
+            state[3][lane] = rotateLeft(state[3][lane], 45);
+        }
+#endif
+    }
+
+    alignas(64) uint64_t state[4][lanes];
+    uint64_t buffer[lanes];
+    size_t buffered = lanes;
+};
+
+}
@@ -0,0 +1,85 @@
+#include <stdexcept>
+#include <thread>
+
+#include "Rcu.hpp"
+
+namespace ct {
+
+namespace rcu {
+
+namespace detail {
+
+// Epoch 0 marks an idle slot.
+std::atomic<uint64_t> globalEpoch{ 1 };
+
+static Slot slots[maxReaders];
+
+// Frees the slot of a thread when it exits.
+struct Registration
+{
+    ~Registration()
+    {
+        if (slot != nullptr)
+        {
+            slot->epoch.store(0, std::memory_order_relaxed);
+            slot->used.store(false, std::memory_order_release);
+            slot = nullptr;
+        }
+    }
+};
+
+static thread_local Registration registration;
+
+Slot*
+registerThread()
+{
+    for (Slot& candidate : slots)
+    {
+        bool expected = false;
+        if (!candidate.used.load(std::memory_order_relaxed) && candidate.used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+        {
+            // Touching the thread_local constructs it, its destructor runs at thread exit.
+            (void)registration;
+            slot = &candidate;
+            return slot;
+        }
+    }
+    --depth;
+    throw std::length_error("rcu: more reader threads than ct::rcu::maxReaders");
+}
+
+}
+
+uint64_t
+advance()
+{
+    const uint64_t epoch = detail::globalEpoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    // Either a reader's slot store is visible to passed(), or the reader sees the unlinked state.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch;
+}
+
+bool
+passed(uint64_t epoch)
+{
+    for (const detail::Slot& slot : detail::slots)
+    {
+        // Acquire pairs with readUnlock(), the reads of the old object happen before it is freed.
+        const uint64_t entered = slot.epoch.load(std::memory_order_acquire);
+        if (entered != 0 && entered < epoch)
+            return false;
+    }
+    return true;
+}
+
+void
+synchronize()
+{
+    const uint64_t epoch = advance();
+    while (!passed(epoch))
+        std::this_thread::yield();
+}
+
+}
+
+}
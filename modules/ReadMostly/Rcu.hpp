@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ct {
+
+namespace rcu {
+
+/**
+ * Epoch based read-copy-update, the grace periods behind RcuBox.
+ *
+ * A reader announces the global epoch in its own cache line slot when it enters a read section
+ * and clears it when it leaves. Nothing is locked and no line other threads write is written,
+ * so readers on many cores do not slow each other down, unlike the reader count of
+ * std::shared_mutex. A writer unlinks the old object, advances the epoch and frees the object
+ * once no slot holds an epoch older than the new one.
+ *
+ *     {
+ *         ct::rcu::ReadGuard guard;
+ *         const Config* config = current.load(std::memory_order_acquire);
+ *         use(*config);
+ *     }
+ *
+ * Read sections nest. A thread claims a slot at its first read section and frees it when it
+ * exits, at most maxReaders threads can be inside read sections at the same time.
+ */
+constexpr size_t maxReaders = 256;
+
+namespace detail {
+
+struct alignas(64) Slot
+{
+    // Epoch the reader entered at, 0 outside read sections.
+    std::atomic<uint64_t> epoch{ 0 };
+    std::atomic<bool> used{ false };
+};
+
+extern std::atomic<uint64_t> globalEpoch;
+
+// Claims a free slot for the calling thread, throws std::length_error when all are taken.
+Slot* registerThread();
+
+inline thread_local Slot* slot = nullptr;
+inline thread_local unsigned depth = 0;
+
+}
+
+inline void
+readLock()
+{
+    if (detail::depth++ > 0)
+        return;
+    detail::Slot* slot = detail::slot != nullptr ? detail::slot : detail::registerThread();
+    slot->epoch.store(detail::globalEpoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+    // Orders the slot store before the loads of the read section (Dekker with advance()).
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+inline void
+readUnlock()
+{
+    if (--detail::depth == 0)
+        detail::slot->epoch.store(0, std::memory_order_release);
+}
+
+class ReadGuard
+{
+public:
+    ReadGuard() { readLock(); }
+    ~ReadGuard() { readUnlock(); }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+};
+
+// Call after unlinking objects, returns the epoch from which they may be freed.
+uint64_t advance();
+// True when no reader is in a read section which entered before 'epoch'.
+bool passed(uint64_t epoch);
+// Waits until all read sections entered before the call have left. Not inside a read section.
+void synchronize();
+
+}
+
+}
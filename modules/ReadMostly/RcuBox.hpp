@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "Rcu.hpp"
+
+namespace ct {
+
+/**
+ * Holds a value of any size which many threads read and few threads replace (read-copy-update).
+ *
+ * Readers pin the current object in an rcu read section and use it in place, no copy, no lock
+ * and no store to a line other threads touch. A writer builds a new object, swaps the pointer
+ * and frees the old one after every reader which could still see it has left (Rcu.hpp).
+ *
+ *     ct::RcuBox<std::vector<Vector3>> points(std::vector<Vector3>(64, Vector3{ 5, 5, 5 }));
+ *     // reader threads
+ *     float total = points.read([](const std::vector<Vector3>& values) { return sum(values); });
+ *     // writer thread
+ *     points.update([](std::vector<Vector3>& values) { values.push_back(Vector3{ 1, 2, 2 }); });
+ *
+ * Writers are serialized by a mutex and never wait for readers, old objects stay in a retired
+ * list until a later write or reclaim() finds them unused. The box must outlive its readers.
+ */
+template <typename T>
+class RcuBox
+{
+public:
+    // The pinned object, valid until the snapshot is destroyed.
+    class Snapshot
+    {
+    public:
+        explicit Snapshot(const RcuBox& box) : value(box.current.load(std::memory_order_acquire)) {}
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+
+        const T& operator*() const { return *value; }
+        const T* operator->() const { return value; }
+
+    private:
+        // Declared first, the read section starts before the pointer is loaded.
+        rcu::ReadGuard guard;
+        const T* value;
+    };
+
+    RcuBox() : RcuBox(T{}) {}
+    explicit RcuBox(T value) : current(new T(std::move(value))) {}
+
+    ~RcuBox()
+    {
+        delete current.load(std::memory_order_relaxed);
+        for (const Retired& retired : retiredList)
+            delete retired.value;
+    }
+
+    RcuBox(const RcuBox&) = delete;
+    RcuBox& operator=(const RcuBox&) = delete;
+
+    Snapshot snapshot() const { return Snapshot(*this); }
+
+    // Calls read(const T&) inside a read section and returns its result.
+    template <typename Read>
+    auto read(Read read) const
+    {
+        rcu::ReadGuard guard;
+        return read(*current.load(std::memory_order_acquire));
+    }
+
+    void store(T value) { publish(new T(std::move(value))); }
+
+    // Copies the current value, changes the copy and publishes it. Concurrent updates are not lost.
+    template <typename Update>
+    void update(Update change)
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        std::unique_ptr<T> copy(new T(*current.load(std::memory_order_relaxed)));
+        change(*copy);
+        retire(current.exchange(copy.release(), std::memory_order_acq_rel));
+    }
+
+    // Frees the retired objects no reader can see anymore, returns how many are left.
+    size_t reclaim()
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        return reclaimRetired();
+    }
+
+    // Waits for the readers of all retired objects and frees them. Not inside a read section.
+    void synchronize()
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        rcu::synchronize();
+        for (const Retired& retired : retiredList)
+            delete retired.value;
+        retiredList.clear();
+    }
+
+    // Replaced objects which are not freed yet.
+    size_t retired() const
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        return retiredList.size();
+    }
+
+private:
+    struct Retired
+    {
+        T* value;
+        uint64_t epoch;
+    };
+
+    void publish(T* value)
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        retire(current.exchange(value, std::memory_order_acq_rel));
+    }
+
+    void retire(T* value)
+    {
+        retiredList.push_back(Retired{ value, rcu::advance() });
+        reclaimRetired();
+    }
+
+    // The list is in epoch order and a reader which blocks one epoch blocks all later ones.
+    size_t reclaimRetired()
+    {
+        size_t freed = 0;
+        while (freed < retiredList.size() && rcu::passed(retiredList[freed].epoch))
+            delete retiredList[freed++].value;
+        retiredList.erase(retiredList.begin(), retiredList.begin() + static_cast<std::ptrdiff_t>(freed));
+        return retiredList.size();
+    }
+
+    std::atomic<T*> current;
+    mutable std::mutex writer;
+    std::vector<Retired> retiredList;
+};
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "EventCount.hpp"
+
+namespace ct {
+
+/**
+ * Publishes a small trivially copyable value to readers which never write shared memory.
+ *
+ * The writer makes the sequence odd, writes the value and makes it even again. A reader copies
+ * the value between two loads of the sequence and retries when they differ or are odd, so it
+ * pays two loads and the copy, no lock and no store. Readers only retry while a write is in
+ * progress, writers are rare by assumption. Writers exclude each other with the odd sequence.
+ *
+ *     ct::Seqlock<Vector3> position{ Vector3{ 5, 5, 5 } };
+ *     // reader threads
+ *     const Vector3 now = position.load();
+ *     // writer thread
+ *     position.update([](Vector3& value) { value.x += 1; });
+ *
+ * The value is kept in relaxed atomic words, a copy racing with a write is then well defined
+ * and discarded. For larger values, or values which own memory, use RcuBox.
+ */
+template <typename T>
+class Seqlock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock needs a trivially copyable type");
+
+public:
+    Seqlock() : Seqlock(T{}) {}
+    explicit Seqlock(const T& value) { write(value); }
+
+    Seqlock(const Seqlock&) = delete;
+    Seqlock& operator=(const Seqlock&) = delete;
+
+    T load() const
+    {
+        T value;
+        while (!tryLoad(value))
+            cpuRelax();
+        return value;
+    }
+
+    // One attempt, false when a writer was active and 'value' is not consistent.
+    bool tryLoad(T& value) const
+    {
+        const uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            return false;
+        uint64_t buffer[wordCount];
+        for (size_t i = 0; i < wordCount; i++)
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        // Orders the word loads before the second load of the sequence.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != before)
+            return false;
+        std::memcpy(&value, buffer, sizeof(T));
+        return true;
+    }
+
+    void store(const T& value)
+    {
+        const uint64_t odd = lockWriter();
+        write(value);
+        sequence.store(odd + 1, std::memory_order_release);
+    }
+
+    // Read, modify and write under the writer lock, concurrent updates are not lost.
+    template <typename Update>
+    void update(Update change)
+    {
+        const uint64_t odd = lockWriter();
+        T value = read();
+        change(value);
+        write(value);
+        sequence.store(odd + 1, std::memory_order_release);
+    }
+
+    // Number of completed writes.
+    uint64_t version() const { return sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t wordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    uint64_t lockWriter()
+    {
+        uint64_t even = sequence.load(std::memory_order_relaxed);
+        while ((even & 1) || !sequence.compare_exchange_weak(even, even + 1, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            cpuRelax();
+            even = sequence.load(std::memory_order_relaxed);
+        }
+        // Orders the odd sequence before the word stores.
+        std::atomic_thread_fence(std::memory_order_release);
+        return even + 1;
+    }
+
+    T read() const
+    {
+        uint64_t buffer[wordCount];
+        for (size_t i = 0; i < wordCount; i++)
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+    void write(const T& value)
+    {
+        uint64_t buffer[wordCount] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+        for (size_t i = 0; i < wordCount; i++)
+            words[i].store(buffer[i], std::memory_order_relaxed);
+    }
+
+    alignas(64) std::atomic<uint64_t> sequence{ 0 };
+    std::atomic<uint64_t> words[wordCount];
+};
+
+}
@@ -0,0 +1,614 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "ParallelFor.hpp"
+
+namespace ct {
+
+/**
+ * Prefix sums (scan) of arithmetic arrays, sequential and parallel.
+ *
+ *     inclusiveScan  out[i] = init + in[0] + ... + in[i]       std::inclusive_scan
+ *     exclusiveScan  out[i] = init + in[0] + ... + in[i - 1]   std::exclusive_scan
+ *     segmentedScan  inclusive scan which restarts at every i with heads[i] != 0
+ *
+ * The sequential kernels compute the prefix of a whole SIMD vector in registers
+ * (log2(lanes) shifts and adds) and add the running total of the previous vectors,
+ * instead of one dependent addition per element. AVX2 handles 8 x 32 or 4 x 64 bit lanes,
+ * SSE2 4 x 32 or 2 x 64 bit lanes, other builds and types use the scalar loop.
+ * segmentedScan() computes the prefix the same way with the heads as lane masks.
+ *
+ * The parallel versions use two passes over contiguous chunks, one per thread:
+ *  1. every thread sums its chunk,
+ *  2. the chunk sums are scanned on the calling thread (one value per thread),
+ *  3. every thread scans its chunk starting from the sum of all chunks before it.
+ * The input is read twice and the output written once, out may be the same array as in.
+ *
+ * Integer results are the same as std::partial_sum. Floating point additions are
+ * reassociated by the SIMD and parallel kernels, results differ by rounding.
+ */
+
+namespace scan {
+
+// SIMD operations for the scan kernels, enabled for 4 and 8 byte integers, float and double.
+template <typename T, typename Enable = void>
+struct Simd
+{
+    static constexpr bool enabled = false;
+};
+
+#if defined(__AVX2__)
+
+template <typename T>
+struct Simd<T, std::enable_if_t<std::is_integral_v<T> && sizeof(T) == 4>>
+{
+    static constexpr bool enabled = true;
+    static constexpr size_t lanes = 8;
+    using Vector = __m256i;
+
+    static Vector load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(T* p, Vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static Vector add(Vector a, Vector b) { return _mm256_add_epi32(a, b); }
+    static Vector set1(T value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+    static Vector zero() { return _mm256_setzero_si256(); }
+
+    // Prefix of the 8 lanes: in each 128 bit half, then the last lane of the low half into the high half.
+    static Vector prefix(Vector v)
+    {
+        v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+        v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+        const __m256i low = _mm256_permute2x128_si256(v, v, 0x08);
+        return _mm256_add_epi32(v, _mm256_shuffle_epi32(low, 0xff));
+    }
+    // Lane i becomes lane i - count, the first 'count' lanes become zero.
+    template <int count>
+    static Vector shiftLanes(Vector v)
+    {
+        v = _mm256_permutevar8x32_epi32(v, _mm256_sub_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(count)));
+        return _mm256_blend_epi32(v, _mm256_setzero_si256(), (1 << count) - 1);
+    }
+    static Vector broadcastLast(Vector v) { return _mm256_permutevar8x32_epi32(v, _mm256_set1_epi32(7)); }
+    // All bits set in the lanes with a non zero head byte.
+    static Vector heads(const uint8_t* p)
+    {
+        long long bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        return _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(_mm_cvtsi64_si128(bytes)), _mm256_setzero_si256());
+    }
+    static Vector andNot(Vector mask, Vector v) { return _mm256_andnot_si256(mask, v); }
+    static Vector orBits(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+    static T sum(Vector v)
+    {
+        alignas(32) T values[lanes];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(values), v);
+        T total = 0;
+        for (T value : values)
+            total += value;
+        return total;
+    }
+};
+
+template <typename T>
+struct Simd<T, std::enable_if_t<std::is_integral_v<T> && sizeof(T) == 8>>
+{
+    static constexpr bool enabled = true;
+    static constexpr size_t lanes = 4;
+    using Vector = __m256i;
+
+    static Vector load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(T* p, Vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static Vector add(Vector a, Vector b) { return _mm256_add_epi64(a, b); }
+    static Vector set1(T value) { return _mm256_set1_epi64x(static_cast<long long>(value)); }
+    static Vector zero() { return _mm256_setzero_si256(); }
+
+    static Vector prefix(Vector v)
+    {
+        v = _mm256_add_epi64(v, _mm256_slli_si256(v, 8));
+        const __m256i low = _mm256_permute2x128_si256(v, v, 0x08);
+        return _mm256_add_epi64(v, _mm256_unpackhi_epi64(low, low));
+    }
+    template <int count>
+    static Vector shiftLanes(Vector v)
+    {
+        if constexpr (count == 1)
+            return _mm256_blend_epi32(_mm256_permute4x64_epi64(v, _MM_SHUFFLE(2, 1, 0, 0)), _mm256_setzero_si256(), 0x03);
+        else
+            return _mm256_permute2x128_si256(v, v, 0x08);
+    }
+    static Vector broadcastLast(Vector v) { return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 3, 3, 3)); }
+    static Vector heads(const uint8_t* p)
+    {
+        int bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        return _mm256_cmpgt_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128(bytes)), _mm256_setzero_si256());
+    }
+    static Vector andNot(Vector mask, Vector v) { return _mm256_andnot_si256(mask, v); }
+    static Vector orBits(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+    static T sum(Vector v)
+    {
+        alignas(32) T values[lanes];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(values), v);
+        return values[0] + values[1] + values[2] + values[3];
+    }
+};
+
+template <>
+struct Simd<float>
+{
+    static constexpr bool enabled = true;
+    static constexpr size_t lanes = 8;
+    using Vector = __m256;
+
+    static Vector load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Vector v) { _mm256_storeu_ps(p, v); }
+    static Vector add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+    static Vector set1(float value) { return _mm256_set1_ps(value); }
+    static Vector zero() { return _mm256_setzero_ps(); }
+
+    static Vector prefix(Vector v)
+    {
+        v = _mm256_add_ps(v, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(v), 4)));
+        v = _mm256_add_ps(v, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(v), 8)));
+        const __m256 low = _mm256_permute2f128_ps(v, v, 0x08);
+        return _mm256_add_ps(v, _mm256_shuffle_ps(low, low, 0xff));
+    }
+    template <int count>
+    static Vector shiftLanes(Vector v)
+    {
+        v = _mm256_permutevar8x32_ps(v, _mm256_sub_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(count)));
+        return _mm256_blend_ps(v, _mm256_setzero_ps(), (1 << count) - 1);
+    }
+    static Vector broadcastLast(Vector v) { return _mm256_permutevar8x32_ps(v, _mm256_set1_epi32(7)); }
+    static Vector heads(const uint8_t* p) { return _mm256_castsi256_ps(Simd<int32_t>::heads(p)); }
+    static Vector andNot(Vector mask, Vector v) { return _mm256_andnot_ps(mask, v); }
+    static Vector orBits(Vector a, Vector b) { return _mm256_or_ps(a, b); }
+    static float sum(Vector v)
+    {
+        alignas(32) float values[lanes];
+        _mm256_store_ps(values, v);
+        return ((values[0] + values[1]) + (values[2] + values[3])) + ((values[4] + values[5]) + (values[6] + values[7]));
+    }
+};
+
+template <>
+struct Simd<double>
+{
+    static constexpr bool enabled = true;
+    static constexpr size_t lanes = 4;
+    using Vector = __m256d;
+
+    static Vector load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, Vector v) { _mm256_storeu_pd(p, v); }
+    static Vector add(Vector a, Vector b) { return _mm256_add_pd(a, b); }
+    static Vector set1(double value) { return _mm256_set1_pd(value); }
+    static Vector zero() { return _mm256_setzero_pd(); }
+
+    static Vector prefix(Vector v)
+    {
+        v = _mm256_add_pd(v, _mm256_castsi256_pd(_mm256_slli_si256(_mm256_castpd_si256(v), 8)));
+        const __m256d low = _mm256_permute2f128_pd(v, v, 0x08);
+        return _mm256_add_pd(v, _mm256_unpackhi_pd(low, low));
+    }
+    template <int count>
+    static Vector shiftLanes(Vector v)
+    {
+        if constexpr (count == 1)
+            return _mm256_blend_pd(_mm256_permute4x64_pd(v, _MM_SHUFFLE(2, 1, 0, 0)), _mm256_setzero_pd(), 0x01);
+        else
+            return _mm256_permute2f128_pd(v, v, 0x08);
+    }
+    static Vector broadcastLast(Vector v) { return _mm256_permute4x64_pd(v, _MM_SHUFFLE(3, 3, 3, 3)); }
+    static Vector heads(const uint8_t* p) { return _mm256_castsi256_pd(Simd<int64_t>::heads(p)); }
+    static Vector andNot(Vector mask, Vector v) { return _mm256_andnot_pd(mask, v); }
+    static Vector orBits(Vector a, Vector b) { return _mm256_or_pd(a, b); }
+    static double sum(Vector v)
+    {
+        alignas(32) double values[lanes];
+        _mm256_store_pd(values, v);
+        return (values[0] + values[1]) + (values[2] + values[3]);
+    }
+};
+
+#elif defined(__SSE2__)
+
+template <typename T>
+struct Simd<T, std::enable_if_t<std::is_integral_v<T> && sizeof(T) == 4>>
+{
+    static constexpr bool enabled = true;
+    static constexpr size_t lanes = 4;
+    using Vector = __m128i;
+
+    static Vector load(const T* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void store(T* p, Vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    static Vector add(Vector a, Vector b) { return _mm_add_epi32(a, b); }
+    static Vector set1(T value) { return _mm_set1_epi32(static_cast<int>(value)); }
+    static Vector zero() { return _mm_setzero_si128(); }
+
+    static Vector prefix(Vector v)
+    {
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        return _mm_add_epi32(v, _mm_slli_si128(v, 8));
+    }
+    template <int count>
+    static Vector shiftLanes(Vector v) { return _mm_slli_si128(v, 4 * count); }
+    static Vector broadcastLast(Vector v) { return _mm_shuffle_epi32(v, 0xff); }
+    static Vector heads(const uint8_t* p)
+    {
+        int bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+        return _mm_cmpgt_epi32(wide, zero);
+    }
+    static Vector andNot(Vector mask, Vector v) { return _mm_andnot_si128(mask, v); }
+    static Vector orBits(Vector a, Vector b) { return _mm_or_si128(a, b); }
+    static T sum(Vector v)
+    {
+        alignas(16) T values[lanes];
+        _mm_store_si128(reinterpret_cast<__m128i*>(values), v);
+        return values[0] + values[1] + values[2] + values[3];
+    }
+};
+
+template <typename T>
+struct Simd<T, std::enable_if_t<std::is_integral_v<T> && sizeof(T) == 8>>
+{
+    static constexpr bool enabled = true;
+    static constexpr size_t lanes = 2;
+    using Vector = __m128i;
+
+    static Vector load(const T* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void store(T* p, Vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    static Vector add(Vector a, Vector b) { return _mm_add_epi64(a, b); }
+    static Vector set1(T value) { return _mm_set1_epi64x(static_cast<long long>(value)); }
+    static Vector zero() { return _mm_setzero_si128(); }
+
+    static Vector prefix(Vector v) { return _mm_add_epi64(v, _mm_slli_si128(v, 8)); }
+    template <int count>
+    static Vector shiftLanes(Vector v) { return _mm_slli_si128(v, 8 * count); }
+    static Vector broadcastLast(Vector v) { return _mm_unpackhi_epi64(v, v); }
+    // No 64 bit compare in SSE2, compare 32 bit lanes and duplicate them.
+    static Vector heads(const uint8_t* p)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bytes = _mm_cvtsi32_si128(p[0] | (p[1] << 8));
+        const __m128i mask = _mm_cmpgt_epi32(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero), zero);
+        return _mm_unpacklo_epi32(mask, mask);
+    }
+    static Vector andNot(Vector mask, Vector v) { return _mm_andnot_si128(mask, v); }
+    static Vector orBits(Vector a, Vector b) { return _mm_or_si128(a, b); }
+    static T sum(Vector v)
+    {
+        alignas(16) T values[lanes];
+        _mm_store_si128(reinterpret_cast<__m128i*>(values), v);
+        return values[0] + values[1];
+    }
+};
+
+template <>
+struct Simd<float>
+{
+    static constexpr bool enabled = true;
+    static constexpr size_t lanes = 4;
+    using Vector = __m128;
+
+    static Vector load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Vector v) { _mm_storeu_ps(p, v); }
+    static Vector add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+    static Vector set1(float value) { return _mm_set1_ps(value); }
+    static Vector zero() { return _mm_setzero_ps(); }
+
+    static Vector prefix(Vector v)
+    {
+        v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+        return _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+    }
+    template <int count>
+    static Vector shiftLanes(Vector v) { return _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4 * count)); }
+    static Vector broadcastLast(Vector v) { return _mm_shuffle_ps(v, v, 0xff); }
+    static Vector heads(const uint8_t* p) { return _mm_castsi128_ps(Simd<int32_t>::heads(p)); }
+    static Vector andNot(Vector mask, Vector v) { return _mm_andnot_ps(mask, v); }
+    static Vector orBits(Vector a, Vector b) { return _mm_or_ps(a, b); }
+    static float sum(Vector v)
+    {
+        alignas(16) float values[lanes];
+        _mm_store_ps(values, v);
+        return (values[0] + values[1]) + (values[2] + values[3]);
+    }
+};
+
+template <>
+struct Simd<double>
+{
+    static constexpr bool enabled = true;
+    static constexpr size_t lanes = 2;
+    using Vector = __m128d;
+
+    static Vector load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, Vector v) { _mm_storeu_pd(p, v); }
+    static Vector add(Vector a, Vector b) { return _mm_add_pd(a, b); }
+    static Vector set1(double value) { return _mm_set1_pd(value); }
+    static Vector zero() { return _mm_setzero_pd(); }
+
+    static Vector prefix(Vector v) { return _mm_add_pd(v, _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(v), 8))); }
+    template <int count>
+    static Vector shiftLanes(Vector v) { return _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(v), 8 * count)); }
+    static Vector broadcastLast(Vector v) { return _mm_unpackhi_pd(v, v); }
+    static Vector heads(const uint8_t* p) { return _mm_castsi128_pd(Simd<int64_t>::heads(p)); }
+    static Vector andNot(Vector mask, Vector v) { return _mm_andnot_pd(mask, v); }
+    static Vector orBits(Vector a, Vector b) { return _mm_or_pd(a, b); }
+    static double sum(Vector v)
+    {
+        alignas(16) double values[lanes];
+        _mm_store_pd(values, v);
+        return values[0] + values[1];
+    }
+};
+
+#endif
+
+// Sum of in[0, size).
+template <typename T>
+T
+sum(const T* in, size_t size)
+{
+    size_t i = 0;
+    T total = T{};
+    if constexpr (Simd<T>::enabled)
+    {
+        using S = Simd<T>;
+        // Two accumulators hide the latency of the floating point addition.
+        typename S::Vector first = S::zero();
+        typename S::Vector second = S::zero();
+        for (; i + 2 * S::lanes <= size; i += 2 * S::lanes)
+        {
+            first = S::add(first, S::load(in + i));
+            second = S::add(second, S::load(in + i + S::lanes));
+        }
+        total = S::sum(S::add(first, second));
+    }
+    for (; i < size; i++)
+        total += in[i];
+    return total;
+}
+
+/**
+ * Scan of in[0, size) to out starting from 'carry', the sum of everything before in[0].
+ * Returns the carry for the next block, carry + in[0] + ... + in[size - 1].
+ */
+template <bool exclusive, typename T>
+T
+scanBlock(const T* in, size_t size, T* out, T carry)
+{
+    size_t i = 0;
+    if constexpr (Simd<T>::enabled)
+    {
+        using S = Simd<T>;
+        typename S::Vector total = S::set1(carry);
+        for (; i + S::lanes <= size; i += S::lanes)
+        {
+            const typename S::Vector prefix = S::prefix(S::load(in + i));
+            if constexpr (exclusive)
+                S::store(out + i, S::add(total, S::template shiftLanes<1>(prefix)));
+            else
+                S::store(out + i, S::add(total, prefix));
+            total = S::add(total, S::broadcastLast(prefix));
+        }
+        // The last lane of 'total' is the carry.
+        alignas(64) T lanes[S::lanes];
+        S::store(lanes, total);
+        carry = lanes[S::lanes - 1];
+    }
+    for (; i < size; i++)
+    {
+        const T value = in[i];
+        if constexpr (exclusive)
+        {
+            out[i] = carry;
+            carry += value;
+        }
+        else
+        {
+            carry += value;
+            out[i] = carry;
+        }
+    }
+    return carry;
+}
+
+/**
+ * The two passes of the parallel scan. forEachChunk(function) calls function(begin, end, chunk)
+ * for 'chunks' contiguous chunks in order, split the same way on both calls: parallelFor() in
+ * scanParallel(), the pinned threads of a numaPartition() in NumaScan.hpp.
+ */
+template <bool exclusive, typename T, typename ForEachChunk>
+void
+scanChunks(const T* first, T* out, T init, unsigned chunks, ForEachChunk forEachChunk)
+{
+    if (chunks <= 1)
+    {
+        // One chunk needs no carries, a single pass.
+        forEachChunk([first, out, init](size_t begin, size_t end, unsigned) { scanBlock<exclusive>(first + begin, end - begin, out + begin, init); });
+        return;
+    }
+
+    std::vector<T> carries(chunks + 1, T{});
+    forEachChunk([&carries, first](size_t begin, size_t end, unsigned t) { carries[t + 1] = sum(first + begin, end - begin); });
+
+    carries[0] = init;
+    for (unsigned t = 0; t < chunks; t++)
+        carries[t + 1] += carries[t];
+
+    forEachChunk([&carries, first, out](size_t begin, size_t end, unsigned t) {
+        scanBlock<exclusive>(first + begin, end - begin, out + begin, carries[t]);
+    });
+}
+
+template <bool exclusive, typename T>
+T*
+scanParallel(const T* first, const T* last, T* out, T init, unsigned threads, size_t minChunk)
+{
+    const size_t size = static_cast<size_t>(last - first);
+    threads = parallelThreads(size, threads, minChunk);
+    if (threads <= 1)
+    {
+        scanBlock<exclusive>(first, size, out, init);
+        return out + size;
+    }
+
+    scanChunks<exclusive>(first, out, init, threads, [size, threads, minChunk](auto function) { parallelFor(size, threads, function, minChunk); });
+    return out + size;
+}
+
+/**
+ * Segmented prefix of one vector (Hillis-Steele): in step s lane i adds lane i - s
+ * unless there is a head in lanes (i - s, i], 'flags' collects the heads.
+ * Afterwards a flag is set when the lane or a lane before it is a head.
+ */
+template <typename S, int step = 1>
+void
+segmentedPrefix(typename S::Vector& values, typename S::Vector& flags)
+{
+    if constexpr (step < static_cast<int>(S::lanes))
+    {
+        values = S::add(values, S::andNot(flags, S::template shiftLanes<step>(values)));
+        flags = S::orBits(flags, S::template shiftLanes<step>(flags));
+        segmentedPrefix<S, 2 * step>(values, flags);
+    }
+}
+
+// Segmented inclusive scan of a block starting from 'carry', returns the carry for the next block.
+template <typename T>
+T
+segmentedBlock(const T* in, const uint8_t* heads, size_t size, T* out, T carry)
+{
+    size_t i = 0;
+    if constexpr (Simd<T>::enabled)
+    {
+        // No branch on the heads, they are as unpredictable as the data.
+        using S = Simd<T>;
+        typename S::Vector total = S::set1(carry);
+        for (; i + S::lanes <= size; i += S::lanes)
+        {
+            typename S::Vector values = S::load(in + i);
+            typename S::Vector flags = S::heads(heads + i);
+            segmentedPrefix<S>(values, flags);
+            // The carry reaches the lanes before the first head.
+            values = S::add(values, S::andNot(flags, total));
+            S::store(out + i, values);
+            total = S::broadcastLast(values);
+        }
+        alignas(64) T lanes[S::lanes];
+        S::store(lanes, total);
+        carry = lanes[S::lanes - 1];
+    }
+    for (; i < size; i++)
+    {
+        carry = heads[i] ? in[i] : carry + in[i];
+        out[i] = carry;
+    }
+    return carry;
+}
+
+}
+
+// out[i] = init + in[0] + ... + in[i]. Returns the end of the output, out may be first.
+template <typename T>
+T*
+inclusiveScan(const T* first, const T* last, T* out, T init = T{})
+{
+    static_assert(std::is_arithmetic_v<T>, "scan needs an arithmetic type");
+    scan::scanBlock<false>(first, static_cast<size_t>(last - first), out, init);
+    return out + (last - first);
+}
+
+// out[i] = init + in[0] + ... + in[i - 1], out[0] = init. Turns lengths into offsets.
+template <typename T>
+T*
+exclusiveScan(const T* first, const T* last, T* out, T init = T{})
+{
+    static_assert(std::is_arithmetic_v<T>, "scan needs an arithmetic type");
+    scan::scanBlock<true>(first, static_cast<size_t>(last - first), out, init);
+    return out + (last - first);
+}
+
+template <typename T>
+T*
+inclusiveScanParallel(const T* first, const T* last, T* out, T init = T{}, unsigned threads = 0, size_t minChunk = 1 << 16)
+{
+    static_assert(std::is_arithmetic_v<T>, "scan needs an arithmetic type");
+    return scan::scanParallel<false>(first, last, out, init, threads, minChunk);
+}
+
+template <typename T>
+T*
+exclusiveScanParallel(const T* first, const T* last, T* out, T init = T{}, unsigned threads = 0, size_t minChunk = 1 << 16)
+{
+    static_assert(std::is_arithmetic_v<T>, "scan needs an arithmetic type");
+    return scan::scanParallel<true>(first, last, out, init, threads, minChunk);
+}
+
+/**
+ * Inclusive scan which starts again at every element with heads[i] != 0:
+ * values { 1, 2, 3, 4, 5 }, heads { 1, 0, 1, 0, 0 } gives { 1, 3, 3, 7, 12 }.
+ * The first element always starts a segment.
+ */
+template <typename T>
+T*
+segmentedScan(const T* first, const T* last, const uint8_t* heads, T* out)
+{
+    static_assert(std::is_arithmetic_v<T>, "scan needs an arithmetic type");
+    scan::segmentedBlock(first, heads, static_cast<size_t>(last - first), out, T{});
+    return out + (last - first);
+}
+
+/**
+ * segmentedScan() with the same two passes as inclusiveScanParallel(). Pass 1 also
+ * remembers whether a chunk has a head, the carry does not cross a head.
+ */
+template <typename T>
+T*
+segmentedScanParallel(const T* first, const T* last, const uint8_t* heads, T* out, unsigned threads = 0, size_t minChunk = 1 << 16)
+{
+    static_assert(std::is_arithmetic_v<T>, "scan needs an arithmetic type");
+
+    const size_t size = static_cast<size_t>(last - first);
+    threads = parallelThreads(size, threads, minChunk);
+    if (threads <= 1)
+        return segmentedScan(first, last, heads, out);
+
+    // Sum after the last head of every chunk, the whole chunk when it has no head.
+    std::vector<T> tails(threads, T{});
+    std::vector<uint8_t> hasHead(threads, 0);
+    parallelFor(size, threads, [&tails, &hasHead, first, heads](size_t begin, size_t end, unsigned t) {
+        size_t start = end;
+        while (start > begin && !heads[start - 1])
+            start--;
+        // start - 1 is the last head, it belongs to the tail.
+        hasHead[t] = start > begin;
+        if (hasHead[t])
+            start--;
+        tails[t] = scan::sum(first + start, end - start);
+    }, minChunk);
+
+    std::vector<T> carries(threads, T{});
+    for (unsigned t = 1; t < threads; t++)
+        carries[t] = hasHead[t - 1] ? tails[t - 1] : carries[t - 1] + tails[t - 1];
+
+    parallelFor(size, threads, [&carries, first, heads, out](size_t begin, size_t end, unsigned t) {
+        scan::segmentedBlock(first + begin, heads + begin, end - begin, out + begin, carries[t]);
+    }, minChunk);
+
+    return out + size;
+}
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "SearchCommon.hpp"
+
+namespace ct {
+
+/**
+ * Immutable index over a sorted range for lowerBound/upperBound in Eytzinger (BFS) order.
+ *
+ * Binary search over a sorted array touches a new cache line on almost every probe and
+ * the probes depend on each other, so a lookup in a large array costs log2(n) memory
+ * latencies. Here the keys are stored like a binary heap: the children of node k are
+ * 2k and 2k+1, the first levels of the tree share a few hot cache lines and the
+ * 16 (for 4 byte keys) descendants four levels down lie in one cache line, which is
+ * prefetched while the current level is compared. The descent has no unpredictable branch.
+ *
+ * Results are positions in the sorted input, the same as std::lower_bound - begin.
+ * Works for any copyable key and strict weak ordering, strings included. The position
+ * of every node is stored next to the keys, one extra access at the end of a lookup.
+ */
+template <typename T, typename Compare = std::less<T>>
+class EytzingerIndex
+{
+public:
+    EytzingerIndex() = default;
+
+    // [first, last) must be sorted by 'compare'.
+    template <typename Iterator>
+    EytzingerIndex(Iterator first, Iterator last, Compare _compare = Compare())
+        : compare(std::move(_compare))
+    {
+        const std::vector<T> sorted(first, last);
+        count = sorted.size();
+        // Node 0 is never visited, it keeps the layout 1 based.
+        keys.resize(count + 1, count > 0 ? sorted[0] : T());
+        ranks.resize(count + 1, count);
+
+        size_t rank = 0;
+        build(sorted, rank, 1);
+
+        // Levels of the tree, the bit length of count.
+        for (size_t k = count; k > 0; k >>= 1)
+            depth++;
+    }
+
+    size_t size() const { return count; }
+
+    // Position of the first key not less than 'key', size() when there is none.
+    size_t lowerBound(const T& key) const { return find<false>(key); }
+
+    // Position of the first key greater than 'key', size() when there is none.
+    size_t upperBound(const T& key) const { return find<true>(key); }
+
+    // lowerBound of 'queryCount' keys, the searches are interleaved to overlap their cache misses.
+    void lowerBound(const T* queries, size_t queryCount, size_t* out) const { findBatch<false>(queries, queryCount, out); }
+
+    void upperBound(const T* queries, size_t queryCount, size_t* out) const { findBatch<true>(queries, queryCount, out); }
+
+private:
+    // Elements per cache line, prefetching node k * stride loads the descendants log2(stride) levels down.
+    static constexpr size_t stride = sizeof(T) < search::cacheLine ? search::cacheLine / sizeof(T) : 1;
+
+    void build(const std::vector<T>& sorted, size_t& rank, size_t k)
+    {
+        // In-order traversal of the implicit tree assigns the sorted keys, recursion depth is log2(n).
+        if (k > count)
+            return;
+        build(sorted, rank, 2 * k);
+        keys[k] = sorted[rank];
+        ranks[k] = rank++;
+        build(sorted, rank, 2 * k + 1);
+    }
+
+    // Goes right when the node is before 'key': less for lowerBound, less or equal for upperBound.
+    template <bool upper>
+    bool goRight(const T& node, const T& key) const
+    {
+        if constexpr (upper)
+            return !compare(key, node);
+        else
+            return compare(node, key);
+    }
+
+    // One level down. The last level may be incomplete, k > count stays where it is.
+    template <bool upper>
+    size_t step(size_t k, const T& key) const
+    {
+        const bool valid = k <= count;
+        const size_t node = valid ? k : 0;
+        const size_t next = 2 * k + goRight<upper>(keys[node], key);
+        return valid ? next : k;
+    }
+
+    // Leaves the right turns made after the last left turn, that node is the answer.
+    size_t rankOf(size_t k) const
+    {
+        k >>= search::countTrailingZeros(~static_cast<uint64_t>(k)) + 1;
+        return ranks[k];
+    }
+
+    template <bool upper>
+    size_t find(const T& key) const
+    {
+        // Every search makes 'depth' steps, the loop exit does not depend on the data.
+        size_t k = 1;
+        for (size_t level = 0; level < depth; level++)
+        {
+            search::prefetch(keys.data(), k * stride * sizeof(T));
+            k = step<upper>(k, key);
+        }
+        return rankOf(k);
+    }
+
+    template <bool upper>
+    void findBatch(const T* queries, size_t queryCount, size_t* out) const
+    {
+        size_t k[search::batchSize];
+        for (size_t begin = 0; begin < queryCount; begin += search::batchSize)
+        {
+            const size_t size = std::min(search::batchSize, queryCount - begin);
+            for (size_t q = 0; q < size; q++)
+                k[q] = 1;
+
+            for (size_t level = 0; level < depth; level++)
+            {
+                for (size_t q = 0; q < size; q++)
+                {
+                    k[q] = step<upper>(k[q], queries[begin + q]);
+                    search::prefetch(keys.data(), k[q] * sizeof(T));
+                }
+            }
+
+            for (size_t q = 0; q < size; q++)
+                out[begin + q] = rankOf(k[q]);
+        }
+    }
+
+    std::vector<T, search::CacheLineAllocator<T>> keys;
+    // Position in the sorted input of every node, ranks[0] is size() for "not found".
+    std::vector<size_t> ranks;
+    size_t count = 0;
+    size_t depth = 0;
+    Compare compare;
+};
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+#if defined(__SSE2__) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ct {
+
+namespace search {
+
+constexpr size_t cacheLine = 64;
+
+// Queries interleaved by the batch functions, enough misses in flight to hide the memory latency.
+constexpr size_t batchSize = 16;
+
+inline unsigned
+countTrailingZeros(uint64_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+}
+
+inline unsigned
+popCount(uint64_t x)
+{
+#if defined(_MSC_VER)
+    return static_cast<unsigned>(__popcnt64(x));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(x));
+#endif
+}
+
+// Prefetch hint, never faults. The address is computed as an integer, it may point past the array.
+inline void
+prefetch(const void* base, size_t offset)
+{
+    const auto address = reinterpret_cast<const char*>(reinterpret_cast<uintptr_t>(base) + offset);
+#if defined(__SSE2__) || defined(_M_X64)
+    _mm_prefetch(address, _MM_HINT_T0);
+#elif defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+// Allocator for std::vector which puts the first element at the start of a cache line.
+template <typename T>
+struct CacheLineAllocator
+{
+    using value_type = T;
+
+    CacheLineAllocator() = default;
+    template <typename U>
+    CacheLineAllocator(const CacheLineAllocator<U>&)
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        if (count > std::numeric_limits<size_t>::max() / sizeof(T))
+            throw std::bad_array_new_length();
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(cacheLine)));
+    }
+
+    void deallocate(T* pointer, size_t) { ::operator delete(pointer, std::align_val_t(cacheLine)); }
+
+    template <typename U>
+    bool operator==(const CacheLineAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const CacheLineAllocator<U>&) const { return false; }
+};
+
+}
+
+}
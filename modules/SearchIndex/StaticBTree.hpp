@@ -0,0 +1,297 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "SearchCommon.hpp"
+
+namespace ct {
+
+namespace search {
+
+// Number of keys in a node which are less than 'key' (lowerBound) or less or equal (upperBound).
+template <bool upper, typename T, size_t B>
+inline unsigned
+countBefore(const T* keys, T key)
+{
+#if defined(__AVX512F__)
+    if constexpr (std::is_same_v<T, int32_t> && B == 16)
+    {
+        const __m512i k = _mm512_set1_epi32(key);
+        const __m512i node = _mm512_load_si512(keys);
+        return popCount(upper ? _mm512_cmple_epi32_mask(node, k) : _mm512_cmplt_epi32_mask(node, k));
+    }
+    if constexpr (std::is_same_v<T, int64_t> && B == 8)
+    {
+        const __m512i k = _mm512_set1_epi64(key);
+        const __m512i node = _mm512_load_si512(keys);
+        return popCount(upper ? _mm512_cmple_epi64_mask(node, k) : _mm512_cmplt_epi64_mask(node, k));
+    }
+    if constexpr (std::is_same_v<T, float> && B == 16)
+    {
+        const __m512 k = _mm512_set1_ps(key);
+        const __m512 node = _mm512_load_ps(keys);
+        return popCount(upper ? _mm512_cmp_ps_mask(node, k, _CMP_LE_OQ) : _mm512_cmp_ps_mask(node, k, _CMP_LT_OQ));
+    }
+    if constexpr (std::is_same_v<T, double> && B == 8)
+    {
+        const __m512d k = _mm512_set1_pd(key);
+        const __m512d node = _mm512_load_pd(keys);
+        return popCount(upper ? _mm512_cmp_pd_mask(node, k, _CMP_LE_OQ) : _mm512_cmp_pd_mask(node, k, _CMP_LT_OQ));
+    }
+#endif
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, int32_t> && B == 16)
+    {
+        // node > key counts the keys after, node < key is key > node.
+        const __m256i k = _mm256_set1_epi32(key);
+        const __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i*>(keys));
+        const __m256i high = _mm256_load_si256(reinterpret_cast<const __m256i*>(keys + 8));
+        const __m256i lowMask = upper ? _mm256_cmpgt_epi32(low, k) : _mm256_cmpgt_epi32(k, low);
+        const __m256i highMask = upper ? _mm256_cmpgt_epi32(high, k) : _mm256_cmpgt_epi32(k, high);
+        const unsigned bits = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(lowMask)))
+                              | static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(highMask))) << 8;
+        return upper ? 16 - popCount(bits) : popCount(bits);
+    }
+    if constexpr (std::is_same_v<T, int64_t> && B == 8)
+    {
+        const __m256i k = _mm256_set1_epi64x(key);
+        const __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i*>(keys));
+        const __m256i high = _mm256_load_si256(reinterpret_cast<const __m256i*>(keys + 4));
+        const __m256i lowMask = upper ? _mm256_cmpgt_epi64(low, k) : _mm256_cmpgt_epi64(k, low);
+        const __m256i highMask = upper ? _mm256_cmpgt_epi64(high, k) : _mm256_cmpgt_epi64(k, high);
+        const unsigned bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(lowMask)))
+                              | static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(highMask))) << 4;
+        return upper ? 8 - popCount(bits) : popCount(bits);
+    }
+    if constexpr (std::is_same_v<T, float> && B == 16)
+    {
+        const __m256 k = _mm256_set1_ps(key);
+        const __m256 low = _mm256_load_ps(keys);
+        const __m256 high = _mm256_load_ps(keys + 8);
+        const __m256 lowMask = upper ? _mm256_cmp_ps(low, k, _CMP_LE_OQ) : _mm256_cmp_ps(low, k, _CMP_LT_OQ);
+        const __m256 highMask = upper ? _mm256_cmp_ps(high, k, _CMP_LE_OQ) : _mm256_cmp_ps(high, k, _CMP_LT_OQ);
+        return popCount(static_cast<unsigned>(_mm256_movemask_ps(lowMask)) | static_cast<unsigned>(_mm256_movemask_ps(highMask)) << 8);
+    }
+    if constexpr (std::is_same_v<T, double> && B == 8)
+    {
+        const __m256d k = _mm256_set1_pd(key);
+        const __m256d low = _mm256_load_pd(keys);
+        const __m256d high = _mm256_load_pd(keys + 4);
+        const __m256d lowMask = upper ? _mm256_cmp_pd(low, k, _CMP_LE_OQ) : _mm256_cmp_pd(low, k, _CMP_LT_OQ);
+        const __m256d highMask = upper ? _mm256_cmp_pd(high, k, _CMP_LE_OQ) : _mm256_cmp_pd(high, k, _CMP_LT_OQ);
+        return popCount(static_cast<unsigned>(_mm256_movemask_pd(lowMask)) | static_cast<unsigned>(_mm256_movemask_pd(highMask)) << 4);
+    }
+#elif defined(__SSE2__)
+    if constexpr (std::is_same_v<T, int32_t> && B == 16)
+    {
+        const __m128i k = _mm_set1_epi32(key);
+        unsigned bits = 0;
+        for (unsigned i = 0; i < 4; i++)
+        {
+            const __m128i part = _mm_load_si128(reinterpret_cast<const __m128i*>(keys + 4 * i));
+            const __m128i mask = upper ? _mm_cmpgt_epi32(part, k) : _mm_cmplt_epi32(part, k);
+            bits |= static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(mask))) << (4 * i);
+        }
+        return upper ? 16 - popCount(bits) : popCount(bits);
+    }
+    if constexpr (std::is_same_v<T, float> && B == 16)
+    {
+        const __m128 k = _mm_set1_ps(key);
+        unsigned bits = 0;
+        for (unsigned i = 0; i < 4; i++)
+        {
+            const __m128 part = _mm_load_ps(keys + 4 * i);
+            bits |= static_cast<unsigned>(_mm_movemask_ps(upper ? _mm_cmple_ps(part, k) : _mm_cmplt_ps(part, k))) << (4 * i);
+        }
+        return popCount(bits);
+    }
+    if constexpr (std::is_same_v<T, double> && B == 8)
+    {
+        const __m128d k = _mm_set1_pd(key);
+        unsigned bits = 0;
+        for (unsigned i = 0; i < 4; i++)
+        {
+            const __m128d part = _mm_load_pd(keys + 2 * i);
+            bits |= static_cast<unsigned>(_mm_movemask_pd(upper ? _mm_cmple_pd(part, k) : _mm_cmplt_pd(part, k))) << (2 * i);
+        }
+        return popCount(bits);
+    }
+#endif
+    // Without SIMD a loop without branches, vectorized by the compiler where possible.
+    unsigned count = 0;
+    for (size_t i = 0; i < B; i++)
+        count += upper ? !(key < keys[i]) : keys[i] < key;
+    return count;
+}
+
+}
+
+/**
+ * Immutable static B+tree (S+tree) over a sorted range of numbers for lowerBound/upperBound.
+ *
+ * Every node is one cache line of B keys (16 for 4 byte keys, 8 for 8 byte keys) and has
+ * B + 1 children, the children of node k in the layer below are k * (B + 1) + i. The leaves
+ * are the sorted keys themselves, padded with the maximum value, key i of an inner node is
+ * the smallest key under child i + 1. A lookup loads log_(B+1)(n) cache lines instead of
+ * the log2(n) of binary search and finds the child with one SIMD compare and a popcount,
+ * no branch depends on the keys. The layers are stored from the root down, the top
+ * layers of a big tree fit into L1/L2.
+ *
+ * Results are positions in the sorted input, the same as std::lower_bound - begin.
+ * Keys must be arithmetic types and not NaN. int32_t, int64_t, float and double compare
+ * with SSE2, or AVX2/AVX-512 when the build enables them (CPPTRAINING_ENABLE_NATIVE_ARCH).
+ */
+template <typename T>
+class StaticBTree
+{
+    static_assert(std::is_arithmetic_v<T>, "StaticBTree needs arithmetic keys");
+
+public:
+    // Keys per node, a node fills a cache line.
+    static constexpr size_t B = sizeof(T) < search::cacheLine ? search::cacheLine / sizeof(T) : 1;
+
+    StaticBTree() = default;
+
+    // [first, last) must be sorted ascending.
+    template <typename Iterator>
+    StaticBTree(Iterator first, Iterator last)
+    {
+        count = static_cast<size_t>(std::distance(first, last));
+        if (count == 0)
+            return;
+
+        // Nodes per layer from the leaves up.
+        std::vector<size_t> layerSizes{ (count + B - 1) / B };
+        while (layerSizes.back() > 1)
+            layerSizes.push_back((layerSizes.back() + B) / (B + 1));
+
+        size_t total = 0;
+        for (size_t size : layerSizes)
+            total += size;
+        nodes.resize(total);
+
+        // Root first, the last entry is the end of the leaves.
+        layers.resize(layerSizes.size() + 1);
+        size_t offset = 0;
+        for (size_t h = layerSizes.size(); h-- > 0;)
+        {
+            layers[layerSizes.size() - 1 - h] = offset;
+            offset += layerSizes[h];
+        }
+        layers.back() = offset;
+
+        Node* leaves = nodes.data() + layers[layers.size() - 2];
+        size_t i = 0;
+        for (Iterator it = first; it != last; ++it, ++i)
+            leaves[i / B].keys[i % B] = *it;
+        for (; i < layerSizes[0] * B; i++)
+            leaves[i / B].keys[i % B] = padding();
+
+        // Inner layers, the first key of the leftmost leaf under every child but the first.
+        size_t leavesPerChild = 1;
+        for (size_t h = 1; h < layerSizes.size(); h++)
+        {
+            Node* layer = nodes.data() + layers[layerSizes.size() - 1 - h];
+            for (size_t j = 0; j < layerSizes[h]; j++)
+            {
+                for (size_t k = 0; k < B; k++)
+                {
+                    const size_t child = j * (B + 1) + k + 1;
+                    layer[j].keys[k] = child < layerSizes[h - 1] ? leaves[child * leavesPerChild].keys[0] : padding();
+                }
+            }
+            leavesPerChild *= B + 1;
+        }
+    }
+
+    size_t size() const { return count; }
+
+    // Position of the first key not less than 'key', size() when there is none.
+    size_t lowerBound(T key) const { return find<false>(key); }
+
+    // Position of the first key greater than 'key', size() when there is none.
+    size_t upperBound(T key) const { return find<true>(key); }
+
+    // lowerBound of 'queryCount' keys, the searches are interleaved to overlap their cache misses.
+    void lowerBound(const T* queries, size_t queryCount, size_t* out) const { findBatch<false>(queries, queryCount, out); }
+
+    void upperBound(const T* queries, size_t queryCount, size_t* out) const { findBatch<true>(queries, queryCount, out); }
+
+private:
+    struct alignas(search::cacheLine) Node
+    {
+        T keys[B];
+    };
+
+    // Sorts after every key, infinity keeps float keys at infinity sorted.
+    static constexpr T padding()
+    {
+        return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    }
+
+    // Child 'index' of node k in layer h. Only keys at the maximum value count the padding
+    // of the last node, they stay in the last child.
+    size_t child(size_t h, size_t k, unsigned index) const
+    {
+        return std::min(k * (B + 1) + index, layers[h + 2] - layers[h + 1] - 1);
+    }
+
+    // Padding compares greater, a position past the end means "none".
+    size_t leafPosition(size_t k, unsigned index) const { return std::min(count, k * B + index); }
+
+    template <bool upper>
+    size_t find(T key) const
+    {
+        if (count == 0)
+            return 0;
+
+        size_t k = 0;
+        for (size_t h = 0; h + 2 < layers.size(); h++)
+            k = child(h, k, search::countBefore<upper, T, B>(nodes[layers[h] + k].keys, key));
+        return leafPosition(k, search::countBefore<upper, T, B>(nodes[layers[layers.size() - 2] + k].keys, key));
+    }
+
+    template <bool upper>
+    void findBatch(const T* queries, size_t queryCount, size_t* out) const
+    {
+        if (count == 0)
+        {
+            std::fill(out, out + queryCount, size_t{ 0 });
+            return;
+        }
+
+        size_t k[search::batchSize];
+        for (size_t begin = 0; begin < queryCount; begin += search::batchSize)
+        {
+            const size_t size = std::min(search::batchSize, queryCount - begin);
+            for (size_t q = 0; q < size; q++)
+                k[q] = 0;
+
+            for (size_t h = 0; h + 2 < layers.size(); h++)
+            {
+                for (size_t q = 0; q < size; q++)
+                {
+                    k[q] = child(h, k[q], search::countBefore<upper, T, B>(nodes[layers[h] + k[q]].keys, queries[begin + q]));
+                    search::prefetch(nodes.data() + layers[h + 1], k[q] * sizeof(Node));
+                }
+            }
+
+            const Node* leaves = nodes.data() + layers[layers.size() - 2];
+            for (size_t q = 0; q < size; q++)
+                out[begin + q] = leafPosition(k[q], search::countBefore<upper, T, B>(leaves[k[q]].keys, queries[begin + q]));
+        }
+    }
+
+    std::vector<Node, search::CacheLineAllocator<Node>> nodes;
+    // Offset of every layer in 'nodes', the root first, then the leaves and the end.
+    std::vector<size_t> layers;
+    size_t count = 0;
+};
+
+}
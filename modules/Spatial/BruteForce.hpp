@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SpatialCommon.hpp"
+
+namespace ct {
+
+namespace spatial {
+
+/**
+ * Every query checks every point, the baseline of KdTree and UniformGrid. The scan uses the
+ * same SoA kernels as the tree leaves, the difference in the benchmarks is the pruning.
+ */
+class BruteForce
+{
+public:
+    BruteForce(const Point3* points, size_t count)
+    {
+        pointArrays.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            pointArrays.push(static_cast<uint32_t>(i), points[i]);
+    }
+    explicit BruteForce(const std::vector<Point3>& points) : BruteForce(points.data(), points.size()) {}
+
+    size_t size() const { return pointArrays.size(); }
+
+    std::vector<Neighbor> nearest(Point3 query, size_t k) const
+    {
+        std::vector<Neighbor> result;
+        KnnHeap heap(k);
+        scanNearest(pointArrays, 0, pointArrays.size(), query, heap);
+        heap.take(result);
+        return result;
+    }
+
+    std::vector<Neighbor> within(Point3 query, float radius) const
+    {
+        std::vector<Neighbor> result;
+        scanWithin(pointArrays, 0, pointArrays.size(), query, radius * radius, result);
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+private:
+    PointArrays pointArrays;
+};
+
+}
+
+}
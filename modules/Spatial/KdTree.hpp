@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "SpatialCommon.hpp"
+
+namespace ct {
+
+namespace spatial {
+
+/**
+ * k-d tree over a static point set for k nearest neighbour and radius queries.
+ *
+ * Nodes split at the median of their widest axis until at most leafSize points are left.
+ * The points are stored reordered in leaf order as three coordinate arrays (SoA), a leaf is
+ * one contiguous range scanned 8 points at a time (scanNearest / scanWithin). Every node keeps
+ * its bounding box, a subtree is skipped when its box is farther than the current k-th
+ * neighbour or the radius.
+ *
+ *     ct::spatial::KdTree tree(points);
+ *     std::vector<ct::spatial::Neighbor> nearest = tree.nearest(query, 8);
+ *     std::vector<ct::spatial::Neighbor> around = tree.within(query, 0.1f);
+ *
+ * The batch queries sort the queries in Z-order first, consecutive queries then walk the same
+ * nodes and leaves while they are still in cache. Ids are the indices into the input.
+ */
+class KdTree
+{
+public:
+    static constexpr size_t leafSize = 32;
+
+    KdTree(const Point3* points, size_t count) { build(points, count); }
+    explicit KdTree(const std::vector<Point3>& points) : KdTree(points.data(), points.size()) {}
+
+    size_t size() const { return pointArrays.size(); }
+    size_t nodeCount() const { return nodeList.size(); }
+
+    // The min(k, size()) nearest points, nearest first.
+    std::vector<Neighbor> nearest(Point3 query, size_t k) const
+    {
+        std::vector<Neighbor> result;
+        KnnHeap heap(k);
+        search(query, heap);
+        heap.take(result);
+        return result;
+    }
+
+    // All points with distance <= radius, nearest first.
+    std::vector<Neighbor> within(Point3 query, float radius) const
+    {
+        std::vector<Neighbor> result;
+        collect(query, radius * radius, result);
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    /**
+     * The neighbours of queries[i] go to out[i * k ...], nearest first. Needs k <= size().
+     */
+    void nearestBatch(const Point3* queries, size_t count, size_t k, Neighbor* out) const
+    {
+        KnnHeap heap(k);
+        std::vector<Neighbor> result;
+        for (uint32_t q : zOrder(queries, count))
+        {
+            search(queries[q], heap);
+            heap.take(result);
+            std::copy(result.begin(), result.end(), out + q * k);
+        }
+    }
+
+    /**
+     * Neighbours of queries[i] are neighbors[offsets[i] ... offsets[i + 1]), nearest first.
+     */
+    void withinBatch(const Point3* queries, size_t count, float radius, std::vector<size_t>& offsets, std::vector<Neighbor>& neighbors) const
+    {
+        std::vector<std::vector<Neighbor>> results(count);
+        for (uint32_t q : zOrder(queries, count))
+        {
+            collect(queries[q], radius * radius, results[q]);
+            std::sort(results[q].begin(), results[q].end());
+        }
+
+        offsets.assign(count + 1, 0);
+        for (size_t q = 0; q < count; q++)
+            offsets[q + 1] = offsets[q] + results[q].size();
+        neighbors.clear();
+        neighbors.reserve(offsets[count]);
+        for (const auto& result : results)
+            neighbors.insert(neighbors.end(), result.begin(), result.end());
+    }
+
+private:
+    struct Node
+    {
+        float low[3];
+        float high[3];
+        uint32_t begin;
+        uint32_t end;
+        // Children, 0 for a leaf (the root is never a child).
+        uint32_t left;
+        uint32_t right;
+    };
+
+    // Depth is at most log2(size / leafSize) + 1, two entries per level.
+    static constexpr size_t maxStack = 128;
+
+    void build(const Point3* points, size_t count)
+    {
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0u);
+        if (count > 0)
+        {
+            nodeList.reserve(2 * (count / leafSize + 1));
+            buildNode(points, order, 0, count);
+        }
+
+        pointArrays.reserve(count);
+        for (uint32_t id : order)
+            pointArrays.push(id, points[id]);
+    }
+
+    uint32_t buildNode(const Point3* points, std::vector<uint32_t>& order, size_t begin, size_t end)
+    {
+        Node node{};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            node.low[axis] = std::numeric_limits<float>::infinity();
+            node.high[axis] = -std::numeric_limits<float>::infinity();
+        }
+        for (size_t i = begin; i < end; i++)
+        {
+            const float coordinates[3] = { points[order[i]].x, points[order[i]].y, points[order[i]].z };
+            for (int axis = 0; axis < 3; axis++)
+            {
+                node.low[axis] = std::min(node.low[axis], coordinates[axis]);
+                node.high[axis] = std::max(node.high[axis], coordinates[axis]);
+            }
+        }
+        node.begin = static_cast<uint32_t>(begin);
+        node.end = static_cast<uint32_t>(end);
+
+        const uint32_t index = static_cast<uint32_t>(nodeList.size());
+        nodeList.push_back(node);
+        if (end - begin <= leafSize)
+            return index;
+
+        int axis = 0;
+        for (int a = 1; a < 3; a++)
+        {
+            if (node.high[a] - node.low[a] > node.high[axis] - node.low[axis])
+                axis = a;
+        }
+        const size_t middle = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + static_cast<std::ptrdiff_t>(begin), order.begin() + static_cast<std::ptrdiff_t>(middle),
+                         order.begin() + static_cast<std::ptrdiff_t>(end), [points, axis](uint32_t a, uint32_t b) {
+                             return coordinate(points[a], axis) < coordinate(points[b], axis);
+                         });
+
+        const uint32_t left = buildNode(points, order, begin, middle);
+        const uint32_t right = buildNode(points, order, middle, end);
+        nodeList[index].left = left;
+        nodeList[index].right = right;
+        return index;
+    }
+
+    static float coordinate(Point3 point, int axis) { return axis == 0 ? point.x : axis == 1 ? point.y : point.z; }
+
+    void search(Point3 query, KnnHeap& heap) const
+    {
+        if (nodeList.empty())
+            return;
+        struct Entry
+        {
+            uint32_t node;
+            float distance;
+        };
+        Entry stack[maxStack];
+        size_t top = 0;
+        stack[top++] = Entry{ 0, 0.0f };
+        while (top > 0)
+        {
+            const Entry entry = stack[--top];
+            if (entry.distance > heap.worst())
+                continue;
+            const Node& node = nodeList[entry.node];
+            if (node.left == 0)
+            {
+                scanNearest(pointArrays, node.begin, node.end, query, heap);
+                continue;
+            }
+            const float left = boxDistanceSquared(query, nodeList[node.left].low, nodeList[node.left].high);
+            const float right = boxDistanceSquared(query, nodeList[node.right].low, nodeList[node.right].high);
+            // The nearer child is popped first and tightens the bound for the other.
+            if (left <= right)
+            {
+                stack[top++] = Entry{ node.right, right };
+                stack[top++] = Entry{ node.left, left };
+            }
+            else
+            {
+                stack[top++] = Entry{ node.left, left };
+                stack[top++] = Entry{ node.right, right };
+            }
+        }
+    }
+
+    void collect(Point3 query, float radiusSquared, std::vector<Neighbor>& out) const
+    {
+        if (nodeList.empty())
+            return;
+        uint32_t stack[maxStack];
+        size_t top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const Node& node = nodeList[stack[--top]];
+            if (boxDistanceSquared(query, node.low, node.high) > radiusSquared)
+                continue;
+            if (node.left == 0)
+                scanWithin(pointArrays, node.begin, node.end, query, radiusSquared, out);
+            else
+            {
+                stack[top++] = node.right;
+                stack[top++] = node.left;
+            }
+        }
+    }
+
+    // Query indices sorted by the Z-order of the queries in the root box.
+    std::vector<uint32_t> zOrder(const Point3* queries, size_t count) const
+    {
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0u);
+        if (nodeList.empty())
+            return order;
+
+        const Node& root = nodeList[0];
+        const float extent = std::max({ root.high[0] - root.low[0], root.high[1] - root.low[1], root.high[2] - root.low[2] });
+        const float scale = extent > 0 ? 1024.0f / extent : 0.0f;
+        const Point3 low{ root.low[0], root.low[1], root.low[2] };
+        std::vector<uint64_t> keys(count);
+        for (size_t q = 0; q < count; q++)
+            keys[q] = uint64_t{ mortonCode(queries[q], low, scale) } << 32 | q;
+        std::sort(keys.begin(), keys.end());
+        for (size_t q = 0; q < count; q++)
+            order[q] = static_cast<uint32_t>(keys[q]);
+        return order;
+    }
+
+    std::vector<Node> nodeList;
+    PointArrays pointArrays;
+};
+
+}
+
+}
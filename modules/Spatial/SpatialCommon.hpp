@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "SearchCommon.hpp"
+
+namespace ct {
+
+namespace spatial {
+
+// The coordinates of TemplateClass<float>.
+struct Point3
+{
+    float x;
+    float y;
+    float z;
+};
+
+struct Neighbor
+{
+    uint32_t id;
+    float distanceSquared;
+
+    // Nearest first, ties by id, the order of every query result.
+    bool operator<(const Neighbor& other) const
+    {
+        return distanceSquared != other.distanceSquared ? distanceSquared < other.distanceSquared : id < other.id;
+    }
+    bool operator==(const Neighbor& other) const { return id == other.id && distanceSquared == other.distanceSquared; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, search::CacheLineAllocator<T>>;
+
+// Coordinates as three arrays (SoA), one load brings the x of 8 points into a register.
+struct PointArrays
+{
+    AlignedVector<float> xs;
+    AlignedVector<float> ys;
+    AlignedVector<float> zs;
+    AlignedVector<uint32_t> ids;
+
+    size_t size() const { return xs.size(); }
+
+    void reserve(size_t count)
+    {
+        xs.reserve(count);
+        ys.reserve(count);
+        zs.reserve(count);
+        ids.reserve(count);
+    }
+
+    void push(uint32_t id, Point3 point)
+    {
+        xs.push_back(point.x);
+        ys.push_back(point.y);
+        zs.push_back(point.z);
+        ids.push_back(id);
+    }
+
+    Point3 point(size_t i) const { return Point3{ xs[i], ys[i], zs[i] }; }
+};
+
+inline float
+distanceSquared(Point3 a, Point3 b)
+{
+    const float dx = a.x - b.x;
+    const float dy = a.y - b.y;
+    const float dz = a.z - b.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// Squared distance from 'point' to the box [low, high], 0 inside.
+inline float
+boxDistanceSquared(Point3 point, const float (&low)[3], const float (&high)[3])
+{
+    const float coordinates[3] = { point.x, point.y, point.z };
+    float sum = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const float below = low[axis] - coordinates[axis];
+        const float above = coordinates[axis] - high[axis];
+        const float outside = std::max(0.0f, std::max(below, above));
+        sum += outside * outside;
+    }
+    return sum;
+}
+
+/**
+ * The k nearest candidates seen so far, a max heap on the distance. worst() is the pruning
+ * bound, infinite until k candidates were offered. With k == 0 it is -infinity, every
+ * candidate and subtree is pruned.
+ */
+class KnnHeap
+{
+public:
+    explicit KnnHeap(size_t _k) : k(_k) { heap.reserve(k); }
+
+    float worst() const
+    {
+        if (k == 0)
+            return -std::numeric_limits<float>::infinity();
+        return heap.size() < k ? std::numeric_limits<float>::infinity() : heap.front().distanceSquared;
+    }
+
+    void offer(uint32_t id, float distance)
+    {
+        if (k == 0)
+            return;
+        const Neighbor candidate{ id, distance };
+        if (heap.size() < k)
+        {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end());
+        }
+        else if (candidate < heap.front())
+        {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = candidate;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+
+    // Nearest first, empties the heap.
+    void take(std::vector<Neighbor>& out)
+    {
+        std::sort_heap(heap.begin(), heap.end());
+        out.swap(heap);
+        heap.clear();
+    }
+
+private:
+    size_t k;
+    std::vector<Neighbor> heap;
+};
+
+/**
+ * Leaf scans on PointArrays ranges [begin, end). AVX2 computes the distances of 8 points per
+ * step, the scalar loop is left for the compiler to vectorize with SSE.
+ */
+inline void
+scanNearest(const PointArrays& points, size_t begin, size_t end, Point3 query, KnnHeap& heap)
+{
+    size_t i = begin;
+#if defined(__AVX2__)
+    const __m256 qx = _mm256_set1_ps(query.x);
+    const __m256 qy = _mm256_set1_ps(query.y);
+    const __m256 qz = _mm256_set1_ps(query.z);
+    for (; i + 8 <= end; i += 8)
+    {
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(points.xs.data() + i), qx);
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(points.ys.data() + i), qy);
+        const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(points.zs.data() + i), qz);
+        const __m256 distances = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        // Only the lanes which beat the current worst go to the heap.
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(distances, _mm256_set1_ps(heap.worst()), _CMP_LE_OQ)));
+        if (mask == 0)
+            continue;
+        alignas(32) float values[8];
+        _mm256_store_ps(values, distances);
+        while (mask != 0)
+        {
+            const unsigned lane = search::countTrailingZeros(mask);
+            heap.offer(points.ids[i + lane], values[lane]);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < end; i++)
+    {
+        const float distance = distanceSquared(points.point(i), query);
+        if (distance <= heap.worst())
+            heap.offer(points.ids[i], distance);
+    }
+}
+
+inline void
+scanWithin(const PointArrays& points, size_t begin, size_t end, Point3 query, float radiusSquared, std::vector<Neighbor>& out)
+{
+    size_t i = begin;
+#if defined(__AVX2__)
+    const __m256 qx = _mm256_set1_ps(query.x);
+    const __m256 qy = _mm256_set1_ps(query.y);
+    const __m256 qz = _mm256_set1_ps(query.z);
+    const __m256 limit = _mm256_set1_ps(radiusSquared);
+    for (; i + 8 <= end; i += 8)
+    {
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(points.xs.data() + i), qx);
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(points.ys.data() + i), qy);
+        const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(points.zs.data() + i), qz);
+        const __m256 distances = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(distances, limit, _CMP_LE_OQ)));
+        if (mask == 0)
+            continue;
+        alignas(32) float values[8];
+        _mm256_store_ps(values, distances);
+        while (mask != 0)
+        {
+            const unsigned lane = search::countTrailingZeros(mask);
+            out.push_back(Neighbor{ points.ids[i + lane], values[lane] });
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < end; i++)
+    {
+        const float distance = distanceSquared(points.point(i), query);
+        if (distance <= radiusSquared)
+            out.push_back(Neighbor{ points.ids[i], distance });
+    }
+}
+
+// Spreads the low 10 bits of x to every third bit.
+inline uint32_t
+spreadBits(uint32_t x)
+{
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+// Z-order of a point in the box [low, low + size), nearby points get nearby codes.
+inline uint32_t
+mortonCode(Point3 point, Point3 low, float scale)
+{
+    const auto cell = [scale](float value, float origin) {
+        const float position = (value - origin) * scale;
+        return static_cast<uint32_t>(std::min(1023.0f, std::max(0.0f, position)));
+    };
+    return spreadBits(cell(point.x, low.x)) | (spreadBits(cell(point.y, low.y)) << 1) | (spreadBits(cell(point.z, low.z)) << 2);
+}
+
+}
+
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "SpatialCommon.hpp"
+
+namespace ct {
+
+namespace spatial {
+
+/**
+ * Hashed uniform grid for points which move, appear and disappear.
+ *
+ * Space is cut into cubes of cellSize, only occupied cells exist in a hash map. A cell keeps
+ * its points as coordinate arrays, insert, erase and move are O(1) (erase swaps the last point
+ * of the cell into the hole). Radius queries visit the cells the sphere overlaps, a cell size
+ * near the usual radius keeps that to 27 cells. Nearest neighbour queries visit shells of
+ * cells around the query until the k-th neighbour is closer than the next shell.
+ *
+ *     ct::spatial::UniformGrid grid(0.05f);
+ *     grid.insert(id, position);
+ *     grid.move(id, newPosition);
+ *     std::vector<ct::spatial::Neighbor> around = grid.within(query, 0.05f);
+ *
+ * Coordinates divided by cellSize must stay within +-2^20.
+ */
+class UniformGrid
+{
+public:
+    explicit UniformGrid(float _cellSize) : cellSize(_cellSize), inverseCellSize(1.0f / _cellSize) {}
+
+    size_t size() const { return locationMap.size(); }
+    size_t cellCount() const { return cellMap.size(); }
+
+    // 'id' must not be in the grid yet.
+    void insert(uint32_t id, Point3 point)
+    {
+        const Key key = keyOf(point);
+        Cell& cell = cellMap[pack(key)];
+        locationMap[id] = Location{ pack(key), static_cast<uint32_t>(cell.points.size()) };
+        cell.points.push(id, point);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            lowCell[axis] = std::min(lowCell[axis], key.c[axis]);
+            highCell[axis] = std::max(highCell[axis], key.c[axis]);
+        }
+    }
+
+    // False when 'id' is not in the grid.
+    bool erase(uint32_t id)
+    {
+        const auto found = locationMap.find(id);
+        if (found == locationMap.end())
+            return false;
+        const Location location = found->second;
+        locationMap.erase(found);
+
+        const auto cellEntry = cellMap.find(location.cell);
+        PointArrays& points = cellEntry->second.points;
+        const size_t last = points.size() - 1;
+        if (location.slot != last)
+        {
+            points.xs[location.slot] = points.xs[last];
+            points.ys[location.slot] = points.ys[last];
+            points.zs[location.slot] = points.zs[last];
+            points.ids[location.slot] = points.ids[last];
+            locationMap[points.ids[location.slot]].slot = location.slot;
+        }
+        points.xs.pop_back();
+        points.ys.pop_back();
+        points.zs.pop_back();
+        points.ids.pop_back();
+        if (points.size() == 0)
+            cellMap.erase(cellEntry);
+        return true;
+    }
+
+    // Moves 'id' to 'point', inserts it when it is not in the grid.
+    void move(uint32_t id, Point3 point)
+    {
+        const auto found = locationMap.find(id);
+        if (found != locationMap.end() && found->second.cell == pack(keyOf(point)))
+        {
+            PointArrays& points = cellMap.find(found->second.cell)->second.points;
+            points.xs[found->second.slot] = point.x;
+            points.ys[found->second.slot] = point.y;
+            points.zs[found->second.slot] = point.z;
+            return;
+        }
+        erase(id);
+        insert(id, point);
+    }
+
+    // All points with distance <= radius, nearest first.
+    std::vector<Neighbor> within(Point3 query, float radius) const
+    {
+        std::vector<Neighbor> result;
+        const float radiusSquared = radius * radius;
+        const Key low = keyOf(Point3{ query.x - radius, query.y - radius, query.z - radius });
+        const Key high = keyOf(Point3{ query.x + radius, query.y + radius, query.z + radius });
+        const double cells = double(high.c[0] - low.c[0] + 1) * double(high.c[1] - low.c[1] + 1) * double(high.c[2] - low.c[2] + 1);
+        if (cells > static_cast<double>(cellMap.size()))
+        {
+            // Fewer occupied cells than cells in the box, check them all instead of hashing empty ones.
+            for (const auto& entry : cellMap)
+                scanWithin(entry.second.points, 0, entry.second.points.size(), query, radiusSquared, result);
+        }
+        else
+        {
+            for (int32_t x = low.c[0]; x <= high.c[0]; x++)
+                for (int32_t y = low.c[1]; y <= high.c[1]; y++)
+                    for (int32_t z = low.c[2]; z <= high.c[2]; z++)
+                        visit(Key{ { x, y, z } }, [&](const PointArrays& points) { scanWithin(points, 0, points.size(), query, radiusSquared, result); });
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // The min(k, size()) nearest points, nearest first.
+    std::vector<Neighbor> nearest(Point3 query, size_t k) const
+    {
+        std::vector<Neighbor> result;
+        KnnHeap heap(k);
+        if (k == 0 || cellMap.empty())
+            return result;
+
+        const Key center = keyOf(query);
+        // Shells beyond this one hold no occupied cell.
+        int32_t lastShell = 0;
+        for (int axis = 0; axis < 3; axis++)
+            lastShell = std::max({ lastShell, center.c[axis] - lowCell[axis], highCell[axis] - center.c[axis] });
+
+        for (int32_t shell = 0; shell <= lastShell; shell++)
+        {
+            // Every point of shell s is at least (s - 1) * cellSize away from the query.
+            const float bound = static_cast<float>(shell - 1) * cellSize;
+            if (shell > 0 && bound * bound > heap.worst())
+                break;
+            visitShell(center, shell, [&](const PointArrays& points) { scanNearest(points, 0, points.size(), query, heap); });
+        }
+        heap.take(result);
+        return result;
+    }
+
+private:
+    struct Key
+    {
+        int32_t c[3];
+    };
+
+    struct Cell
+    {
+        PointArrays points;
+    };
+
+    struct Location
+    {
+        uint64_t cell;
+        uint32_t slot;
+    };
+
+    static constexpr int32_t keyBias = 1 << 20;
+
+    Key keyOf(Point3 point) const
+    {
+        const auto cell = [this](float value) {
+            const float scaled = std::floor(value * inverseCellSize);
+            return static_cast<int32_t>(std::min(float(keyBias - 1), std::max(float(-keyBias), scaled)));
+        };
+        return Key{ { cell(point.x), cell(point.y), cell(point.z) } };
+    }
+
+    // 21 bits per axis.
+    static uint64_t pack(Key key)
+    {
+        return uint64_t(uint32_t(key.c[0] + keyBias)) << 42 | uint64_t(uint32_t(key.c[1] + keyBias)) << 21 | uint64_t(uint32_t(key.c[2] + keyBias));
+    }
+
+    template <typename Visit>
+    void visit(Key key, Visit&& scan) const
+    {
+        const auto found = cellMap.find(pack(key));
+        if (found != cellMap.end())
+            scan(found->second.points);
+    }
+
+    // The cells with Chebyshev distance 'shell' from 'center': full faces for x = +-shell, the rest in between.
+    template <typename Visit>
+    void visitShell(Key center, int32_t shell, Visit&& scan) const
+    {
+        if (shell == 0)
+        {
+            visit(center, scan);
+            return;
+        }
+        for (int32_t dx = -shell; dx <= shell; dx++)
+        {
+            const bool xFace = dx == -shell || dx == shell;
+            for (int32_t dy = -shell; dy <= shell; dy++)
+            {
+                const bool yFace = dy == -shell || dy == shell;
+                const int32_t step = xFace || yFace ? 1 : 2 * shell;
+                for (int32_t dz = -shell; dz <= shell; dz += step)
+                    visit(Key{ { center.c[0] + dx, center.c[1] + dy, center.c[2] + dz } }, scan);
+            }
+        }
+    }
+
+    float cellSize;
+    float inverseCellSize;
+    std::unordered_map<uint64_t, Cell> cellMap;
+    std::unordered_map<uint32_t, Location> locationMap;
+    // Occupied cell bounds, only grow.
+    int32_t lowCell[3] = { std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max() };
+    int32_t highCell[3] = { std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min() };
+};
+
+}
+
+}
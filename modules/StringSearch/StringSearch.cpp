@@ -0,0 +1,409 @@
+#include <algorithm>
+#include <cstring>
+#include <queue>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "StringSearch.hpp"
+
+namespace ct {
+
+namespace {
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+#if defined(__AVX2__)
+using ByteVector = __m256i;
+constexpr size_t vectorBytes = 32;
+
+inline ByteVector
+broadcast(char c)
+{
+    return _mm256_set1_epi8(c);
+}
+
+// Bit i set when p[i] == first and p[i + lastOffset] == last.
+inline uint32_t
+candidates(const char* p, size_t lastOffset, ByteVector first, ByteVector last)
+{
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + lastOffset));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+}
+#else
+using ByteVector = __m128i;
+constexpr size_t vectorBytes = 16;
+
+inline ByteVector
+broadcast(char c)
+{
+    return _mm_set1_epi8(c);
+}
+
+inline uint32_t
+candidates(const char* p, size_t lastOffset, ByteVector first, ByteVector last)
+{
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + lastOffset));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+}
+#endif
+
+inline unsigned
+lowestBit(uint32_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(x));
+#endif
+}
+
+inline unsigned
+highestBit(uint32_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, x);
+    return static_cast<unsigned>(index);
+#else
+    return 31 - static_cast<unsigned>(__builtin_clz(x));
+#endif
+}
+
+#endif
+
+// The window at 'p' matches when the bytes between the first and the last one match.
+inline bool
+middleMatches(const char* p, const std::string& needle)
+{
+    return needle.size() <= 2 || memcmp(p + 1, needle.data() + 1, needle.size() - 2) == 0;
+}
+
+inline bool
+windowMatches(const char* p, const std::string& needle)
+{
+    return p[0] == needle.front() && p[needle.size() - 1] == needle.back() && middleMatches(p, needle);
+}
+
+size_t
+findFiltered(std::string_view haystack, const std::string& needle, size_t pos)
+{
+    const char* s = haystack.data();
+    const size_t lastOffset = needle.size() - 1;
+    // Window starts are [pos, end).
+    const size_t end = haystack.size() - lastOffset;
+    size_t i = pos;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    const ByteVector first = broadcast(needle.front());
+    const ByteVector last = broadcast(needle.back());
+    for (; i + vectorBytes <= end; i += vectorBytes)
+    {
+        for (uint32_t mask = candidates(s + i, lastOffset, first, last); mask != 0; mask &= mask - 1)
+        {
+            const size_t candidate = i + lowestBit(mask);
+            if (middleMatches(s + candidate, needle))
+                return candidate;
+        }
+    }
+#else
+    // memchr is vectorized by the C library.
+    while (i < end)
+    {
+        const void* found = memchr(s + i, needle.front(), end - i);
+        if (found == nullptr)
+            return StringSearcher::npos;
+        i = static_cast<size_t>(static_cast<const char*>(found) - s);
+        if (windowMatches(s + i, needle))
+            return i;
+        i++;
+    }
+#endif
+
+    for (; i < end; i++)
+    {
+        if (windowMatches(s + i, needle))
+            return i;
+    }
+    return StringSearcher::npos;
+}
+
+size_t
+rfindFiltered(std::string_view haystack, const std::string& needle)
+{
+    const char* s = haystack.data();
+    const size_t lastOffset = needle.size() - 1;
+    // Window starts still to test are [0, end), from the highest one.
+    size_t end = haystack.size() - lastOffset;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    const ByteVector first = broadcast(needle.front());
+    const ByteVector last = broadcast(needle.back());
+    for (; end >= vectorBytes; end -= vectorBytes)
+    {
+        const size_t block = end - vectorBytes;
+        for (uint32_t mask = candidates(s + block, lastOffset, first, last); mask != 0;)
+        {
+            const unsigned bit = highestBit(mask);
+            if (middleMatches(s + block + bit, needle))
+                return block + bit;
+            mask &= ~(uint32_t{ 1 } << bit);
+        }
+    }
+#endif
+
+    while (end-- > 0)
+    {
+        if (windowMatches(s + end, needle))
+            return end;
+    }
+    return StringSearcher::npos;
+}
+
+}
+
+StringSearcher::StringSearcher(std::string_view _needle)
+    : pattern(_needle)
+{
+    if (pattern.empty())
+        selected = Algorithm::Empty;
+    else if (pattern.size() == 1)
+        selected = Algorithm::Byte;
+    else if (pattern.size() < horspoolMinLength())
+        selected = Algorithm::SimdFilter;
+    else
+        selected = Algorithm::Horspool;
+
+    if (selected != Algorithm::Horspool)
+        return;
+
+    // Shift which aligns the last occurrence of the byte in needle[0, size - 1)
+    // with the last byte of the window, the needle length when it does not occur.
+    const size_t size = pattern.size();
+    shift.fill(static_cast<uint32_t>(size));
+    for (size_t i = 0; i + 1 < size; i++)
+        shift[static_cast<uint8_t>(pattern[i])] = static_cast<uint32_t>(size - 1 - i);
+
+    // The same for rfind with the first occurrence in needle[1, size) and the first byte of the window.
+    reverseShift.fill(static_cast<uint32_t>(size));
+    for (size_t i = size - 1; i > 0; i--)
+        reverseShift[static_cast<uint8_t>(pattern[i])] = static_cast<uint32_t>(i);
+}
+
+size_t
+StringSearcher::horspoolMinLength()
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+    return 256;
+#else
+    return 16;
+#endif
+}
+
+size_t
+StringSearcher::find(std::string_view haystack, size_t pos) const
+{
+    if (pos > haystack.size() || haystack.size() - pos < pattern.size())
+        return npos;
+
+    switch (selected)
+    {
+    case Algorithm::Empty:
+        return pos;
+    case Algorithm::Byte:
+    {
+        const void* found = memchr(haystack.data() + pos, pattern.front(), haystack.size() - pos);
+        return found != nullptr ? static_cast<size_t>(static_cast<const char*>(found) - haystack.data()) : npos;
+    }
+    case Algorithm::SimdFilter:
+        return findFiltered(haystack, pattern, pos);
+    case Algorithm::Horspool:
+        return findHorspool(haystack, pos);
+    }
+    return npos;
+}
+
+size_t
+StringSearcher::rfind(std::string_view haystack) const
+{
+    if (haystack.size() < pattern.size())
+        return npos;
+
+    switch (selected)
+    {
+    case Algorithm::Empty:
+        return haystack.size();
+    case Algorithm::Byte:
+        return haystack.rfind(pattern.front());
+    case Algorithm::SimdFilter:
+        return rfindFiltered(haystack, pattern);
+    case Algorithm::Horspool:
+        return rfindHorspool(haystack);
+    }
+    return npos;
+}
+
+size_t
+StringSearcher::count(std::string_view haystack) const
+{
+    if (pattern.empty())
+        return haystack.size() + 1;
+
+    size_t total = 0;
+    for (size_t pos = find(haystack); pos != npos; pos = find(haystack, pos + 1))
+        total++;
+    return total;
+}
+
+size_t
+StringSearcher::findHorspool(std::string_view haystack, size_t pos) const
+{
+    const char* s = haystack.data();
+    const size_t size = pattern.size();
+    const char last = pattern.back();
+
+    for (size_t window = pos; window + size <= haystack.size();)
+    {
+        const char c = s[window + size - 1];
+        if (c == last && memcmp(s + window, pattern.data(), size - 1) == 0)
+            return window;
+        window += shift[static_cast<uint8_t>(c)];
+    }
+    return npos;
+}
+
+size_t
+StringSearcher::rfindHorspool(std::string_view haystack) const
+{
+    const char* s = haystack.data();
+    const size_t size = pattern.size();
+    const char first = pattern.front();
+
+    size_t window = haystack.size() - size;
+    while (true)
+    {
+        const char c = s[window];
+        if (c == first && memcmp(s + window + 1, pattern.data() + 1, size - 1) == 0)
+            return window;
+        const size_t step = reverseShift[static_cast<uint8_t>(c)];
+        if (window < step)
+            return npos;
+        window -= step;
+    }
+}
+
+size_t
+findString(std::string_view haystack, std::string_view needle, size_t pos)
+{
+    return StringSearcher(needle).find(haystack, pos);
+}
+
+size_t
+findLastString(std::string_view haystack, std::string_view needle)
+{
+    return StringSearcher(needle).rfind(haystack);
+}
+
+MultiStringSearcher::MultiStringSearcher(const std::vector<std::string>& needles)
+{
+    // Trie, 0 is the root and a missing transition.
+    next.assign(256, 0);
+    terminal.push_back(noNeedle);
+
+    for (size_t n = 0; n < needles.size(); n++)
+    {
+        const std::string& needle = needles[n];
+        lengths.push_back(needle.size());
+        if (needle.empty())
+            continue;
+
+        uint32_t state = 0;
+        for (char c : needle)
+        {
+            uint32_t& target = next[size_t{ state } * 256 + static_cast<uint8_t>(c)];
+            if (target == 0)
+            {
+                target = static_cast<uint32_t>(terminal.size());
+                terminal.push_back(noNeedle);
+                next.resize(next.size() + 256, 0);
+            }
+            // resize() may have moved the table, read the target again.
+            state = next[size_t{ state } * 256 + static_cast<uint8_t>(c)];
+        }
+        if (terminal[state] == noNeedle)
+            terminal[state] = static_cast<uint32_t>(n);
+    }
+
+    // Breadth first: failure links and missing transitions from the failure state, which
+    // is closer to the root and already complete. The result is a DFA without failure links.
+    const size_t states = terminal.size();
+    std::vector<uint32_t> failure(states, 0);
+    firstOutput.assign(states, 0);
+    outputLink.assign(states, 0);
+
+    std::queue<uint32_t> queue;
+    for (size_t c = 0; c < 256; c++)
+    {
+        if (next[c] != 0)
+            queue.push(next[c]);
+    }
+
+    while (!queue.empty())
+    {
+        const uint32_t state = queue.front();
+        queue.pop();
+
+        const uint32_t fail = failure[state];
+        outputLink[state] = firstOutput[fail];
+        firstOutput[state] = terminal[state] != noNeedle ? state : outputLink[state];
+
+        for (size_t c = 0; c < 256; c++)
+        {
+            uint32_t& target = next[size_t{ state } * 256 + c];
+            if (target != 0)
+            {
+                failure[target] = next[size_t{ fail } * 256 + c];
+                queue.push(target);
+            }
+            else
+                target = next[size_t{ fail } * 256 + c];
+        }
+    }
+}
+
+MultiStringSearcher::Match
+MultiStringSearcher::findFirst(std::string_view haystack) const
+{
+    uint32_t state = 0;
+    for (size_t i = 0; i < haystack.size(); i++)
+    {
+        state = next[size_t{ state } * 256 + static_cast<uint8_t>(haystack[i])];
+        const uint32_t output = firstOutput[state];
+        if (output != 0)
+        {
+            // The longest needle ending here starts first.
+            const uint32_t needle = terminal[output];
+            return Match{ i + 1 - lengths[needle], needle };
+        }
+    }
+    return Match{ npos, npos };
+}
+
+size_t
+MultiStringSearcher::count(std::string_view haystack) const
+{
+    size_t total = 0;
+    forEach(haystack, [&total](const Match&) { total++; });
+    return total;
+}
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ct {
+
+/**
+ * Substring search over std::string_view, which can view a std::string or a MappedFile.
+ *
+ * StringSearcher picks the algorithm by needle length:
+ *  - 1 byte:        memchr.
+ *  - short needles: SIMD filter on the first and the last byte of the needle. A block of
+ *                   32 (AVX2) or 16 (SSE2) window starts is tested with two compares,
+ *                   only candidates with both bytes matching are compared with memcmp.
+ *  - long needles:  Boyer-Moore-Horspool, the last byte of the window selects a shift
+ *                   of up to the needle length, most of the haystack is never read.
+ * rfind() runs the same algorithms from the end of the haystack (std::find_end, string::rfind).
+ * Build the searcher once and reuse it, the Horspool tables are built in the constructor.
+ */
+class StringSearcher
+{
+public:
+    enum class Algorithm
+    {
+        Empty,
+        Byte,
+        SimdFilter,
+        Horspool,
+    };
+
+    static constexpr size_t npos = std::string_view::npos;
+
+    /**
+     * Needles of at least this many bytes use Horspool. The SIMD filter tests 16 or 32
+     * positions per step and stays ahead of Horspool on log text up to a few hundred bytes,
+     * without SIMD Horspool wins early. See test/Modules/string_search.cpp.
+     */
+    static size_t horspoolMinLength();
+
+    explicit StringSearcher(std::string_view _needle);
+
+    // First occurrence at or after 'pos', npos when there is none. An empty needle is found at 'pos'.
+    size_t find(std::string_view haystack, size_t pos = 0) const;
+    // Last occurrence, npos when there is none. An empty needle is found at haystack.size().
+    size_t rfind(std::string_view haystack) const;
+    // Number of occurrences, overlapping ones included.
+    size_t count(std::string_view haystack) const;
+
+    Algorithm algorithm() const { return selected; }
+    const std::string& needle() const { return pattern; }
+
+private:
+    size_t findHorspool(std::string_view haystack, size_t pos) const;
+    size_t rfindHorspool(std::string_view haystack) const;
+
+    std::string pattern;
+    Algorithm selected;
+    // Horspool shifts by the last byte of the window (find) and by the first byte (rfind).
+    std::array<uint32_t, 256> shift{};
+    std::array<uint32_t, 256> reverseShift{};
+};
+
+// StringSearcher(needle).find(haystack, pos) without keeping the searcher.
+size_t findString(std::string_view haystack, std::string_view needle, size_t pos = 0);
+// Last occurrence, like std::find_end.
+size_t findLastString(std::string_view haystack, std::string_view needle);
+
+/**
+ * Searches many needles in one pass with an Aho-Corasick automaton.
+ *
+ * The automaton is a dense DFA, 256 transitions of 4 bytes per trie node, so every haystack
+ * byte is one table load whatever the number of needles. Searching N needles with N
+ * StringSearchers reads the haystack N times. Matches are reported in the order of their
+ * end position, overlapping matches and needles inside other needles included.
+ */
+class MultiStringSearcher
+{
+public:
+    struct Match
+    {
+        size_t position;
+        size_t needle;
+    };
+
+    static constexpr size_t npos = std::string_view::npos;
+
+    // Empty needles are ignored, a repeated needle is reported once with its first index.
+    explicit MultiStringSearcher(const std::vector<std::string>& needles);
+
+    // Calls function(Match) for every match.
+    template <typename Function>
+    void forEach(std::string_view haystack, Function function) const
+    {
+        uint32_t state = 0;
+        for (size_t i = 0; i < haystack.size(); i++)
+        {
+            state = next[size_t{ state } * 256 + static_cast<uint8_t>(haystack[i])];
+            for (uint32_t output = firstOutput[state]; output != 0; output = outputLink[output])
+            {
+                const uint32_t needle = terminal[output];
+                function(Match{ i + 1 - lengths[needle], needle });
+            }
+        }
+    }
+
+    // Match with the lowest end position, position npos when there is none.
+    Match findFirst(std::string_view haystack) const;
+    size_t count(std::string_view haystack) const;
+
+    size_t needleCount() const { return lengths.size(); }
+    size_t stateCount() const { return terminal.size(); }
+
+private:
+    static constexpr uint32_t noNeedle = ~uint32_t{ 0 };
+
+    std::vector<uint32_t> next;
+    // Needle which ends in the state or noNeedle.
+    std::vector<uint32_t> terminal;
+    // The state itself when it is terminal, else the nearest terminal state on the failure chain, 0 for none.
+    std::vector<uint32_t> firstOutput;
+    // Next terminal state on the failure chain.
+    std::vector<uint32_t> outputLink;
+    std::vector<size_t> lengths;
+};
+
+}
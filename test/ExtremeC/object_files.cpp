@@ -0,0 +1,368 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ Extreme C, Chapter 3: Object Files
+ by Kamran Amini
+
+ file: https://github.com/janbajana/CppTraining/apps/ExtremeC_OjectFiles
+ run: ./test/extremec_object_files
+
+ max() and max_3() are compiled in their own translation unit (MinMax library).
+ Without LTO every call is a real call. Build with -DCPPTRAINING_ENABLE_LTO=ON
+ and the cross TU benchmarks should run as fast as the inlined ones.
+*/
+
+// C++ headers
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "examples_chapter3_2_funcs.h"
+
+// The same functions as in examples_chapter3_2_funcs.c, but visible to the compiler.
+static inline int
+max_inline(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+static inline int
+max_3_inline(int a, int b, int c)
+{
+    int temp = max_inline(a, b);
+    return c > temp ? c : temp;
+}
+
+static std::vector<int>
+random_data(size_t size, unsigned seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> distribution(-1000, 1000);
+
+    std::vector<int> data(size);
+    for (auto& element : data)
+        element = distribution(generator);
+    return data;
+}
+
+static std::vector<float>
+random_data_f32(size_t size, unsigned seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(-1000.0f, 1000.0f);
+
+    std::vector<float> data(size);
+    for (auto& element : data)
+        element = distribution(generator);
+    return data;
+}
+
+static void
+benchmark_max_3_cross_tu(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<int> a = random_data(size, 1);
+    std::vector<int> b = random_data(size, 2);
+    std::vector<int> c = random_data(size, 3);
+
+    for (auto _ : state)
+    {
+        int result = 0;
+        for (size_t i = 0; i < size; i++)
+            result += max_3(a[i], b[i], c[i]);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+
+    for (size_t i = 0; i < size; i++)
+        EXPECT_EQ(max_3(a[i], b[i], c[i]), max_3_inline(a[i], b[i], c[i]));
+}
+
+static void
+benchmark_max_3_inline(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<int> a = random_data(size, 1);
+    std::vector<int> b = random_data(size, 2);
+    std::vector<int> c = random_data(size, 3);
+
+    for (auto _ : state)
+    {
+        int result = 0;
+        for (size_t i = 0; i < size; i++)
+            result += max_3_inline(a[i], b[i], c[i]);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+// Chain of calls, every max() result feeds the next call.
+static void
+benchmark_max_chain_cross_tu(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<int> a = random_data(size, 1);
+
+    for (auto _ : state)
+    {
+        int result = a[0];
+        for (size_t i = 1; i < size; i++)
+            result = max(result, a[i]);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void
+benchmark_max_chain_inline(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<int> a = random_data(size, 1);
+
+    for (auto _ : state)
+    {
+        int result = a[0];
+        for (size_t i = 1; i < size; i++)
+            result = max_inline(result, a[i]);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+// == Array kernels (examples_chapter3_2_kernels.c)
+
+// Elementwise max of three signals by calling max_3() in a loop.
+static void
+benchmark_max_n_scalar_loop(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<int> a = random_data(size, 1);
+    std::vector<int> b = random_data(size, 2);
+    std::vector<int> c = random_data(size, 3);
+    std::vector<int> out(size);
+
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < size; i++)
+            out[i] = max_3(a[i], b[i], c[i]);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void
+benchmark_max_n_i32(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<int> a = random_data(size, 1);
+    std::vector<int> b = random_data(size, 2);
+    std::vector<int> c = random_data(size, 3);
+    std::vector<int> out(size);
+
+    for (auto _ : state)
+    {
+        max_n_i32(a.data(), b.data(), c.data(), out.data(), size);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+
+    for (size_t i = 0; i < size; i++)
+        EXPECT_EQ(out[i], max_3(a[i], b[i], c[i]));
+}
+
+static void
+benchmark_max_n_f32(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<float> a = random_data_f32(size, 1);
+    std::vector<float> b = random_data_f32(size, 2);
+    std::vector<float> c = random_data_f32(size, 3);
+    std::vector<float> out(size);
+
+    for (auto _ : state)
+    {
+        max_n_f32(a.data(), b.data(), c.data(), out.data(), size);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+
+    for (size_t i = 0; i < size; i++)
+        EXPECT_EQ(out[i], std::max(std::max(a[i], b[i]), c[i]));
+}
+
+static void
+benchmark_max_reduce_scalar_loop(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<int> a = random_data(size, 1);
+
+    for (auto _ : state)
+    {
+        int result = INT_MIN;
+        for (size_t i = 0; i < size; i++)
+            result = max(a[i], result);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void
+benchmark_max_reduce_i32(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<int> a = random_data(size, 1);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(max_reduce_i32(a.data(), size));
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+
+    EXPECT_EQ(max_reduce_i32(a.data(), size), *std::max_element(a.begin(), a.end()));
+}
+
+static void
+benchmark_max_reduce_f32(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<float> a = random_data_f32(size, 1);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(max_reduce_f32(a.data(), size));
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+
+    EXPECT_EQ(max_reduce_f32(a.data(), size), *std::max_element(a.begin(), a.end()));
+}
+
+static void
+benchmark_clamp_n_i32(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<int> a = random_data(size, 1);
+    std::vector<int> out(size);
+
+    for (auto _ : state)
+    {
+        clamp_n_i32(a.data(), -100, 100, out.data(), size);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+
+    for (size_t i = 0; i < size; i++)
+        EXPECT_EQ(out[i], std::clamp(a[i], -100, 100));
+}
+
+static void
+benchmark_clamp_n_f32(benchmark::State& state)
+{
+    const size_t size = state.range(0);
+    std::vector<float> a = random_data_f32(size, 1);
+    std::vector<float> out(size);
+
+    for (auto _ : state)
+    {
+        clamp_n_f32(a.data(), -100.0f, 100.0f, out.data(), size);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+
+    for (size_t i = 0; i < size; i++)
+        EXPECT_EQ(out[i], std::clamp(a[i], -100.0f, 100.0f));
+}
+
+// Sizes which are not a multiple of the vector width exercise the scalar tail.
+static void
+benchmark_kernels_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(max_reduce_i32(nullptr, 0));
+    }
+
+    EXPECT_EQ(max_reduce_i32(nullptr, 0), INT_MIN);
+    EXPECT_TRUE(std::isinf(max_reduce_f32(nullptr, 0)));
+
+    for (size_t size = 1; size < 40; size++)
+    {
+        std::vector<int> a = random_data(size, 4);
+        std::vector<int> b = random_data(size, 5);
+        std::vector<int> c = random_data(size, 6);
+        EXPECT_EQ(max_reduce_i32(a.data(), size), *std::max_element(a.begin(), a.end()));
+
+        // Output aliases the first input.
+        std::vector<int> expected(size);
+        for (size_t i = 0; i < size; i++)
+            expected[i] = max_3(a[i], b[i], c[i]);
+        max_n_i32(a.data(), b.data(), c.data(), a.data(), size);
+        EXPECT_EQ(a, expected);
+    }
+
+    // NaN elements are skipped by the reduction.
+    std::vector<float> f = random_data_f32(37, 7);
+    const float expected = *std::max_element(f.begin(), f.end());
+    f[0] = NAN;
+    f[20] = NAN;
+    f[36] = NAN;
+    EXPECT_EQ(max_reduce_f32(f.data(), f.size()), expected);
+}
+
+BENCHMARK(benchmark_max_3_cross_tu)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(benchmark_max_3_inline)->Arg(1 << 10)->Arg(1 << 16);
+
+BENCHMARK(benchmark_max_chain_cross_tu)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(benchmark_max_chain_inline)->Arg(1 << 10)->Arg(1 << 16);
+
+BENCHMARK(benchmark_max_n_scalar_loop)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK(benchmark_max_n_i32)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK(benchmark_max_n_f32)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+BENCHMARK(benchmark_max_reduce_scalar_loop)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK(benchmark_max_reduce_i32)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK(benchmark_max_reduce_f32)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+BENCHMARK(benchmark_clamp_n_i32)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(benchmark_clamp_n_f32)->Arg(1 << 10)->Arg(1 << 16);
+
+BENCHMARK(benchmark_kernels_edge_cases)->Iterations(1);
+
+BENCHMARK_MAIN();
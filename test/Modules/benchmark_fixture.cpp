@@ -0,0 +1,185 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Benchmark fixtures with preallocated buffers (modules/BenchmarkFixture)
+
+ benchmark_nth_element and benchmark_eliminate_duplicates copied their dataset into a new
+ std::vector in every iteration, malloc, page faults and the copy were measured with the
+ algorithm. BenchmarkFixture restores the data with memcpy into warm, page touched memory
+ and reports the setup cost (setup_ns) apart from the algorithm (algorithm_ns).
+ Arguments: number of elements.
+
+ run: ./test/benchmark_fixture
+*/
+
+// C++ headers
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "BenchmarkFixture.hpp"
+
+// Values in [0, range), a small range gives duplicates.
+static std::vector<int>
+make_data(size_t size, size_t range = 1000003)
+{
+    std::vector<int> data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = static_cast<int>((i * 2654435761u) % range);
+    return data;
+}
+
+static int
+median(std::vector<int> data)
+{
+    std::nth_element(data.begin(), data.begin() + data.size() / 2, data.end());
+    return data[data.size() / 2];
+}
+
+// The old way, a new vector in every iteration.
+static void
+benchmark_nth_element_copy(benchmark::State& state)
+{
+    const auto data = make_data(static_cast<size_t>(state.range(0)));
+
+    int result = 0;
+    for (auto _ : state)
+    {
+        std::vector<int> v = data;
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        result = v[v.size() / 2];
+        benchmark::DoNotOptimize(v.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    EXPECT_EQ(result, median(data));
+}
+
+// PauseTiming around the copy, the pause itself costs about a microsecond.
+static void
+benchmark_nth_element_pause_timing(benchmark::State& state)
+{
+    const auto data = make_data(static_cast<size_t>(state.range(0)));
+    std::vector<int> v(data.size());
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::copy(data.begin(), data.end(), v.begin());
+        state.ResumeTiming();
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        benchmark::DoNotOptimize(v.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    EXPECT_EQ(v[v.size() / 2], median(data));
+}
+
+static void
+benchmark_nth_element_fixture(benchmark::State& state)
+{
+    const auto data = make_data(static_cast<size_t>(state.range(0)));
+
+    ct::BenchmarkFixture<int> fixture(state, data);
+    for (auto _ : state)
+    {
+        std::vector<int>& v = fixture.reset();
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        benchmark::DoNotOptimize(v.data());
+    }
+    fixture.stop();
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    EXPECT_EQ(fixture.get()[data.size() / 2], median(data));
+}
+
+// The data comes from memory, not from the cache.
+static void
+benchmark_nth_element_fixture_cold(benchmark::State& state)
+{
+    const auto data = make_data(static_cast<size_t>(state.range(0)));
+
+    ct::BenchmarkFixture<int> fixture(state, data, ct::BenchmarkFixture<int>::CacheState::Cold);
+    for (auto _ : state)
+    {
+        std::vector<int>& v = fixture.reset();
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        benchmark::DoNotOptimize(v.data());
+    }
+    fixture.stop();
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    EXPECT_EQ(fixture.get()[data.size() / 2], median(data));
+}
+
+static void
+benchmark_fixture_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        // Empty dataset.
+        {
+            ct::BenchmarkFixture<int> fixture(state, {});
+            EXPECT_TRUE(fixture.reset().empty());
+        }
+
+        // reset() restores the data after the algorithm changed it, the buffer is not reallocated.
+        const auto data = make_data(1000, 100);
+        ct::BenchmarkFixture<int> fixture(state, data);
+        const int* buffer = fixture.get().data();
+        for (int round = 0; round < 3; round++)
+        {
+            std::vector<int>& v = fixture.reset();
+            EXPECT_EQ(v.data(), buffer);
+            EXPECT_EQ(v, data);
+            std::sort(v.begin(), v.end());
+            v.erase(std::unique(v.begin(), v.end()), v.end());
+            EXPECT_EQ(v.size(), 100u);
+        }
+        EXPECT_EQ(fixture.dataset(), data);
+        EXPECT_GT(fixture.setupNanoseconds(), 0.0);
+
+        // Cold mode keeps the contents, only the caches are flushed.
+        ct::BenchmarkFixture<int> cold(state, data, ct::BenchmarkFixture<int>::CacheState::Cold);
+        EXPECT_EQ(cold.reset(), data);
+    }
+
+    EXPECT_EQ(state.counters.count("setup_ns"), 1u);
+    EXPECT_EQ(state.counters.count("algorithm_ns"), 1u);
+}
+
+static void
+sizes(benchmark::internal::Benchmark* benchmark)
+{
+    for (int64_t size : { 48, 4096, 1 << 20 })
+        benchmark->Arg(size);
+}
+
+BENCHMARK(benchmark_nth_element_copy)->Apply(sizes);
+BENCHMARK(benchmark_nth_element_pause_timing)->Apply(sizes);
+BENCHMARK(benchmark_nth_element_fixture)->Apply(sizes);
+BENCHMARK(benchmark_nth_element_fixture_cold)->Apply(sizes);
+BENCHMARK(benchmark_fixture_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
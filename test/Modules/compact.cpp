@@ -0,0 +1,239 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ SIMD stream compaction (modules/Compact)
+
+ std::remove_if and std::copy_if branch on the predicate for every element,
+ ct::removeIf and ct::copyIf turn the predicate into a mask and pack the kept elements
+ with permute tables (AVX2) or compress (AVX-512). Build with CPPTRAINING_ENABLE_NATIVE_ARCH
+ to get the SIMD path, the fallback walks the bits of the mask.
+ Arguments: number of elements, percent of kept elements.
+
+ run: ./test/compact
+*/
+
+// C++ headers
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "Compact.hpp"
+
+// Values 0..99, 'value < percent' keeps about percent % of them.
+template <typename T>
+static std::vector<T>
+make_data(size_t size)
+{
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> distribution(0, 99);
+
+    std::vector<T> data(size);
+    for (auto& element : data)
+        element = static_cast<T>(distribution(generator));
+    return data;
+}
+
+// Both benchmarks of a pair copy the input back every iteration, the copy is the same for both.
+template <typename T>
+static void
+benchmark_std_remove_if(benchmark::State& state)
+{
+    const std::vector<T> data = make_data<T>(state.range(0));
+    const T percent = static_cast<T>(state.range(1));
+    std::vector<T> v(data.size());
+
+    for (auto _ : state)
+    {
+        std::copy(data.begin(), data.end(), v.begin());
+        benchmark::DoNotOptimize(std::remove_if(v.begin(), v.end(), [percent](T value) { return !(value < percent); }));
+    }
+
+    state.SetItemsProcessed(state.iterations() * data.size());
+}
+
+template <typename T>
+static void
+benchmark_remove_if(benchmark::State& state)
+{
+    const std::vector<T> data = make_data<T>(state.range(0));
+    const T percent = static_cast<T>(state.range(1));
+    const auto remove = [percent](T value) { return !(value < percent); };
+    std::vector<T> v(data.size());
+
+    for (auto _ : state)
+    {
+        std::copy(data.begin(), data.end(), v.begin());
+        benchmark::DoNotOptimize(ct::removeIf(v.data(), v.data() + v.size(), remove));
+    }
+
+    state.SetItemsProcessed(state.iterations() * data.size());
+
+    std::vector<T> expected = data;
+    expected.erase(std::remove_if(expected.begin(), expected.end(), remove), expected.end());
+
+    v = data;
+    v.resize(ct::removeIf(v.data(), v.data() + v.size(), remove) - v.data());
+    EXPECT_EQ(v, expected);
+}
+
+template <typename T>
+static void
+benchmark_std_copy_if(benchmark::State& state)
+{
+    const std::vector<T> data = make_data<T>(state.range(0));
+    const T percent = static_cast<T>(state.range(1));
+    std::vector<T> out(data.size());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(std::copy_if(data.begin(), data.end(), out.begin(), [percent](T value) { return value < percent; }));
+    }
+
+    state.SetItemsProcessed(state.iterations() * data.size());
+}
+
+template <typename T>
+static void
+benchmark_copy_if(benchmark::State& state)
+{
+    const std::vector<T> data = make_data<T>(state.range(0));
+    const T percent = static_cast<T>(state.range(1));
+    const auto keep = [percent](T value) { return value < percent; };
+    std::vector<T> out(data.size());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::copyIf(data.data(), data.data() + data.size(), out.data(), keep));
+    }
+
+    state.SetItemsProcessed(state.iterations() * data.size());
+
+    std::vector<T> expected;
+    std::copy_if(data.begin(), data.end(), std::back_inserter(expected), keep);
+
+    // Room for the kept elements only, masked stores must not touch the guard after them.
+    const T guard = static_cast<T>(-1);
+    std::vector<T> exact(expected.size() + 16, guard);
+    T* end = ct::copyIf(data.data(), data.data() + data.size(), exact.data(), keep);
+    EXPECT_EQ(end - exact.data(), static_cast<ptrdiff_t>(expected.size()));
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), exact.begin()));
+    EXPECT_TRUE(std::all_of(exact.begin() + expected.size(), exact.end(), [guard](T value) { return value == guard; }));
+}
+
+// The predicate of benchmark_remove_elements in stl_algorithms, unpredictable on random data.
+static void
+benchmark_std_remove_odd(benchmark::State& state)
+{
+    const std::vector<int> data = make_data<int>(state.range(0));
+    std::vector<int> v(data.size());
+
+    for (auto _ : state)
+    {
+        std::copy(data.begin(), data.end(), v.begin());
+        benchmark::DoNotOptimize(std::remove_if(v.begin(), v.end(), [](int val) { return val % 2 != 0; }));
+    }
+
+    state.SetItemsProcessed(state.iterations() * data.size());
+}
+
+static void
+benchmark_remove_odd(benchmark::State& state)
+{
+    const std::vector<int> data = make_data<int>(state.range(0));
+    std::vector<int> v(data.size());
+
+    for (auto _ : state)
+    {
+        std::copy(data.begin(), data.end(), v.begin());
+        benchmark::DoNotOptimize(ct::removeIf(v.data(), v.data() + v.size(), [](int val) { return val % 2 != 0; }));
+    }
+
+    state.SetItemsProcessed(state.iterations() * data.size());
+}
+
+static void
+benchmark_compact_edge_cases(benchmark::State& state)
+{
+    std::vector<int64_t> v(1000 + 37);
+    for (size_t i = 0; i < v.size(); i++)
+        v[i] = static_cast<int64_t>(i);
+
+    for (auto _ : state)
+    {
+        std::vector<int64_t> copy = v;
+        benchmark::DoNotOptimize(ct::remove(copy.data(), copy.data() + copy.size(), int64_t{ 5 }));
+    }
+
+    // Empty, nothing removed, everything removed, a size which is not a multiple of the block.
+    std::vector<int> empty;
+    EXPECT_EQ(ct::removeIf(empty.data(), empty.data(), [](int) { return true; }), empty.data());
+
+    std::vector<int64_t> all = v;
+    EXPECT_EQ(ct::removeIf(all.data(), all.data() + all.size(), [](int64_t) { return false; }), all.data() + all.size());
+    EXPECT_EQ(all, v);
+    EXPECT_EQ(ct::removeIf(all.data(), all.data() + all.size(), [](int64_t) { return true; }), all.data());
+
+    std::vector<int64_t> odd = v;
+    odd.resize(ct::removeIf(odd.data(), odd.data() + odd.size(), [](int64_t value) { return value % 2 == 0; }) - odd.data());
+    ASSERT_EQ(odd.size(), v.size() / 2);
+    for (size_t i = 0; i < odd.size(); i++)
+        EXPECT_EQ(odd[i], static_cast<int64_t>(2 * i + 1));
+
+    std::vector<float> floats{ 1.0f, -2.0f, 3.5f, -0.0f, 5.0f };
+    floats.resize(ct::remove(floats.data(), floats.data() + floats.size(), 3.5f) - floats.data());
+    EXPECT_EQ(floats, (std::vector<float>{ 1.0f, -2.0f, -0.0f, 5.0f }));
+
+    std::vector<double> doubles{ 1.0, 2.0, 3.0 };
+    std::vector<double> out(3);
+    EXPECT_EQ(ct::copyIf(doubles.data(), doubles.data() + 3, out.data(), [](double d) { return d > 1.5; }) - out.data(), 2);
+    EXPECT_EQ(out[0], 2.0);
+    EXPECT_EQ(out[1], 3.0);
+}
+
+static void
+selectivities(benchmark::internal::Benchmark* benchmark)
+{
+    for (int percent : { 1, 10, 50, 90, 99 })
+        benchmark->Args({ 1 << 20, percent });
+}
+
+BENCHMARK_TEMPLATE(benchmark_std_remove_if, int32_t)->Apply(selectivities);
+BENCHMARK_TEMPLATE(benchmark_remove_if, int32_t)->Apply(selectivities);
+BENCHMARK_TEMPLATE(benchmark_std_remove_if, int64_t)->Apply(selectivities);
+BENCHMARK_TEMPLATE(benchmark_remove_if, int64_t)->Apply(selectivities);
+BENCHMARK_TEMPLATE(benchmark_std_remove_if, float)->Apply(selectivities);
+BENCHMARK_TEMPLATE(benchmark_remove_if, float)->Apply(selectivities);
+
+BENCHMARK_TEMPLATE(benchmark_std_copy_if, int32_t)->Apply(selectivities);
+BENCHMARK_TEMPLATE(benchmark_copy_if, int32_t)->Apply(selectivities);
+BENCHMARK_TEMPLATE(benchmark_std_copy_if, int64_t)->Apply(selectivities);
+BENCHMARK_TEMPLATE(benchmark_copy_if, int64_t)->Apply(selectivities);
+BENCHMARK_TEMPLATE(benchmark_std_copy_if, float)->Apply(selectivities);
+BENCHMARK_TEMPLATE(benchmark_copy_if, float)->Apply(selectivities);
+
+BENCHMARK(benchmark_std_remove_odd)->Arg(1 << 20);
+BENCHMARK(benchmark_remove_odd)->Arg(1 << 20);
+BENCHMARK(benchmark_compact_edge_cases)->Iterations(1000);
+
+BENCHMARK_MAIN();
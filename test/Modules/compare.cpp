@@ -0,0 +1,275 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Vectorized equal, mismatch and lexicographic compare (modules/Compare)
+
+ benchmark_comparing_elements compares vectors with std::equal and std::mismatch.
+ std::mismatch compares one element per step, the kernels here compare 32 or 64 bytes
+ per step for integers, characters and padding free structs and return the first
+ differing index. Argument: number of elements, the ranges differ in the last one.
+
+ run: ./test/compare
+*/
+
+// C++ headers
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "Compare.hpp"
+
+// Snapshot record without padding, compared member by member.
+struct Record
+{
+    int32_t id;
+    int32_t value;
+    int64_t timestamp;
+
+    bool operator==(const Record& other) const { return id == other.id && value == other.value && timestamp == other.timestamp; }
+    bool operator<(const Record& other) const
+    {
+        return id != other.id ? id < other.id : (value != other.value ? value < other.value : timestamp < other.timestamp);
+    }
+};
+
+// Padding after 'flag', the bytes differ even when the members are equal.
+struct Padded
+{
+    char flag;
+    int32_t value;
+
+    bool operator==(const Padded& other) const { return flag == other.flag && value == other.value; }
+};
+
+namespace ct {
+template <>
+struct IsTriviallyComparable<Record> : std::true_type
+{
+};
+}
+
+static_assert(ct::isTriviallyComparable<int>);
+static_assert(ct::isTriviallyComparable<const char>);
+static_assert(ct::isTriviallyComparable<Record>);
+static_assert(!ct::isTriviallyComparable<float>);
+static_assert(!ct::isTriviallyComparable<Padded>);
+
+template <typename T>
+static std::vector<T>
+make_values(size_t size)
+{
+    std::vector<T> values(size);
+    for (size_t i = 0; i < size; i++)
+        values[i] = static_cast<T>(i * 2654435761u);
+    return values;
+}
+
+template <>
+std::vector<Record>
+make_values<Record>(size_t size)
+{
+    std::vector<Record> values(size);
+    for (size_t i = 0; i < size; i++)
+        values[i] = { static_cast<int32_t>(i), static_cast<int32_t>(i * 7), static_cast<int64_t>(i) << 20 };
+    return values;
+}
+
+// The copy differs in the last element.
+template <typename T>
+static std::vector<T>
+changed_copy(const std::vector<T>& values)
+{
+    std::vector<T> copy = values;
+    if (!copy.empty())
+        copy.back() = T{};
+    return copy;
+}
+
+template <typename T>
+static void
+benchmark_std_mismatch(benchmark::State& state)
+{
+    const auto a = make_values<T>(static_cast<size_t>(state.range(0)));
+    const auto b = changed_copy(a);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::mismatch(a.begin(), a.end(), b.begin()));
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * a.size() * sizeof(T) * 2));
+    EXPECT_EQ(static_cast<size_t>(std::mismatch(a.begin(), a.end(), b.begin()).first - a.begin()), a.size() - 1);
+}
+
+template <typename T>
+static void
+benchmark_mismatch(benchmark::State& state)
+{
+    const auto a = make_values<T>(static_cast<size_t>(state.range(0)));
+    const auto b = changed_copy(a);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(ct::mismatchIndex(a, b));
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * a.size() * sizeof(T) * 2));
+    EXPECT_EQ(ct::mismatchIndex(a, b), a.size() - 1);
+}
+
+template <typename T>
+static void
+benchmark_std_equal(benchmark::State& state)
+{
+    const auto a = make_values<T>(static_cast<size_t>(state.range(0)));
+    const auto b = changed_copy(a);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * a.size() * sizeof(T) * 2));
+    EXPECT_FALSE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+}
+
+template <typename T>
+static void
+benchmark_equal(benchmark::State& state)
+{
+    const auto a = make_values<T>(static_cast<size_t>(state.range(0)));
+    const auto b = changed_copy(a);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(ct::equal(a, b));
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * a.size() * sizeof(T) * 2));
+    EXPECT_FALSE(ct::equal(a, b));
+}
+
+template <typename T>
+static void
+benchmark_std_lexicographical_compare(benchmark::State& state)
+{
+    const auto a = make_values<T>(static_cast<size_t>(state.range(0)));
+    const auto b = changed_copy(a);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::lexicographical_compare(b.begin(), b.end(), a.begin(), a.end()));
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * a.size() * sizeof(T) * 2));
+    EXPECT_EQ(std::lexicographical_compare(b.begin(), b.end(), a.begin(), a.end()), b.back() < a.back());
+}
+
+template <typename T>
+static void
+benchmark_lexicographic_compare(benchmark::State& state)
+{
+    const auto a = make_values<T>(static_cast<size_t>(state.range(0)));
+    const auto b = changed_copy(a);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(ct::lexicographicCompare(b, a));
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * a.size() * sizeof(T) * 2));
+    EXPECT_EQ(ct::lexicographicCompare(b, a) < 0, b.back() < a.back());
+}
+
+static void
+benchmark_compare_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        // Every length around the vector widths and every mismatch position.
+        for (size_t size = 0; size < 300; size++)
+        {
+            const auto a = make_values<uint8_t>(size);
+            EXPECT_EQ(ct::mismatchIndex(a, a), size);
+            EXPECT_TRUE(ct::equal(a, a));
+            for (size_t position = 0; position < size; position += 1 + size / 16)
+            {
+                auto b = a;
+                b[position] ^= 0x80;
+                EXPECT_EQ(ct::mismatchIndex(a, b), position);
+                EXPECT_FALSE(ct::equal(a, b));
+                // A difference in a later byte of the same element reports the element.
+                const auto wide = make_values<int32_t>(size);
+                auto wideB = wide;
+                wideB[position] ^= 0x01000000;
+                EXPECT_EQ(ct::mismatchIndex(wide, wideB), position);
+            }
+        }
+    }
+
+    // Three way compare, characters are unsigned like std::string::compare.
+    const std::string hello = "hello";
+    EXPECT_EQ(ct::lexicographicCompare(hello, std::string("hello")), 0);
+    EXPECT_LT(ct::lexicographicCompare(std::string("hell"), hello), 0);
+    EXPECT_GT(ct::lexicographicCompare(hello, std::string("hell")), 0);
+    EXPECT_LT(ct::lexicographicCompare(std::string("a\x7f"), std::string("a\x80")), 0);
+    EXPECT_LT(std::string("a\x7f").compare("a\x80"), 0);
+    EXPECT_GT(ct::lexicographicCompare(std::vector<int>{ 1, 2, 3 }, std::vector<int>{ 1, 2, -3 }), 0);
+    EXPECT_EQ(ct::lexicographicCompare(std::vector<int>{}, std::vector<int>{}), 0);
+    EXPECT_FALSE(ct::equal(std::vector<int>{ 1 }, std::vector<int>{ 1, 2 }));
+
+    // Structs: bytes for Record, operator== for Padded and floats.
+    auto records = make_values<Record>(100);
+    auto changed = records;
+    changed[42].timestamp++;
+    EXPECT_EQ(ct::mismatchIndex(records, changed), 42u);
+    EXPECT_LT(ct::lexicographicCompare(records, changed), 0);
+
+    std::vector<Padded> padded(3);
+    std::vector<Padded> paddedCopy(3);
+    std::memset(static_cast<void*>(padded.data()), 0xff, sizeof(Padded) * 3);
+    for (size_t i = 0; i < 3; i++)
+    {
+        padded[i].flag = 'x';
+        padded[i].value = 1;
+        paddedCopy[i] = { 'x', 1 };
+    }
+    EXPECT_TRUE(ct::equal(padded, paddedCopy));
+
+    const std::vector<double> zeros{ 0.0, 1.0 };
+    const std::vector<double> negativeZeros{ -0.0, 1.0 };
+    EXPECT_TRUE(ct::equal(zeros, negativeZeros));
+}
+
+static void
+sizes(benchmark::internal::Benchmark* benchmark)
+{
+    for (int size : { 48, 1 << 12, 1 << 20, 1 << 24 })
+        benchmark->Arg(size);
+}
+
+BENCHMARK_TEMPLATE(benchmark_std_mismatch, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_mismatch, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_std_equal, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_equal, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_std_lexicographical_compare, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_lexicographic_compare, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_std_mismatch, char)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_mismatch, char)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_std_mismatch, Record)->Arg(1 << 18);
+BENCHMARK_TEMPLATE(benchmark_mismatch, Record)->Arg(1 << 18);
+BENCHMARK_TEMPLATE(benchmark_std_equal, Record)->Arg(1 << 18);
+BENCHMARK_TEMPLATE(benchmark_equal, Record)->Arg(1 << 18);
+BENCHMARK(benchmark_compare_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,382 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Coroutine runtime (modules/Coroutine, C++20 build only)
+
+ A blocked OS thread keeps its stack (8 MB reserved, a few pages resident) and every
+ switch goes through the kernel scheduler. A suspended coroutine is its frame on the heap
+ and a switch is a queue push and an indirect call. The benchmarks compare a handoff between
+ two threads with one between two coroutines and measure the resident memory per waiting
+ thread and per waiting task.
+
+ Configure with -DCPPTRAINING_ENABLE_CXX20=ON.
+
+ run: ./test/coroutine
+*/
+
+// C++ headers
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "Executor.hpp"
+#include "Task.hpp"
+#include "WhenAll.hpp"
+
+// Resident memory of the process in bytes, 0 when unknown.
+static size_t
+resident_bytes()
+{
+#if defined(__linux__)
+    size_t pages = 0;
+    size_t resident = 0;
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (file == nullptr)
+        return 0;
+    const int fields = std::fscanf(file, "%zu %zu", &pages, &resident);
+    std::fclose(file);
+    return fields == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+// Coroutines wait here until release() posts them all to the executor.
+class Gate
+{
+public:
+    auto wait()
+    {
+        struct Awaiter
+        {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) const
+            {
+                std::lock_guard<std::mutex> lock(gate.mutex);
+                gate.waiting.push_back(handle);
+            }
+            void await_resume() const noexcept {}
+
+            Gate& gate;
+        };
+        return Awaiter{ *this };
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return waiting.size();
+    }
+
+    void release(ct::Executor& executor)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto handle : waiting)
+            executor.post(handle);
+        waiting.clear();
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::coroutine_handle<>> waiting;
+};
+
+static ct::Task<int>
+square(int value)
+{
+    co_return value * value;
+}
+
+static ct::Task<int>
+sum_of_squares(int count)
+{
+    int sum = 0;
+    for (int i = 1; i <= count; i++)
+        sum += co_await square(i);
+    co_return sum;
+}
+
+static ct::Task<int>
+throw_after_sleep(ct::Executor& executor)
+{
+    co_await executor.sleepFor(std::chrono::milliseconds(1));
+    throw std::runtime_error("refresh failed");
+}
+
+static ct::Task<int>
+sleep_and_return(ct::Executor& executor, int milliseconds, std::mutex& mutex, std::vector<int>& order)
+{
+    co_await executor.sleepFor(std::chrono::milliseconds(milliseconds));
+    std::lock_guard<std::mutex> lock(mutex);
+    order.push_back(milliseconds);
+    co_return milliseconds;
+}
+
+static ct::Task<>
+sleep_once(ct::Executor& executor, std::chrono::milliseconds time)
+{
+    co_await executor.schedule();
+    co_await executor.sleepFor(time);
+}
+
+static ct::Task<>
+yield_many(ct::Executor& executor, int64_t count)
+{
+    for (int64_t i = 0; i < count; i++)
+        co_await executor.schedule();
+}
+
+static ct::Task<>
+wait_at_gate(Gate& gate, std::atomic<size_t>& finished)
+{
+    co_await gate.wait();
+    finished.fetch_add(1, std::memory_order_relaxed);
+}
+
+static ct::Task<std::thread::id>
+worker_thread_id(ct::Executor& executor)
+{
+    co_await executor.schedule();
+    co_return std::this_thread::get_id();
+}
+
+// Two threads hand a token back and forth, every handoff wakes the other thread.
+static void
+benchmark_switch_threads(benchmark::State& state)
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    int turn = 0;
+    bool stop = false;
+
+    std::thread partner([&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            changed.wait(lock, [&]() { return turn == 1 || stop; });
+            if (stop)
+                return;
+            turn = 0;
+            changed.notify_one();
+        }
+    });
+
+    for (auto _ : state)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        turn = 1;
+        changed.notify_one();
+        changed.wait(lock, [&]() { return turn == 0; });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    changed.notify_one();
+    partner.join();
+
+    // One iteration is two switches.
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+
+// A coroutine suspends and is resumed through the ready queue of a one thread executor.
+static void
+benchmark_switch_coroutines(benchmark::State& state)
+{
+    ct::Executor executor(1);
+    constexpr int64_t batch = 1000;
+
+    for (auto _ : state)
+        executor.run(yield_many(executor, batch));
+
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+// Awaiting a finished task: frame allocation and two symmetric transfers, no queue.
+static void
+benchmark_await_task(benchmark::State& state)
+{
+    ct::Executor executor(1);
+    constexpr int count = 1000;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(executor.run(sum_of_squares(count)));
+
+    state.SetItemsProcessed(state.iterations() * count);
+    EXPECT_EQ(executor.run(sum_of_squares(count)), 333833500);
+}
+
+static void
+benchmark_memory_per_thread(benchmark::State& state)
+{
+    const size_t count = static_cast<size_t>(state.range(0));
+    size_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        std::mutex mutex;
+        std::condition_variable released;
+        size_t waiting = 0;
+        bool release = false;
+
+        const size_t before = resident_bytes();
+        std::vector<std::thread> threads;
+        threads.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            threads.emplace_back([&]() {
+                std::unique_lock<std::mutex> lock(mutex);
+                waiting++;
+                released.notify_all();
+                released.wait(lock, [&]() { return release; });
+            });
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            released.wait(lock, [&]() { return waiting == count; });
+        }
+        // Later iterations reuse the memory freed by the first one.
+        bytes = std::max(bytes, resident_bytes() - before);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            release = true;
+        }
+        released.notify_all();
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    state.counters["bytes_per_waiter"] = static_cast<double>(bytes) / static_cast<double>(count);
+}
+
+static void
+benchmark_memory_per_task(benchmark::State& state)
+{
+    const size_t count = static_cast<size_t>(state.range(0));
+    ct::Executor executor(1);
+    size_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        Gate gate;
+        std::atomic<size_t> finished{ 0 };
+
+        const size_t before = resident_bytes();
+        for (size_t i = 0; i < count; i++)
+            executor.spawn(wait_at_gate(gate, finished));
+        while (gate.size() < count)
+            std::this_thread::yield();
+        // Later iterations reuse the memory freed by the first one.
+        bytes = std::max(bytes, resident_bytes() - before);
+
+        gate.release(executor);
+        while (finished.load(std::memory_order_relaxed) < count)
+            std::this_thread::yield();
+    }
+
+    state.counters["bytes_per_waiter"] = static_cast<double>(bytes) / static_cast<double>(count);
+}
+
+static void
+benchmark_coroutine_edge_cases(benchmark::State& state)
+{
+    ct::Executor executor(2);
+    EXPECT_EQ(executor.threadCount(), 2u);
+
+    for (auto _ : state)
+    {
+        // Values, nested tasks and exceptions.
+        EXPECT_EQ(executor.run(square(7)), 49);
+        EXPECT_EQ(executor.run(sum_of_squares(3)), 14);
+        EXPECT_THROW(executor.run(throw_after_sleep(executor)), std::runtime_error);
+        EXPECT_NE(executor.run(worker_thread_id(executor)), std::this_thread::get_id());
+
+        // Timers fire in deadline order, whenAll keeps the order of the tasks.
+        std::mutex mutex;
+        std::vector<int> order;
+        std::vector<ct::Task<int>> sleeps;
+        for (int milliseconds : { 30, 10, 20 })
+            sleeps.push_back(sleep_and_return(executor, milliseconds, mutex, order));
+        EXPECT_EQ(executor.run(ct::whenAll(std::move(sleeps))), (std::vector<int>{ 30, 10, 20 }));
+        EXPECT_EQ(order, (std::vector<int>{ 10, 20, 30 }));
+
+        // Finished synchronously, empty, and failing whenAll.
+        std::vector<ct::Task<int>> squares;
+        for (int i = 0; i < 4; i++)
+            squares.push_back(square(i));
+        EXPECT_EQ(executor.run(ct::whenAll(std::move(squares))), (std::vector<int>{ 0, 1, 4, 9 }));
+        EXPECT_TRUE(executor.run(ct::whenAll(std::vector<ct::Task<int>>{})).empty());
+        executor.run(ct::whenAll(std::vector<ct::Task<>>{}));
+        std::vector<ct::Task<int>> failing;
+        failing.push_back(square(2));
+        failing.push_back(throw_after_sleep(executor));
+        EXPECT_THROW(executor.run(ct::whenAll(std::move(failing))), std::runtime_error);
+
+        // Thousands of sleeping tasks share two threads, they sleep at the same time.
+        std::vector<ct::Task<>> many;
+        for (int i = 0; i < 10000; i++)
+            many.push_back(sleep_once(executor, std::chrono::milliseconds(20)));
+        const auto start = std::chrono::steady_clock::now();
+        executor.run(ct::whenAll(std::move(many)));
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+
+        // Fire and forget.
+        Gate gate;
+        std::atomic<size_t> finished{ 0 };
+        for (int i = 0; i < 100; i++)
+            executor.spawn(wait_at_gate(gate, finished));
+        while (gate.size() < 100)
+            std::this_thread::yield();
+        EXPECT_EQ(finished.load(), 0u);
+        gate.release(executor);
+        while (finished.load() < 100)
+            std::this_thread::yield();
+
+        ct::Task<int> moved = square(3);
+        ct::Task<int> target = std::move(moved);
+        EXPECT_FALSE(moved.valid());
+        EXPECT_TRUE(target.valid());
+        EXPECT_EQ(executor.run(std::move(target)), 9);
+    }
+}
+
+BENCHMARK(benchmark_switch_threads)->UseRealTime();
+BENCHMARK(benchmark_switch_coroutines)->UseRealTime();
+BENCHMARK(benchmark_await_task)->UseRealTime();
+BENCHMARK(benchmark_memory_per_thread)->Arg(1000)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_memory_per_task)->Arg(100000)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_coroutine_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
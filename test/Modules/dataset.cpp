@@ -0,0 +1,319 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Memory mapped binary datasets (modules/Dataset)
+
+ The inputs of stl_algorithms.cpp are static vectors filled at startup. Bigger inputs
+ read from text files spend most of the time in parsing, binary files read into a vector
+ still copy every byte. A dataset file is mapped and its columns used in place.
+ Load arguments: number of int32 values. Create big files with apps/DatasetGenerator.
+
+ run: ./test/dataset
+*/
+
+// C++ headers
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "Dataset.hpp"
+
+static std::string
+temp_path(const std::string& name)
+{
+    return (std::filesystem::temp_directory_path() / ("ct_dataset_" + name)).string();
+}
+
+static std::vector<int32_t>
+make_values(size_t size)
+{
+    std::vector<int32_t> values(size);
+    for (size_t i = 0; i < size; i++)
+        values[i] = static_cast<int32_t>(i * 2654435761u) >> 8;
+    return values;
+}
+
+static int64_t
+sum(const int32_t* first, const int32_t* last)
+{
+    return std::accumulate(first, last, int64_t{ 0 });
+}
+
+static void
+write_dataset(const std::string& path, const std::vector<int32_t>& values)
+{
+    ct::DatasetWriter writer;
+    writer.addColumn("values", values);
+    ASSERT_TRUE(writer.write(path));
+}
+
+static void
+flip_byte(const std::string& path, size_t offset)
+{
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekg(static_cast<std::streamoff>(offset));
+    char byte = 0;
+    file.read(&byte, 1);
+    byte = static_cast<char>(byte ^ 0x5a);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(&byte, 1);
+}
+
+// Text file, one number per line, parsed with operator>>.
+static void
+benchmark_load_text(benchmark::State& state)
+{
+    const auto values = make_values(static_cast<size_t>(state.range(0)));
+    const std::string path = temp_path("text");
+    {
+        std::ofstream file(path);
+        for (int32_t value : values)
+            file << value << '\n';
+    }
+
+    int64_t total = 0;
+    for (auto _ : state)
+    {
+        std::ifstream file(path);
+        std::vector<int32_t> loaded;
+        int32_t value;
+        while (file >> value)
+            loaded.push_back(value);
+        total = sum(loaded.data(), loaded.data() + loaded.size());
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+    EXPECT_EQ(total, sum(values.data(), values.data() + values.size()));
+    std::filesystem::remove(path);
+}
+
+// Binary file read into a vector, no parsing but a copy of every byte.
+static void
+benchmark_load_read(benchmark::State& state)
+{
+    const auto values = make_values(static_cast<size_t>(state.range(0)));
+    const std::string path = temp_path("read");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(int32_t)));
+    }
+
+    int64_t total = 0;
+    for (auto _ : state)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<int32_t> loaded(values.size());
+        file.read(reinterpret_cast<char*>(loaded.data()), static_cast<std::streamsize>(loaded.size() * sizeof(int32_t)));
+        total = sum(loaded.data(), loaded.data() + loaded.size());
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+    EXPECT_EQ(total, sum(values.data(), values.data() + values.size()));
+    std::filesystem::remove(path);
+}
+
+// Dataset mapped in place, the sum reads the page cache directly.
+static void
+benchmark_load_mmap(benchmark::State& state)
+{
+    const auto values = make_values(static_cast<size_t>(state.range(0)));
+    const std::string path = temp_path("mmap");
+    write_dataset(path, values);
+
+    int64_t total = 0;
+    for (auto _ : state)
+    {
+        auto dataset = ct::Dataset::open(path);
+        const auto column = dataset->column<int32_t>("values");
+        total = sum(column.begin(), column.end());
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+    EXPECT_EQ(total, sum(values.data(), values.data() + values.size()));
+    std::filesystem::remove(path);
+}
+
+// Only the headers, independent of the file size.
+static void
+benchmark_open_mmap(benchmark::State& state)
+{
+    const auto values = make_values(static_cast<size_t>(state.range(0)));
+    const std::string path = temp_path("open");
+    write_dataset(path, values);
+
+    size_t size = 0;
+    for (auto _ : state)
+    {
+        auto dataset = ct::Dataset::open(path);
+        size = dataset->column<int32_t>("values").size();
+        benchmark::DoNotOptimize(size);
+    }
+
+    EXPECT_EQ(size, values.size());
+    std::filesystem::remove(path);
+}
+
+static void
+benchmark_checksum(benchmark::State& state)
+{
+    const auto values = make_values(static_cast<size_t>(state.range(0)));
+
+    uint64_t checksum = 0;
+    for (auto _ : state)
+    {
+        checksum = ct::dataset::checksum(values.data(), values.size() * sizeof(int32_t));
+        benchmark::DoNotOptimize(checksum);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * values.size() * sizeof(int32_t)));
+    EXPECT_EQ(checksum, ct::dataset::checksum(values.data(), values.size() * sizeof(int32_t)));
+}
+
+static void
+benchmark_dataset_edge_cases(benchmark::State& state)
+{
+    const std::string path = temp_path("edge_cases");
+
+    for (auto _ : state)
+    {
+        // All element types round trip, every column is aligned.
+        const auto ints = make_values(1001);
+        const std::vector<int8_t> bytes = { -1, 2, -3 };
+        const std::vector<uint16_t> shorts = { 1, 65535 };
+        const std::vector<int64_t> longs = { -1, INT64_MAX };
+        const std::vector<float> floats = { 0.5f, -2.0f };
+        const std::vector<double> doubles = { 3.25 };
+        const std::vector<uint32_t> empty;
+        {
+            ct::DatasetWriter writer;
+            writer.addColumn("ints", ints);
+            writer.addColumn("bytes", bytes);
+            writer.addColumn("shorts", shorts);
+            writer.addColumn("longs", longs);
+            writer.addColumn("floats", floats);
+            writer.addColumn("doubles", doubles);
+            writer.addColumn("empty", empty);
+            ASSERT_TRUE(writer.write(path));
+        }
+
+        std::string error;
+        auto dataset = ct::Dataset::open(path, ct::Dataset::Verify::All, &error);
+        ASSERT_NE(dataset, nullptr) << error;
+        EXPECT_EQ(dataset->columns().size(), 7u);
+        EXPECT_TRUE(dataset->verifyColumns());
+
+        const auto loaded = dataset->column<int32_t>("ints");
+        EXPECT_EQ(std::vector<int32_t>(loaded.begin(), loaded.end()), ints);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(loaded.data()) % ct::dataset::alignment, 0u);
+        EXPECT_EQ(loaded.subview(1000, 1)[0], ints.back());
+        const auto loadedBytes = dataset->column<int8_t>("bytes");
+        EXPECT_EQ(std::vector<int8_t>(loadedBytes.begin(), loadedBytes.end()), bytes);
+        EXPECT_EQ(dataset->column<uint16_t>("shorts").back(), 65535);
+        EXPECT_EQ(dataset->column<int64_t>("longs").back(), INT64_MAX);
+        EXPECT_EQ(dataset->column<float>("floats")[1], -2.0f);
+        EXPECT_EQ(dataset->column<double>("doubles").front(), 3.25);
+        EXPECT_TRUE(dataset->column<uint32_t>("empty").empty());
+        for (const auto& column : dataset->columns())
+            EXPECT_EQ(column.offset % ct::dataset::alignment, 0u);
+
+        // Missing column or another type gives an empty view.
+        EXPECT_EQ(dataset->find("missing"), nullptr);
+        EXPECT_TRUE(dataset->column<int32_t>("missing").empty());
+        EXPECT_TRUE(dataset->column<uint32_t>("ints").empty());
+        EXPECT_TRUE(dataset->column<int64_t>("ints").empty());
+        dataset.reset();
+
+        // A changed data byte is found by the column checksum, the header is still fine.
+        const size_t intsOffset = 64 + 7 * 64;
+        flip_byte(path, intsOffset + 17);
+        dataset = ct::Dataset::open(path);
+        ASSERT_NE(dataset, nullptr);
+        EXPECT_FALSE(dataset->verifyColumns(&error));
+        EXPECT_NE(error.find("ints"), std::string::npos);
+        dataset.reset();
+        EXPECT_EQ(ct::Dataset::open(path, ct::Dataset::Verify::All), nullptr);
+
+        // A changed column header is found by the header checksum.
+        flip_byte(path, intsOffset + 17);
+        flip_byte(path, 64 + 40);
+        EXPECT_EQ(ct::Dataset::open(path, ct::Dataset::Verify::Header, &error), nullptr);
+        EXPECT_NE(error.find("checksum"), std::string::npos);
+        flip_byte(path, 64 + 40);
+        EXPECT_NE(ct::Dataset::open(path, ct::Dataset::Verify::All), nullptr);
+
+        // Truncated file, other file, no file.
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+        EXPECT_EQ(ct::Dataset::open(path, ct::Dataset::Verify::Header, &error), nullptr);
+        EXPECT_NE(error.find("truncated"), std::string::npos);
+        {
+            std::ofstream file(path);
+            file << "values\n1\n2\n3\n" << std::string(100, ' ');
+        }
+        EXPECT_EQ(ct::Dataset::open(path, ct::Dataset::Verify::Header, &error), nullptr);
+        EXPECT_NE(error.find("not a dataset"), std::string::npos);
+        std::filesystem::remove(path);
+        EXPECT_EQ(ct::Dataset::open(path, ct::Dataset::Verify::Header, &error), nullptr);
+        EXPECT_NE(error.find(path), std::string::npos);
+
+        // Dataset without columns.
+        ASSERT_TRUE(ct::DatasetWriter().write(path));
+        dataset = ct::Dataset::open(path, ct::Dataset::Verify::All);
+        ASSERT_NE(dataset, nullptr);
+        EXPECT_TRUE(dataset->columns().empty());
+        dataset.reset();
+
+        // Invalid names.
+        ct::DatasetWriter twice;
+        twice.addColumn("ints", ints);
+        twice.addColumn("ints", ints);
+        EXPECT_FALSE(twice.write(path, &error));
+        ct::DatasetWriter tooLong;
+        tooLong.addColumn(std::string(ct::dataset::maxNameLength + 1, 'x'), ints);
+        EXPECT_FALSE(tooLong.write(path, &error));
+        ct::DatasetWriter unnamed;
+        unnamed.addColumn("", ints);
+        EXPECT_FALSE(unnamed.write(path, &error));
+
+        // The checksum depends on every byte and the length.
+        const std::vector<uint8_t> zeros(100, 0);
+        EXPECT_NE(ct::dataset::checksum(zeros.data(), 99), ct::dataset::checksum(zeros.data(), 100));
+        EXPECT_NE(ct::dataset::checksum(ints.data(), 4000), ct::dataset::checksum(ints.data() + 1, 4000));
+    }
+
+    std::filesystem::remove(path);
+}
+
+BENCHMARK(benchmark_load_text)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_load_read)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_load_mmap)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_open_mmap)->Arg(1 << 22);
+BENCHMARK(benchmark_checksum)->Arg(1 << 12)->Arg(1 << 22);
+BENCHMARK(benchmark_dataset_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
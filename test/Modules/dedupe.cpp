@@ -0,0 +1,269 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Duplicate elimination without sorting (modules/Dedupe)
+
+ stl_algorithms eliminates duplicates with sort + unique, O(n log n) only to make
+ duplicates adjacent. dedupe keeps the first occurrence in input order with a hash set,
+ distinctCountApprox counts with HyperLogLog in 16 KiB.
+ Arguments: number of values, number of distinct values in the input.
+
+ run: ./test/dedupe
+*/
+
+// C++ headers
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "Dedupe.hpp"
+
+static std::vector<int>
+make_events(size_t size, size_t cardinality)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(0, static_cast<int>(cardinality) - 1);
+
+    std::vector<int> events(size);
+    for (auto& event : events)
+        event = distribution(generator);
+    return events;
+}
+
+// Reference, first occurrences in input order.
+static std::vector<int>
+first_occurrences(const std::vector<int>& events)
+{
+    std::unordered_set<int> seen;
+    std::vector<int> result;
+    for (int event : events)
+    {
+        if (seen.insert(event).second)
+            result.push_back(event);
+    }
+    return result;
+}
+
+static void
+benchmark_sort_unique(benchmark::State& state)
+{
+    const std::vector<int> events = make_events(state.range(0), state.range(1));
+
+    for (auto _ : state)
+    {
+        std::vector<int> v = events;
+        std::sort(v.begin(), v.end());
+        v.erase(std::unique(v.begin(), v.end()), v.end());
+        benchmark::DoNotOptimize(v.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+
+static void
+benchmark_unordered_set(benchmark::State& state)
+{
+    const std::vector<int> events = make_events(state.range(0), state.range(1));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(first_occurrences(events));
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+
+static void
+benchmark_dedupe(benchmark::State& state)
+{
+    const std::vector<int> events = make_events(state.range(0), state.range(1));
+    std::vector<int> out(events.size());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::dedupeCopy(events.begin(), events.end(), out.begin()));
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+
+    const std::vector<int> expected = first_occurrences(events);
+    out.erase(ct::dedupeCopy(events.begin(), events.end(), out.begin()), out.end());
+    EXPECT_EQ(out, expected);
+
+    // In place, like std::unique.
+    std::vector<int> v = events;
+    v.erase(ct::dedupe(v.begin(), v.end()), v.end());
+    EXPECT_EQ(v, expected);
+}
+
+static void
+benchmark_dedupe_parallel(benchmark::State& state)
+{
+    const std::vector<int> events = make_events(state.range(0), state.range(1));
+    std::vector<int> out(events.size());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::dedupeCopyParallel(events.begin(), events.end(), out.begin()));
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+
+    const std::vector<int> expected = first_occurrences(events);
+    out.erase(ct::dedupeCopyParallel(events.begin(), events.end(), out.begin()), out.end());
+    EXPECT_EQ(out, expected);
+
+    // More threads than cores and tiny chunks, the same order.
+    std::vector<int> small(events.size());
+    small.erase(ct::dedupeCopyParallel(events.begin(), events.end(), small.begin(), 7, 1000), small.end());
+    EXPECT_EQ(small, expected);
+}
+
+static void
+benchmark_distinct_count(benchmark::State& state)
+{
+    const std::vector<int> events = make_events(state.range(0), state.range(1));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::distinctCount(events.begin(), events.end()));
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+
+    const size_t expected = first_occurrences(events).size();
+    EXPECT_EQ(ct::distinctCount(events.begin(), events.end()), expected);
+    EXPECT_EQ(ct::distinctCountParallel(events.begin(), events.end()), expected);
+    EXPECT_EQ(ct::distinctCountParallel(events.begin(), events.end(), 7, 1000), expected);
+}
+
+static void
+benchmark_distinct_count_approx(benchmark::State& state)
+{
+    const std::vector<int> events = make_events(state.range(0), state.range(1));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::distinctCountApprox(events.begin(), events.end()));
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+
+    // Four standard errors, a fixed seed makes the test deterministic anyway.
+    const double expected = static_cast<double>(first_occurrences(events).size());
+    const double tolerance = 4.0 * ct::HyperLogLog().standardError() * expected;
+    const double estimate = ct::distinctCountApprox(events.begin(), events.end());
+    EXPECT_NEAR(estimate, expected, tolerance);
+    state.counters["relative_error"] = std::abs(estimate - expected) / expected;
+}
+
+static void
+benchmark_distinct_count_approx_parallel(benchmark::State& state)
+{
+    const std::vector<int> events = make_events(state.range(0), state.range(1));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::distinctCountApproxParallel(events.begin(), events.end()));
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+
+    // Merged registers are the same as the registers of one counter over everything.
+    EXPECT_EQ(ct::distinctCountApproxParallel(events.begin(), events.end(), 14, 7, 1000),
+              ct::distinctCountApprox(events.begin(), events.end()));
+}
+
+static void
+benchmark_dedupe_strings(benchmark::State& state)
+{
+    std::vector<std::string> words;
+    for (int event : make_events(state.range(0), state.range(1)))
+        words.push_back("event-" + std::to_string(event));
+
+    std::vector<std::string> out(words.size());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::dedupeCopy(words.begin(), words.end(), out.begin()));
+    }
+
+    state.SetItemsProcessed(state.iterations() * words.size());
+
+    out.erase(ct::dedupeCopy(words.begin(), words.end(), out.begin()), out.end());
+    EXPECT_EQ(out.size(), std::set<std::string>(words.begin(), words.end()).size());
+    EXPECT_EQ(out.front(), words.front());
+}
+
+static void
+benchmark_hash_set_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        ct::FlatHashSet<int> set;
+        for (int i = 0; i < 1000; i++)
+            set.insert(i & 255);
+        benchmark::DoNotOptimize(set.size());
+    }
+
+    std::vector<int> empty;
+    EXPECT_EQ(ct::dedupe(empty.begin(), empty.end()), empty.end());
+    EXPECT_EQ(ct::distinctCount(empty.begin(), empty.end()), 0u);
+    EXPECT_EQ(ct::distinctCountApprox(empty.begin(), empty.end()), 0.0);
+
+    // Growing keeps every key.
+    ct::FlatHashSet<long long> set;
+    for (long long i = 0; i < 100000; i++)
+        EXPECT_TRUE(set.insert(i * 4096));
+    EXPECT_EQ(set.size(), 100000u);
+    EXPECT_TRUE(set.contains(4096 * 99999LL));
+    EXPECT_FALSE(set.contains(1));
+    EXPECT_FALSE(set.insert(0));
+
+    // Exact for few values, linear counting.
+    std::vector<int> few{ 3, 1, 3, 2, 1 };
+    EXPECT_NEAR(ct::distinctCountApprox(few.begin(), few.end()), 3.0, 0.1);
+}
+
+// From almost all duplicates to almost all distinct.
+static void
+cardinalities(benchmark::internal::Benchmark* benchmark)
+{
+    for (int cardinality : { 16, 1 << 10, 1 << 16, 1 << 20 })
+        benchmark->Args({ 1 << 20, cardinality });
+}
+
+BENCHMARK(benchmark_sort_unique)->Apply(cardinalities);
+BENCHMARK(benchmark_unordered_set)->Apply(cardinalities);
+BENCHMARK(benchmark_dedupe)->Apply(cardinalities);
+BENCHMARK(benchmark_dedupe_parallel)->Apply(cardinalities)->UseRealTime();
+BENCHMARK(benchmark_distinct_count)->Apply(cardinalities);
+BENCHMARK(benchmark_distinct_count_approx)->Apply(cardinalities);
+BENCHMARK(benchmark_distinct_count_approx_parallel)->Apply(cardinalities)->UseRealTime();
+BENCHMARK(benchmark_dedupe_strings)->Args({ 1 << 18, 1 << 12 });
+BENCHMARK(benchmark_hash_set_edge_cases)->Iterations(1000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,275 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+
+/*
+ Half precision storage (modules/HalfPrecision)
+
+ TemplateClass coordinates packed as Fp16 or Bf16, 6 bytes per vector instead of 12. The
+ length and dot kernels convert in registers (F16C / AVX-512 with -march=native), once the
+ arrays do not fit in the caches the packed formats move half the bytes. Argument: vectors,
+ 4K (in L1) to 16M (192 MB of floats).
+
+ run: ./test/half_precision
+*/
+
+// C++ headers
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "PackedVectors.hpp"
+#include "Random.hpp"
+
+using ct::half::Bf16;
+using ct::half::Fp16;
+using ct::half::Fp32;
+using ct::half::PackedVectors;
+
+struct Cloud
+{
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> zs;
+};
+
+// Coordinates in [-100, 100), the range of the LessonOne vectors.
+static Cloud
+random_cloud(size_t count, uint64_t seed)
+{
+    ct::Xoshiro256StarStar generator(seed);
+    Cloud cloud;
+    for (std::vector<float>* list : { &cloud.xs, &cloud.ys, &cloud.zs })
+    {
+        list->resize(count);
+        for (float& value : *list)
+            value = static_cast<float>(ct::uniformReal(generator) * 200.0 - 100.0);
+    }
+    return cloud;
+}
+
+// Every 16 bit pattern decodes to a float which encodes back to it, the bulk (SIMD) conversion
+// gives the scalar bits.
+template <typename Format>
+static void
+check_round_trip()
+{
+    std::vector<uint16_t> patterns(65536);
+    for (uint32_t bits = 0; bits < 65536; bits++)
+        patterns[bits] = static_cast<uint16_t>(bits);
+    std::vector<float> decoded(patterns.size());
+    ct::half::decode<Format>(patterns.data(), decoded.data(), patterns.size());
+    std::vector<uint16_t> encoded(patterns.size());
+    ct::half::encode<Format>(decoded.data(), encoded.data(), decoded.size());
+    for (uint32_t bits = 0; bits < 65536; bits++)
+    {
+        const float value = Format::decode(patterns[bits]);
+        if (std::isnan(value))
+        {
+            EXPECT_TRUE(std::isnan(decoded[bits]));
+            EXPECT_TRUE(std::isnan(Format::decode(encoded[bits])));
+            continue;
+        }
+        EXPECT_EQ(value, decoded[bits]);
+        EXPECT_EQ(Format::encode(value), patterns[bits]);
+        EXPECT_EQ(encoded[bits], patterns[bits]);
+    }
+}
+
+// Quantization error of random floats over the normal range, rounding ties and overflow.
+template <typename Format>
+static void
+check_quantization(float smallest, float largest)
+{
+    ct::Xoshiro256StarStar generator(1);
+    std::vector<float> values;
+    for (int i = 0; i < 100000; i++)
+    {
+        const double exponent = std::log2(smallest) + ct::uniformReal(generator) * (std::log2(largest) - std::log2(smallest));
+        const float value = static_cast<float>(std::exp2(exponent));
+        values.push_back(i % 2 == 0 ? value : -value);
+    }
+    std::vector<uint16_t> packed(values.size());
+    ct::half::encode<Format>(values.data(), packed.data(), values.size());
+    double worst = 0;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        EXPECT_EQ(packed[i], Format::encode(values[i]));
+        worst = std::max(worst, std::fabs(double(Format::decode(packed[i])) / values[i] - 1.0));
+    }
+    EXPECT_LE(worst, Format::maxRelativeError);
+    // The bound is tight, rounding takes up to half a unit of the last place.
+    EXPECT_GT(worst, 0.9 * Format::maxRelativeError);
+
+    EXPECT_EQ(Format::decode(Format::encode(0.0f)), 0.0f);
+    EXPECT_TRUE(std::signbit(Format::decode(Format::encode(-0.0f))));
+    EXPECT_EQ(Format::decode(Format::encode(std::numeric_limits<float>::infinity())), std::numeric_limits<float>::infinity());
+    EXPECT_TRUE(std::isnan(Format::decode(Format::encode(std::numeric_limits<float>::quiet_NaN()))));
+}
+
+template <typename Format, typename Policy>
+static void
+check_kernels(const Cloud& cloud)
+{
+    const size_t count = cloud.xs.size();
+    const PackedVectors<Format> vectors(cloud.xs.data(), cloud.ys.data(), cloud.zs.data(), count);
+    ASSERT_EQ(vectors.size(), count);
+    std::vector<float> lengths(count), dots(count);
+    vectors.template lengths<Policy>(lengths.data());
+    const float qx = 0.48f, qy = -0.6f, qz = 0.64f;
+    vectors.dots(qx, qy, qz, dots.data());
+    for (size_t i = 0; i < count; i++)
+    {
+        const double x = cloud.xs[i], y = cloud.ys[i], z = cloud.zs[i];
+        const double length = std::sqrt(x * x + y * y + z * z);
+        const double bound = Format::maxRelativeError + Policy::maxRelativeError + 4e-7;
+        EXPECT_NEAR(lengths[i], length, bound * length);
+        // |q| = 1
+        EXPECT_NEAR(dots[i], x * qx + y * qy + z * qz, (Format::maxRelativeError + 4e-7) * length);
+
+        float px, py, pz;
+        vectors.get(i, px, py, pz);
+        EXPECT_NEAR(dots[i], px * qx + py * qy + pz * qz, 1e-5 * length);
+    }
+}
+
+static void
+check_half_precision()
+{
+    check_round_trip<Fp16>();
+    check_round_trip<Bf16>();
+    check_quantization<Fp16>(6.2e-5f, 65000.0f);
+    check_quantization<Bf16>(1.2e-38f, 3e38f);
+
+    // Fp16 range ends: 65504 is the largest half, 65520 rounds up to infinity, 2^-24 the
+    // smallest denormal.
+    EXPECT_EQ(Fp16::decode(Fp16::encode(65504.0f)), 65504.0f);
+    EXPECT_EQ(Fp16::decode(Fp16::encode(65519.0f)), 65504.0f);
+    EXPECT_TRUE(std::isinf(Fp16::decode(Fp16::encode(65520.0f))));
+    EXPECT_EQ(Fp16::decode(Fp16::encode(5.9604645e-8f)), 5.9604645e-8f);
+    EXPECT_EQ(Fp16::decode(Fp16::encode(2.9e-8f)), 0.0f);
+    EXPECT_EQ(Bf16::decode(Bf16::encode(1.0f + 1.0f / 256)), 1.0f); // Tie to even.
+    EXPECT_EQ(Bf16::decode(Bf16::encode(1.0f + 3.0f / 256)), 1.0f + 4.0f / 256);
+
+    // 1003 vectors leave a tail after the SIMD steps.
+    const Cloud cloud = random_cloud(1003, 2);
+    check_kernels<Fp32, ct::precision::Exact>(cloud);
+    check_kernels<Fp16, ct::precision::Exact>(cloud);
+    check_kernels<Bf16, ct::precision::Exact>(cloud);
+    check_kernels<Fp16, ct::precision::RsqrtNewton>(cloud);
+
+    PackedVectors<Fp16> pushed;
+    pushed.push(1.0f, 2.0f, 2.0f);
+    std::vector<float> length(pushed.size());
+    pushed.lengths(length.data());
+    EXPECT_EQ(length[0], 3.0f);
+    EXPECT_EQ(pushed.bytes(), 6u);
+}
+
+template <typename Format>
+static void
+benchmark_lengths(benchmark::State& state)
+{
+    const size_t count = static_cast<size_t>(state.range(0));
+    const Cloud cloud = random_cloud(count, 3);
+    const PackedVectors<Format> vectors(cloud.xs.data(), cloud.ys.data(), cloud.zs.data(), count);
+    std::vector<float> out(count);
+    for (auto _ : state)
+    {
+        vectors.lengths(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * vectors.bytes()));
+}
+
+template <typename Format>
+static void
+benchmark_dots(benchmark::State& state)
+{
+    const size_t count = static_cast<size_t>(state.range(0));
+    const Cloud cloud = random_cloud(count, 4);
+    const PackedVectors<Format> vectors(cloud.xs.data(), cloud.ys.data(), cloud.zs.data(), count);
+    std::vector<float> out(count);
+    for (auto _ : state)
+    {
+        vectors.dots(0.48f, -0.6f, 0.64f, out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * vectors.bytes()));
+}
+
+template <typename Format>
+static void
+benchmark_encode(benchmark::State& state)
+{
+    const size_t count = static_cast<size_t>(state.range(0));
+    const Cloud cloud = random_cloud(count, 5);
+    std::vector<typename Format::Storage> packed(count);
+    for (auto _ : state)
+    {
+        ct::half::encode<Format>(cloud.xs.data(), packed.data(), count);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+template <typename Format>
+static void
+benchmark_decode(benchmark::State& state)
+{
+    const size_t count = static_cast<size_t>(state.range(0));
+    const Cloud cloud = random_cloud(count, 5);
+    std::vector<typename Format::Storage> packed(count);
+    ct::half::encode<Format>(cloud.xs.data(), packed.data(), count);
+    std::vector<float> out(count);
+    for (auto _ : state)
+    {
+        ct::half::decode<Format>(packed.data(), out.data(), count);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+static void
+benchmark_half_precision_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+        check_half_precision();
+}
+
+BENCHMARK_TEMPLATE(benchmark_lengths, Fp32)->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_lengths, Fp16)->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_lengths, Bf16)->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_dots, Fp32)->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_dots, Fp16)->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_dots, Bf16)->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_encode, Fp16)->Arg(1 << 16)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_encode, Bf16)->Arg(1 << 16)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_decode, Fp16)->Arg(1 << 16)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_decode, Bf16)->Arg(1 << 16)->Unit(benchmark::kMicrosecond);
+BENCHMARK(benchmark_half_precision_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,275 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Huge page allocator (modules/HugePages)
+
+ Sort, lower_bound and shuffle jump around arrays of tens of MB. With 4K pages nearly every
+ access needs a page walk because the dTLB covers only a few MB, with 2 MB pages the whole
+ array fits. Each kernel runs on a std::vector with std::allocator and one with
+ ct::HugePageAllocator. The label says which path the allocator took and how much of
+ the array the kernel really backs with huge pages. dtlb_misses needs hardware counters,
+ page_faults shows the same effect when the arrays are first touched.
+
+ run: ./test/huge_pages
+*/
+
+// C++ headers
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "BenchmarkPerfCounters.hpp"
+#include "HugePageAllocator.hpp"
+#include "Random.hpp"
+#include "Shuffle.hpp"
+
+constexpr size_t sort_count = 1 << 22;
+constexpr size_t search_count = 1 << 24;
+constexpr size_t lookup_count = 1 << 16;
+
+using HugeInts = std::vector<int, ct::HugePageAllocator<int>>;
+
+// Employee of test/Pluralsight/stl_algorithms.cpp with fixed size names, 48 bytes.
+struct Employee
+{
+    char firstName[20];
+    char lastName[20];
+    int64_t salary;
+};
+
+static const std::vector<ct::PerfCounters::Event> tlb_events{
+    ct::PerfCounters::Event::DTLBMisses,
+    ct::PerfCounters::Event::PageFaults,
+    ct::PerfCounters::Event::Cycles,
+};
+
+static std::string
+describe_pages(const void* data, size_t bytes, bool huge)
+{
+    const size_t hugeBytes = ct::hugepages::transparentHugeBytes(data, bytes);
+    std::string label = huge ? ct::hugepages::name(ct::hugepages::lastPath()) : "std::allocator";
+    return label + ", " + std::to_string(hugeBytes >> 20) + " of " + std::to_string(bytes >> 20) + " MB on transparent huge pages";
+}
+
+template <typename Vector>
+static Vector
+random_values(size_t count, uint64_t seed)
+{
+    Vector values(count);
+    ct::Xoshiro256StarStar generator(seed);
+    for (auto& value : values)
+        value = static_cast<typename Vector::value_type>(generator() >> 33);
+    return values;
+}
+
+static bool
+transparent_huge_pages_enabled()
+{
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string modes;
+    std::getline(file, modes);
+    return modes.find("[always]") != std::string::npos || modes.find("[madvise]") != std::string::npos;
+}
+
+template <typename Vector>
+static void
+benchmark_sort(benchmark::State& state)
+{
+    const Vector source = random_values<Vector>(sort_count, 1);
+    Vector values(sort_count);
+    state.SetLabel(describe_pages(values.data(), values.size() * sizeof(int), !std::is_same_v<Vector, std::vector<int>>));
+
+    ct::BenchmarkPerfCounters perf(state, tlb_events);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::copy(source.begin(), source.end(), values.begin());
+        state.ResumeTiming();
+        std::sort(values.begin(), values.end());
+        benchmark::DoNotOptimize(values.data());
+    }
+    perf.stop();
+
+    EXPECT_TRUE(std::is_sorted(values.begin(), values.end()));
+}
+
+template <typename Vector>
+static void
+benchmark_lower_bound(benchmark::State& state)
+{
+    Vector values = random_values<Vector>(search_count, 2);
+    std::sort(values.begin(), values.end());
+    const std::vector<int> keys = random_values<std::vector<int>>(lookup_count, 3);
+    state.SetLabel(describe_pages(values.data(), values.size() * sizeof(int), !std::is_same_v<Vector, std::vector<int>>));
+
+    const auto count_found = [&values, &keys]() {
+        size_t found = 0;
+        for (int key : keys)
+            found += *std::lower_bound(values.begin(), values.end() - 1, key) == key;
+        return found;
+    };
+
+    ct::BenchmarkPerfCounters perf(state, tlb_events);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(count_found());
+    perf.stop();
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * lookup_count));
+    EXPECT_LE(count_found(), lookup_count);
+}
+
+template <typename Vector>
+static void
+benchmark_shuffle(benchmark::State& state)
+{
+    Vector values(search_count);
+    std::iota(values.begin(), values.end(), 0);
+    ct::Xoshiro256StarStar generator(4);
+    state.SetLabel(describe_pages(values.data(), values.size() * sizeof(int), !std::is_same_v<Vector, std::vector<int>>));
+
+    ct::BenchmarkPerfCounters perf(state, tlb_events);
+    for (auto _ : state)
+    {
+        ct::shuffle(values.begin(), values.end(), generator);
+        benchmark::DoNotOptimize(values.data());
+    }
+    perf.stop();
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * search_count));
+    EXPECT_EQ(std::accumulate(values.begin(), values.end(), int64_t{ 0 }), int64_t{ search_count } * (search_count - 1) / 2);
+}
+
+template <typename Vector>
+static void
+benchmark_sort_employees(benchmark::State& state)
+{
+    Vector source(sort_count / 4);
+    ct::Xoshiro256StarStar generator(5);
+    for (auto& employee : source)
+        employee = { "Jeff", "Johnsin", static_cast<int64_t>(generator() >> 40) };
+    Vector employees = source;
+    state.SetLabel(describe_pages(employees.data(), employees.size() * sizeof(Employee), !std::is_same_v<Vector, std::vector<Employee>>));
+
+    const auto bySalary = [](const Employee& a, const Employee& b) { return a.salary < b.salary; };
+    ct::BenchmarkPerfCounters perf(state, tlb_events);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::copy(source.begin(), source.end(), employees.begin());
+        state.ResumeTiming();
+        std::sort(employees.begin(), employees.end(), bySalary);
+        benchmark::DoNotOptimize(employees.data());
+    }
+    perf.stop();
+
+    EXPECT_TRUE(std::is_sorted(employees.begin(), employees.end(), bySalary));
+}
+
+static void
+benchmark_huge_pages_edge_cases(benchmark::State& state)
+{
+    using ct::hugepages::Path;
+    const size_t hugePage = ct::hugepages::hugePageSize();
+    const size_t large = 4 * hugePage + 123;
+
+    for (auto _ : state)
+    {
+        EXPECT_GE(hugePage, 4096u);
+        EXPECT_EQ(ct::hugepages::minimumBytes(), hugePage / 2);
+        EXPECT_STREQ(ct::hugepages::name(Path::HugeTlb), "hugetlb");
+        EXPECT_STREQ(ct::PerfCounters::name(ct::PerfCounters::Event::DTLBMisses), "dtlb_misses");
+        EXPECT_NE(ct::PerfCounters::create(tlb_events), nullptr);
+
+        // Small allocations come from the heap.
+        Path used = Path::HugeTlb;
+        void* small = ct::hugepages::allocate(100, Path::HugeTlb, &used);
+        ASSERT_NE(small, nullptr);
+        EXPECT_EQ(used, Path::Regular);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(small) % 64, 0u);
+        ct::hugepages::deallocate(small, 100);
+
+        // Whatever path is taken, the memory is usable and huge page aligned.
+        for (Path first : { Path::HugeTlb, Path::Transparent, Path::Regular })
+        {
+            const size_t before = ct::hugepages::allocationCount(Path::Regular) + ct::hugepages::allocationCount(Path::Transparent) +
+                                  ct::hugepages::allocationCount(Path::HugeTlb);
+            auto* bytes = static_cast<unsigned char*>(ct::hugepages::allocate(large, first, &used));
+            ASSERT_NE(bytes, nullptr);
+            EXPECT_EQ(ct::hugepages::lastPath(), used);
+            EXPECT_GE(static_cast<int>(used), static_cast<int>(first));
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(bytes) % hugePage, 0u);
+            EXPECT_EQ(ct::hugepages::allocationCount(Path::Regular) + ct::hugepages::allocationCount(Path::Transparent) +
+                          ct::hugepages::allocationCount(Path::HugeTlb),
+                      before + 1);
+
+            std::fill(bytes, bytes + large, 0xab);
+            EXPECT_EQ(bytes[large - 1], 0xab);
+            EXPECT_LE(ct::hugepages::transparentHugeBytes(bytes, large), large + hugePage);
+            ct::hugepages::deallocate(bytes, large);
+        }
+
+        // Without reserved huge pages, stock Linux without root, madvise is the path.
+        if (transparent_huge_pages_enabled())
+        {
+            void* memory = ct::hugepages::allocate(large, Path::Transparent, &used);
+            EXPECT_EQ(used, Path::Transparent);
+            ct::hugepages::deallocate(memory, large);
+        }
+
+        // In std containers, the growth steps switch from the heap to mappings.
+        HugeInts values;
+        for (int i = 0; i < 1 << 20; i++)
+            values.push_back(i);
+        if (transparent_huge_pages_enabled())
+        {
+            EXPECT_NE(ct::hugepages::lastPath(), Path::Regular);
+        }
+        EXPECT_EQ(values[12345], 12345);
+        EXPECT_EQ(std::accumulate(values.begin(), values.end(), int64_t{ 0 }), (int64_t{ 1 } << 20) * ((1 << 20) - 1) / 2);
+        HugeInts copy = values;
+        EXPECT_EQ(copy, values);
+        values.clear();
+        values.shrink_to_fit();
+        EXPECT_TRUE(values.empty());
+
+        std::vector<Employee, ct::HugePageAllocator<Employee>> employees(2, Employee{ "Rick", "Novak", 1001 });
+        EXPECT_EQ(employees[1].salary, 1001);
+        EXPECT_TRUE(ct::HugePageAllocator<int>() == ct::HugePageAllocator<Employee>());
+    }
+}
+
+BENCHMARK_TEMPLATE(benchmark_sort, std::vector<int>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(benchmark_sort, HugeInts)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(benchmark_lower_bound, std::vector<int>);
+BENCHMARK_TEMPLATE(benchmark_lower_bound, HugeInts);
+BENCHMARK_TEMPLATE(benchmark_shuffle, std::vector<int>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(benchmark_shuffle, HugeInts)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(benchmark_sort_employees, std::vector<Employee>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(benchmark_sort_employees, std::vector<Employee, ct::HugePageAllocator<Employee>>)->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_huge_pages_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
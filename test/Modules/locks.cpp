@@ -0,0 +1,288 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+/*
+ Locks and lock profiling (modules/Locks)
+
+ TemplateClass keeps a commented out mutex next to the note "std::atomic is faster".
+ std::mutex, a ticket lock, an MCS queue lock and a spin-then-futex mutex guard the
+ coordinates of a shared vector, argument: work inside the critical section, threads
+ 1 to 8. Instrumented<> adds wait histograms and call sites, locks::report() ranks them.
+
+ run: ./test/locks
+*/
+
+// C++ headers
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "AdaptiveMutex.hpp"
+#include "Instrumented.hpp"
+#include "McsLock.hpp"
+#include "TicketLock.hpp"
+#include "Topology.hpp"
+
+// TemplateClass<float> with its call counter.
+struct SharedVector
+{
+    float x = 1;
+    float y = 2;
+    float z = 2;
+    uint64_t timesCalled = 0;
+};
+
+// 'work' dependent multiply-adds on the shared coordinates.
+static void
+critical_section(SharedVector& vector, int64_t work)
+{
+    vector.timesCalled++;
+    for (int64_t i = 0; i < work; i++)
+    {
+        vector.x = vector.x * 0.5f + vector.y;
+        vector.y = vector.y * 0.5f + vector.z;
+    }
+}
+
+// Constructs plain locks and names instrumented ones.
+template <typename Lock>
+struct Make
+{
+    static Lock* lock(const char*) { return new Lock(); }
+};
+
+template <typename Lock>
+struct Make<ct::Instrumented<Lock>>
+{
+    static ct::Instrumented<Lock>* lock(const char* name) { return new ct::Instrumented<Lock>(name); }
+};
+
+template <typename Lock>
+static void
+benchmark_lock(benchmark::State& state)
+{
+    static Lock* lock = Make<Lock>::lock("benchmark_lock");
+    static SharedVector vector;
+    const int64_t work = state.range(0);
+
+    for (auto _ : state)
+    {
+        ct::LockGuard<Lock> guard(*lock);
+        critical_section(vector, work);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// What the comment in TemplateClass means: the counter alone as an atomic, no lock.
+static void
+benchmark_atomic_counter(benchmark::State& state)
+{
+    static std::atomic<uint64_t> timesCalled{ 0 };
+    for (auto _ : state)
+        timesCalled.fetch_add(1, std::memory_order_relaxed);
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// Every thread increments a plain counter under the lock, none may be lost.
+template <typename Lock>
+static uint64_t
+count_with_threads(Lock& lock, int threads, int increments)
+{
+    SharedVector vector;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+        workers.emplace_back([&lock, &vector, increments]() {
+            for (int i = 0; i < increments; i++)
+            {
+                ct::LockGuard<Lock> guard(lock);
+                critical_section(vector, 1);
+            }
+        });
+    for (auto& worker : workers)
+        worker.join();
+    return vector.timesCalled;
+}
+
+template <typename Lock>
+static void
+check_lock(Lock& lock)
+{
+    EXPECT_EQ(count_with_threads(lock, 4, 5000), 20000u);
+
+    EXPECT_TRUE(lock.try_lock());
+    bool acquired = true;
+    std::thread other([&lock, &acquired]() { acquired = lock.try_lock(); });
+    other.join();
+    EXPECT_FALSE(acquired);
+    lock.unlock();
+
+    // A waiter gets the lock after the holder, long after its spin budget.
+    lock.lock();
+    std::atomic<bool> entered{ false };
+    std::thread waiter([&lock, &entered]() {
+        lock.lock();
+        entered = true;
+        lock.unlock();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(entered.load());
+    lock.unlock();
+    waiter.join();
+    EXPECT_TRUE(entered.load());
+}
+
+static void
+check_instrumented()
+{
+    ct::Instrumented<ct::AdaptiveMutex> quiet("quiet");
+    ct::Instrumented<ct::TicketLock> busy("busy");
+
+    for (int i = 0; i < 3; i++)
+    {
+        ct::LockGuard<ct::Instrumented<ct::AdaptiveMutex>> guard(quiet);
+    }
+    EXPECT_TRUE(quiet.try_lock());
+    quiet.unlock();
+
+    ct::locks::LockReport report = quiet.profile().report();
+    EXPECT_EQ(report.acquisitions, 4u);
+    EXPECT_EQ(report.contended, 0u);
+    ASSERT_EQ(report.sites.size(), 2u);
+    EXPECT_NE(std::string(report.sites[0].file).find("locks.cpp"), std::string::npos);
+
+    // The main thread holds 'busy' for 20 ms while another thread waits.
+    const unsigned holderLine = __LINE__ + 1;
+    busy.lock();
+    std::thread waiter([&busy]() {
+        ct::LockGuard<ct::Instrumented<ct::TicketLock>> guard(busy);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    busy.unlock();
+    waiter.join();
+
+    report = busy.profile().report();
+    EXPECT_EQ(report.acquisitions, 2u);
+    EXPECT_EQ(report.contended, 1u);
+    EXPECT_GE(report.waitNanoseconds, 10000000u);
+    EXPECT_EQ(report.maxWaitNanoseconds, report.waitNanoseconds);
+    EXPECT_GE(report.waitPercentile(0.99), report.waitNanoseconds);
+    EXPECT_LE(report.waitPercentile(0.99), 2 * report.waitNanoseconds);
+    uint64_t histogram = 0;
+    for (uint64_t count : report.waitHistogram)
+        histogram += count;
+    EXPECT_EQ(histogram, 1u);
+    ASSERT_EQ(report.sites.size(), 2u);
+    // The holder blocked the waiter, both count as contended sites.
+    const auto holder = std::find_if(report.sites.begin(), report.sites.end(), [holderLine](const ct::locks::SiteReport& site) { return site.line == holderLine; });
+    ASSERT_NE(holder, report.sites.end());
+    EXPECT_EQ(holder->blocking, 1u);
+    EXPECT_EQ(holder->contended, 0u);
+
+    // The contended lock ranks before the quiet one.
+    const std::vector<ct::locks::LockReport> ranking = ct::locks::report(100);
+    const auto position = [&ranking](const char* name) {
+        return std::find_if(ranking.begin(), ranking.end(), [name](const ct::locks::LockReport& lock) { return lock.name == name; }) - ranking.begin();
+    };
+    EXPECT_LT(position("busy"), position("quiet"));
+    const std::string text = ct::locks::formatReport(ranking);
+    EXPECT_NE(text.find("busy"), std::string::npos);
+    EXPECT_NE(text.find("locks.cpp:" + std::to_string(holderLine)), std::string::npos);
+
+    busy.profile().reset();
+    EXPECT_EQ(busy.profile().report().acquisitions, 0u);
+
+    // Sites beyond maxSites go to "other", the tracked sites keep their own counts.
+    ct::locks::Profile crowded("crowded");
+    for (unsigned line = 1; line <= ct::locks::maxSites + 4; line++)
+        crowded.acquired("crowded.cpp", line, 0, false, nullptr);
+    report = crowded.report();
+    ASSERT_EQ(report.sites.size(), ct::locks::maxSites + 1);
+    for (const ct::locks::SiteReport& site : report.sites)
+        EXPECT_EQ(site.acquisitions, site.file == ct::locks::otherSite ? 4u : 1u);
+    EXPECT_EQ(std::count_if(report.sites.begin(), report.sites.end(), [](const ct::locks::SiteReport& site) { return site.file == ct::locks::otherSite; }), 1);
+}
+
+static void
+benchmark_locks_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        std::mutex mutex;
+        check_lock(mutex);
+        ct::TicketLock ticket;
+        check_lock(ticket);
+        ct::McsLock mcs;
+        check_lock(mcs);
+        ct::AdaptiveMutex adaptive;
+        check_lock(adaptive);
+        EXPECT_LE(adaptive.spinLimit(), ct::AdaptiveMutex::maxSpins);
+        ct::Instrumented<ct::McsLock> instrumented("instrumented mcs");
+        check_lock(instrumented);
+
+        // MCS locks may be released in any order, each one remembers its node.
+        ct::McsLock a;
+        ct::McsLock b;
+        ct::McsLock c;
+        a.lock();
+        b.lock();
+        a.unlock();
+        c.lock();
+        b.unlock();
+        EXPECT_TRUE(a.try_lock());
+        EXPECT_FALSE(c.try_lock());
+        a.unlock();
+        c.unlock();
+
+        check_instrumented();
+    }
+}
+
+// FIFO spin locks hand the lock to the next waiter in line, with more threads than allowed CPUs
+// that waiter is often descheduled and all others spin behind it (convoy), a run takes minutes.
+// Their thread counts stop at the allowed CPUs, the blocking locks keep the full range.
+static void
+fair_spin_lock_args(benchmark::internal::Benchmark* benchmark)
+{
+    const size_t cpus = std::max<size_t>(1, ct::Topology::detect().allowedCpuCount());
+    for (int64_t hold : { 0, 32, 512 })
+        benchmark->Arg(hold);
+    for (size_t threads = 1; threads <= std::min<size_t>(cpus, 8); threads *= 2)
+        benchmark->Threads(static_cast<int>(threads));
+}
+
+BENCHMARK(benchmark_atomic_counter)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_lock, std::mutex)->Arg(0)->Arg(32)->Arg(512)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_lock, ct::TicketLock)->Apply(fair_spin_lock_args)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_lock, ct::McsLock)->Apply(fair_spin_lock_args)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_lock, ct::AdaptiveMutex)->Arg(0)->Arg(32)->Arg(512)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_lock, ct::Instrumented<ct::AdaptiveMutex>)->Arg(0)->Arg(32)->Arg(512)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(benchmark_locks_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
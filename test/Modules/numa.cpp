@@ -0,0 +1,306 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ NUMA topology, thread pinning and memory placement (modules/Numa)
+
+ Threads of parallelFor() run on any CPU and the pages of a std::vector go to the node
+ of the thread which fills it. On a dual socket machine half of the threads then read
+ remote memory. numaPartition() gives every thread a CPU and a contiguous block of the
+ data, firstTouch() puts the pages of a block on the node of its thread. The scan
+ benchmarks run the prefix sum of modules/Scan both ways.
+ On a single node machine the benchmarks are the same, the tests use a fake /sys tree.
+
+ run: ./test/numa
+*/
+
+// C++ headers
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "Affinity.hpp"
+#include "NumaMemory.hpp"
+#include "NumaParallel.hpp"
+#include "NumaScan.hpp"
+#include "Topology.hpp"
+
+constexpr size_t value_count = 1 << 24;
+
+static void
+write_file(const std::filesystem::path& path, const std::string& text)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << text;
+}
+
+// Two sockets, two cores per socket with two hyper-threads, siblings are cpu and cpu + 4.
+static std::string
+make_dual_socket_tree()
+{
+    const auto root = std::filesystem::temp_directory_path() / "ct_numa_sys";
+    std::filesystem::remove_all(root);
+    const auto system = root / "devices" / "system";
+
+    write_file(system / "cpu" / "online", "0-7\n");
+    for (unsigned cpu = 0; cpu < 8; cpu++)
+    {
+        const auto topology = system / "cpu" / ("cpu" + std::to_string(cpu)) / "topology";
+        write_file(topology / "physical_package_id", std::to_string((cpu / 2) % 2) + "\n");
+        write_file(topology / "core_id", std::to_string(cpu % 2) + "\n");
+    }
+    write_file(system / "node" / "node0" / "cpulist", "0-1,4-5\n");
+    write_file(system / "node" / "node0" / "meminfo", "Node 0 MemTotal:       16777216 kB\nNode 0 MemFree:        1024 kB\n");
+    write_file(system / "node" / "node1" / "cpulist", "2-3,6-7\n");
+    write_file(system / "node" / "node1" / "meminfo", "Node 1 MemTotal:       16777216 kB\n");
+    write_file(system / "node" / "possible", "0-1\n");
+    write_file(root / "cpuinfo", "processor\t: 0\nmodel name\t: Test CPU @ 2.00GHz\n");
+    return root.string();
+}
+
+static double
+sum_range(const double* values, size_t begin, size_t end)
+{
+    return std::accumulate(values + begin, values + end, 0.0);
+}
+
+// Pages touched by the main thread, summed by threads on any CPU.
+static void
+benchmark_sum_serial_touch(benchmark::State& state)
+{
+    std::vector<double> values(value_count, 1.0);
+
+    const auto sum = [&values]() {
+        std::vector<double> partial(ct::hardwareThreads(), 0.0);
+        const unsigned threads = ct::parallelFor(values.size(), 0, [&](size_t begin, size_t end, unsigned t) { partial[t] = sum_range(values.data(), begin, end); });
+        return std::accumulate(partial.begin(), partial.begin() + threads, 0.0);
+    };
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sum());
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value_count * sizeof(double)));
+    EXPECT_EQ(sum(), static_cast<double>(value_count));
+}
+
+// Every thread pinned and reading the pages it touched first.
+static void
+benchmark_sum_first_touch(benchmark::State& state)
+{
+    const ct::Topology topology = ct::Topology::detect();
+    const auto partition = ct::numaPartition(topology, value_count);
+    ct::NumaBuffer<double> values(value_count);
+    ct::firstTouch(values.data(), partition, 1.0);
+
+    const auto sum = [&]() {
+        return ct::numaParallelReduce(partition, 0.0, [&values](size_t begin, size_t end) { return sum_range(values.data(), begin, end); }, std::plus<>());
+    };
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sum());
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value_count * sizeof(double)));
+    state.SetLabel(topology.describe());
+    EXPECT_EQ(sum(), static_cast<double>(value_count));
+}
+
+// Pages round robin over all nodes, every thread reads local and remote pages.
+static void
+benchmark_sum_interleaved(benchmark::State& state)
+{
+    const ct::Topology topology = ct::Topology::detect();
+    const auto partition = ct::numaPartition(topology, value_count);
+    ct::NumaBuffer<double> values(value_count);
+    std::vector<unsigned> nodes;
+    for (const auto& node : topology.nodes())
+        nodes.push_back(node.id);
+    values.interleave(nodes);
+    std::fill(values.begin(), values.end(), 1.0);
+
+    const auto sum = [&]() {
+        return ct::numaParallelReduce(partition, 0.0, [&values](size_t begin, size_t end) { return sum_range(values.data(), begin, end); }, std::plus<>());
+    };
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sum());
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value_count * sizeof(double)));
+    EXPECT_EQ(sum(), static_cast<double>(value_count));
+}
+
+// Prefix sum with parallelFor(), input and output filled by the main thread.
+static void
+benchmark_scan_serial_touch(benchmark::State& state)
+{
+    std::vector<int64_t> values(value_count, 1);
+    std::vector<int64_t> offsets(value_count, 0);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(ct::exclusiveScanParallel(values.data(), values.data() + values.size(), offsets.data()));
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value_count * 2 * sizeof(int64_t)));
+    EXPECT_EQ(offsets.back(), static_cast<int64_t>(value_count - 1));
+}
+
+// The same scan on the pinned threads, input and output first touched with their partition.
+static void
+benchmark_scan_first_touch(benchmark::State& state)
+{
+    const ct::Topology topology = ct::Topology::detect();
+    const auto partition = ct::numaPartition(topology, value_count);
+    ct::NumaBuffer<int64_t> values(value_count);
+    ct::NumaBuffer<int64_t> offsets(value_count);
+    ct::firstTouch(values.data(), partition, int64_t{ 1 });
+    ct::firstTouch(offsets.data(), partition);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(ct::exclusiveScanParallel(partition, values.begin(), values.end(), offsets.data()));
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value_count * 2 * sizeof(int64_t)));
+    state.SetLabel(topology.describe());
+    EXPECT_EQ(offsets[value_count - 1], static_cast<int64_t>(value_count - 1));
+}
+
+static void
+benchmark_numa_edge_cases(benchmark::State& state)
+{
+    const std::string root = make_dual_socket_tree();
+
+    for (auto _ : state)
+    {
+        EXPECT_EQ(ct::numa::parseCpuList("0-3,8,10-11\n"), (std::vector<unsigned>{ 0, 1, 2, 3, 8, 10, 11 }));
+        EXPECT_TRUE(ct::numa::parseCpuList("").empty());
+        EXPECT_EQ(ct::numa::formatCpuList({ 11, 0, 1, 2, 3, 8, 10 }), "0-3,8,10-11");
+
+        // Dual socket machine from files.
+        const auto dual = ct::Topology::fromFiles(root, root + "/cpuinfo");
+        ASSERT_EQ(dual.nodeCount(), 2u);
+        EXPECT_EQ(dual.cpus().size(), 8u);
+        EXPECT_EQ(dual.allowedCpuCount(), 8u);
+        EXPECT_EQ(dual.nodes()[1].cpus, (std::vector<unsigned>{ 2, 3, 6, 7 }));
+        EXPECT_EQ(dual.nodes()[0].memoryBytes, 16ull << 30);
+        EXPECT_EQ(dual.nodeOfCpu(5), 0);
+        EXPECT_EQ(dual.nodeOfCpu(6), 1);
+        EXPECT_EQ(dual.nodeOfCpu(42), -1);
+        EXPECT_EQ(dual.allowedCpus(1), (std::vector<unsigned>{ 2, 3, 6, 7 }));
+        EXPECT_EQ(dual.modelName(), "Test CPU @ 2.00GHz");
+        EXPECT_EQ(dual.describe(), "2 nodes, 8 cpus (node0: 0-1,4-5 16.0 GiB, node1: 2-3,6-7 16.0 GiB)");
+
+        // Compact keeps siblings together and fills node 0 first, scatter alternates nodes and cores.
+        EXPECT_EQ(dual.placeThreads(8, ct::Topology::Placement::Compact), (std::vector<unsigned>{ 0, 4, 1, 5, 2, 6, 3, 7 }));
+        EXPECT_EQ(dual.placeThreads(8, ct::Topology::Placement::Scatter), (std::vector<unsigned>{ 0, 2, 1, 3, 4, 6, 5, 7 }));
+        EXPECT_EQ(dual.placeThreads(10, ct::Topology::Placement::Scatter)[9], 2u);
+
+        // Each node gets one contiguous block.
+        const auto partition = ct::numaPartition(dual, 800, 4, ct::Topology::Placement::Scatter, 1);
+        ASSERT_EQ(partition.size(), 4u);
+        EXPECT_EQ(partition[0].cpu, 0u);
+        EXPECT_EQ(partition[1].cpu, 1u);
+        EXPECT_EQ(partition[2].cpu, 2u);
+        EXPECT_EQ(partition[1].node, 0u);
+        EXPECT_EQ(partition[2].node, 1u);
+        EXPECT_EQ(partition[2].begin, 400u);
+        EXPECT_EQ(partition[3].end, 800u);
+        EXPECT_EQ(ct::numaPartition(dual, 10, 4).size(), 1u);
+
+        // No /sys, ids from /proc/cpuinfo.
+        const auto fallback = std::filesystem::temp_directory_path() / "ct_numa_cpuinfo";
+        write_file(fallback / "cpuinfo", "processor\t: 0\nphysical id\t: 0\ncore id\t\t: 0\n\nprocessor\t: 1\nphysical id\t: 1\ncore id\t\t: 3\n");
+        const auto single = ct::Topology::fromFiles((fallback / "missing").string(), (fallback / "cpuinfo").string());
+        ASSERT_EQ(single.nodeCount(), 1u);
+        ASSERT_EQ(single.cpus().size(), 2u);
+        EXPECT_EQ(single.cpus()[1].package, 1u);
+        EXPECT_EQ(single.cpus()[1].core, 3u);
+        EXPECT_EQ(single.nodes()[0].cpus, (std::vector<unsigned>{ 0, 1 }));
+        std::filesystem::remove_all(fallback);
+
+        // This machine, a single node VM works as well.
+        const auto topology = ct::Topology::detect();
+        ASSERT_GE(topology.nodeCount(), 1u);
+        ASSERT_GE(topology.allowedCpuCount(), 1u);
+        const unsigned cpu = topology.placeThreads(1, ct::Topology::Placement::Compact)[0];
+        {
+            ct::ScopedAffinity pin(cpu);
+#if defined(__linux__)
+            EXPECT_TRUE(pin.isPinned());
+            EXPECT_EQ(ct::currentCpu(), static_cast<int>(cpu));
+#endif
+        }
+
+        // Pages are placed on touch, on the bound node.
+        ct::NumaBuffer<int> buffer(1 << 16);
+        ASSERT_EQ(buffer.size(), 1u << 16);
+        const unsigned node = topology.nodes()[0].id;
+        if (ct::numa::isAvailable())
+        {
+            EXPECT_TRUE(buffer.bindToNode(node));
+            EXPECT_EQ(ct::numa::nodeOfAddress(buffer.data()), -1);
+            std::fill(buffer.begin(), buffer.end(), 7);
+            EXPECT_EQ(ct::numa::nodeOfAddress(buffer.data()), static_cast<int>(node));
+            EXPECT_EQ(ct::numa::nodeOfAddress(&buffer[buffer.size() - 1]), static_cast<int>(node));
+        }
+        EXPECT_FALSE(ct::numa::setMemoryPolicy(buffer.data(), buffer.size() * sizeof(int), ct::numa::Policy::Bind, {}));
+
+        // First touch and reduce with the same partition.
+        ct::NumaBuffer<int> values(100000);
+        const auto ranges = ct::numaPartition(topology, values.size(), 0, ct::Topology::Placement::Compact, 1000);
+        ct::firstTouch(values.data(), ranges, 3);
+        const long sum = ct::numaParallelReduce(ranges, 0l, [&values](size_t begin, size_t end) { return std::accumulate(values.begin() + begin, values.begin() + end, 0l); }, std::plus<>());
+        EXPECT_EQ(sum, 300000);
+        EXPECT_EQ(ct::numaParallelReduce(ct::numaPartition(topology, 0), 5, [](size_t, size_t) { return 0; }, std::plus<>()), 5);
+
+        // Scans with the partition, the ranges of the fake machine included.
+        std::vector<int> lengths(100000);
+        std::iota(lengths.begin(), lengths.end(), -500);
+        std::vector<int> expected(lengths.size());
+        std::vector<int> scanned(lengths.size());
+        std::partial_sum(lengths.begin(), lengths.end(), expected.begin());
+        for (const auto& partition : { ranges, ct::numaPartition(dual, lengths.size(), 4, ct::Topology::Placement::Scatter, 1) })
+        {
+            EXPECT_EQ(ct::inclusiveScanParallel(partition, lengths.data(), lengths.data() + lengths.size(), scanned.data()), scanned.data() + scanned.size());
+            EXPECT_EQ(scanned, expected);
+            ct::exclusiveScanParallel(partition, lengths.data(), lengths.data() + lengths.size(), scanned.data(), 7);
+            EXPECT_EQ(scanned[0], 7);
+            EXPECT_EQ(scanned.back(), expected[expected.size() - 2] + 7);
+        }
+        ct::inclusiveScanParallel(ct::numaPartition(topology, 0), lengths.data(), lengths.data(), scanned.data());
+
+        ct::NumaBuffer<int> moved = std::move(values);
+        EXPECT_EQ(moved.size(), 100000u);
+        EXPECT_TRUE(values.empty());
+    }
+
+    std::filesystem::remove_all(root);
+}
+
+BENCHMARK(benchmark_sum_serial_touch)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(benchmark_sum_first_touch)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(benchmark_sum_interleaved)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(benchmark_scan_serial_touch)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(benchmark_scan_first_touch)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(benchmark_numa_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
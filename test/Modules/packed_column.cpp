@@ -0,0 +1,315 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Compressed integer columns (modules/PackedColumn)
+
+ The int columns of test/Pluralsight/stl_algorithms.cpp hold small values in 32 bits. A metric
+ column in [-50, 50] packs into 7 bits per value and a sorted id column with small gaps into
+ a few bits of differences. The scans read 4 - 8 times fewer bytes: count and sum work in the
+ registers the unpacking fills, min and max read the block headers only, find skips all blocks
+ which can not hold the value.
+
+ run: ./test/packed_column
+*/
+
+// C++ headers
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "PackedColumn.hpp"
+#include "Random.hpp"
+
+constexpr size_t value_count = 1 << 22;
+
+// Random values in [low, high].
+static std::vector<int32_t>
+metric_values(size_t count, int32_t low, int32_t high, uint64_t seed)
+{
+    ct::Xoshiro256StarStar generator(seed);
+    std::vector<int32_t> values(count);
+    for (auto& value : values)
+        value = ct::uniformInt(generator, low, high);
+    return values;
+}
+
+// Increasing ids with gaps of 1 to 8.
+static std::vector<int32_t>
+id_values(size_t count, uint64_t seed)
+{
+    ct::Xoshiro256StarStar generator(seed);
+    std::vector<int32_t> values(count);
+    int32_t id = 1000;
+    for (auto& value : values)
+    {
+        id += ct::uniformInt(generator, 1, 8);
+        value = id;
+    }
+    return values;
+}
+
+static size_t
+count_between(const std::vector<int32_t>& values, int32_t low, int32_t high)
+{
+    return static_cast<size_t>(std::count_if(values.begin(), values.end(), [low, high](int32_t value) { return low <= value && value <= high; }));
+}
+
+static void
+set_bytes_per_value(benchmark::State& state, size_t bytes)
+{
+    state.counters["bytes_per_value"] = static_cast<double>(bytes) / static_cast<double>(value_count);
+}
+
+static void
+benchmark_count_vector(benchmark::State& state)
+{
+    const std::vector<int32_t> values = metric_values(value_count, -50, 50, 1);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(count_between(values, -10, 10));
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * value_count));
+    set_bytes_per_value(state, values.size() * sizeof(int32_t));
+}
+
+static void
+benchmark_count_packed(benchmark::State& state)
+{
+    const std::vector<int32_t> values = metric_values(value_count, -50, 50, 1);
+    const ct::PackedColumn column(values);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(column.countBetween(-10, 10));
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * value_count));
+    set_bytes_per_value(state, column.packedBytes());
+    EXPECT_EQ(column.countBetween(-10, 10), count_between(values, -10, 10));
+}
+
+static void
+benchmark_sum_vector(benchmark::State& state)
+{
+    const std::vector<int32_t> values = metric_values(value_count, -50, 50, 2);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::accumulate(values.begin(), values.end(), int64_t{ 0 }));
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * value_count));
+    set_bytes_per_value(state, values.size() * sizeof(int32_t));
+}
+
+static void
+benchmark_sum_packed(benchmark::State& state)
+{
+    const std::vector<int32_t> values = metric_values(value_count, -50, 50, 2);
+    const ct::PackedColumn column(values);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(column.sum());
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * value_count));
+    set_bytes_per_value(state, column.packedBytes());
+    EXPECT_EQ(column.sum(), std::accumulate(values.begin(), values.end(), int64_t{ 0 }));
+}
+
+// Sorted ids, the last one is searched.
+static void
+benchmark_find_id_vector(benchmark::State& state)
+{
+    const std::vector<int32_t> ids = id_values(value_count, 3);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::find(ids.begin(), ids.end(), ids.back()));
+
+    set_bytes_per_value(state, ids.size() * sizeof(int32_t));
+}
+
+static void
+benchmark_find_id_packed(benchmark::State& state)
+{
+    const std::vector<int32_t> ids = id_values(value_count, 3);
+    const ct::PackedColumn column(ids);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(column.find(ids.back()));
+
+    set_bytes_per_value(state, column.packedBytes());
+    EXPECT_EQ(column.find(ids.back()), value_count - 1);
+}
+
+static void
+benchmark_min_max_vector(benchmark::State& state)
+{
+    const std::vector<int32_t> values = metric_values(value_count, -50, 50, 4);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::minmax_element(values.begin(), values.end()));
+
+    set_bytes_per_value(state, values.size() * sizeof(int32_t));
+}
+
+static void
+benchmark_min_max_packed(benchmark::State& state)
+{
+    const std::vector<int32_t> values = metric_values(value_count, -50, 50, 4);
+    const ct::PackedColumn column(values);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::make_pair(column.min(), column.max()));
+
+    set_bytes_per_value(state, column.packedBytes());
+    EXPECT_EQ(column.min(), -50);
+    EXPECT_EQ(column.max(), 50);
+}
+
+// Unpacking to 32 bit, against copying the uncompressed column.
+static void
+benchmark_decode(benchmark::State& state)
+{
+    const bool ids = state.range(0) != 0;
+    const std::vector<int32_t> values = ids ? id_values(value_count, 5) : metric_values(value_count, -50, 50, 5);
+    const ct::PackedColumn column(values);
+    std::vector<int32_t> decoded(value_count);
+
+    for (auto _ : state)
+    {
+        column.decode(decoded.data());
+        benchmark::DoNotOptimize(decoded.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * value_count));
+    state.SetLabel(ids ? "delta ids" : "frame of reference metrics");
+    set_bytes_per_value(state, column.packedBytes());
+    EXPECT_EQ(decoded, values);
+}
+
+static void
+benchmark_copy_vector(benchmark::State& state)
+{
+    const std::vector<int32_t> values = metric_values(value_count, -50, 50, 5);
+    std::vector<int32_t> copy(value_count);
+
+    for (auto _ : state)
+    {
+        std::copy(values.begin(), values.end(), copy.begin());
+        benchmark::DoNotOptimize(copy.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * value_count));
+}
+
+static void
+check_column(const std::vector<int32_t>& values, ct::PackedColumn::Encoding encoding)
+{
+    const ct::PackedColumn column(values, encoding);
+    ASSERT_EQ(column.size(), values.size());
+    EXPECT_EQ(column.decode(), values);
+    for (size_t i = 0; i < values.size(); i += 1 + values.size() / 97)
+        EXPECT_EQ(column.at(i), values[i]);
+    if (!values.empty())
+    {
+        EXPECT_EQ(column.at(values.size() - 1), values.back());
+        EXPECT_EQ(column.min(), *std::min_element(values.begin(), values.end()));
+        EXPECT_EQ(column.max(), *std::max_element(values.begin(), values.end()));
+        EXPECT_EQ(column.find(values.back()), static_cast<size_t>(std::find(values.begin(), values.end(), values.back()) - values.begin()));
+    }
+    EXPECT_EQ(column.sum(), std::accumulate(values.begin(), values.end(), int64_t{ 0 }));
+
+    constexpr int32_t lowest = std::numeric_limits<int32_t>::min();
+    constexpr int32_t highest = std::numeric_limits<int32_t>::max();
+    for (auto [low, high] : { std::pair{ -10, 10 }, std::pair{ 0, 0 }, std::pair{ lowest, highest }, std::pair{ lowest, -1 }, std::pair{ 5, 1 } })
+        EXPECT_EQ(column.countBetween(low, high), low <= high ? count_between(values, low, high) : 0u);
+    EXPECT_EQ(column.countLess(0), count_between(values, lowest, -1));
+    EXPECT_EQ(column.countGreater(0), count_between(values, 1, highest));
+    EXPECT_EQ(column.countEqual(7), count_between(values, 7, 7));
+    EXPECT_EQ(column.countLess(lowest), 0u);
+    EXPECT_EQ(column.countGreater(highest), 0u);
+}
+
+static void
+benchmark_packed_column_edge_cases(benchmark::State& state)
+{
+    using Encoding = ct::PackedColumn::Encoding;
+    constexpr int32_t lowest = std::numeric_limits<int32_t>::min();
+    constexpr int32_t highest = std::numeric_limits<int32_t>::max();
+
+    for (auto _ : state)
+    {
+        // Empty, one value, partial blocks, constant (0 bit) blocks and full 32 bit ranges.
+        for (Encoding encoding : { Encoding::FrameOfReference, Encoding::Delta, Encoding::Auto })
+        {
+            check_column({}, encoding);
+            check_column({ 42 }, encoding);
+            check_column(metric_values(1000, -50, 50, 6), encoding);
+            check_column(std::vector<int32_t>(700, -3), encoding);
+            check_column({ lowest, highest, 0, -1, 1, highest, lowest }, encoding);
+            check_column(metric_values(3000, lowest, highest, 7), encoding);
+            check_column(id_values(5000, 8), encoding);
+            for (unsigned bits = 1; bits <= 31; bits += 3)
+                check_column(metric_values(600, 0, (1 << bits) - 1, bits), encoding);
+
+            // Decreasing values, negative differences.
+            std::vector<int32_t> decreasing = id_values(1000, 9);
+            std::reverse(decreasing.begin(), decreasing.end());
+            check_column(decreasing, encoding);
+        }
+
+        // Auto picks delta for ids and frame of reference for random metrics.
+        const ct::PackedColumn ids(id_values(4096, 10));
+        EXPECT_TRUE(std::all_of(ids.blocks().begin(), ids.blocks().end(), [](const auto& block) { return block.delta && block.bits <= 3; }));
+        const ct::PackedColumn metrics(metric_values(4096, -50, 50, 11));
+        EXPECT_TRUE(std::none_of(metrics.blocks().begin(), metrics.blocks().end(), [](const auto& block) { return block.delta; }));
+        EXPECT_EQ(metrics.blocks()[0].bits, 7);
+        // A quarter of the memory or less.
+        EXPECT_LT(metrics.packedBytes() * 4, 4096 * sizeof(int32_t));
+        EXPECT_LT(ids.packedBytes() * 8, 4096 * sizeof(int32_t));
+
+        // Delta does not fit a range over 2^31, the block falls back to frame of reference.
+        const ct::PackedColumn wide({ lowest, highest }, Encoding::Delta);
+        EXPECT_FALSE(wide.blocks()[0].delta);
+        EXPECT_EQ(wide.at(1), highest);
+
+        // Searches which are not found.
+        const ct::PackedColumn column(metric_values(1000, -50, 50, 12));
+        EXPECT_EQ(column.find(51), column.size());
+        EXPECT_EQ(column.countBetween(51, 100), 0u);
+        EXPECT_EQ(column.countBetween(-50, 50), column.size());
+        EXPECT_EQ(ct::PackedColumn().find(0), 0u);
+    }
+}
+
+BENCHMARK(benchmark_count_vector);
+BENCHMARK(benchmark_count_packed);
+BENCHMARK(benchmark_sum_vector);
+BENCHMARK(benchmark_sum_packed);
+BENCHMARK(benchmark_find_id_vector);
+BENCHMARK(benchmark_find_id_packed);
+BENCHMARK(benchmark_min_max_vector);
+BENCHMARK(benchmark_min_max_packed);
+BENCHMARK(benchmark_copy_vector);
+BENCHMARK(benchmark_decode)->Arg(0)->Arg(1);
+BENCHMARK(benchmark_packed_column_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
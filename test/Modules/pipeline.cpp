@@ -0,0 +1,197 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ Fused lazy pipeline (modules/Pipeline)
+
+ stl_algorithms chains copy_if, transform and accumulate through full temporary
+ vectors. ct::from(v) | filter | transform | take | reduce does the same in one pass.
+
+ run: ./test/pipeline
+*/
+
+// C++ headers
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <vector>
+#include <string>
+#include <iterator>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "Pipeline.hpp"
+
+static std::vector<int>
+make_data(size_t size)
+{
+    std::vector<int> data(size);
+    std::iota(data.begin(), data.end(), -static_cast<int>(size / 2));
+    return data;
+}
+
+// Lambdas, not functions. A function pointer is called indirectly and the stages are not inlined.
+static const auto is_even = [](int element) { return element % 2 == 0; };
+static const auto twice = [](int element) { return 2LL * element; };
+
+// The way stl_algorithms does it: every stage is a full pass and a temporary vector.
+static long long
+multi_pass(const std::vector<int>& v)
+{
+    std::vector<int> v4;
+    std::copy_if(std::begin(v), std::end(v), std::back_inserter(v4), is_even);
+
+    std::vector<long long> v2;
+    std::transform(v4.begin(), v4.end(), std::back_inserter(v2), twice);
+
+    return std::accumulate(v2.begin(), v2.end(), 0LL);
+}
+
+static void
+benchmark_multi_pass(benchmark::State& state)
+{
+    std::vector<int> v = make_data(state.range(0));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(multi_pass(v));
+    }
+
+    state.SetBytesProcessed(state.iterations() * v.size() * sizeof(int));
+}
+
+static void
+benchmark_hand_written_loop(benchmark::State& state)
+{
+    std::vector<int> v = make_data(state.range(0));
+
+    for (auto _ : state)
+    {
+        long long sum = 0;
+        for (int element : v)
+        {
+            if (is_even(element))
+                sum += twice(element);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() * v.size() * sizeof(int));
+}
+
+static void
+benchmark_fused(benchmark::State& state)
+{
+    std::vector<int> v = make_data(state.range(0));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::from(v) | ct::filter(is_even) | ct::transform(twice) | ct::reduce(0LL, std::plus<>()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * v.size() * sizeof(int));
+
+    auto sum = ct::from(v) | ct::filter(is_even) | ct::transform(twice) | ct::reduce(0LL, std::plus<>());
+    EXPECT_EQ(sum, multi_pass(v));
+}
+
+static void
+benchmark_fused_parallel(benchmark::State& state)
+{
+    std::vector<int> v = make_data(state.range(0));
+    auto pipeline = ct::from(v) | ct::filter(is_even) | ct::transform(twice);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(pipeline.reduceParallel(0LL, std::plus<>()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * v.size() * sizeof(int));
+
+    EXPECT_EQ(pipeline.reduceParallel(0LL, std::plus<>()), multi_pass(v));
+    // More threads than cores and tiny chunks, still the same result.
+    EXPECT_EQ(pipeline.reduceParallel(0LL, std::plus<>(), 7, 1000), multi_pass(v));
+}
+
+// take() stops reading the input, the rest of the range is never touched.
+static void
+benchmark_fused_take(benchmark::State& state)
+{
+    std::vector<int> v = make_data(state.range(0));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::from(v) | ct::filter(is_even) | ct::take(100) | ct::reduce(0LL, std::plus<>()));
+    }
+
+    std::vector<int> v4;
+    std::copy_if(std::begin(v), std::end(v), std::back_inserter(v4), is_even);
+    auto expected = std::accumulate(v4.begin(), v4.begin() + 100, 0LL);
+
+    auto sum = ct::from(v) | ct::filter(is_even) | ct::take(100) | ct::reduce(0LL, std::plus<>());
+    EXPECT_EQ(sum, expected);
+
+    // Sequential fallback, take depends on the order.
+    auto parallelSum = (ct::from(v) | ct::filter(is_even) | ct::take(100)).reduceParallel(0LL, std::plus<>(), 4, 1);
+    EXPECT_EQ(parallelSum, expected);
+}
+
+static void
+benchmark_pipeline_terminals(benchmark::State& state)
+{
+    const std::vector<int> v{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize((ct::from(v) | ct::filter(is_even)).count());
+    }
+
+    EXPECT_EQ((ct::from(v) | ct::filter(is_even)).count(), 5);
+    EXPECT_EQ((ct::from(v) | ct::take(0)).count(), 0);
+    EXPECT_EQ((ct::from(v) | ct::take(20)).count(), 10);
+
+    // Transform can change the element type.
+    std::vector<std::string> words = ct::from(v)
+        | ct::filter([](int i) { return i > 7; })
+        | ct::transform([](int i) { return std::to_string(i); })
+        | ct::toVector();
+    EXPECT_EQ(words, (std::vector<std::string>{ "8", "9", "10" }));
+
+    // Stages can repeat in any order.
+    std::vector<int> result = ct::from(v.begin(), v.end())
+        | ct::transform([](int i) { return i * 3; })
+        | ct::filter(is_even)
+        | ct::take(3)
+        | ct::transform([](int i) { return i + 1; })
+        | ct::toVector();
+    EXPECT_EQ(result, (std::vector<int>{ 7, 13, 19 }));
+
+    int visited = 0;
+    (ct::from(v) | ct::take(4)).forEach([&visited](int) { visited++; });
+    EXPECT_EQ(visited, 4);
+}
+
+BENCHMARK(benchmark_multi_pass)->Arg(1 << 16)->Arg(1 << 22);
+BENCHMARK(benchmark_hand_written_loop)->Arg(1 << 16)->Arg(1 << 22);
+BENCHMARK(benchmark_fused)->Arg(1 << 16)->Arg(1 << 22);
+BENCHMARK(benchmark_fused_parallel)->Arg(1 << 16)->Arg(1 << 22)->UseRealTime();
+BENCHMARK(benchmark_fused_take)->Arg(1 << 16);
+BENCHMARK(benchmark_pipeline_terminals)->Iterations(1000);
+
+BENCHMARK_MAIN();
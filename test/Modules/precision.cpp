@@ -0,0 +1,297 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+
+/*
+ Precision policies (modules/Precision)
+
+ Length and normalize of TemplateClass vectors with Exact (sqrt), RsqrtNewton (rsqrtps and
+ one Newton step), Squared (no root) and Polynomial (minimax polynomial on the mantissa).
+ The tests check maxRelativeError of every policy on every float mantissa. Argument: vectors,
+ AoS scalar loop against the SoA batch functions.
+
+ run: ./test/precision
+*/
+
+// C++ headers
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "Precision.hpp"
+#include "Random.hpp"
+
+using namespace ct::precision;
+
+struct Vector3
+{
+    float x;
+    float y;
+    float z;
+};
+
+struct Arrays
+{
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> zs;
+};
+
+static std::vector<Vector3>
+random_vectors(size_t count, uint64_t seed)
+{
+    ct::Xoshiro256StarStar generator(seed);
+    std::vector<Vector3> vectors(count);
+    for (Vector3& vector : vectors)
+    {
+        vector.x = static_cast<float>(ct::uniformReal(generator) * 200.0 - 100.0);
+        vector.y = static_cast<float>(ct::uniformReal(generator) * 200.0 - 100.0);
+        vector.z = static_cast<float>(ct::uniformReal(generator) * 200.0 - 100.0);
+    }
+    return vectors;
+}
+
+static Arrays
+to_arrays(const std::vector<Vector3>& vectors)
+{
+    Arrays arrays;
+    for (const Vector3& vector : vectors)
+    {
+        arrays.xs.push_back(vector.x);
+        arrays.ys.push_back(vector.y);
+        arrays.zs.push_back(vector.z);
+    }
+    return arrays;
+}
+
+static float
+from_bits(uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// The largest |result / exact - 1| of length() and inverseLength() over the mantissas of [1, 4)
+// times 2^(2 * shift) for each shift, every 'stride'-th one.
+template <typename Policy>
+static void
+sweep_mantissas(uint32_t stride, double& length_error, double& inverse_error)
+{
+    length_error = 0;
+    inverse_error = 0;
+    for (int shift : { -60, -10, 0, 1, 25, 60 })
+    {
+        const uint32_t first = static_cast<uint32_t>(127 + 2 * shift) << 23;
+        for (uint32_t bits = first; bits < first + (2u << 23); bits += stride)
+        {
+            const float squared = from_bits(bits);
+            const double exact = std::sqrt(static_cast<double>(squared));
+            length_error = std::max(length_error, std::fabs(Policy::length(squared) / exact - 1.0));
+            inverse_error = std::max(inverse_error, std::fabs(Policy::inverseLength(squared) * exact - 1.0));
+        }
+    }
+}
+
+template <typename Policy>
+static void
+check_bounds(uint32_t stride)
+{
+    double length_error, inverse_error;
+    sweep_mantissas<Policy>(stride, length_error, inverse_error);
+    EXPECT_LE(length_error, Policy::maxRelativeError);
+    EXPECT_LE(inverse_error, Policy::maxRelativeError);
+}
+
+template <typename Policy>
+static void
+check_policy()
+{
+    check_bounds<Policy>(101);
+
+    EXPECT_EQ(Policy::length(0.0f), 0.0f);
+    // Infinity, or NaN from the Newton step.
+    EXPECT_FALSE(std::isfinite(Policy::inverseLength(0.0f)));
+
+    // Lengths from coordinates add the rounding of the sum of squares.
+    for (const Vector3& vector : random_vectors(2000, 1))
+    {
+        const double exact = std::sqrt(double(vector.x) * vector.x + double(vector.y) * vector.y + double(vector.z) * vector.z);
+        EXPECT_NEAR(length<Policy>(vector.x, vector.y, vector.z) / exact, 1.0, Policy::maxRelativeError + 2e-7);
+        float x = vector.x, y = vector.y, z = vector.z;
+        normalize<Policy>(x, y, z);
+        EXPECT_NEAR(std::sqrt(double(x) * x + double(y) * y + double(z) * z), 1.0, Policy::maxRelativeError + 4e-7);
+    }
+}
+
+// The batch functions give the scalar results, 1003 vectors leave a tail after the SIMD steps.
+template <typename Policy>
+static void
+check_batch()
+{
+    const std::vector<Vector3> vectors = random_vectors(1003, 3);
+    Arrays arrays = to_arrays(vectors);
+    std::vector<float> out(vectors.size());
+    lengths<Policy>(arrays.xs.data(), arrays.ys.data(), arrays.zs.data(), out.data(), vectors.size());
+    normalize<Policy>(arrays.xs.data(), arrays.ys.data(), arrays.zs.data(), vectors.size());
+    for (size_t i = 0; i < vectors.size(); i++)
+    {
+        float x = vectors[i].x, y = vectors[i].y, z = vectors[i].z;
+        EXPECT_EQ(out[i], length<Policy>(x, y, z));
+        normalize<Policy>(x, y, z);
+        EXPECT_EQ(arrays.xs[i], x);
+        EXPECT_EQ(arrays.ys[i], y);
+        EXPECT_EQ(arrays.zs[i], z);
+    }
+}
+
+static void
+check_precision()
+{
+    check_policy<Exact>();
+    check_policy<RsqrtNewton>();
+    check_policy<Polynomial>();
+    EXPECT_EQ(Exact::length(2.0), std::sqrt(2.0));
+
+    EXPECT_EQ(length<Squared>(1.0f, 2.0f, 2.0f), 9.0f);
+    float x = 3.0f, y = 0.0f, z = 4.0f;
+    normalize<Squared>(x, y, z);
+    EXPECT_FLOAT_EQ(x, 0.6f);
+    EXPECT_FLOAT_EQ(z, 0.8f);
+    // Keeps the order of the exact lengths.
+    const std::vector<Vector3> vectors = random_vectors(1000, 2);
+    for (size_t i = 1; i < vectors.size(); i++)
+    {
+        const Vector3& a = vectors[i - 1];
+        const Vector3& b = vectors[i];
+        EXPECT_EQ(length<Squared>(a.x, a.y, a.z) < length<Squared>(b.x, b.y, b.z), length<Exact>(a.x, a.y, a.z) < length<Exact>(b.x, b.y, b.z));
+    }
+
+    check_batch<Exact>();
+    check_batch<RsqrtNewton>();
+    check_batch<Squared>();
+    check_batch<Polynomial>();
+}
+
+template <typename Policy>
+static void
+benchmark_length_scalar(benchmark::State& state)
+{
+    const std::vector<Vector3> vectors = random_vectors(static_cast<size_t>(state.range(0)), 4);
+    std::vector<float> out(vectors.size());
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < vectors.size(); i++)
+            out[i] = length<Policy>(vectors[i].x, vectors[i].y, vectors[i].z);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Policy>
+static void
+benchmark_length_batch(benchmark::State& state)
+{
+    const Arrays arrays = to_arrays(random_vectors(static_cast<size_t>(state.range(0)), 4));
+    std::vector<float> out(arrays.xs.size());
+    for (auto _ : state)
+    {
+        lengths<Policy>(arrays.xs.data(), arrays.ys.data(), arrays.zs.data(), out.data(), out.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Policy>
+static void
+benchmark_normalize_scalar(benchmark::State& state)
+{
+    const std::vector<Vector3> source = random_vectors(static_cast<size_t>(state.range(0)), 5);
+    std::vector<Vector3> vectors = source;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        vectors = source;
+        state.ResumeTiming();
+        for (Vector3& vector : vectors)
+            normalize<Policy>(vector.x, vector.y, vector.z);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Policy>
+static void
+benchmark_normalize_batch(benchmark::State& state)
+{
+    const Arrays source = to_arrays(random_vectors(static_cast<size_t>(state.range(0)), 5));
+    Arrays arrays = source;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        arrays = source;
+        state.ResumeTiming();
+        normalize<Policy>(arrays.xs.data(), arrays.ys.data(), arrays.zs.data(), arrays.xs.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(benchmark_length_scalar, Exact)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_length_scalar, RsqrtNewton)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_length_scalar, Squared)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_length_scalar, Polynomial)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_length_batch, Exact)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_length_batch, RsqrtNewton)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_length_batch, Squared)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_length_batch, Polynomial)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_normalize_scalar, Exact)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_normalize_scalar, RsqrtNewton)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_normalize_scalar, Polynomial)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_normalize_batch, Exact)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_normalize_batch, RsqrtNewton)->Arg(4096);
+BENCHMARK_TEMPLATE(benchmark_normalize_batch, Polynomial)->Arg(4096);
+
+// Every mantissa once, the edge cases check a sample of them.
+static void
+benchmark_mantissa_sweep(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        check_bounds<Exact>(1);
+        check_bounds<RsqrtNewton>(1);
+        check_bounds<Polynomial>(1);
+    }
+}
+
+static void
+benchmark_precision_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+        check_precision();
+}
+BENCHMARK(benchmark_mantissa_sweep)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_precision_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
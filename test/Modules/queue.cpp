@@ -0,0 +1,318 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Bounded queues between threads (modules/Queue)
+
+ LessonOne refresh threads hand work over with a queue. MpmcQueue is Vyukov's ring
+ with one CAS per element, SpscQueue a Lamport ring without CAS, both compared with
+ std::queue behind a mutex and condition variables. Throughput arguments: messages,
+ producers, consumers. Blocking operations spin, yield and then sleep on a futex.
+
+ run: ./test/queue
+*/
+
+// C++ headers
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "MpmcQueue.hpp"
+#include "SpscQueue.hpp"
+
+// Baseline, bounded std::queue behind a mutex with the blocking part of the queue interface.
+template <typename T>
+class MutexQueue
+{
+public:
+    explicit MutexQueue(size_t _capacity) : capacity(_capacity) {}
+
+    void push(const T& value)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this]() { return values.size() < capacity; });
+            values.push(value);
+        }
+        notEmpty.notify_one();
+    }
+
+    T pop()
+    {
+        T value;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this]() { return !values.empty(); });
+            value = values.front();
+            values.pop();
+        }
+        notFull.notify_one();
+        return value;
+    }
+
+    void pushBatch(const T* batch, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            push(batch[i]);
+    }
+
+    size_t popBatch(T* batch, size_t count)
+    {
+        size_t popped = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this]() { return !values.empty(); });
+            for (; popped < count && !values.empty(); popped++)
+            {
+                batch[popped] = values.front();
+                values.pop();
+            }
+        }
+        notFull.notify_all();
+        return popped;
+    }
+
+private:
+    size_t capacity;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::queue<T> values;
+};
+
+constexpr size_t queue_capacity = 1024;
+constexpr size_t batch_size = 64;
+
+// Every producer pushes its share of 1..messages, every consumer pops its share, returns the sum popped.
+template <typename Queue>
+static uint64_t
+transfer(Queue& queue, size_t messages, unsigned producers, unsigned consumers, bool batched)
+{
+    std::atomic<uint64_t> sum{ 0 };
+    std::vector<std::thread> threads;
+
+    for (unsigned p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&queue, messages, producers, batched, p]() {
+            const uint64_t begin = messages * p / producers;
+            const uint64_t end = messages * (p + 1) / producers;
+            if (!batched)
+            {
+                for (uint64_t i = begin; i < end; i++)
+                    queue.push(i + 1);
+                return;
+            }
+            uint64_t batch[batch_size];
+            for (uint64_t i = begin; i < end; i += batch_size)
+            {
+                const size_t count = static_cast<size_t>(std::min<uint64_t>(batch_size, end - i));
+                for (size_t j = 0; j < count; j++)
+                    batch[j] = i + j + 1;
+                queue.pushBatch(batch, count);
+            }
+        });
+    }
+
+    for (unsigned c = 0; c < consumers; c++)
+    {
+        threads.emplace_back([&queue, &sum, messages, consumers, batched, c]() {
+            size_t remaining = messages * (c + 1) / consumers - messages * c / consumers;
+            uint64_t local = 0;
+            if (!batched)
+            {
+                for (; remaining > 0; remaining--)
+                    local += queue.pop();
+            }
+            else
+            {
+                uint64_t batch[batch_size];
+                while (remaining > 0)
+                {
+                    const size_t popped = queue.popBatch(batch, std::min(batch_size, remaining));
+                    for (size_t j = 0; j < popped; j++)
+                        local += batch[j];
+                    remaining -= popped;
+                }
+            }
+            sum.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+    return sum.load();
+}
+
+template <typename Queue, bool batched>
+static void
+benchmark_throughput(benchmark::State& state)
+{
+    const size_t messages = static_cast<size_t>(state.range(0));
+    const unsigned producers = static_cast<unsigned>(state.range(1));
+    const unsigned consumers = static_cast<unsigned>(state.range(2));
+    Queue queue(queue_capacity);
+
+    uint64_t sum = 0;
+    for (auto _ : state)
+    {
+        sum = transfer(queue, messages, producers, consumers, batched);
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * messages));
+    EXPECT_EQ(sum, uint64_t(messages) * (messages + 1) / 2);
+}
+
+// Round trip of one message to an echo thread and back, the latency of a handover.
+template <typename Queue>
+static void
+benchmark_ping_pong(benchmark::State& state)
+{
+    Queue ping(queue_capacity);
+    Queue pong(queue_capacity);
+
+    std::thread echo([&ping, &pong]() {
+        while (true)
+        {
+            const uint64_t value = ping.pop();
+            if (value == 0)
+                return;
+            pong.push(value + 1);
+        }
+    });
+
+    uint64_t value = 1;
+    for (auto _ : state)
+    {
+        ping.push(value);
+        value = pong.pop();
+    }
+    ping.push(uint64_t{ 0 });
+    echo.join();
+
+    EXPECT_EQ(value, uint64_t(state.iterations()) + 1);
+}
+
+template <typename Queue>
+static void
+check_single_thread(Queue& queue)
+{
+    EXPECT_EQ(queue.capacity(), 8u);
+
+    int value = -1;
+    EXPECT_FALSE(queue.tryPop(value));
+    EXPECT_EQ(value, -1);
+
+    // FIFO over many laps around the ring.
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_TRUE(queue.tryPush(i));
+        EXPECT_TRUE(queue.tryPush(i + 1000));
+        EXPECT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(value, i);
+        EXPECT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(value, i + 1000);
+    }
+
+    for (int i = 0; i < 8; i++)
+        EXPECT_TRUE(queue.tryPush(i));
+    EXPECT_FALSE(queue.tryPush(8));
+    EXPECT_EQ(queue.size(), 8u);
+
+    // A batch takes what fits.
+    int batch[8];
+    EXPECT_EQ(queue.tryPopBatch(batch, 3), 3u);
+    EXPECT_EQ(batch[0], 0);
+    EXPECT_EQ(batch[2], 2);
+    const int more[5] = { 8, 9, 10, 11, 12 };
+    EXPECT_EQ(queue.tryPushBatch(more, 5), 3u);
+    EXPECT_EQ(queue.tryPushBatch(more + 3, 2), 0u);
+
+    EXPECT_EQ(queue.tryPopBatch(batch, 8), 8u);
+    for (int i = 0; i < 8; i++)
+        EXPECT_EQ(batch[i], i + 3);
+    EXPECT_EQ(queue.tryPopBatch(batch, 8), 0u);
+    EXPECT_EQ(queue.size(), 0u);
+}
+
+static void
+benchmark_queue_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        ct::MpmcQueue<int> mpmc(5);
+        check_single_thread(mpmc);
+        ct::SpscQueue<int> spsc(8);
+        check_single_thread(spsc);
+    }
+
+    // Values which own memory are moved through the queue.
+    ct::MpmcQueue<std::string> strings(4);
+    strings.push(std::string(100, 'a'));
+    EXPECT_EQ(strings.pop(), std::string(100, 'a'));
+
+    // The producer blocks on a full queue until the consumer makes room, order is kept.
+    for (auto strategy : { ct::WaitStrategy::SpinYield, ct::WaitStrategy::SpinYieldBlock })
+    {
+        ct::SpscQueue<int> spsc(2, strategy);
+        std::thread producer([&spsc]() {
+            for (int i = 0; i < 10000; i++)
+                spsc.push(i);
+        });
+        bool ordered = true;
+        for (int i = 0; i < 10000; i++)
+            ordered &= spsc.pop() == i;
+        producer.join();
+        EXPECT_TRUE(ordered);
+
+        // Every value arrives exactly once with two producers and two consumers on a tiny ring.
+        ct::MpmcQueue<uint64_t> mpmc(2, strategy);
+        EXPECT_EQ(transfer(mpmc, 20000, 2, 2, false), uint64_t(20000) * 20001 / 2);
+        EXPECT_EQ(transfer(mpmc, 20000, 2, 2, true), uint64_t(20000) * 20001 / 2);
+    }
+}
+
+static void
+producers_consumers(benchmark::internal::Benchmark* benchmark)
+{
+    for (int threads : { 1, 2, 4 })
+        benchmark->Args({ 1 << 16, threads, threads });
+}
+
+BENCHMARK_TEMPLATE(benchmark_throughput, MutexQueue<uint64_t>, false)->Apply(producers_consumers)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_throughput, ct::MpmcQueue<uint64_t>, false)->Apply(producers_consumers)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_throughput, ct::SpscQueue<uint64_t>, false)->Args({ 1 << 16, 1, 1 })->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_throughput, MutexQueue<uint64_t>, true)->Apply(producers_consumers)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_throughput, ct::MpmcQueue<uint64_t>, true)->Apply(producers_consumers)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_throughput, ct::SpscQueue<uint64_t>, true)->Args({ 1 << 16, 1, 1 })->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_ping_pong, MutexQueue<uint64_t>)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_ping_pong, ct::MpmcQueue<uint64_t>)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_ping_pong, ct::SpscQueue<uint64_t>)->UseRealTime();
+BENCHMARK(benchmark_queue_edge_cases)->Iterations(1000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,331 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Fast seeded random numbers and shuffles (modules/Random)
+
+ benchmark_shuffle_numbers shuffles with std::mt19937. Generating test data with
+ std::mt19937 and std::uniform_int_distribution costs more than the code under test,
+ xoshiro256** and PCG64 with Lemire's bounded integers are several times faster and
+ reproducible everywhere. Shuffle arguments: number of elements.
+
+ run: ./test/random
+*/
+
+// C++ headers
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "Random.hpp"
+#include "Shuffle.hpp"
+#include "SimdRandom.hpp"
+
+constexpr size_t value_count = 1 << 16;
+
+template <typename Generator>
+static void
+benchmark_generate(benchmark::State& state)
+{
+    Generator generator(42);
+    std::vector<uint64_t> values(value_count);
+    for (auto _ : state)
+    {
+        for (auto& value : values)
+            value = generator();
+        benchmark::DoNotOptimize(values.data());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value_count * sizeof(uint64_t)));
+    EXPECT_NE(values[0], values[1]);
+}
+
+static void
+benchmark_generate_simd(benchmark::State& state)
+{
+    ct::SimdXoshiro256StarStar generator(42);
+    std::vector<uint64_t> values(value_count);
+    for (auto _ : state)
+    {
+        generator.fill(values.data(), values.size());
+        benchmark::DoNotOptimize(values.data());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value_count * sizeof(uint64_t)));
+    EXPECT_NE(values[0], values[1]);
+}
+
+// Dice for test data, [0, 1000).
+static void
+benchmark_bounded_mt19937(benchmark::State& state)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<uint32_t> distribution(0, 999);
+    std::vector<uint32_t> values(value_count);
+    for (auto _ : state)
+    {
+        for (auto& value : values)
+            value = distribution(generator);
+        benchmark::DoNotOptimize(values.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * value_count));
+    EXPECT_LT(*std::max_element(values.begin(), values.end()), 1000u);
+}
+
+template <typename Generator>
+static void
+benchmark_bounded_lemire(benchmark::State& state)
+{
+    Generator generator(42);
+    std::vector<uint32_t> values(value_count);
+    for (auto _ : state)
+    {
+        for (auto& value : values)
+            value = ct::uniformInt<uint32_t>(generator, 0, 999);
+        benchmark::DoNotOptimize(values.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * value_count));
+    EXPECT_LT(*std::max_element(values.begin(), values.end()), 1000u);
+}
+
+static void
+benchmark_bounded_simd(benchmark::State& state)
+{
+    ct::SimdXoshiro256StarStar generator(42);
+    std::vector<uint32_t> values(value_count);
+    for (auto _ : state)
+    {
+        generator.fillBounded(values.data(), values.size(), 1000);
+        benchmark::DoNotOptimize(values.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * value_count));
+    EXPECT_LT(*std::max_element(values.begin(), values.end()), 1000u);
+}
+
+static std::vector<int>
+make_sequence(size_t size)
+{
+    std::vector<int> values(size);
+    std::iota(values.begin(), values.end(), 0);
+    return values;
+}
+
+static bool
+is_permutation_of_sequence(std::vector<int> values)
+{
+    std::sort(values.begin(), values.end());
+    return values == make_sequence(values.size());
+}
+
+static void
+benchmark_std_shuffle(benchmark::State& state)
+{
+    auto values = make_sequence(static_cast<size_t>(state.range(0)));
+    std::mt19937 generator(42);
+    for (auto _ : state)
+    {
+        std::shuffle(values.begin(), values.end(), generator);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+    EXPECT_TRUE(is_permutation_of_sequence(values));
+}
+
+static void
+benchmark_shuffle(benchmark::State& state)
+{
+    auto values = make_sequence(static_cast<size_t>(state.range(0)));
+    ct::Xoshiro256StarStar generator(42);
+    for (auto _ : state)
+    {
+        ct::shuffle(values.begin(), values.end(), generator);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+    EXPECT_TRUE(is_permutation_of_sequence(values));
+}
+
+static void
+benchmark_shuffle_parallel(benchmark::State& state)
+{
+    auto values = make_sequence(static_cast<size_t>(state.range(0)));
+    uint64_t seed = 42;
+    for (auto _ : state)
+    {
+        ct::shuffleParallel(values.begin(), values.end(), seed++);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+    EXPECT_TRUE(is_permutation_of_sequence(values));
+}
+
+static void
+benchmark_random_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        // Reference outputs: xoshiro256** from the state 1, 2, 3, 4 and pcg64(42, 54) of pcg-cpp.
+        auto xoshiro = ct::Xoshiro256StarStar::fromState(1, 2, 3, 4);
+        EXPECT_EQ(xoshiro(), 11520u);
+        EXPECT_EQ(xoshiro(), 0u);
+        EXPECT_EQ(xoshiro(), 1509978240u);
+        EXPECT_EQ(xoshiro(), 1215971899390074240u);
+
+        ct::Pcg64 pcg(42, 54);
+        EXPECT_EQ(pcg(), 0x86b1da1d72062b68u);
+        EXPECT_EQ(pcg(), 0x1304aa46c9853d39u);
+        EXPECT_EQ(pcg(), 0xa3670e9e0dd50358u);
+
+        // advance(n) is n calls.
+        ct::Pcg64 stepped(7);
+        ct::Pcg64 advanced(7);
+        for (int i = 0; i < 1000; i++)
+            stepped();
+        advanced.advance(1000);
+        EXPECT_EQ(stepped(), advanced());
+
+        // Lane i of the SIMD generator is the scalar generator after i jumps, however the output is requested.
+        ct::SimdXoshiro256StarStar simd(5);
+        std::vector<uint64_t> batch(3 * 8 + 5);
+        simd.fill(batch.data(), 3);
+        simd.fill(batch.data() + 3, 1);
+        batch[4] = simd();
+        simd.fill(batch.data() + 5, batch.size() - 5);
+        ct::SimdXoshiro256StarStar whole(5);
+        std::vector<uint64_t> reference(batch.size());
+        whole.fill(reference.data(), reference.size());
+        EXPECT_EQ(batch, reference);
+
+        ct::Xoshiro256StarStar lane(5);
+        lane.jump();
+        lane.jump();
+        EXPECT_EQ(reference[2], lane());
+        EXPECT_EQ(reference[10], lane());
+
+        // Same seed, same numbers, other seeds or streams other numbers.
+        EXPECT_EQ(ct::Xoshiro256StarStar(9)(), ct::Xoshiro256StarStar(9)());
+        EXPECT_NE(ct::Xoshiro256StarStar(9)(), ct::Xoshiro256StarStar(10)());
+        EXPECT_NE(ct::Xoshiro256StarStar(9, 0)(), ct::Xoshiro256StarStar(9, 1)());
+    }
+
+    // Bounded integers cover the range uniformly, 6 buckets of 60000 draws.
+    ct::Xoshiro256StarStar generator(1);
+    std::mt19937 generator32(1);
+    ct::SimdXoshiro256StarStar simd(1);
+    std::vector<uint32_t> simdValues(60000);
+    simd.fillBounded(simdValues.data(), simdValues.size(), 6);
+    size_t buckets[3][6] = {};
+    for (size_t i = 0; i < 60000; i++)
+    {
+        buckets[0][ct::boundedRandom32(generator, 6)]++;
+        buckets[1][ct::boundedRandom32(generator32, 6)]++;
+        buckets[2][simdValues[i]]++;
+    }
+    for (auto& bucket : buckets)
+    {
+        for (size_t count : bucket)
+            EXPECT_NEAR(static_cast<double>(count), 10000.0, 500.0);
+    }
+
+    EXPECT_EQ(ct::boundedRandom(generator, 1), 0u);
+    const uint64_t big = (uint64_t{ 1 } << 63) + 3;
+    EXPECT_LT(ct::boundedRandom(generator, big), big);
+    for (int i = 0; i < 100; i++)
+    {
+        const int value = ct::uniformInt(generator, -3, 3);
+        EXPECT_GE(value, -3);
+        EXPECT_LE(value, 3);
+    }
+    // Types narrower than int with negative bounds, every value is drawn.
+    std::vector<size_t> narrow(256, 0);
+    for (int i = 0; i < 10000; i++)
+    {
+        const int8_t tiny = ct::uniformInt<int8_t>(generator, -100, 27);
+        EXPECT_GE(tiny, -100);
+        EXPECT_LE(tiny, 27);
+        narrow[static_cast<size_t>(tiny + 128)]++;
+        const int16_t small = ct::uniformInt<int16_t>(generator, -30000, -29000);
+        EXPECT_GE(small, -30000);
+        EXPECT_LE(small, -29000);
+    }
+    EXPECT_EQ(std::count(narrow.begin(), narrow.end(), 0), 256 - 128);
+    ct::uniformInt<int8_t>(generator, std::numeric_limits<int8_t>::min(), std::numeric_limits<int8_t>::max());
+    ct::uniformInt(generator, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max());
+    const double real = ct::uniformReal(generator);
+    EXPECT_GE(real, 0.0);
+    EXPECT_LT(real, 1.0);
+
+    // A seed gives the same permutation on any number of threads.
+    auto serial = make_sequence(100000);
+    auto parallel = serial;
+    ct::shuffleParallel(serial.begin(), serial.end(), 3, 1, 1000);
+    ct::shuffleParallel(parallel.begin(), parallel.end(), 3, 4, 1000);
+    EXPECT_EQ(serial, parallel);
+    EXPECT_TRUE(is_permutation_of_sequence(serial));
+    EXPECT_NE(serial, make_sequence(100000));
+
+    // Every element lands everywhere, the first element of 3 after 30000 parallel shuffles.
+    size_t positions[3] = {};
+    for (uint64_t seed = 0; seed < 30000; seed++)
+    {
+        auto small = make_sequence(3);
+        ct::shuffleParallel(small.begin(), small.end(), seed, 1, 1);
+        positions[small[0]]++;
+    }
+    for (size_t count : positions)
+        EXPECT_NEAR(static_cast<double>(count), 10000.0, 500.0);
+
+    std::vector<int> empty;
+    ct::shuffleParallel(empty.begin(), empty.end(), 1);
+    ct::shuffle(empty.begin(), empty.end(), generator);
+}
+
+static void
+sizes(benchmark::internal::Benchmark* benchmark)
+{
+    for (int size : { 1 << 16, 1 << 20, 1 << 24 })
+        benchmark->Arg(size);
+}
+
+BENCHMARK_TEMPLATE(benchmark_generate, std::mt19937_64);
+BENCHMARK_TEMPLATE(benchmark_generate, ct::Xoshiro256StarStar);
+BENCHMARK_TEMPLATE(benchmark_generate, ct::Pcg64);
+BENCHMARK(benchmark_generate_simd);
+BENCHMARK(benchmark_bounded_mt19937);
+BENCHMARK_TEMPLATE(benchmark_bounded_lemire, ct::Xoshiro256StarStar);
+BENCHMARK_TEMPLATE(benchmark_bounded_lemire, ct::Pcg64);
+BENCHMARK(benchmark_bounded_simd);
+BENCHMARK(benchmark_std_shuffle)->Apply(sizes);
+BENCHMARK(benchmark_shuffle)->Apply(sizes);
+BENCHMARK(benchmark_shuffle_parallel)->Apply(sizes)->UseRealTime();
+BENCHMARK(benchmark_random_edge_cases)->Iterations(100);
+
+BENCHMARK_MAIN();
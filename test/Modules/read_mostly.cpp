@@ -0,0 +1,369 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+/*
+ Read-mostly publication (modules/ReadMostly)
+
+ constFunction() in LessonOne reads a shared TemplateClass from two threads, the class
+ comments weigh a mutex against an atomic. Seqlock publishes a small trivially copyable
+ value, RcuBox a value of any size, both without locks or shared stores on the read side.
+ Reader scaling against std::mutex and std::shared_mutex, thread 0 writes every 1024 reads.
+
+ run: ./test/read_mostly
+*/
+
+// C++ headers
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "RcuBox.hpp"
+#include "Seqlock.hpp"
+
+// The payload of TemplateClass<float>.
+struct Vector3
+{
+    float x;
+    float y;
+    float z;
+
+    float length() const { return std::sqrt(x * x + y * y + z * z); }
+};
+
+// Baselines with the read/store interface of RcuBox.
+template <typename T>
+class MutexBox
+{
+public:
+    explicit MutexBox(T _value) : value(std::move(_value)) {}
+
+    template <typename Read>
+    auto read(Read read) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return read(value);
+    }
+
+    void store(T _value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        value = std::move(_value);
+    }
+
+private:
+    mutable std::mutex mutex;
+    T value;
+};
+
+template <typename T>
+class SharedMutexBox
+{
+public:
+    explicit SharedMutexBox(T _value) : value(std::move(_value)) {}
+
+    template <typename Read>
+    auto read(Read read) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return read(value);
+    }
+
+    void store(T _value)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        value = std::move(_value);
+    }
+
+private:
+    mutable std::shared_mutex mutex;
+    T value;
+};
+
+template <typename T, typename Read>
+static auto
+read_box(const ct::Seqlock<T>& box, Read read)
+{
+    return read(box.load());
+}
+
+template <typename Box, typename Read>
+static auto
+read_box(const Box& box, Read read)
+{
+    return box.read(read);
+}
+
+constexpr uint64_t write_period = 1024;
+constexpr size_t point_count = 64;
+
+// Every vector written has length 3, a torn read would not.
+static Vector3
+vector_of_length_3(uint64_t i)
+{
+    const Vector3 vectors[3] = { { 1, 2, 2 }, { 2, 1, 2 }, { 2, 2, 1 } };
+    return vectors[i % 3];
+}
+
+static std::vector<Vector3>
+points_of_length_3(uint64_t i)
+{
+    std::vector<Vector3> points(point_count);
+    for (size_t p = 0; p < point_count; p++)
+        points[p] = vector_of_length_3(i + p);
+    return points;
+}
+
+template <typename Box>
+static void
+benchmark_read_vector(benchmark::State& state)
+{
+    static Box box(vector_of_length_3(0));
+
+    double total = 0;
+    uint64_t reads = 0;
+    for (auto _ : state)
+    {
+        total += read_box(box, [](const Vector3& vector) { return vector.length(); });
+        if (state.thread_index() == 0 && ++reads % write_period == 0)
+            box.store(vector_of_length_3(reads / write_period));
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    EXPECT_EQ(total, 3.0 * static_cast<double>(state.iterations()));
+}
+
+// One point of a vector, the object is too large to copy on every read.
+template <typename Box>
+static void
+benchmark_read_points(benchmark::State& state)
+{
+    static Box box(points_of_length_3(0));
+
+    double total = 0;
+    uint64_t reads = 0;
+    for (auto _ : state)
+    {
+        const size_t index = static_cast<size_t>(reads++ % point_count);
+        total += box.read([index](const std::vector<Vector3>& points) { return points[index].length(); });
+        if (state.thread_index() == 0 && reads % write_period == 0)
+            box.store(points_of_length_3(reads / write_period));
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    EXPECT_EQ(total, 3.0 * static_cast<double>(state.iterations()));
+}
+
+template <typename Box>
+static void
+benchmark_write_points(benchmark::State& state)
+{
+    Box box(points_of_length_3(0));
+    uint64_t writes = 0;
+    for (auto _ : state)
+        box.store(points_of_length_3(++writes));
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// Counts the live objects, RcuBox must free every replaced one exactly once.
+struct Tracked
+{
+    static std::atomic<int> alive;
+
+    explicit Tracked(int _value = 0) : value(_value) { alive++; }
+    Tracked(const Tracked& other) : value(other.value) { alive++; }
+    Tracked& operator=(const Tracked& other) = default;
+    ~Tracked() { alive--; }
+
+    int value;
+};
+
+std::atomic<int> Tracked::alive{ 0 };
+
+struct Wide
+{
+    uint64_t values[8];
+};
+
+// 13 bytes, not a multiple of the word size.
+struct Odd
+{
+    char text[13];
+};
+
+static void
+check_seqlock()
+{
+    ct::Seqlock<Vector3> vector;
+    EXPECT_EQ(vector.load().x, 0.0f);
+    EXPECT_EQ(vector.version(), 0u);
+    vector.store(Vector3{ 1, 2, 2 });
+    EXPECT_EQ(vector.load().length(), 3.0f);
+    vector.update([](Vector3& value) { value.z = -2; });
+    EXPECT_EQ(vector.load().z, -2.0f);
+    EXPECT_EQ(vector.version(), 2u);
+    Vector3 loaded{};
+    EXPECT_TRUE(vector.tryLoad(loaded));
+    EXPECT_EQ(loaded.y, 2.0f);
+
+    ct::Seqlock<Odd> odd(Odd{ "hello world!" });
+    EXPECT_STREQ(odd.load().text, "hello world!");
+
+    // A reader never sees a value half written.
+    ct::Seqlock<Wide> wide;
+    constexpr uint64_t writes = 20000;
+    std::thread writer([&wide]() {
+        for (uint64_t i = 1; i <= writes; i++)
+        {
+            Wide value;
+            for (uint64_t& word : value.values)
+                word = i;
+            wide.store(value);
+        }
+    });
+    bool consistent = true;
+    uint64_t last = 0;
+    while (last != writes)
+    {
+        const Wide value = wide.load();
+        for (uint64_t word : value.values)
+            consistent &= word == value.values[0];
+        consistent &= value.values[0] >= last;
+        last = value.values[0];
+    }
+    writer.join();
+    EXPECT_TRUE(consistent);
+
+    // Concurrent updates are serialized.
+    ct::Seqlock<uint64_t> counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; t++)
+        threads.emplace_back([&counter]() {
+            for (int i = 0; i < 1000; i++)
+                counter.update([](uint64_t& value) { value++; });
+        });
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(counter.load(), 2000u);
+}
+
+static void
+check_rcu_box()
+{
+    {
+        ct::RcuBox<Tracked> box(Tracked(1));
+        EXPECT_EQ(box.read([](const Tracked& value) { return value.value; }), 1);
+
+        {
+            // The snapshot keeps the replaced object alive.
+            auto snapshot = box.snapshot();
+            box.store(Tracked(2));
+            EXPECT_EQ(snapshot->value, 1);
+            EXPECT_EQ(box.retired(), 1u);
+            EXPECT_EQ(box.reclaim(), 1u);
+            // Read sections nest.
+            EXPECT_EQ(box.read([](const Tracked& value) { return value.value; }), 2);
+            EXPECT_EQ((*box.snapshot()).value, 2);
+        }
+        EXPECT_EQ(box.reclaim(), 0u);
+        EXPECT_EQ(Tracked::alive.load(), 1);
+
+        box.update([](Tracked& value) { value.value += 10; });
+        EXPECT_EQ(box.snapshot()->value, 12);
+        box.synchronize();
+        EXPECT_EQ(box.retired(), 0u);
+    }
+    EXPECT_EQ(Tracked::alive.load(), 0);
+
+    // Readers see whole vectors while a writer replaces them.
+    {
+        ct::RcuBox<std::vector<int>> box(std::vector<int>(256, 0));
+        std::atomic<bool> done{ false };
+        std::vector<std::thread> readers;
+        std::atomic<bool> consistent{ true };
+        for (int t = 0; t < 2; t++)
+            readers.emplace_back([&box, &done, &consistent]() {
+                while (!done.load())
+                {
+                    const bool same = box.read([](const std::vector<int>& values) {
+                        for (int value : values)
+                            if (value != values[0])
+                                return false;
+                        return true;
+                    });
+                    if (!same)
+                        consistent = false;
+                }
+            });
+        for (int i = 1; i <= 2000; i++)
+            box.update([](std::vector<int>& values) {
+                for (int& value : values)
+                    value++;
+            });
+        done = true;
+        for (auto& reader : readers)
+            reader.join();
+        EXPECT_TRUE(consistent.load());
+        EXPECT_EQ(box.snapshot()->front(), 2000);
+        box.synchronize();
+        EXPECT_EQ(box.retired(), 0u);
+    }
+
+    // Exited threads give their reader slot back.
+    ct::RcuBox<int> small(7);
+    int total = 0;
+    for (size_t t = 0; t < ct::rcu::maxReaders + 44; t++)
+    {
+        std::thread reader([&small, &total]() { total += small.read([](int value) { return value; }); });
+        reader.join();
+    }
+    EXPECT_EQ(total, 7 * static_cast<int>(ct::rcu::maxReaders + 44));
+}
+
+static void
+benchmark_read_mostly_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        check_seqlock();
+        check_rcu_box();
+    }
+}
+
+BENCHMARK_TEMPLATE(benchmark_read_vector, MutexBox<Vector3>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_read_vector, SharedMutexBox<Vector3>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_read_vector, ct::Seqlock<Vector3>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_read_vector, ct::RcuBox<Vector3>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_read_points, MutexBox<std::vector<Vector3>>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_read_points, SharedMutexBox<std::vector<Vector3>>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_read_points, ct::RcuBox<std::vector<Vector3>>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_write_points, MutexBox<std::vector<Vector3>>);
+BENCHMARK_TEMPLATE(benchmark_write_points, SharedMutexBox<std::vector<Vector3>>);
+BENCHMARK_TEMPLATE(benchmark_write_points, ct::RcuBox<std::vector<Vector3>>);
+BENCHMARK(benchmark_read_mostly_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,264 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Prefix sums (modules/Scan)
+
+ stl_algorithms covers iota, generate and accumulate, but no scan. std::partial_sum is one
+ dependent addition per element on one core. ct::inclusiveScan adds whole SIMD vectors with
+ an in register prefix, the parallel versions scan chunks on all cores in two passes.
+ Arguments: number of elements.
+
+ run: ./test/scan
+*/
+
+// C++ headers
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "Scan.hpp"
+
+// Lengths of variable length records, 1..64 bytes.
+template <typename T>
+static std::vector<T>
+make_lengths(size_t size)
+{
+    std::mt19937 generator(3);
+    std::uniform_int_distribution<int> distribution(1, 64);
+
+    std::vector<T> lengths(size);
+    for (auto& length : lengths)
+        length = static_cast<T>(distribution(generator));
+    return lengths;
+}
+
+// Exact for integers. The SIMD and parallel kernels reassociate floating point additions,
+// above 2^24 the float sums of both sides are rounded differently.
+template <typename T>
+static void
+expect_scan_eq(const std::vector<T>& actual, const std::vector<T>& expected)
+{
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            ASSERT_NEAR(actual[i], expected[i], std::abs(expected[i]) * (sizeof(T) == 4 ? 1e-4 : 1e-9)) << "index " << i;
+        else
+            ASSERT_EQ(actual[i], expected[i]) << "index " << i;
+    }
+}
+
+template <typename T>
+static void
+benchmark_partial_sum(benchmark::State& state)
+{
+    const std::vector<T> data = make_lengths<T>(state.range(0));
+    std::vector<T> out(data.size());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(std::partial_sum(data.begin(), data.end(), out.begin()));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size() * sizeof(T));
+}
+
+template <typename T>
+static void
+benchmark_inclusive_scan(benchmark::State& state)
+{
+    const std::vector<T> data = make_lengths<T>(state.range(0));
+    std::vector<T> out(data.size());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::inclusiveScan(data.data(), data.data() + data.size(), out.data()));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size() * sizeof(T));
+
+    std::vector<T> expected(data.size());
+    std::partial_sum(data.begin(), data.end(), expected.begin());
+    expect_scan_eq(out, expected);
+
+    // In place with init.
+    std::vector<T> v = data;
+    ct::inclusiveScan(v.data(), v.data() + v.size(), v.data(), T{ 10 });
+    for (auto& element : expected)
+        element += T{ 10 };
+    expect_scan_eq(v, expected);
+}
+
+template <typename T>
+static void
+benchmark_inclusive_scan_parallel(benchmark::State& state)
+{
+    const std::vector<T> data = make_lengths<T>(state.range(0));
+    std::vector<T> out(data.size());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::inclusiveScanParallel(data.data(), data.data() + data.size(), out.data()));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size() * sizeof(T));
+
+    std::vector<T> expected(data.size());
+    std::partial_sum(data.begin(), data.end(), expected.begin());
+    expect_scan_eq(out, expected);
+
+    // More threads than cores and chunks which do not end on a vector.
+    std::fill(out.begin(), out.end(), T{});
+    ct::inclusiveScanParallel(data.data(), data.data() + data.size(), out.data(), T{}, 7, 1001);
+    expect_scan_eq(out, expected);
+}
+
+// Record lengths to record offsets, the use case of exclusiveScan.
+template <typename T>
+static void
+benchmark_exclusive_scan_parallel(benchmark::State& state)
+{
+    const std::vector<T> lengths = make_lengths<T>(state.range(0));
+    std::vector<T> offsets(lengths.size());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::exclusiveScanParallel(lengths.data(), lengths.data() + lengths.size(), offsets.data()));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * lengths.size() * sizeof(T));
+
+    std::vector<T> expected(lengths.size());
+    std::exclusive_scan(lengths.begin(), lengths.end(), expected.begin(), T{ 100 });
+
+    ct::exclusiveScan(lengths.data(), lengths.data() + lengths.size(), offsets.data(), T{ 100 });
+    expect_scan_eq(offsets, expected);
+
+    std::fill(offsets.begin(), offsets.end(), T{});
+    ct::exclusiveScanParallel(lengths.data(), lengths.data() + lengths.size(), offsets.data(), T{ 100 }, 7, 1001);
+    expect_scan_eq(offsets, expected);
+}
+
+template <typename T>
+static void
+benchmark_segmented_scan(benchmark::State& state)
+{
+    const std::vector<T> data = make_lengths<T>(state.range(0));
+    std::vector<uint8_t> heads(data.size());
+    std::mt19937 generator(5);
+    for (auto& head : heads)
+        head = generator() % 16 == 0;
+
+    std::vector<T> out(data.size());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::segmentedScanParallel(data.data(), data.data() + data.size(), heads.data(), out.data()));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size() * sizeof(T));
+
+    std::vector<T> expected(data.size());
+    T carry{};
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        carry = heads[i] ? data[i] : carry + data[i];
+        expected[i] = carry;
+    }
+
+    expect_scan_eq(out, expected);
+    ct::segmentedScan(data.data(), data.data() + data.size(), heads.data(), out.data());
+    expect_scan_eq(out, expected);
+    ct::segmentedScanParallel(data.data(), data.data() + data.size(), heads.data(), out.data(), 7, 1001);
+    expect_scan_eq(out, expected);
+
+    // Chunks without heads carry over several chunks.
+    std::vector<uint8_t> sparse(data.size(), 0);
+    sparse[data.size() / 3] = 1;
+    ct::segmentedScanParallel(data.data(), data.data() + data.size(), sparse.data(), out.data(), 7, 1001);
+    EXPECT_EQ(out[data.size() / 3], data[data.size() / 3]);
+    EXPECT_EQ(out.back(), std::accumulate(data.begin() + data.size() / 3, data.end(), T{}));
+}
+
+static void
+benchmark_scan_edge_cases(benchmark::State& state)
+{
+    const std::vector<int> v{ 1, 2, 3, 4, 5 };
+    std::vector<int> out(v.size());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::inclusiveScan(v.data(), v.data() + v.size(), out.data()));
+    }
+
+    EXPECT_EQ(out, (std::vector<int>{ 1, 3, 6, 10, 15 }));
+    ct::exclusiveScan(v.data(), v.data() + v.size(), out.data());
+    EXPECT_EQ(out, (std::vector<int>{ 0, 1, 3, 6, 10 }));
+
+    const std::vector<uint8_t> heads{ 1, 0, 1, 0, 0 };
+    ct::segmentedScan(v.data(), v.data() + v.size(), heads.data(), out.data());
+    EXPECT_EQ(out, (std::vector<int>{ 1, 3, 3, 7, 12 }));
+
+    std::vector<double> empty;
+    EXPECT_EQ(ct::inclusiveScanParallel(empty.data(), empty.data(), empty.data()), empty.data());
+
+    // Small values next to a large one, the exclusive scan must not subtract.
+    const std::vector<float> floats{ 1.0f, 1e30f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+    std::vector<float> offsets(floats.size());
+    ct::exclusiveScan(floats.data(), floats.data() + floats.size(), offsets.data());
+    EXPECT_EQ(offsets[0], 0.0f);
+    EXPECT_EQ(offsets[1], 1.0f);
+}
+
+static void
+sizes(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->Arg(1 << 16)->Arg(1 << 22);
+}
+
+BENCHMARK_TEMPLATE(benchmark_partial_sum, int32_t)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_inclusive_scan, int32_t)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_inclusive_scan_parallel, int32_t)->Apply(sizes)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_partial_sum, int64_t)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_inclusive_scan, int64_t)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_inclusive_scan_parallel, int64_t)->Apply(sizes)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_partial_sum, float)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_inclusive_scan, float)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_inclusive_scan_parallel, float)->Apply(sizes)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_partial_sum, double)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_inclusive_scan, double)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_inclusive_scan_parallel, double)->Apply(sizes)->UseRealTime();
+
+BENCHMARK_TEMPLATE(benchmark_exclusive_scan_parallel, int64_t)->Apply(sizes)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_segmented_scan, int32_t)->Apply(sizes)->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_segmented_scan, double)->Apply(sizes)->UseRealTime();
+BENCHMARK(benchmark_scan_edge_cases)->Iterations(1000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,280 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Static search indexes for sorted lookups (modules/SearchIndex)
+
+ stl_algorithms searches sorted vectors with std::lower_bound and std::upper_bound,
+ binary search misses the cache on almost every probe of a large array.
+ EytzingerIndex stores the keys in BFS order and prefetches four levels ahead,
+ StaticBTree loads one cache line per level and compares 16 keys with SIMD.
+ Argument: number of keys, 1K to 16M (64 MiB of int32_t, 1B keys do not fit this machine).
+
+ run: ./test/search_index
+*/
+
+// C++ headers
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "EytzingerIndex.hpp"
+#include "StaticBTree.hpp"
+
+constexpr size_t query_count = 1 << 12;
+
+// Sorted keys with gaps, so half of the queries are not in the array.
+template <typename T>
+static std::vector<T>
+make_keys(size_t size)
+{
+    std::vector<T> keys(size);
+    for (size_t i = 0; i < size; i++)
+        keys[i] = static_cast<T>(2 * i + 1);
+    return keys;
+}
+
+template <typename T>
+static std::vector<T>
+make_queries(size_t size, size_t count)
+{
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<size_t> distribution(0, 2 * size + 1);
+    std::vector<T> queries(count);
+    for (auto& query : queries)
+        query = static_cast<T>(distribution(generator));
+    return queries;
+}
+
+template <typename T>
+static std::vector<size_t>
+reference_lower_bound(const std::vector<T>& keys, const std::vector<T>& queries)
+{
+    std::vector<size_t> positions;
+    for (const auto& query : queries)
+        positions.push_back(static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), query) - keys.begin()));
+    return positions;
+}
+
+static void
+benchmark_std_lower_bound(benchmark::State& state)
+{
+    const auto keys = make_keys<int32_t>(static_cast<size_t>(state.range(0)));
+    const auto queries = make_queries<int32_t>(keys.size(), query_count);
+
+    std::vector<size_t> positions(query_count);
+    for (auto _ : state)
+    {
+        for (size_t q = 0; q < query_count; q++)
+            positions[q] = static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), queries[q]) - keys.begin());
+        benchmark::DoNotOptimize(positions.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * query_count));
+    EXPECT_EQ(positions, reference_lower_bound(keys, queries));
+}
+
+template <typename Index>
+static void
+benchmark_index(benchmark::State& state)
+{
+    const auto keys = make_keys<int32_t>(static_cast<size_t>(state.range(0)));
+    const auto queries = make_queries<int32_t>(keys.size(), query_count);
+    const Index index(keys.begin(), keys.end());
+
+    std::vector<size_t> positions(query_count);
+    for (auto _ : state)
+    {
+        for (size_t q = 0; q < query_count; q++)
+            positions[q] = index.lowerBound(queries[q]);
+        benchmark::DoNotOptimize(positions.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * query_count));
+    EXPECT_EQ(positions, reference_lower_bound(keys, queries));
+}
+
+template <typename Index>
+static void
+benchmark_index_batch(benchmark::State& state)
+{
+    const auto keys = make_keys<int32_t>(static_cast<size_t>(state.range(0)));
+    const auto queries = make_queries<int32_t>(keys.size(), query_count);
+    const Index index(keys.begin(), keys.end());
+
+    std::vector<size_t> positions(query_count);
+    for (auto _ : state)
+    {
+        index.lowerBound(queries.data(), query_count, positions.data());
+        benchmark::DoNotOptimize(positions.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * query_count));
+    EXPECT_EQ(positions, reference_lower_bound(keys, queries));
+}
+
+// The sorting names of benchmark_sort_employees, "first.last".
+static std::vector<std::string>
+make_names(size_t size)
+{
+    std::vector<std::string> names(size);
+    for (size_t i = 0; i < size; i++)
+        names[i] = "first" + std::to_string(i * 7919 % size) + ".last" + std::to_string(i);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+static void
+benchmark_names_std_lower_bound(benchmark::State& state)
+{
+    const auto names = make_names(static_cast<size_t>(state.range(0)));
+    const auto queries = make_names(query_count);
+
+    size_t found = 0;
+    for (auto _ : state)
+    {
+        found = 0;
+        for (const auto& query : queries)
+            found += static_cast<size_t>(std::lower_bound(names.begin(), names.end(), query) - names.begin());
+        benchmark::DoNotOptimize(found);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * query_count));
+}
+
+static void
+benchmark_names_eytzinger(benchmark::State& state)
+{
+    const auto names = make_names(static_cast<size_t>(state.range(0)));
+    const auto queries = make_names(query_count);
+    const ct::EytzingerIndex<std::string> index(names.begin(), names.end());
+
+    std::vector<size_t> positions(query_count);
+    for (auto _ : state)
+    {
+        index.lowerBound(queries.data(), query_count, positions.data());
+        benchmark::DoNotOptimize(positions.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * query_count));
+    EXPECT_EQ(positions, reference_lower_bound(names, queries));
+}
+
+template <typename T, typename Index>
+static void
+check_index(const std::vector<T>& keys, const std::vector<T>& queries)
+{
+    const Index index(keys.begin(), keys.end());
+    EXPECT_EQ(index.size(), keys.size());
+
+    std::vector<size_t> batch(queries.size());
+    index.lowerBound(queries.data(), queries.size(), batch.data());
+    EXPECT_EQ(batch, reference_lower_bound(keys, queries));
+
+    std::vector<size_t> upper;
+    for (const auto& query : queries)
+    {
+        upper.push_back(static_cast<size_t>(std::upper_bound(keys.begin(), keys.end(), query) - keys.begin()));
+        EXPECT_EQ(index.lowerBound(query), static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), query) - keys.begin()));
+        EXPECT_EQ(index.upperBound(query), upper.back());
+    }
+    index.upperBound(queries.data(), queries.size(), batch.data());
+    EXPECT_EQ(batch, upper);
+}
+
+template <typename T>
+static void
+check_both(const std::vector<T>& keys, const std::vector<T>& queries)
+{
+    check_index<T, ct::EytzingerIndex<T>>(keys, queries);
+    check_index<T, ct::StaticBTree<T>>(keys, queries);
+}
+
+static void
+benchmark_search_index_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        // Every size around the node and level boundaries, duplicates and keys outside the range.
+        for (size_t size : { 0, 1, 2, 3, 15, 16, 17, 31, 33, 255, 272, 289, 1000 })
+        {
+            std::vector<int32_t> keys;
+            for (size_t i = 0; i < size; i++)
+                keys.push_back(static_cast<int32_t>(i / 3) * 2);
+            std::vector<int32_t> queries;
+            for (int32_t q = -2; q < static_cast<int32_t>(size) + 2; q++)
+                queries.push_back(q);
+            check_both(keys, queries);
+        }
+    }
+
+    // The extremes of the key type are keys and queries, they collide with the padding.
+    const int32_t min = std::numeric_limits<int32_t>::min();
+    const int32_t max = std::numeric_limits<int32_t>::max();
+    std::vector<int32_t> extremes{ min, min, -1, 0, 1, max, max };
+    extremes.insert(extremes.begin() + 3, 20, 0);
+    check_both(extremes, { min, -1, 0, 1, max - 1, max });
+
+    const auto keys64 = make_keys<int64_t>(5000);
+    check_both(keys64, make_queries<int64_t>(keys64.size(), 1000));
+    const auto keysFloat = make_keys<float>(5000);
+    check_both(keysFloat, make_queries<float>(keysFloat.size(), 1000));
+    const float infinity = std::numeric_limits<float>::infinity();
+    check_both<float>({ -infinity, 0.5f, 1.5f, infinity, infinity }, { -infinity, 0.0f, 1.5f, infinity });
+    const auto keysDouble = make_keys<double>(5000);
+    check_both(keysDouble, make_queries<double>(keysDouble.size(), 1000));
+    const auto keys16 = make_keys<uint16_t>(5000);
+    check_both(keys16, make_queries<uint16_t>(keys16.size(), 1000));
+
+    const auto names = make_names(3000);
+    check_index<std::string, ct::EytzingerIndex<std::string>>(names, make_names(100));
+
+    // Any strict weak ordering, here descending.
+    const std::vector<std::string> descending(names.rbegin(), names.rend());
+    const ct::EytzingerIndex<std::string, std::greater<std::string>> index(descending.begin(), descending.end());
+    EXPECT_EQ(index.lowerBound("zzz"), 0u);
+    EXPECT_EQ(index.lowerBound(""), descending.size());
+    EXPECT_EQ(index.lowerBound(descending[1234]), 1234u);
+    EXPECT_EQ(index.upperBound(descending[1234]), 1235u);
+}
+
+static void
+sizes(benchmark::internal::Benchmark* benchmark)
+{
+    for (int64_t size = 1 << 10; size <= 1 << 24; size *= 8)
+        benchmark->Arg(size);
+    benchmark->Arg(1 << 24);
+}
+
+BENCHMARK(benchmark_std_lower_bound)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_index, ct::EytzingerIndex<int32_t>)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_index_batch, ct::EytzingerIndex<int32_t>)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_index, ct::StaticBTree<int32_t>)->Apply(sizes);
+BENCHMARK_TEMPLATE(benchmark_index_batch, ct::StaticBTree<int32_t>)->Apply(sizes);
+BENCHMARK(benchmark_names_std_lower_bound)->Arg(1 << 16);
+BENCHMARK(benchmark_names_eytzinger)->Arg(1 << 16);
+BENCHMARK(benchmark_search_index_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,324 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+/*
+ Spatial index (modules/Spatial)
+
+ TemplateClass points, nearest neighbour and radius queries. Brute force scans every
+ point, KdTree prunes subtrees by their bounding boxes and scans SoA leaves with AVX2,
+ UniformGrid hashes cells for points which move. Argument: points, 10K to 10M uniform
+ in the unit cube, k = 8, the radius holds 32 points on average.
+
+ run: ./test/spatial
+*/
+
+// C++ headers
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "BruteForce.hpp"
+#include "KdTree.hpp"
+#include "Random.hpp"
+#include "UniformGrid.hpp"
+
+using ct::spatial::Neighbor;
+using ct::spatial::Point3;
+
+constexpr size_t neighbors_k = 8;
+constexpr size_t query_count = 1024;
+constexpr double average_within = 32;
+
+static std::vector<Point3>
+random_points(size_t count, uint64_t seed)
+{
+    ct::Xoshiro256StarStar generator(seed);
+    std::vector<Point3> points(count);
+    for (Point3& point : points)
+    {
+        point.x = static_cast<float>(ct::uniformReal(generator));
+        point.y = static_cast<float>(ct::uniformReal(generator));
+        point.z = static_cast<float>(ct::uniformReal(generator));
+    }
+    return points;
+}
+
+// Radius of a sphere which holds 'average' of 'count' uniform points of the unit cube.
+static float
+radius_for(size_t count, double average)
+{
+    return static_cast<float>(std::cbrt(3.0 * average / (4.0 * M_PI * static_cast<double>(count))));
+}
+
+static const std::vector<Point3>&
+cloud(size_t count)
+{
+    static std::map<size_t, std::vector<Point3>> clouds;
+    auto& points = clouds[count];
+    if (points.empty())
+        points = random_points(count, count);
+    return points;
+}
+
+static const std::vector<Point3>&
+queries()
+{
+    static const std::vector<Point3> points = random_points(query_count, 1);
+    return points;
+}
+
+template <typename Index>
+static std::unique_ptr<Index>
+make_index(const std::vector<Point3>& points)
+{
+    return std::make_unique<Index>(points);
+}
+
+template <>
+std::unique_ptr<ct::spatial::UniformGrid>
+make_index<ct::spatial::UniformGrid>(const std::vector<Point3>& points)
+{
+    auto grid = std::make_unique<ct::spatial::UniformGrid>(radius_for(points.size(), average_within));
+    for (size_t i = 0; i < points.size(); i++)
+        grid->insert(static_cast<uint32_t>(i), points[i]);
+    return grid;
+}
+
+// Built once per size, the benchmarks of one index share it.
+template <typename Index>
+static const Index&
+index_for(size_t count)
+{
+    static std::map<size_t, std::unique_ptr<Index>> indexes;
+    auto& index = indexes[count];
+    if (!index)
+        index = make_index<Index>(cloud(count));
+    return *index;
+}
+
+template <typename Index>
+static void
+benchmark_nearest(benchmark::State& state)
+{
+    const size_t count = static_cast<size_t>(state.range(0));
+    const Index& index = index_for<Index>(count);
+    const std::vector<Point3>& points = queries();
+
+    size_t q = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(index.nearest(points[q++ % query_count], neighbors_k).data());
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template <typename Index>
+static void
+benchmark_within(benchmark::State& state)
+{
+    const size_t count = static_cast<size_t>(state.range(0));
+    const Index& index = index_for<Index>(count);
+    const std::vector<Point3>& points = queries();
+    const float radius = radius_for(count, average_within);
+
+    size_t q = 0;
+    size_t found = 0;
+    for (auto _ : state)
+        found += index.within(points[q++ % query_count], radius).size();
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["found"] = static_cast<double>(found) / static_cast<double>(state.iterations());
+}
+
+// All queries at once in Z-order.
+static void
+benchmark_nearest_batch(benchmark::State& state)
+{
+    const size_t count = static_cast<size_t>(state.range(0));
+    const ct::spatial::KdTree& tree = index_for<ct::spatial::KdTree>(count);
+    const std::vector<Point3>& points = queries();
+    std::vector<Neighbor> out(query_count * neighbors_k);
+
+    for (auto _ : state)
+    {
+        tree.nearestBatch(points.data(), query_count, neighbors_k, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * query_count));
+}
+
+template <typename Index>
+static void
+benchmark_build(benchmark::State& state)
+{
+    const std::vector<Point3>& points = cloud(static_cast<size_t>(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(make_index<Index>(points).get());
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * points.size()));
+}
+
+// Every point takes a small step, most stay in their cell.
+static void
+benchmark_grid_move(benchmark::State& state)
+{
+    const std::vector<Point3>& start = cloud(static_cast<size_t>(state.range(0)));
+    auto grid = make_index<ct::spatial::UniformGrid>(start);
+    std::vector<Point3> points = start;
+    ct::Xoshiro256StarStar generator(7);
+
+    for (auto _ : state)
+    {
+        for (uint32_t i = 0; i < query_count; i++)
+        {
+            const uint32_t id = static_cast<uint32_t>(ct::boundedRandom(generator, points.size()));
+            points[id].x += static_cast<float>(ct::uniformReal(generator) - 0.5) * 1e-3f;
+            grid->move(id, points[id]);
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * query_count));
+}
+
+// Same distances in the same order, ids may differ between exact ties computed by different kernels.
+static void
+expect_same(const std::vector<Neighbor>& expected, const std::vector<Neighbor>& actual)
+{
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++)
+        EXPECT_NEAR(expected[i].distanceSquared, actual[i].distanceSquared, 1e-6f * (1.0f + expected[i].distanceSquared));
+}
+
+template <typename Index>
+static void
+check_against_brute_force(const Index& index, const ct::spatial::BruteForce& brute, const std::vector<Point3>& probes)
+{
+    for (const Point3& probe : probes)
+    {
+        for (size_t k : { size_t{ 1 }, size_t{ 8 }, size_t{ 50 } })
+            expect_same(brute.nearest(probe, k), index.nearest(probe, k));
+        for (float radius : { 0.0f, 0.02f, 0.1f, 0.5f })
+            expect_same(brute.within(probe, radius), index.within(probe, radius));
+    }
+}
+
+static void
+check_spatial()
+{
+    // Uniform points plus a dense cluster and exact duplicates.
+    std::vector<Point3> points = random_points(5000, 11);
+    for (size_t i = 0; i < 500; i++)
+        points.push_back(Point3{ 0.5f + 1e-4f * static_cast<float>(i % 7), 0.5f, 0.5f + 1e-4f * static_cast<float>(i % 3) });
+    for (size_t i = 0; i < 100; i++)
+        points.push_back(points[i]);
+
+    std::vector<Point3> probes = random_points(50, 12);
+    probes.push_back(Point3{ 0.5f, 0.5f, 0.5f });
+    probes.push_back(Point3{ 5.0f, -3.0f, 2.0f });
+    probes.push_back(points[42]);
+
+    const ct::spatial::BruteForce brute(points);
+    const ct::spatial::KdTree tree(points);
+    EXPECT_EQ(tree.size(), points.size());
+    check_against_brute_force(tree, brute, probes);
+
+    auto grid = make_index<ct::spatial::UniformGrid>(points);
+    EXPECT_EQ(grid->size(), points.size());
+    check_against_brute_force(*grid, brute, probes);
+
+    // A point's nearest neighbour is itself.
+    const std::vector<Neighbor> self = tree.nearest(points[4321], 1);
+    ASSERT_EQ(self.size(), 1u);
+    EXPECT_EQ(self[0].id, 4321u);
+    EXPECT_EQ(self[0].distanceSquared, 0.0f);
+
+    // Batches give the results of single queries.
+    std::vector<Neighbor> batch(probes.size() * 8);
+    tree.nearestBatch(probes.data(), probes.size(), 8, batch.data());
+    std::vector<size_t> offsets;
+    std::vector<Neighbor> within;
+    tree.withinBatch(probes.data(), probes.size(), 0.1f, offsets, within);
+    ASSERT_EQ(offsets.size(), probes.size() + 1);
+    for (size_t q = 0; q < probes.size(); q++)
+    {
+        EXPECT_EQ(tree.nearest(probes[q], 8), std::vector<Neighbor>(batch.begin() + q * 8, batch.begin() + q * 8 + 8));
+        EXPECT_EQ(tree.within(probes[q], 0.1f), std::vector<Neighbor>(within.begin() + offsets[q], within.begin() + offsets[q + 1]));
+    }
+
+    // Fewer points than k, empty indexes.
+    const std::vector<Point3> three(points.begin(), points.begin() + 3);
+    EXPECT_EQ(ct::spatial::KdTree(three).nearest(probes[0], 10).size(), 3u);
+    EXPECT_EQ(make_index<ct::spatial::UniformGrid>(three)->nearest(probes[0], 10).size(), 3u);
+    EXPECT_TRUE(ct::spatial::KdTree(std::vector<Point3>()).nearest(probes[0], 4).empty());
+    EXPECT_TRUE(ct::spatial::KdTree(std::vector<Point3>()).within(probes[0], 1.0f).empty());
+    EXPECT_TRUE(ct::spatial::UniformGrid(0.1f).nearest(probes[0], 4).empty());
+
+    // k = 0 gives no neighbours.
+    EXPECT_TRUE(tree.nearest(probes[0], 0).empty());
+    EXPECT_TRUE(brute.nearest(probes[0], 0).empty());
+    EXPECT_TRUE(grid->nearest(probes[0], 0).empty());
+    tree.nearestBatch(probes.data(), probes.size(), 0, batch.data());
+
+    // Moves and erases keep the grid equal to brute force over the current positions.
+    ct::Xoshiro256StarStar generator(13);
+    for (int step = 0; step < 3000; step++)
+    {
+        const uint32_t id = static_cast<uint32_t>(ct::boundedRandom(generator, points.size()));
+        points[id] = Point3{ static_cast<float>(ct::uniformReal(generator)), points[id].y, static_cast<float>(ct::uniformReal(generator)) };
+        grid->move(id, points[id]);
+    }
+    std::vector<Point3> remaining;
+    for (uint32_t id = 0; id < points.size(); id++)
+    {
+        if (id % 3 == 0)
+            EXPECT_TRUE(grid->erase(id));
+        else
+            remaining.push_back(points[id]);
+    }
+    EXPECT_FALSE(grid->erase(0));
+    EXPECT_EQ(grid->size(), remaining.size());
+    check_against_brute_force(*grid, ct::spatial::BruteForce(remaining), probes);
+}
+
+static void
+benchmark_spatial_edge_cases(benchmark::State& state)
+{
+    for (auto _ : state)
+        check_spatial();
+}
+
+BENCHMARK_TEMPLATE(benchmark_nearest, ct::spatial::BruteForce)->RangeMultiplier(10)->Range(10000, 10000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_nearest, ct::spatial::KdTree)->RangeMultiplier(10)->Range(10000, 10000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_nearest, ct::spatial::UniformGrid)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(benchmark_nearest_batch)->RangeMultiplier(10)->Range(10000, 10000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_within, ct::spatial::BruteForce)->RangeMultiplier(10)->Range(10000, 10000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_within, ct::spatial::KdTree)->RangeMultiplier(10)->Range(10000, 10000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_within, ct::spatial::UniformGrid)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmark_build, ct::spatial::KdTree)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(benchmark_build, ct::spatial::UniformGrid)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_grid_move)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(benchmark_spatial_edge_cases)->Iterations(10);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,366 @@
+/* Copyright (c) 2021-2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ Substring search (modules/StringSearch)
+
+ benchmark_find_string in stl_algorithms searches a 20 byte sentence. Here the haystack is a
+ generated log from KB to 64 MB, the needle is only at its end (find) or start (rfind).
+ ct::StringSearcher uses a SIMD first/last byte filter for short needles and Horspool
+ for long ones, ct::MultiStringSearcher finds many needles in one pass (Aho-Corasick).
+ Arguments: haystack bytes, needle length or number of needles.
+
+ Set CT_SEARCH_FILE to a large file (GB) to run benchmark_mapped_file on it, otherwise
+ a 64 MB temporary file is generated.
+
+ run: ./test/string_search
+*/
+
+// C++ headers
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// GTest headers
+#include <gtest/gtest.h>
+#include <benchmark/benchmark.h>
+
+// Library headers
+#include "MappedFile.hpp"
+#include "StringSearch.hpp"
+
+static const std::vector<std::string> levels{ "INFO", "DEBUG", "WARN", "TRACE" };
+static const std::vector<std::string> words{ "request", "worker", "session", "cache", "query", "socket", "thread", "timeout" };
+
+// Log lines without the needles below.
+static std::string
+make_log(size_t size, unsigned seed = 1)
+{
+    std::mt19937 generator(seed);
+    std::string log;
+    log.reserve(size + 128);
+    while (log.size() < size)
+    {
+        log += "2026-10-19T12:";
+        log += std::to_string(10 + generator() % 50) + ":" + std::to_string(10 + generator() % 50) + " ";
+        log += levels[generator() % levels.size()] + " ";
+        log += words[generator() % words.size()] + "-" + std::to_string(generator() % 100) + " ";
+        log += words[generator() % words.size()] + " " + std::to_string(generator() % 1000000) + " done in ";
+        log += std::to_string(generator() % 500) + " ms\n";
+    }
+    log.resize(size);
+    return log;
+}
+
+static std::string
+make_needle(size_t length)
+{
+    std::string needle = "ERROR disk full on /dev/sda1 while writing the journal of the database";
+    while (needle.size() < length)
+        needle += needle;
+    needle.resize(length);
+    return needle;
+}
+
+// The needle only at the end, every algorithm reads the whole haystack.
+static std::string
+make_haystack(size_t size, const std::string& needle)
+{
+    std::string haystack = make_log(size);
+    haystack.replace(haystack.size() - needle.size(), needle.size(), needle);
+    return haystack;
+}
+
+static void
+benchmark_string_view_find(benchmark::State& state)
+{
+    const std::string needle = make_needle(state.range(1));
+    const std::string haystack = make_haystack(state.range(0), needle);
+    const std::string_view view(haystack);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(view.find(needle));
+    }
+
+    state.SetBytesProcessed(state.iterations() * haystack.size());
+}
+
+static void
+benchmark_std_search(benchmark::State& state)
+{
+    const std::string needle = make_needle(state.range(1));
+    const std::string haystack = make_haystack(state.range(0), needle);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * haystack.size());
+}
+
+static void
+benchmark_std_boyer_moore_horspool(benchmark::State& state)
+{
+    const std::string needle = make_needle(state.range(1));
+    const std::string haystack = make_haystack(state.range(0), needle);
+    const std::boyer_moore_horspool_searcher searcher(needle.begin(), needle.end());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(std::search(haystack.begin(), haystack.end(), searcher));
+    }
+
+    state.SetBytesProcessed(state.iterations() * haystack.size());
+}
+
+static void
+benchmark_searcher_find(benchmark::State& state)
+{
+    const std::string needle = make_needle(state.range(1));
+    const std::string haystack = make_haystack(state.range(0), needle);
+    const ct::StringSearcher searcher(needle);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(searcher.find(haystack));
+    }
+
+    state.SetBytesProcessed(state.iterations() * haystack.size());
+    state.SetLabel(searcher.algorithm() == ct::StringSearcher::Algorithm::Horspool ? "horspool" : "simd filter");
+
+    EXPECT_EQ(searcher.find(haystack), haystack.size() - needle.size());
+    EXPECT_EQ(searcher.count(haystack), 1u);
+}
+
+// find_end: the needle only at the start, the search runs from the end.
+static void
+benchmark_std_find_end(benchmark::State& state)
+{
+    const std::string needle = make_needle(state.range(1));
+    std::string haystack = make_log(state.range(0));
+    haystack.replace(0, needle.size(), needle);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(std::find_end(haystack.begin(), haystack.end(), needle.begin(), needle.end()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * haystack.size());
+}
+
+static void
+benchmark_searcher_rfind(benchmark::State& state)
+{
+    const std::string needle = make_needle(state.range(1));
+    std::string haystack = make_log(state.range(0));
+    haystack.replace(0, needle.size(), needle);
+    const ct::StringSearcher searcher(needle);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(searcher.rfind(haystack));
+    }
+
+    state.SetBytesProcessed(state.iterations() * haystack.size());
+
+    EXPECT_EQ(searcher.rfind(haystack), 0u);
+    EXPECT_EQ(std::string_view(haystack).rfind(needle), 0u);
+}
+
+// Error patterns grepped in one pass over the log, random words after the first 16.
+static std::vector<std::string>
+make_patterns(size_t count)
+{
+    std::vector<std::string> patterns{
+        "ERROR", "FATAL", "panic", "segfault", "out of memory", "connection reset", "timed out", "refused",
+        "disk full", "corrupt", "deadlock", "assertion", "unreachable", "overflow", "denied", "killed"
+    };
+    std::mt19937 generator(13);
+    while (patterns.size() < count)
+    {
+        std::string word;
+        for (int i = 0; i < 8; i++)
+            word += static_cast<char>('a' + generator() % 26);
+        patterns.push_back(word);
+    }
+    patterns.resize(count);
+    return patterns;
+}
+
+static void
+benchmark_find_each_pattern(benchmark::State& state)
+{
+    std::string haystack = make_log(state.range(0));
+    haystack.replace(haystack.size() / 2, 9, "disk full");
+    std::vector<ct::StringSearcher> searchers;
+    for (const auto& pattern : make_patterns(state.range(1)))
+        searchers.emplace_back(pattern);
+
+    for (auto _ : state)
+    {
+        size_t total = 0;
+        for (const auto& searcher : searchers)
+            total += searcher.count(haystack);
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetBytesProcessed(state.iterations() * haystack.size());
+}
+
+// One pass whatever the number of patterns.
+static void
+benchmark_aho_corasick(benchmark::State& state)
+{
+    std::string haystack = make_log(state.range(0));
+    haystack.replace(haystack.size() / 2, 9, "disk full");
+    const std::vector<std::string> patterns = make_patterns(state.range(1));
+    const ct::MultiStringSearcher searcher(patterns);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(searcher.count(haystack));
+    }
+
+    state.SetBytesProcessed(state.iterations() * haystack.size());
+    state.counters["states"] = static_cast<double>(searcher.stateCount());
+
+    size_t expected = 0;
+    for (const auto& pattern : patterns)
+        expected += ct::StringSearcher(pattern).count(haystack);
+    EXPECT_EQ(searcher.count(haystack), expected);
+
+    const auto first = searcher.findFirst(haystack);
+    EXPECT_EQ(first.position, haystack.size() / 2);
+    EXPECT_EQ(patterns[first.needle], "disk full");
+}
+
+static void
+benchmark_mapped_file(benchmark::State& state)
+{
+    const char* configured = std::getenv("CT_SEARCH_FILE");
+    std::string path = configured != nullptr ? configured : "";
+    if (path.empty())
+    {
+        path = "string_search_haystack.log";
+        std::ofstream(path, std::ios::binary) << make_haystack(64 << 20, make_needle(16));
+    }
+
+    auto file = ct::MappedFile::create(path);
+    ASSERT_NE(file, nullptr);
+    const ct::StringSearcher searcher(make_needle(16));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(searcher.count(file->view()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * file->size());
+
+    if (configured == nullptr)
+    {
+        EXPECT_EQ(searcher.count(file->view()), 1u);
+        file.reset();
+        std::remove(path.c_str());
+    }
+
+    std::string error;
+    EXPECT_EQ(ct::MappedFile::create("/nonexistent/file", ct::MappedFile::Access::Sequential, &error), nullptr);
+    EXPECT_FALSE(error.empty());
+}
+
+static void
+benchmark_search_edge_cases(benchmark::State& state)
+{
+    const std::string haystack = make_log(4096, 9);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::findString(haystack, "timeout"));
+    }
+
+    // Every needle length and every position against std, blocks of the SIMD filter included.
+    std::mt19937 generator(11);
+    for (size_t length : { 1, 2, 3, 7, 16, 31, 32, 33, 64, 255, 256, 300 })
+    {
+        for (int repeat = 0; repeat < 20; repeat++)
+        {
+            const size_t size = length + generator() % 600;
+            const std::string text = make_log(size, generator());
+            const size_t start = generator() % (size - length + 1);
+            const std::string needle = text.substr(start, length);
+            const ct::StringSearcher searcher(needle);
+
+            ASSERT_EQ(searcher.find(text), std::string_view(text).find(needle)) << needle;
+            ASSERT_EQ(searcher.rfind(text), std::string_view(text).rfind(needle)) << needle;
+            ASSERT_EQ(searcher.find(text, start + 1), std::string_view(text).find(needle, start + 1)) << needle;
+        }
+    }
+
+    // Horspool on a repetitive alphabet, occurrences overlap.
+    const std::string a(1000, 'a');
+    const ct::StringSearcher as(std::string(ct::StringSearcher::horspoolMinLength(), 'a'));
+    const size_t last = a.size() - as.needle().size();
+    EXPECT_EQ(as.algorithm(), ct::StringSearcher::Algorithm::Horspool);
+    EXPECT_EQ(as.find(a), 0u);
+    EXPECT_EQ(as.rfind(a), last);
+    EXPECT_EQ(as.count(a), last + 1);
+
+    EXPECT_EQ(ct::findString("", "x"), std::string_view::npos);
+    EXPECT_EQ(ct::findString("abc", ""), 0u);
+    EXPECT_EQ(ct::findLastString("abc", ""), 3u);
+    EXPECT_EQ(ct::findString("abc", "abcd"), std::string_view::npos);
+    EXPECT_EQ(ct::findString("abc", "c", 5), std::string_view::npos);
+    EXPECT_EQ(ct::findLastString("Hello I am sentence.", "en"), 15u);
+
+    // Needles inside needles and overlapping matches.
+    const ct::MultiStringSearcher multi({ "he", "she", "his", "hers", "" });
+    std::vector<std::pair<size_t, size_t>> matches;
+    multi.forEach("ushers", [&matches](const ct::MultiStringSearcher::Match& match) { matches.emplace_back(match.position, match.needle); });
+    EXPECT_EQ(matches, (std::vector<std::pair<size_t, size_t>>{ { 1, 1 }, { 2, 0 }, { 2, 3 } }));
+    EXPECT_EQ(multi.findFirst("nothing").position, ct::MultiStringSearcher::npos);
+}
+
+static void
+haystacks(benchmark::internal::Benchmark* benchmark)
+{
+    for (int size : { 4 << 10, 1 << 20, 64 << 20 })
+    {
+        for (int length : { 5, 48, 512 })
+            benchmark->Args({ size, length });
+    }
+}
+
+BENCHMARK(benchmark_string_view_find)->Apply(haystacks);
+BENCHMARK(benchmark_std_search)->Apply(haystacks);
+BENCHMARK(benchmark_std_boyer_moore_horspool)->Apply(haystacks);
+BENCHMARK(benchmark_searcher_find)->Apply(haystacks);
+BENCHMARK(benchmark_std_find_end)->Apply(haystacks);
+BENCHMARK(benchmark_searcher_rfind)->Apply(haystacks);
+BENCHMARK(benchmark_find_each_pattern)->Args({ 1 << 20, 16 })->Args({ 1 << 20, 256 })->Args({ 64 << 20, 16 });
+BENCHMARK(benchmark_aho_corasick)->Args({ 1 << 20, 16 })->Args({ 1 << 20, 256 })->Args({ 64 << 20, 16 });
+BENCHMARK(benchmark_mapped_file)->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_search_edge_cases)->Iterations(100);
+
+BENCHMARK_MAIN();
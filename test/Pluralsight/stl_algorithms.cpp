@@ -39,6 +39,15 @@
 #include <gmock/gmock.h>
 #include <benchmark/benchmark.h>
 
+// Adds cycles, instructions, branch and cache misses to every benchmark (Linux perf_event_open).
+#include "BenchmarkPerfCounters.hpp"
+// Seeded xoshiro256** and Fisher-Yates with Lemire's bounded integers (modules/Random).
+#include "Shuffle.hpp"
+// SIMD equal, mismatch and three way compare of contiguous ranges (modules/Compare).
+#include "Compare.hpp"
+// Preallocated datasets copied back in place, setup cost reported apart (modules/BenchmarkFixture).
+#include "BenchmarkFixture.hpp"
+
 /* 
  The standard library has 3 major categories:
   - Collections: vector, map, etc. (containers)
@@ -112,10 +121,12 @@ benchmark_count_with_for(benchmark::State& state)
     const int targetValue = 2;
 
     // First do some benchmarks.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         benchmark::DoNotOptimize(count_custom(v, targetValue));
     }
+    perf.stop();
 
     auto result = count_custom(v, targetValue);
     EXPECT_EQ(result, 10);
@@ -128,11 +139,13 @@ benchmark_count_with_std(benchmark::State& state)
     const int targetValue = 2;
 
     // First do some benchmarks.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         // To use non member begin and end. It can work for C style arrays as well.
         benchmark::DoNotOptimize(std::count(std::begin(v), std::end(v), targetValue));
     }
+    perf.stop();
 
     auto result = std::count(std::begin(v), std::end(v), targetValue);
     EXPECT_EQ(result, 10);
@@ -159,10 +172,12 @@ benchmark_odd_for(benchmark::State& state)
     std::vector<int> v = findData;
 
     // First do some benchmarks.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         benchmark::DoNotOptimize(count_if_custom(v));
     }
+    perf.stop();
 
     auto result = count_if_custom(v);
     EXPECT_EQ(result, 240);
@@ -175,10 +190,12 @@ benchmark_odd_std_member(benchmark::State& state)
     std::vector<int> v = findData;
 
     // First do some benchmarks.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         benchmark::DoNotOptimize(std::count_if(v.begin(), v.end(), [](const auto& element) { return element % 2 != 0; }));
     }
+    perf.stop();
 
     auto result = std::count_if(v.begin(), v.end(), [](const auto& element) { return element % 2 != 0; });
     EXPECT_EQ(result, 240);
@@ -195,10 +212,12 @@ benchmark_find_number(benchmark::State& state)
     const int findMe = 5;
 
     // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         benchmark::DoNotOptimize(std::find(v.begin(), v.end(), 5));
     }
+    perf.stop();
 
     // Find the first number.
     auto result = std::find(v.begin(), v.end(), findMe);
@@ -255,10 +274,12 @@ benchmark_find_string(benchmark::State& state)
     const char findMe = 'a';
 
     // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         benchmark::DoNotOptimize(std::find(s.begin(), s.end(), 'a'));
     }
+    perf.stop();
 
     auto result = std::find(s.begin(), s.end(), findMe);
     EXPECT_NE(result, s.end());
@@ -341,12 +362,14 @@ benchmark_sort_numbers(benchmark::State& state)
     std::vector<int> v = sortData;
 
     // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         std::sort(std::begin(v), std::end(v));
         EXPECT_EQ(*std::begin(v), -49);
         EXPECT_EQ(*(std::end(v) - 1), 39);
     }
+    perf.stop();
 
     // Check if it is sorted
     auto isSorted = std::is_sorted(std::begin(v), std::end(v));
@@ -377,12 +400,16 @@ benchmark_sort_numbers(benchmark::State& state)
 }
 
 // Sort employees from Employee struct.
+// Compare the perf counters with benchmark_sort_numbers: getSortingName() allocates a new string
+// on every comparison (instructions, page faults), Employee is larger than int (cache misses)
+// and comparing strings is data dependent (branch misses).
 static void
 benchmark_sort_employees(benchmark::State& state)
 {
     std::vector<Employee> v = staff;
 
     // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         std::sort(std::begin(v), std::end(v),
@@ -390,6 +417,7 @@ benchmark_sort_employees(benchmark::State& state)
         EXPECT_EQ(std::begin(v)->getSalary(), 1008);
         EXPECT_EQ((std::end(v) - 1)->getSalary(), 1000);
     }
+    perf.stop();
 
     std::sort(std::begin(v), std::end(v),
               [](const auto& e1, const auto& e2) { return e1.getSortingName() < e2.getSortingName(); });
@@ -416,14 +444,17 @@ benchmark_shuffle_numbers(benchmark::State& state)
 {
     std::vector<int> v = sortData;
 
-    std::random_device randomDevice;
-    std::mt19937 generator(randomDevice());
+    // A fixed seed makes every run shuffle the same way. std::shuffle with std::mt19937 gives
+    // other permutations with other standard libraries and spends its time in the distribution.
+    ct::Xoshiro256StarStar generator(42);
 
     // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
-        std::shuffle(std::begin(v), std::end(v), generator);
+        ct::shuffle(std::begin(v), std::end(v), generator);
     }
+    perf.stop();
 
     // To print uncomment here.
     // std::copy(v.begin(), v.end(), std::ostream_iterator<int>(std::cout, " "));
@@ -460,14 +491,23 @@ static void
 benchmark_nth_element(benchmark::State& state)
 {
     // First do some benchmarks. Change value to see how time changes.
+    // The fixture restores sortData without allocating, a vector copy would cost more than nth_element.
+    ct::BenchmarkFixture<int> data(state, sortData);
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
-        std::vector<int> v = sortData;
+        std::vector<int>& v = data.reset();
         auto m = v.begin() + v.size() / 2;
-        EXPECT_EQ(v[v.size() / 2], -40);
         std::nth_element(v.begin(), m, v.end());
-        benchmark::DoNotOptimize(v);
+        benchmark::DoNotOptimize(v.data());
     }
+    perf.stop();
+    data.stop();
+
+    std::vector<int>& v = data.reset();
+    EXPECT_EQ(v[v.size() / 2], -40);
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    EXPECT_TRUE(std::all_of(v.begin(), v.begin() + v.size() / 2, [&v](int i) { return i <= v[v.size() / 2]; }));
 }
 
 // == Comparing and Accumulating (equal(), mismatch()) ==
@@ -491,10 +531,12 @@ benchmark_comparing_elements(benchmark::State& state)
     std::vector<int> vB = compareDataB;
 
     // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         benchmark::DoNotOptimize(std::equal(std::begin(vA), std::end(vA), std::begin(vB), std::end(vB)));
     }
+    perf.stop();
 
     bool same = std::equal(std::begin(vA), std::end(vA), std::begin(vB), std::end(vB));
     EXPECT_FALSE(same);
@@ -505,6 +547,30 @@ benchmark_comparing_elements(benchmark::State& state)
 
     auto distance = firstChange.first - std::begin(vA);
     EXPECT_EQ(distance, 1);
+
+    // The same with the SIMD kernels, vectors of ints compare their bytes.
+    EXPECT_FALSE(ct::equal(vA, vB));
+    EXPECT_EQ(ct::mismatchIndex(vA, vB), 1u);
+    EXPECT_EQ(ct::lexicographicCompare(vA, vB), 1);
+    EXPECT_EQ(ct::lexicographicCompare(vA, vA), 0);
+}
+
+// The same comparison with ct::equal (modules/Compare), memcmp for trivially comparable types.
+static void
+benchmark_comparing_elements_simd(benchmark::State& state)
+{
+    std::vector<int> vA = compareDataA;
+    std::vector<int> vB = compareDataB;
+
+    ct::BenchmarkPerfCounters perf(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ct::equal(vA, vB));
+    }
+    perf.stop();
+
+    EXPECT_FALSE(ct::equal(vA, vB));
+    EXPECT_TRUE(ct::equal(vA, vA));
 }
 
 static std::vector<int> accumulateData = {
@@ -521,10 +587,12 @@ benchmark_total_elements(benchmark::State& state)
     std::vector<int> v = accumulateData;
 
     // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         benchmark::DoNotOptimize(std::accumulate(std::begin(v), std::end(v), 0));
     }
+    perf.stop();
 
     auto sum = std::accumulate(std::begin(v), std::end(v), 0);
     EXPECT_EQ(sum, 181);
@@ -541,11 +609,18 @@ benchmark_total_elements(benchmark::State& state)
 }
 
 static void
-benchmark_for_each_iterators(benchmark::State& /* state */)
+benchmark_for_each_iterators(benchmark::State& state)
 {
     std::vector<int> v = accumulateData;
 
     // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
+    for (auto _ : state)
+    {
+        std::for_each(v.begin(), v.end(), [](int& element) { element = 2; });
+        benchmark::DoNotOptimize(v.data());
+    }
+    perf.stop();
 
     for (auto it = std::begin(v); it != std::end(v); it++)
     {
@@ -596,6 +671,7 @@ benchmark_copy_elements(benchmark::State& state)
     std::vector<int> v = copyData;
 
     // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         std::vector<int> v2(v.size());
@@ -603,6 +679,7 @@ benchmark_copy_elements(benchmark::State& state)
         EXPECT_EQ(*std::begin(v), *std::begin(v2));
         // It is basically teh same as std::vector<int> v2 = v;
     }
+    perf.stop();
 
     // Find element and copy until you reach the end iterator.
     std::vector<int> v3(v.size());
@@ -648,12 +725,14 @@ benchmark_remove_elements(benchmark::State& state)
 {
     std::vector<int> v = removeData;
 
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
         std::vector<int> v2 = copyData;
         benchmark::DoNotOptimize(std::remove(std::begin(v), std::end(v), -40));
         EXPECT_EQ(v2.size(), copyData.size());
     }
+    perf.stop();
 
     // Remove elements with specific value.
     auto newEndIter = std::remove(std::begin(v), std::end(v), 30);
@@ -677,10 +756,19 @@ benchmark_remove_elements(benchmark::State& state)
 // = Creating and Filling Collections (fill(), fill_n(), iota(), generate(), generate_n())
 
 static void
-benchmark_create_fill_collections(benchmark::State& /* state */)
+benchmark_create_fill_collections(benchmark::State& state)
 {
     std::vector<int> v(400);
 
+    // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
+    for (auto _ : state)
+    {
+        std::iota(std::begin(v), std::end(v), 1);
+        benchmark::DoNotOptimize(v.data());
+    }
+    perf.stop();
+
     // Fill vector with 1
     std::fill(std::begin(v), std::end(v), 1);
     EXPECT_EQ(*std::begin(v), 1);
@@ -718,10 +806,19 @@ static std::vector<int> transformData = {
 };
 
 static void
-benchmark_replace_tranform_values(benchmark::State& /* state */)
+benchmark_replace_tranform_values(benchmark::State& state)
 {
     std::vector<int> v = copyData;
 
+    // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
+    for (auto _ : state)
+    {
+        std::replace(std::begin(v), std::end(v), 30, 0);
+        benchmark::DoNotOptimize(v.data());
+    }
+    perf.stop();
+
     // Replace all values 30 with 0
     std::replace(std::begin(v), std::end(v), 30, 0);
     auto result = std::find(v.begin(), v.end(), 30);
@@ -768,10 +865,12 @@ static std::vector<int> duplicatesData = {
 static void
 benchmark_eliminate_duplicates(benchmark::State& state)
 {
-    // Benchmark
+    // Benchmark, the fixture restores copyData into the same buffer in every iteration.
+    ct::BenchmarkFixture<int> data(state, copyData);
+    ct::BenchmarkPerfCounters perf(state);
     for (auto _ : state)
     {
-        std::vector<int> v2 = copyData;
+        std::vector<int>& v2 = data.reset();
 
         // First sort data to put consecutive together.
         std::sort(std::begin(v2), std::end(v2));
@@ -781,6 +880,8 @@ benchmark_eliminate_duplicates(benchmark::State& state)
         benchmark::DoNotOptimize(last);
         benchmark::DoNotOptimize(v2.erase(last, v2.end()));
     }
+    perf.stop();
+    data.stop();
 
     std::vector<int> v = copyData;
 
@@ -806,10 +907,20 @@ benchmark_eliminate_duplicates(benchmark::State& state)
 static const std::string sentence = "Hello, world.";
 
 static void
-benchmark_reverse_elements(benchmark::State& /* state */)
+benchmark_reverse_elements(benchmark::State& state)
 {
     std::string s = sentence;
 
+    // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
+    for (auto _ : state)
+    {
+        std::reverse(std::begin(s), std::end(s));
+        benchmark::DoNotOptimize(s.data());
+    }
+    perf.stop();
+    s = sentence;
+
     // Reverse the string. Easy !!!
     std::reverse(std::begin(s), std::end(s));
     EXPECT_EQ(s, ".dlrow ,olleH");
@@ -828,11 +939,22 @@ benchmark_reverse_elements(benchmark::State& /* state */)
 // Inserting iterators (back_inserter, front_inserter)
 
 static void
-benchmark_insert_elements(benchmark::State& /* state */)
+benchmark_insert_elements(benchmark::State& state)
 {
     // We have empty vector now.
     std::vector<int> v;
 
+    // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
+    for (auto _ : state)
+    {
+        v.clear();
+        std::fill_n(std::back_inserter(v), 200, 2);
+        benchmark::DoNotOptimize(v.data());
+    }
+    perf.stop();
+    v.clear();
+
     // Fill first 200 elements with 2
     std::fill_n(std::back_inserter(v), 200, 2);
     EXPECT_EQ(*(std::begin(v)), 2);
@@ -878,10 +1000,20 @@ static const std::vector<int> rotateData = {
 };
 
 static void
-benchmark_rotate_elements(benchmark::State& /* state */)
+benchmark_rotate_elements(benchmark::State& state)
 {
     std::vector<int> v = rotateData;
 
+    // First do some benchmarks. Change value to see how time changes.
+    ct::BenchmarkPerfCounters perf(state);
+    for (auto _ : state)
+    {
+        std::rotate(v.begin(), v.begin() + 1, v.end());
+        benchmark::DoNotOptimize(v.data());
+    }
+    perf.stop();
+    v = rotateData;
+
     // Find elements and move it on a diffrent position.
     // The beginning of the original range;
     auto elIt1 = std::find(v.begin(), v.end(), 2);
@@ -922,6 +1054,7 @@ BENCHMARK(benchmark_shuffle_numbers)->Iterations(iterations);
 BENCHMARK(benchmark_nth_element)->Iterations(iterations);
 
 BENCHMARK(benchmark_comparing_elements)->Iterations(iterations);
+BENCHMARK(benchmark_comparing_elements_simd)->Iterations(iterations);
 BENCHMARK(benchmark_total_elements)->Iterations(iterations);
 BENCHMARK(benchmark_for_each_iterators)->Iterations(iterations);
 
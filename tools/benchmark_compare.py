@@ -0,0 +1,272 @@
+#!/usr/bin/env python3
+"""
+Benchmark regression gate for Google Benchmark executables.
+
+Runs a benchmark with JSON output (--benchmark_out_format=json) and repetitions, summarizes every
+benchmark as the median of the repetitions with a confidence interval and compares
+it with a committed baseline. Only the Python standard library is used.
+
+usage:
+  benchmark_compare.py run     --binary <exe> [--out <summary.json>]
+  benchmark_compare.py update  --binary <exe> --baseline <baseline.json>
+  benchmark_compare.py check   --binary <exe> --baseline <baseline.json> [--threshold 0.10]
+  benchmark_compare.py compare --baseline <baseline.json> --current <summary.json>
+
+Common options:
+  --repetitions N   repetitions of every benchmark, default 5
+  --cpu N|auto|none pin the benchmark to one CPU, default auto (last allowed CPU)
+  --metric M        cpu_time or real_time, default cpu_time
+  --filter REGEX    passed to --benchmark_filter
+  --interleave      pass --benchmark_enable_random_interleaving=true
+
+A benchmark regresses when its median is slower than the baseline median by more
+than the threshold and the confidence intervals of both runs do not overlap.
+Baselines from another host, CPU count, benchmark library build type or metric are not
+compared, check and compare exit with 77 (skipped) and ask for a new baseline.
+"""
+
+import argparse
+import datetime
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+SUMMARY_VERSION = 1
+
+# ctest reports the test as skipped (SKIP_RETURN_CODE) when there is no baseline yet
+# or the baseline was recorded on another machine.
+EXIT_NO_BASELINE = 77
+
+# Context fields which must match, timings from another machine or build say nothing.
+MATCHING_CONTEXT = ("host_name", "num_cpus", "library_build_type")
+
+TO_NANOSECONDS = { "ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9 }
+
+
+def median(values):
+    values = sorted(values)
+    middle = len(values) // 2
+    if len(values) % 2:
+        return values[middle]
+    return (values[middle - 1] + values[middle]) / 2.0
+
+
+def median_confidence_interval(values, confidence):
+    """Distribution free interval of the median from order statistics.
+
+    [x(j), x(n-1-j)] covers the median with probability sum C(n, i) / 2^n
+    for i in (j, n - j). The narrowest interval with the requested coverage is
+    returned; with few repetitions it falls back to [min, max].
+    """
+    values = sorted(values)
+    n = len(values)
+    best = 0
+    for j in range(0, n // 2):
+        coverage = sum(math.comb(n, i) for i in range(j + 1, n - j)) / 2.0 ** n
+        if coverage < confidence:
+            break
+        best = j
+    return values[best], values[n - 1 - best]
+
+
+def pick_cpu(option):
+    if option == "none" or not hasattr(os, "sched_getaffinity"):
+        return None
+    if option == "auto":
+        # The last CPU is usually the least busy one on shared machines.
+        return max(os.sched_getaffinity(0))
+    return int(option)
+
+
+def run_benchmark(args):
+    # JSON goes to a file, tests in the benchmark bodies print their failures to stdout.
+    with tempfile.TemporaryDirectory() as directory:
+        out = os.path.join(directory, "benchmark.json")
+        command = [
+            args.binary,
+            "--benchmark_out=%s" % out,
+            "--benchmark_out_format=json",
+            "--benchmark_repetitions=%d" % args.repetitions,
+            "--benchmark_report_aggregates_only=false",
+        ]
+        if args.filter:
+            command.append("--benchmark_filter=%s" % args.filter)
+        if args.interleave:
+            command.append("--benchmark_enable_random_interleaving=true")
+
+        cpu = pick_cpu(args.cpu)
+        preexec = (lambda: os.sched_setaffinity(0, { cpu })) if cpu is not None else None
+
+        print("running: %s%s" % (" ".join(command), " (cpu %d)" % cpu if cpu is not None else ""), file=sys.stderr)
+        result = subprocess.run(command, stdout=sys.stderr, preexec_fn=preexec)
+        if result.returncode != 0:
+            raise SystemExit("benchmark failed with exit code %d" % result.returncode)
+
+        with open(out) as f:
+            return json.load(f)
+
+
+def summarize(raw, metric, confidence):
+    samples = {}
+    for entry in raw.get("benchmarks", []):
+        if entry.get("run_type", "iteration") != "iteration" or entry.get("error_occurred"):
+            continue
+        name = entry.get("run_name", entry["name"])
+        scale = TO_NANOSECONDS[entry.get("time_unit", "ns")]
+        samples.setdefault(name, []).append(entry[metric] * scale)
+
+    benchmarks = {}
+    for name, values in samples.items():
+        low, high = median_confidence_interval(values, confidence)
+        benchmarks[name] = {
+            "median_ns": median(values),
+            "ci_low_ns": low,
+            "ci_high_ns": high,
+            "repetitions": len(values),
+        }
+
+    context = raw.get("context", {})
+    return {
+        "version": SUMMARY_VERSION,
+        "metric": metric,
+        "confidence": confidence,
+        "context": {
+            "date": datetime.datetime.now().isoformat(timespec="seconds"),
+            "host_name": context.get("host_name", ""),
+            "executable": os.path.basename(context.get("executable", "")),
+            "num_cpus": context.get("num_cpus", 0),
+            "mhz_per_cpu": context.get("mhz_per_cpu", 0),
+            "cpu_scaling_enabled": context.get("cpu_scaling_enabled", False),
+            "library_build_type": context.get("library_build_type", ""),
+        },
+        "benchmarks": benchmarks,
+    }
+
+
+def load_summary(path):
+    with open(path) as f:
+        summary = json.load(f)
+    if summary.get("version") != SUMMARY_VERSION:
+        raise SystemExit("%s: unsupported summary version" % path)
+    return summary
+
+
+def save_summary(summary, path):
+    with open(path, "w") as f:
+        json.dump(summary, f, indent=2, sort_keys=True)
+        f.write("\n")
+
+
+def mismatches(baseline, current):
+    """Differences which make the baseline useless for this run."""
+    result = []
+    for key in MATCHING_CONTEXT:
+        if baseline["context"].get(key) != current["context"].get(key):
+            result.append("%s differs from the baseline (%s vs %s)" % (key, baseline["context"].get(key), current["context"].get(key)))
+    if baseline.get("metric") != current.get("metric"):
+        result.append("baseline metric is %s, current is %s" % (baseline.get("metric"), current.get("metric")))
+    return result
+
+
+def compare(baseline, current, threshold):
+    """Prints the comparison, returns the number of regressions."""
+    if current["context"].get("cpu_scaling_enabled"):
+        print("warning: CPU frequency scaling is enabled, results are noisy")
+
+    regressions = 0
+    print("%-60s %12s %12s %8s  %s" % ("benchmark", "baseline[ns]", "current[ns]", "change", "status"))
+    for name, base in sorted(baseline["benchmarks"].items()):
+        cur = current["benchmarks"].get(name)
+        if cur is None:
+            print("%-60s %12.1f %12s %8s  missing" % (name, base["median_ns"], "-", "-"))
+            continue
+
+        change = cur["median_ns"] / base["median_ns"] - 1.0 if base["median_ns"] > 0 else 0.0
+        status = "ok"
+        if change > threshold:
+            # Within the noise when the confidence intervals overlap.
+            if cur["ci_low_ns"] > base["ci_high_ns"]:
+                status = "REGRESSION"
+                regressions += 1
+            else:
+                status = "noise"
+        elif change < -threshold and cur["ci_high_ns"] < base["ci_low_ns"]:
+            status = "improved"
+        print("%-60s %12.1f %12.1f %+7.1f%%  %s" % (name, base["median_ns"], cur["median_ns"], change * 100.0, status))
+
+    for name in sorted(set(current["benchmarks"]) - set(baseline["benchmarks"])):
+        print("%-60s %12s %12.1f %8s  new" % (name, "-", current["benchmarks"][name]["median_ns"], "-"))
+
+    print("%d regression(s) above %.0f%%" % (regressions, threshold * 100.0))
+    return regressions
+
+
+def exit_code(baseline, current, threshold, update_hint):
+    """0 without regressions, 1 with, EXIT_NO_BASELINE when the baseline is from another machine."""
+    problems = mismatches(baseline, current)
+    if problems:
+        for problem in problems:
+            print("skipped: %s" % problem)
+        print("the baseline is from another machine or build, create one for this machine with: %s" % update_hint)
+        return EXIT_NO_BASELINE
+    return 1 if compare(baseline, current, threshold) else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("command", choices=["run", "update", "check", "compare"])
+    parser.add_argument("--binary")
+    parser.add_argument("--baseline")
+    parser.add_argument("--current")
+    parser.add_argument("--out")
+    parser.add_argument("--threshold", type=float, default=0.10)
+    parser.add_argument("--confidence", type=float, default=0.95)
+    parser.add_argument("--repetitions", type=int, default=5)
+    parser.add_argument("--cpu", default="auto")
+    parser.add_argument("--metric", choices=["cpu_time", "real_time"], default="cpu_time")
+    parser.add_argument("--filter")
+    parser.add_argument("--interleave", action="store_true")
+    args = parser.parse_args()
+
+    if args.command == "compare":
+        if not args.baseline or not args.current:
+            parser.error("compare needs --baseline and --current")
+        return exit_code(load_summary(args.baseline), load_summary(args.current), args.threshold,
+                         "%s run --binary <exe> --out %s" % (sys.argv[0], args.baseline))
+
+    if not args.binary:
+        parser.error("%s needs --binary" % args.command)
+    if args.command in ("update", "check") and not args.baseline:
+        parser.error("%s needs --baseline" % args.command)
+    if args.command == "check" and not os.path.exists(args.baseline):
+        print("no baseline %s, create it with: %s update --binary %s --baseline %s" %
+              (args.baseline, sys.argv[0], args.binary, args.baseline))
+        return EXIT_NO_BASELINE
+
+    current = summarize(run_benchmark(args), args.metric, args.confidence)
+
+    if args.command == "run":
+        if args.out:
+            save_summary(current, args.out)
+        else:
+            json.dump(current, sys.stdout, indent=2, sort_keys=True)
+        return 0
+
+    if args.command == "update":
+        os.makedirs(os.path.dirname(os.path.abspath(args.baseline)), exist_ok=True)
+        save_summary(current, args.baseline)
+        print("baseline written: %s (%d benchmarks)" % (args.baseline, len(current["benchmarks"])))
+        return 0
+
+    if args.out:
+        save_summary(current, args.out)
+    return exit_code(load_summary(args.baseline), current, args.threshold,
+                     "cmake --build <build dir> --target benchmark_baseline_update (or %s_baseline_update)" %
+                     os.path.splitext(os.path.basename(args.baseline))[0])
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""
+Build time report per target.
+
+CMake runs every compile and link command through this script when
+CPPTRAINING_BUILD_TIME_REPORT is enabled (RULE_LAUNCH_COMPILE/RULE_LAUNCH_LINK).
+
+usage:
+  build_time.py record <log> -- <command...>   run the command and append its time to <log>
+  build_time.py report <log>                   print the times grouped by target
+"""
+
+import os
+import re
+import subprocess
+import sys
+import time
+
+# Object files are written to <binary dir>/CMakeFiles/<target>.dir/...
+TARGET_DIR = re.compile(r"CMakeFiles[/\\]([^/\\]+)\.dir[/\\]")
+
+
+def output_of(command):
+    for i, arg in enumerate(command):
+        if arg == "-o" and i + 1 < len(command):
+            return command[i + 1]
+        # MSVC cl.exe and link.exe
+        if arg.startswith("/Fo"):
+            return arg[3:]
+        if arg.lower().startswith("/out:"):
+            return arg[5:]
+    # Static libraries: ar qc lib<target>.a <objects...>
+    for arg in command[1:]:
+        if arg.endswith(".a") or arg.endswith(".lib"):
+            return arg
+    return ""
+
+
+def target_of(output):
+    match = TARGET_DIR.search(output)
+    if match:
+        return match.group(1), "compile"
+
+    # Linked binary: strip the platform prefix and suffix.
+    name = os.path.basename(output)
+    name = re.sub(r"\.(so|a|dll|lib|exe|dylib)(\.[0-9.]+)?$", "", name)
+    if name.startswith("lib"):
+        name = name[3:]
+    return name, "link"
+
+
+def record(log, command):
+    start = time.perf_counter()
+    result = subprocess.call(command)
+    seconds = time.perf_counter() - start
+
+    output = output_of(command)
+    target, kind = target_of(output)
+    # Short lines appended with O_APPEND are not interleaved by parallel jobs.
+    with open(log, "a") as f:
+        f.write("%s\t%s\t%.3f\t%s\n" % (target, kind, seconds, output))
+    return result
+
+
+def report(log):
+    if not os.path.exists(log):
+        print("No build times recorded yet: %s" % log)
+        return 0
+
+    targets = {}
+    with open(log) as f:
+        for line in f:
+            parts = line.rstrip("\n").split("\t")
+            if len(parts) != 4:
+                continue
+            target, kind, seconds, output = parts
+            entry = targets.setdefault(target, { "compile": 0.0, "link": 0.0, "units": 0, "slowest": ("", 0.0) })
+            entry[kind] += float(seconds)
+            if kind == "compile":
+                entry["units"] += 1
+                if float(seconds) > entry["slowest"][1]:
+                    entry["slowest"] = (os.path.basename(output), float(seconds))
+
+    rows = sorted(targets.items(), key=lambda item: item[1]["compile"] + item[1]["link"], reverse=True)
+    total = sum(entry["compile"] + entry["link"] for _, entry in rows)
+
+    print("%-28s %9s %9s %9s %6s  %s" % ("target", "total[s]", "compile", "link", "units", "slowest unit"))
+    for target, entry in rows:
+        slowest = "%s (%.2fs)" % entry["slowest"] if entry["units"] else "-"
+        print("%-28s %9.2f %9.2f %9.2f %6d  %s" % (target, entry["compile"] + entry["link"],
+                                                    entry["compile"], entry["link"], entry["units"], slowest))
+    print("%-28s %9.2f" % ("all targets", total))
+    return 0
+
+
+def main(argv):
+    if len(argv) >= 4 and argv[1] == "record" and argv[3] == "--":
+        return record(argv[2], argv[4:])
+    if len(argv) == 3 and argv[1] == "report":
+        return report(argv[2])
+    print(__doc__)
+    return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))